@@ -121,6 +121,8 @@ namespace Grl {
 		public static Grl.KeyID COMPOSER;
 		[CCode (cname ="GRL_METADATA_KEY_ALBUM_ARTIST")]
 		public static Grl.KeyID ALBUM_ARTIST;
+		[CCode (cname ="GRL_METADATA_KEY_CONTINUATION")]
+		public static Grl.KeyID CONTINUATION;
 
 		[CCode (cname ="GRL_METADATA_KEY_CHILDCOUNT_UNKNOWN")]
 		public static uint CHILDCOUNT_UNKNOWN;
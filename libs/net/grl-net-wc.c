@@ -435,6 +435,7 @@ struct request_clos {
   GAsyncResult *result;
   GCancellable *cancellable;
   GHashTable *headers;
+  GrlOperationPriority priority;
   guint source_id;
 };
 
@@ -765,16 +766,47 @@ get_url_now (GrlNetWc *self,
 #endif
 }
 
+/* Exchanges the requests of @a and @b, keeping their dispatch slots */
+static void
+request_clos_swap (struct request_clos *a,
+                   struct request_clos *b)
+{
+  struct request_clos tmp = *a;
+
+  a->url = b->url;
+  a->result = b->result;
+  a->cancellable = b->cancellable;
+  a->headers = b->headers;
+  a->priority = b->priority;
+
+  b->url = tmp.url;
+  b->result = tmp.result;
+  b->cancellable = tmp.cancellable;
+  b->headers = tmp.headers;
+  b->priority = tmp.priority;
+}
+
 static gboolean
 get_url_cb (gpointer user_data)
 {
   struct request_clos *c = (struct request_clos *) user_data;
+  struct request_clos *best = NULL;
+  GList *l;
+
+  /* The slot goes to the oldest of the most urgent pending requests; the one
+     it was booked for takes the slot of that request */
+  for (l = g_queue_peek_tail_link (c->self->pending); l; l = l->prev) {
+    struct request_clos *d = l->data;
+    if (!best || d->priority < best->priority)
+      best = d;
+  }
+  g_assert (best != NULL);
 
-  /* validation */
-  {
-    struct request_clos *d = g_queue_pop_tail (c->self->pending);
-    g_assert (c == d);
+  if (best != c) {
+    GRL_DEBUG ("giving the slot of a request to a more urgent one");
+    request_clos_swap (c, best);
   }
+  g_queue_remove (c->self->pending, c);
 
   if (is_mocked ())
     get_url_mocked (c->self, c->url, c->headers, c->result, c->cancellable);
@@ -788,6 +820,7 @@ static void
 get_url (GrlNetWc *self,
          const char *url,
          GHashTable *headers,
+         GrlOperationPriority priority,
          GAsyncResult *result,
          GCancellable *cancellable)
 {
@@ -802,6 +835,7 @@ get_url (GrlNetWc *self,
   c->headers = headers? g_hash_table_ref (headers): NULL;
   c->result = result;
   c->cancellable = cancellable ? g_object_ref (cancellable) : NULL;
+  c->priority = priority;
 
   now = g_get_real_time () / G_USEC_PER_SEC;
 
@@ -984,13 +1018,51 @@ grl_net_wc_request_with_headers_hash_async (GrlNetWc *self,
                                             GCancellable *cancellable,
                                             GAsyncReadyCallback callback,
                                             gpointer user_data)
+{
+  grl_net_wc_request_with_priority_async (self,
+                                          uri,
+                                          headers,
+                                          GRL_OPERATION_PRIORITY_NORMAL,
+                                          cancellable,
+                                          callback,
+                                          user_data);
+}
+
+/**
+ * grl_net_wc_request_with_priority_async:
+ * @self: a #GrlNetWc instance
+ * @uri: The URI of the resource to request
+ * @headers: (allow-none) (element-type utf8 utf8): a set of additional HTTP
+ * headers for this request or %NULL to ignore
+ * @priority: the priority class of the operation doing the request, as
+ * returned by grl_operation_options_get_priority()
+ * @cancellable: (allow-none): a #GCancellable instance or %NULL to ignore
+ * @callback: The callback when the result is ready
+ * @user_data: User data set for the @callback
+ *
+ * Request the fetching of a web resource given the @uri. This request is
+ * asynchronous, thus the result will be returned within the @callback.
+ *
+ * When requests are delayed by throttling, those with a more urgent @priority
+ * are sent first.
+ *
+ * Since: 0.3.20
+ */
+void
+grl_net_wc_request_with_priority_async (GrlNetWc *self,
+                                        const char *uri,
+                                        GHashTable *headers,
+                                        GrlOperationPriority priority,
+                                        GCancellable *cancellable,
+                                        GAsyncReadyCallback callback,
+                                        gpointer user_data)
 {
 #if SOUP_CHECK_VERSION (2, 99, 2)
   ensure_session (self);
 #endif
   GTask *task = g_task_new (G_OBJECT (self), NULL, callback, user_data);
   g_task_set_source_tag (task, grl_net_wc_request_async);
-  get_url (self, uri, headers, G_ASYNC_RESULT (task), cancellable);
+  get_url (self, uri, headers, priority, G_ASYNC_RESULT (task), cancellable);
 }
 
 
@@ -28,6 +28,7 @@
 #define _GRL_NET_WC_H_
 
 #include <gio/gio.h>
+#include <grilo.h>
 
 G_BEGIN_DECLS
 
@@ -128,6 +129,14 @@ void grl_net_wc_request_with_headers_async (GrlNetWc *self,
                                             gpointer user_data,
                                             ...) G_GNUC_NULL_TERMINATED;
 
+void grl_net_wc_request_with_priority_async (GrlNetWc *self,
+                                             const char *uri,
+                                             GHashTable *headers,
+                                             GrlOperationPriority priority,
+                                             GCancellable *cancellable,
+                                             GAsyncReadyCallback callback,
+                                             gpointer user_data);
+
 gboolean grl_net_wc_request_finish (GrlNetWc *self,
 				    GAsyncResult *result,
 				    gchar **content,
@@ -94,26 +94,16 @@ struct _GrlPlsPrivate {
   GPtrArray *entries;
 };
 
-struct OperationState {
-  GrlSource *source;
-  guint operation_id;
-  gboolean cancelled;
-  gboolean completed;
-  gboolean started;
-  GrlSourceBrowseSpec *bs;
-};
-
 /* -------- Prototypes ------- */
 
 static void
-grl_pls_cancel_cb (struct OperationState *op_state);
+grl_pls_cancel_cb (GrlSourceBrowseSpec *bs);
 static GrlMedia*
 grl_media_new_from_pls_entry (const gchar *uri,
                               GHashTable *metadata);
 
 /* -------- Variables ------- */
 
-static GHashTable *operations = NULL;
 static gboolean is_flatpak = FALSE;
 
 /* -------- Functions ------- */
@@ -172,9 +162,6 @@ grl_pls_init (void)
   if (!initialized) {
     GRL_LOG_DOMAIN_INIT (libpls_log_domain, "pls");
 
-    operations = g_hash_table_new_full (g_direct_hash, g_direct_equal,
-                                        NULL,
-                                        (GDestroyNotify) grl_source_browse_spec_free);
     is_flatpak = g_file_test ("/.flatpak-info", G_FILE_TEST_EXISTS);
 
     initialized = TRUE;
@@ -199,17 +186,6 @@ mime_is_image (const gchar *mime)
   return g_content_type_is_a (mime, "image/*");
 }
 
-static void
-operation_state_free (struct OperationState *op_state)
-{
-  g_return_if_fail (op_state);
-
-  GRL_DEBUG ("%s (%p)", __FUNCTION__, op_state);
-
-  g_object_unref (op_state->source);
-  g_free (op_state);
-}
-
 /*
  * operation_set_finished:
  *
@@ -233,15 +209,9 @@ operation_set_finished (guint operation_id)
 static void
 operation_set_completed (guint operation_id)
 {
-  struct OperationState *op_state;
-
   GRL_DEBUG ("%s (%d)", __FUNCTION__, operation_id);
 
-  op_state = grl_operation_get_private_data (operation_id);
-
-  if (op_state) {
-    op_state->completed = TRUE;
-  }
+  grl_operation_set_state (operation_id, GRL_OPERATION_STATE_COMPLETED);
 }
 
 /*
@@ -254,11 +224,10 @@ operation_set_completed (guint operation_id)
 static gboolean
 operation_is_completed (guint operation_id)
 {
-  struct OperationState *op_state;
-
-  op_state = grl_operation_get_private_data (operation_id);
+  GrlOperationState state;
 
-  return !op_state || op_state->completed;
+  return !grl_operation_get_state (operation_id, &state) ||
+         state == GRL_OPERATION_STATE_COMPLETED;
 }
 
 /*
@@ -270,15 +239,9 @@ operation_is_completed (guint operation_id)
 static void
 operation_set_cancelled (guint operation_id)
 {
-  struct OperationState *op_state;
-
   GRL_DEBUG ("%s (%d)", __FUNCTION__, operation_id);
 
-  op_state = grl_operation_get_private_data (operation_id);
-
-  if (op_state) {
-    op_state->cancelled = TRUE;
-  }
+  grl_operation_set_state (operation_id, GRL_OPERATION_STATE_CANCELLED);
 }
 
 /*
@@ -290,11 +253,10 @@ operation_set_cancelled (guint operation_id)
 static gboolean
 operation_is_cancelled (guint operation_id)
 {
-  struct OperationState *op_state;
+  GrlOperationState state;
 
-  op_state = grl_operation_get_private_data (operation_id);
-
-  return op_state && op_state->cancelled;
+  return grl_operation_get_state (operation_id, &state) &&
+         state == GRL_OPERATION_STATE_CANCELLED;
 }
 
 /*
@@ -306,21 +268,17 @@ operation_is_cancelled (guint operation_id)
 static void
 operation_set_ongoing (GrlSource *source, guint operation_id, GrlSourceBrowseSpec *bs)
 {
-  struct OperationState *op_state;
-
   g_return_if_fail (source);
 
   GRL_DEBUG ("%s (%d)", __FUNCTION__, operation_id);
 
-  op_state = g_new0 (struct OperationState, 1);
-  op_state->source = g_object_ref (source);
-  op_state->operation_id = operation_id;
-  op_state->bs = bs;
-
+  /* The spec is released along with the operation */
   grl_operation_set_private_data (operation_id,
-                                  op_state,
+                                  bs,
                                   (GrlOperationCancelCb) grl_pls_cancel_cb,
-                                  (GDestroyNotify) operation_state_free);
+                                  (GDestroyNotify) grl_source_browse_spec_free);
+  grl_operation_set_info (operation_id, GRL_OP_BROWSE, source);
+  grl_operation_set_state (operation_id, GRL_OPERATION_STATE_RUNNING);
 }
 
 /*
@@ -332,32 +290,31 @@ operation_set_ongoing (GrlSource *source, guint operation_id, GrlSourceBrowseSpe
 static gboolean
 operation_is_ongoing (guint operation_id)
 {
-  struct OperationState *op_state;
+  GrlOperationState state;
 
-  op_state = grl_operation_get_private_data (operation_id);
-
-  return op_state && !op_state->cancelled;
+  return grl_operation_get_state (operation_id, &state) &&
+         state != GRL_OPERATION_STATE_CANCELLED;
 }
 
 static void
-grl_pls_cancel_cb (struct OperationState *op_state)
+grl_pls_cancel_cb (GrlSourceBrowseSpec *bs)
 {
   struct _GrlPlsPrivate *priv;
 
-  g_return_if_fail (op_state);
+  g_return_if_fail (bs);
 
-  GRL_DEBUG ("%s (%p)", __FUNCTION__, op_state);
+  GRL_DEBUG ("%s (%p)", __FUNCTION__, bs);
 
-  if (!operation_is_ongoing (op_state->operation_id)) {
+  if (!operation_is_ongoing (bs->operation_id)) {
     GRL_DEBUG ("Tried to cancel invalid or already cancelled operation. "
                "Skipping...");
     return;
   }
 
-  operation_set_cancelled (op_state->operation_id);
+  operation_set_cancelled (bs->operation_id);
 
   /* Cancel the totem playlist parsing operation */
-  priv = (struct _GrlPlsPrivate *) op_state->bs->user_data;
+  priv = (struct _GrlPlsPrivate *) bs->user_data;
   if (priv && !g_cancellable_is_cancelled (priv->cancellable)) {
     g_cancellable_cancel (priv->cancellable);
   }
@@ -629,6 +586,11 @@ grl_pls_browse_report_results (GrlSourceBrowseSpec *bs)
   GRL_DEBUG ("%s, skip: %d, count: %d, remaining: %d, num entries: %d",
              __FUNCTION__, skip, count, remaining, valid_entries ? valid_entries->len : 0);
 
+  /* Operations started by plugins are accounted by the core, and keep its
+     own data */
+  called_from_plugin =
+    grl_operation_get_private_data (bs->operation_id) != bs;
+
   if (remaining) {
     int i;
 
@@ -638,6 +600,8 @@ grl_pls_browse_report_results (GrlSourceBrowseSpec *bs)
       content = g_ptr_array_index (valid_entries, skip + i);
       g_object_ref (content);
       remaining--;
+      if (!called_from_plugin)
+        grl_operation_add_delivered (bs->operation_id, 1);
       bs->callback (bs->source,
                bs->operation_id,
                content,
@@ -656,13 +620,10 @@ grl_pls_browse_report_results (GrlSourceBrowseSpec *bs)
              NULL);
   }
 
-  called_from_plugin = g_hash_table_lookup (operations,
-      GUINT_TO_POINTER (bs->operation_id)) == NULL;
-
   if (!called_from_plugin) {
     operation_set_completed (bs->operation_id);
+    /* This releases bs */
     operation_set_finished (bs->operation_id);
-    g_hash_table_remove (operations, GUINT_TO_POINTER (bs->operation_id));
   }
 
   return FALSE;
@@ -937,8 +898,6 @@ grl_pls_browse (GrlSource *source,
   bs->user_data = userdata;
   bs->operation_id = grl_operation_generate_id ();
 
-  g_hash_table_insert (operations, GUINT_TO_POINTER (bs->operation_id), bs);
-
   operation_set_ongoing (source, bs->operation_id, bs);
 
   grl_pls_browse_by_spec (source, filter_func, bs);
@@ -116,6 +116,27 @@ grl_media_class_init (GrlMediaClass *klass)
                                                       G_PARAM_READWRITE |
                                                       G_PARAM_CONSTRUCT |
                                                       G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GrlMedia::keys-updated:
+   * @media: the media
+   * @keys: (element-type GrlKeyID): the keys that were added
+   *
+   * Signals that @keys were added to @media after it was sent to the user,
+   * as done by operations using %GRL_RESOLVE_PROGRESSIVE.
+   *
+   * Since: 0.3.20
+   */
+  g_signal_new ("keys-updated",
+                G_TYPE_FROM_CLASS (gobject_class),
+                G_SIGNAL_RUN_LAST,
+                0,
+                NULL,
+                NULL,
+                g_cclosure_marshal_VOID__POINTER,
+                G_TYPE_NONE,
+                1,
+                G_TYPE_POINTER);
 }
 
 static void
@@ -1842,6 +1863,25 @@ grl_media_set_composer (GrlMedia *media, const gchar *composer)
                        composer);
 }
 
+/**
+ * grl_media_set_continuation:
+ * @media: the media instance
+ * @continuation: (allow-none): token to get the elements after @media
+ *
+ * Set the continuation token of the media. Sources able to resume a browse,
+ * search or query right after an element set it in the last element of each
+ * page; see grl_operation_options_set_continuation().
+ *
+ * Since: 0.3.20
+ */
+void
+grl_media_set_continuation (GrlMedia *media, const gchar *continuation)
+{
+  g_return_if_fail (GRL_IS_MEDIA (media));
+  grl_data_set_string (GRL_DATA (media), GRL_METADATA_KEY_CONTINUATION,
+                       continuation);
+}
+
 /**
  * grl_media_set_width:
  * @media: the media instance
@@ -3349,6 +3389,22 @@ grl_media_get_composer_nth (GrlMedia *media, guint index)
   }
 }
 
+/**
+ * grl_media_get_continuation:
+ * @media: the media instance
+ *
+ * Returns: the token to get the elements after @media from its source, or
+ * %NULL
+ *
+ * Since: 0.3.20
+ */
+const gchar *
+grl_media_get_continuation (GrlMedia *media)
+{
+  g_return_val_if_fail (GRL_IS_MEDIA (media), NULL);
+  return grl_data_get_string (GRL_DATA (media), GRL_METADATA_KEY_CONTINUATION);
+}
+
 /**
  * grl_media_get_media_type:
  * @media: the media instance
@@ -206,6 +206,8 @@ void grl_media_set_artist (GrlMedia *media, const gchar *artist);
 
 void grl_media_set_composer (GrlMedia *media, const gchar *composer);
 
+void grl_media_set_continuation (GrlMedia *media, const gchar *continuation);
+
 void grl_media_set_width (GrlMedia *media, gint width);
 
 void grl_media_set_height (GrlMedia *media, gint height);
@@ -390,6 +392,8 @@ const gchar *grl_media_get_composer (GrlMedia *media);
 
 const gchar *grl_media_get_composer_nth (GrlMedia *media, guint index);
 
+const gchar *grl_media_get_continuation (GrlMedia *media);
+
 GrlMediaType grl_media_get_media_type (GrlMedia *media);
 
 gint grl_media_get_width (GrlMedia *media);
@@ -41,6 +41,10 @@
 #include "grl-operation-priv.h"
 #include "grl-registry-priv.h"
 #include "grl-log-priv.h"
+#include "grl-resolve-cache-priv.h"
+#include "grl-source-priv.h"
+#include "grl-metadata-store-priv.h"
+#include "grl-metrics-priv.h"
 #include "config.h"
 
 #include <glib/gi18n-lib.h>
@@ -48,6 +52,9 @@
 static gboolean grl_initialized = FALSE;
 static const gchar *plugin_path = NULL;
 static const gchar *plugin_list = NULL;
+static const gchar *resolve_cache_size = NULL;
+static const gchar *metadata_store = NULL;
+static gboolean metrics = FALSE;
 
 static const gchar *
 get_default_plugin_dir (void)
@@ -134,6 +141,29 @@ post_parse_hook_cb (GOptionContext  *context,
     g_strfreev (split_list);
   }
 
+  /* Bound of the metadata cache */
+  if (!resolve_cache_size) {
+    resolve_cache_size = g_getenv (GRL_RESOLVE_CACHE_SIZE_VAR);
+  }
+
+  if (resolve_cache_size) {
+    grl_resolve_cache_set_max_size (g_ascii_strtoull (resolve_cache_size, NULL, 10));
+  }
+
+  /* File where the metadata cache is persisted */
+  if (!metadata_store) {
+    metadata_store = g_getenv (GRL_METADATA_STORE_VAR);
+  }
+
+  if (metadata_store && *metadata_store) {
+    grl_resolve_cache_set_store_path (metadata_store);
+  }
+
+  /* Latency metrics */
+  if (metrics || g_getenv (GRL_METRICS_VAR)) {
+    grl_metrics_set_enabled (TRUE);
+  }
+
   grl_initialized = TRUE;
 
   return TRUE;
@@ -189,8 +219,12 @@ grl_deinit (void)
     return;
   }
 
+  /* Plugin calls must return before their modules are unloaded */
+  grl_source_threads_shutdown ();
+
   registry = grl_registry_get_default ();
   grl_registry_shutdown (registry);
+  grl_resolve_cache_clear ();
   grl_initialized = FALSE;
 }
 
@@ -221,6 +255,12 @@ grl_init_get_option_group (void)
 #endif
     { "grl-plugin-use", 0, 0, G_OPTION_ARG_STRING, &plugin_list,
       N_("Colon-separated list of Grilo plugins to use"), NULL },
+    { "grl-resolve-cache-size", 0, 0, G_OPTION_ARG_STRING, &resolve_cache_size,
+      N_("Maximum size in bytes of the cache of resolved metadata"), NULL },
+    { "grl-metadata-store", 0, 0, G_OPTION_ARG_FILENAME, &metadata_store,
+      N_("File where resolved metadata is kept across restarts"), NULL },
+    { "grl-metrics", 0, 0, G_OPTION_ARG_NONE, &metrics,
+      N_("Record latency metrics of the sources"), NULL },
     { NULL }
   };
 
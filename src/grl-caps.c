@@ -48,6 +48,7 @@
 #include <grl-value-helper.h>
 
 #include "grl-operation-options-priv.h"
+#include "grl-key-set-priv.h"
 #include "grl-type-builtins.h"
 
 #define GRL_CAPS_KEY_PAGINATION "pagination"
@@ -58,6 +59,9 @@ struct _GrlCapsPrivate {
   GrlTypeFilter type_filter;
   GList *key_filter;
   GList *key_range_filter;
+  GrlKeySet *key_filter_set;
+  GrlKeySet *key_range_filter_set;
+  gboolean continuation_supported;
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE (GrlCaps, grl_caps, G_TYPE_OBJECT);
@@ -74,6 +78,8 @@ grl_caps_finalize (GrlCaps *self)
   g_hash_table_unref (self->priv->data);
   g_list_free (self->priv->key_filter);
   g_list_free (self->priv->key_range_filter);
+  grl_key_set_unref (self->priv->key_filter_set);
+  grl_key_set_unref (self->priv->key_range_filter_set);
 
   G_OBJECT_CLASS (grl_caps_parent_class)->finalize ((GObject *) self);
 }
@@ -90,6 +96,9 @@ grl_caps_init (GrlCaps *self)
   self->priv->type_filter = GRL_TYPE_FILTER_NONE;
   self->priv->key_filter = NULL;
   self->priv->key_range_filter = NULL;
+  self->priv->key_filter_set = NULL;
+  self->priv->key_range_filter_set = NULL;
+  self->priv->continuation_supported = FALSE;
 }
 
 static void
@@ -139,6 +148,9 @@ grl_caps_test_option (GrlCaps *caps, const gchar *key, const GValue *value)
     /* these options must always be handled by plugins */
     return TRUE;
 
+  if (0 == g_strcmp0 (key, GRL_OPERATION_OPTION_CONTINUATION))
+    return caps->priv->continuation_supported;
+
   if (0 == g_strcmp0 (key, GRL_OPERATION_OPTION_TYPE_FILTER)) {
     GrlTypeFilter filter, supported_filter;
 
@@ -223,8 +235,12 @@ grl_caps_set_key_filter (GrlCaps *caps, GList *keys)
   g_return_if_fail (caps);
 
   g_clear_pointer (&caps->priv->key_filter, g_list_free);
+  g_clear_pointer (&caps->priv->key_filter_set, grl_key_set_unref);
 
   caps->priv->key_filter = g_list_copy (keys);
+  if (keys) {
+    caps->priv->key_filter_set = grl_key_set_new_from_list (keys);
+  }
 }
 
 /**
@@ -243,9 +259,8 @@ grl_caps_is_key_filter (GrlCaps *caps, GrlKeyID key)
 {
   g_return_val_if_fail (caps, FALSE);
 
-  if(caps->priv->key_filter) {
-    return g_list_find (caps->priv->key_filter,
-                        GRLKEYID_TO_POINTER(key)) != NULL;
+  if(caps->priv->key_filter_set) {
+    return grl_key_set_contains (caps->priv->key_filter_set, key);
   }
 
   return FALSE;
@@ -280,8 +295,12 @@ grl_caps_set_key_range_filter (GrlCaps *caps, GList *keys)
   g_return_if_fail (caps);
 
   g_clear_pointer (&caps->priv->key_range_filter, g_list_free);
+  g_clear_pointer (&caps->priv->key_range_filter_set, grl_key_set_unref);
 
   caps->priv->key_range_filter = g_list_copy (keys);
+  if (keys) {
+    caps->priv->key_range_filter_set = grl_key_set_new_from_list (keys);
+  }
 }
 
 /**
@@ -300,9 +319,48 @@ grl_caps_is_key_range_filter (GrlCaps *caps, GrlKeyID key)
 {
   g_return_val_if_fail (caps, FALSE);
 
-  if(caps->priv->key_range_filter) {
-    return g_list_find (caps->priv->key_range_filter, GRLKEYID_TO_POINTER (key)) != NULL;
+  if(caps->priv->key_range_filter_set) {
+    return grl_key_set_contains (caps->priv->key_range_filter_set, key);
   }
 
   return FALSE;
 }
+
+/**
+ * grl_caps_get_continuation_supported:
+ * @caps: a #GrlCaps instance
+ *
+ * Checks if the continuation tokens set with grl_media_set_continuation() are
+ * supported in @caps.
+ *
+ * Returns: %TRUE if grl_operation_options_set_continuation() can be used
+ *
+ * Since: 0.3.20
+ **/
+gboolean
+grl_caps_get_continuation_supported (GrlCaps *caps)
+{
+  g_return_val_if_fail (caps, FALSE);
+
+  return caps->priv->continuation_supported;
+}
+
+/**
+ * grl_caps_set_continuation_supported:
+ * @caps: a #GrlCaps instance
+ * @supported: whether continuation tokens are supported
+ *
+ * Sets whether the source sets continuation tokens in the last element of its
+ * pages, and then starts after the element with the token found in the
+ * operation options. By default they are not supported, and the core never
+ * passes them to the source.
+ *
+ * Since: 0.3.20
+ **/
+void
+grl_caps_set_continuation_supported (GrlCaps *caps, gboolean supported)
+{
+  g_return_if_fail (caps != NULL);
+
+  caps->priv->continuation_supported = supported;
+}
@@ -109,6 +109,10 @@ void grl_caps_set_key_range_filter (GrlCaps *caps, GList *keys);
 
 gboolean grl_caps_is_key_range_filter (GrlCaps *caps, GrlKeyID key);
 
+gboolean grl_caps_get_continuation_supported (GrlCaps *caps);
+
+void grl_caps_set_continuation_supported (GrlCaps *caps, gboolean supported);
+
 G_END_DECLS
 
 #endif /* _GRL_CAPS_H_ */
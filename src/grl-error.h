@@ -50,6 +50,8 @@
  * @GRL_CORE_ERROR_NOTIFY_CHANGED_FAILED: Failed to start changed notifications
  * @GRL_CORE_ERROR_OPERATION_CANCELLED: The operation was cancelled
  * @GRL_CORE_ERROR_AUTHENTICATION_TOKEN: Invalid authentication token
+ * @GRL_CORE_ERROR_DEADLINE_EXCEEDED: The operation did not finish before its
+ * deadline. Since: 0.3.20
  *
  * These constants identify all the available core errors
  */
@@ -72,7 +74,8 @@ typedef enum {
   GRL_CORE_ERROR_REGISTER_METADATA_KEY_FAILED,
   GRL_CORE_ERROR_NOTIFY_CHANGED_FAILED,
   GRL_CORE_ERROR_OPERATION_CANCELLED,
-  GRL_CORE_ERROR_AUTHENTICATION_TOKEN
+  GRL_CORE_ERROR_AUTHENTICATION_TOKEN,
+  GRL_CORE_ERROR_DEADLINE_EXCEEDED
 } GrlCoreError;
 
 #endif /* _GRL_ERROR_H_ */
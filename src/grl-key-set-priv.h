@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2026 Grilo Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifndef _GRL_KEY_SET_PRIV_H_
+#define _GRL_KEY_SET_PRIV_H_
+
+#include <glib.h>
+#include <grl-metadata-key.h>
+
+/* Dense set of GrlKeyIDs, stored as a bitmap indexed by the key */
+typedef struct _GrlKeySet GrlKeySet;
+
+GrlKeySet *grl_key_set_new (void);
+
+GrlKeySet *grl_key_set_new_from_list (const GList *keys);
+
+GrlKeySet *grl_key_set_copy (const GrlKeySet *set);
+
+GrlKeySet *grl_key_set_ref (GrlKeySet *set);
+
+void grl_key_set_unref (GrlKeySet *set);
+
+void grl_key_set_add (GrlKeySet *set, GrlKeyID key);
+
+void grl_key_set_remove (GrlKeySet *set, GrlKeyID key);
+
+gboolean grl_key_set_contains (const GrlKeySet *set, GrlKeyID key);
+
+gboolean grl_key_set_is_empty (const GrlKeySet *set);
+
+guint grl_key_set_size (const GrlKeySet *set);
+
+void grl_key_set_union (GrlKeySet *set, const GrlKeySet *other);
+
+void grl_key_set_intersect (GrlKeySet *set, const GrlKeySet *other);
+
+void grl_key_set_subtract (GrlKeySet *set, const GrlKeySet *other);
+
+GList *grl_key_set_to_list (const GrlKeySet *set);
+
+GList *grl_key_set_filter_list (const GrlKeySet *set,
+                                GList **keys,
+                                gboolean return_filtered);
+
+#endif /* _GRL_KEY_SET_PRIV_H_ */
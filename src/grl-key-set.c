@@ -0,0 +1,275 @@
+/*
+ * Copyright (C) 2026 Grilo Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/*
+ * Key lists are handled everywhere as GList of GRLKEYID_TO_POINTER. Checking
+ * whether a key belongs to a list is linear, which makes filtering a list
+ * against another quadratic. As key ids are small consecutive integers, sets
+ * of keys are stored here as a bitmap instead, so membership checks and set
+ * operations are cheap.
+ */
+
+#include <string.h>
+
+#include "grl-key-set-priv.h"
+
+#define WORD_BITS (sizeof (guint32) * 8)
+#define WORD_INDEX(key) ((key) / WORD_BITS)
+#define WORD_MASK(key) (1U << ((key) % WORD_BITS))
+
+struct _GrlKeySet {
+  guint32 *words;
+  guint n_words;
+  gint ref_count;
+};
+
+static void
+key_set_grow (GrlKeySet *set,
+              guint n_words)
+{
+  if (n_words <= set->n_words) {
+    return;
+  }
+
+  set->words = g_renew (guint32, set->words, n_words);
+  memset (set->words + set->n_words, 0,
+          (n_words - set->n_words) * sizeof (guint32));
+  set->n_words = n_words;
+}
+
+GrlKeySet *
+grl_key_set_new (void)
+{
+  GrlKeySet *set = g_slice_new0 (GrlKeySet);
+
+  set->ref_count = 1;
+
+  return set;
+}
+
+GrlKeySet *
+grl_key_set_new_from_list (const GList *keys)
+{
+  GrlKeySet *set = grl_key_set_new ();
+
+  for (; keys; keys = g_list_next (keys)) {
+    grl_key_set_add (set, GRLPOINTER_TO_KEYID (keys->data));
+  }
+
+  return set;
+}
+
+GrlKeySet *
+grl_key_set_copy (const GrlKeySet *set)
+{
+  GrlKeySet *copy;
+
+  g_return_val_if_fail (set != NULL, NULL);
+
+  copy = grl_key_set_new ();
+  key_set_grow (copy, set->n_words);
+  memcpy (copy->words, set->words, set->n_words * sizeof (guint32));
+
+  return copy;
+}
+
+/* Sets shared through references must not be modified any more */
+GrlKeySet *
+grl_key_set_ref (GrlKeySet *set)
+{
+  g_return_val_if_fail (set != NULL, NULL);
+
+  g_atomic_int_inc (&set->ref_count);
+
+  return set;
+}
+
+void
+grl_key_set_unref (GrlKeySet *set)
+{
+  if (!set || !g_atomic_int_dec_and_test (&set->ref_count)) {
+    return;
+  }
+
+  g_free (set->words);
+  g_slice_free (GrlKeySet, set);
+}
+
+void
+grl_key_set_add (GrlKeySet *set,
+                 GrlKeyID key)
+{
+  g_return_if_fail (set != NULL);
+
+  key_set_grow (set, WORD_INDEX (key) + 1);
+  set->words[WORD_INDEX (key)] |= WORD_MASK (key);
+}
+
+void
+grl_key_set_remove (GrlKeySet *set,
+                    GrlKeyID key)
+{
+  g_return_if_fail (set != NULL);
+
+  if (WORD_INDEX (key) < set->n_words) {
+    set->words[WORD_INDEX (key)] &= ~WORD_MASK (key);
+  }
+}
+
+gboolean
+grl_key_set_contains (const GrlKeySet *set,
+                      GrlKeyID key)
+{
+  g_return_val_if_fail (set != NULL, FALSE);
+
+  return WORD_INDEX (key) < set->n_words &&
+    (set->words[WORD_INDEX (key)] & WORD_MASK (key)) != 0;
+}
+
+gboolean
+grl_key_set_is_empty (const GrlKeySet *set)
+{
+  guint i;
+
+  g_return_val_if_fail (set != NULL, TRUE);
+
+  for (i = 0; i < set->n_words; i++) {
+    if (set->words[i]) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+guint
+grl_key_set_size (const GrlKeySet *set)
+{
+  guint32 word;
+  guint i;
+  guint size = 0;
+
+  g_return_val_if_fail (set != NULL, 0);
+
+  for (i = 0; i < set->n_words; i++) {
+    /* Clear the lowest bit set until none is left */
+    for (word = set->words[i]; word; word &= word - 1) {
+      size++;
+    }
+  }
+
+  return size;
+}
+
+/* Adds to @set the keys in @other */
+void
+grl_key_set_union (GrlKeySet *set,
+                   const GrlKeySet *other)
+{
+  guint i;
+
+  g_return_if_fail (set != NULL);
+  g_return_if_fail (other != NULL);
+
+  key_set_grow (set, other->n_words);
+  for (i = 0; i < other->n_words; i++) {
+    set->words[i] |= other->words[i];
+  }
+}
+
+/* Keeps in @set only the keys that are also in @other */
+void
+grl_key_set_intersect (GrlKeySet *set,
+                       const GrlKeySet *other)
+{
+  guint i;
+
+  g_return_if_fail (set != NULL);
+  g_return_if_fail (other != NULL);
+
+  for (i = 0; i < set->n_words; i++) {
+    set->words[i] &= i < other->n_words? other->words[i]: 0;
+  }
+}
+
+/* Removes from @set the keys in @other */
+void
+grl_key_set_subtract (GrlKeySet *set,
+                      const GrlKeySet *other)
+{
+  guint i;
+
+  g_return_if_fail (set != NULL);
+  g_return_if_fail (other != NULL);
+
+  for (i = 0; i < MIN (set->n_words, other->n_words); i++) {
+    set->words[i] &= ~other->words[i];
+  }
+}
+
+/* Returns the keys in @set, in increasing order */
+GList *
+grl_key_set_to_list (const GrlKeySet *set)
+{
+  GList *keys = NULL;
+  GrlKeyID key;
+
+  g_return_val_if_fail (set != NULL, NULL);
+
+  key = set->n_words * WORD_BITS;
+  while (key > 0) {
+    key--;
+    if (set->words[WORD_INDEX (key)] & WORD_MASK (key)) {
+      keys = g_list_prepend (keys, GRLKEYID_TO_POINTER (key));
+    }
+  }
+
+  return keys;
+}
+
+/*
+ * Leaves in @keys only those that belong to @set, keeping their order. If
+ * @return_filtered is %TRUE, a new list with the removed keys is returned.
+ */
+GList *
+grl_key_set_filter_list (const GrlKeySet *set,
+                         GList **keys,
+                         gboolean return_filtered)
+{
+  GList *iter_keys, *next;
+  GList *out_set = NULL;
+
+  g_return_val_if_fail (set != NULL, NULL);
+  g_return_val_if_fail (keys != NULL, NULL);
+
+  iter_keys = *keys;
+  while (iter_keys) {
+    next = g_list_next (iter_keys);
+    if (!grl_key_set_contains (set, GRLPOINTER_TO_KEYID (iter_keys->data))) {
+      if (return_filtered) {
+        out_set = g_list_prepend (out_set, iter_keys->data);
+      }
+      *keys = g_list_delete_link (*keys, iter_keys);
+    }
+    iter_keys = next;
+  }
+
+  return g_list_reverse (out_set);
+}
@@ -0,0 +1,419 @@
+/*
+ * Copyright (C) 2026 Grilo Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/**
+ * SECTION:grl-media-iterator
+ * @short_description: Get the results of an operation as they are needed
+ * @see_also: #GrlSource, #GrlOperationOptions
+ *
+ * A #GrlMediaIterator goes through the results of a browse, search or query
+ * operation at the pace of its user. Elements are only asked to the source
+ * when requested with grl_media_iterator_next_async(), in pages of the
+ * requested size, so the elements waiting to be processed never go beyond
+ * that size, even for operations without a limit of elements.
+ *
+ * Pages after the first one are asked with the continuation token of the
+ * last element received when the source provides one, see
+ * grl_operation_options_set_continuation(), and skipping the elements
+ * already received otherwise.
+ */
+
+#include "grl-media-iterator.h"
+#include "grl-operation-options.h"
+#include "grl-log.h"
+#include "data/grl-media.h"
+
+#include <glib/gi18n-lib.h>
+
+struct _GrlMediaIteratorPrivate {
+  GrlSource *source;
+  GrlSupportedOps operation;
+  GrlMedia *container;
+  gchar *text;
+  GList *keys;
+  GrlOperationOptions *options;
+  /* Where the next page starts: skip counts from the continuation token, if
+     the source declares them in its caps */
+  gboolean use_continuation;
+  gchar *continuation;
+  guint skip;
+  /* Elements still wanted by the user, or GRL_COUNT_INFINITY */
+  gint remaining;
+  guint requested;
+  gboolean done;
+  GTask *pending;
+};
+
+G_DEFINE_TYPE_WITH_PRIVATE (GrlMediaIterator, grl_media_iterator, G_TYPE_OBJECT);
+
+static void
+grl_media_iterator_finalize (GObject *object)
+{
+  GrlMediaIterator *iterator = GRL_MEDIA_ITERATOR (object);
+
+  g_object_unref (iterator->priv->source);
+  g_clear_object (&iterator->priv->container);
+  g_free (iterator->priv->text);
+  g_list_free (iterator->priv->keys);
+  g_object_unref (iterator->priv->options);
+  g_free (iterator->priv->continuation);
+
+  G_OBJECT_CLASS (grl_media_iterator_parent_class)->finalize (object);
+}
+
+static void
+grl_media_iterator_class_init (GrlMediaIteratorClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = grl_media_iterator_finalize;
+}
+
+static void
+grl_media_iterator_init (GrlMediaIterator *iterator)
+{
+  iterator->priv = grl_media_iterator_get_instance_private (iterator);
+}
+
+static GrlMediaIterator *
+media_iterator_new (GrlSource *source,
+                    GrlSupportedOps operation,
+                    const GList *keys,
+                    GrlOperationOptions *options)
+{
+  GrlMediaIterator *iterator;
+
+  iterator = g_object_new (GRL_TYPE_MEDIA_ITERATOR, NULL);
+  iterator->priv->source = g_object_ref (source);
+  iterator->priv->operation = operation;
+  iterator->priv->keys = g_list_copy ((GList *) keys);
+  iterator->priv->options = grl_operation_options_copy (options);
+  iterator->priv->use_continuation =
+    grl_caps_get_continuation_supported (grl_source_get_caps (source, operation));
+  iterator->priv->continuation =
+    g_strdup (grl_operation_options_get_continuation (options));
+  iterator->priv->skip = grl_operation_options_get_skip (options);
+  iterator->priv->remaining = grl_operation_options_get_count (options);
+  iterator->priv->done = (iterator->priv->remaining == 0);
+
+  return iterator;
+}
+
+static void
+media_iterator_media_list_free (GList *medias)
+{
+  g_list_free_full (medias, g_object_unref);
+}
+
+/* Takes note of where the page just received ends */
+static void
+media_iterator_advance (GrlMediaIterator *iterator,
+                        GList *medias)
+{
+  GrlMediaIteratorPrivate *priv = iterator->priv;
+  const gchar *continuation = NULL;
+  guint received;
+
+  received = g_list_length (medias);
+  if (medias && priv->use_continuation) {
+    continuation = grl_media_get_continuation (g_list_last (medias)->data);
+  }
+
+  if (continuation) {
+    g_free (priv->continuation);
+    priv->continuation = g_strdup (continuation);
+    priv->skip = 0;
+  } else {
+    priv->skip += received;
+  }
+
+  if (priv->remaining != GRL_COUNT_INFINITY) {
+    priv->remaining -= MIN (received, (guint) priv->remaining);
+  }
+
+  /* Sources send less elements than asked only when there are no more */
+  if (received < priv->requested || priv->remaining == 0) {
+    priv->done = TRUE;
+  }
+}
+
+static void
+media_iterator_page_cb (GObject *object,
+                        GAsyncResult *result,
+                        gpointer user_data)
+{
+  GTask *task = G_TASK (user_data);
+  GrlMediaIterator *iterator = g_task_get_source_object (task);
+  GrlSource *source = GRL_SOURCE (object);
+  GError *error = NULL;
+  GList *medias;
+
+  switch (iterator->priv->operation) {
+  case GRL_OP_BROWSE:
+    medias = grl_source_browse_finish (source, result, &error);
+    break;
+  case GRL_OP_SEARCH:
+    medias = grl_source_search_finish (source, result, &error);
+    break;
+  case GRL_OP_QUERY:
+    medias = grl_source_query_finish (source, result, &error);
+    break;
+  default:
+    g_assert_not_reached ();
+    return;
+  }
+
+  g_clear_object (&iterator->priv->pending);
+
+  /* A failed page can be asked again */
+  if (error) {
+    g_task_return_error (task, error);
+  } else {
+    media_iterator_advance (iterator, medias);
+    g_task_return_pointer (task, medias,
+                           (GDestroyNotify) media_iterator_media_list_free);
+  }
+  g_object_unref (task);
+}
+
+/**
+ * grl_media_iterator_new_browse:
+ * @source: a source
+ * @container: (allow-none): a container of data transfer objects
+ * @keys: (element-type GrlKeyID): the #GList of
+ * #GrlKeyID<!-- -->s to request
+ * @options: options wanted for that operation
+ *
+ * Creates an iterator over the elements of @container in @source, as sent by
+ * grl_source_browse(). The skip, count and continuation options of @options
+ * delimit the elements to go through.
+ *
+ * Returns: (transfer full): a new #GrlMediaIterator
+ *
+ * Since: 0.3.20
+ */
+GrlMediaIterator *
+grl_media_iterator_new_browse (GrlSource *source,
+                               GrlMedia *container,
+                               const GList *keys,
+                               GrlOperationOptions *options)
+{
+  GrlMediaIterator *iterator;
+
+  g_return_val_if_fail (GRL_IS_SOURCE (source), NULL);
+  g_return_val_if_fail (!container || GRL_IS_MEDIA (container), NULL);
+  g_return_val_if_fail (GRL_IS_OPERATION_OPTIONS (options), NULL);
+
+  iterator = media_iterator_new (source, GRL_OP_BROWSE, keys, options);
+  iterator->priv->container = container? g_object_ref (container): NULL;
+
+  return iterator;
+}
+
+/**
+ * grl_media_iterator_new_search:
+ * @source: a source
+ * @text: (allow-none): the text to search for
+ * @keys: (element-type GrlKeyID): the #GList of
+ * #GrlKeyID<!-- -->s to request
+ * @options: options wanted for that operation
+ *
+ * Creates an iterator over the elements matching @text in @source, as sent
+ * by grl_source_search().
+ *
+ * Returns: (transfer full): a new #GrlMediaIterator
+ *
+ * Since: 0.3.20
+ */
+GrlMediaIterator *
+grl_media_iterator_new_search (GrlSource *source,
+                               const gchar *text,
+                               const GList *keys,
+                               GrlOperationOptions *options)
+{
+  GrlMediaIterator *iterator;
+
+  g_return_val_if_fail (GRL_IS_SOURCE (source), NULL);
+  g_return_val_if_fail (GRL_IS_OPERATION_OPTIONS (options), NULL);
+
+  iterator = media_iterator_new (source, GRL_OP_SEARCH, keys, options);
+  iterator->priv->text = g_strdup (text);
+
+  return iterator;
+}
+
+/**
+ * grl_media_iterator_new_query:
+ * @source: a source
+ * @query: the query to process
+ * @keys: (element-type GrlKeyID): the #GList of
+ * #GrlKeyID<!-- -->s to request
+ * @options: options wanted for that operation
+ *
+ * Creates an iterator over the elements matching @query in @source, as sent
+ * by grl_source_query().
+ *
+ * Returns: (transfer full): a new #GrlMediaIterator
+ *
+ * Since: 0.3.20
+ */
+GrlMediaIterator *
+grl_media_iterator_new_query (GrlSource *source,
+                              const gchar *query,
+                              const GList *keys,
+                              GrlOperationOptions *options)
+{
+  GrlMediaIterator *iterator;
+
+  g_return_val_if_fail (GRL_IS_SOURCE (source), NULL);
+  g_return_val_if_fail (query != NULL, NULL);
+  g_return_val_if_fail (GRL_IS_OPERATION_OPTIONS (options), NULL);
+
+  iterator = media_iterator_new (source, GRL_OP_QUERY, keys, options);
+  iterator->priv->text = g_strdup (query);
+
+  return iterator;
+}
+
+/**
+ * grl_media_iterator_next_async:
+ * @iterator: an iterator
+ * @count: the maximum number of elements to get
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @callback: (scope async): the callback to call when the elements are ready
+ * @user_data: the user data to pass to @callback
+ *
+ * Asks the source for the following @count elements. Only one request can be
+ * running at a time.
+ *
+ * Since: 0.3.20
+ */
+void
+grl_media_iterator_next_async (GrlMediaIterator *iterator,
+                               guint count,
+                               GCancellable *cancellable,
+                               GAsyncReadyCallback callback,
+                               gpointer user_data)
+{
+  GrlMediaIteratorPrivate *priv;
+  GrlOperationOptions *options;
+  GTask *task;
+
+  g_return_if_fail (GRL_IS_MEDIA_ITERATOR (iterator));
+  g_return_if_fail (count > 0);
+
+  priv = iterator->priv;
+  task = g_task_new (iterator, cancellable, callback, user_data);
+  g_task_set_source_tag (task, grl_media_iterator_next_async);
+
+  if (priv->pending) {
+    g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_PENDING,
+                             _("Elements are already being requested"));
+    g_object_unref (task);
+    return;
+  }
+
+  if (priv->done) {
+    g_task_return_pointer (task, NULL, NULL);
+    g_object_unref (task);
+    return;
+  }
+
+  priv->requested = count;
+  if (priv->remaining != GRL_COUNT_INFINITY) {
+    priv->requested = MIN (count, (guint) priv->remaining);
+  }
+  priv->pending = g_object_ref (task);
+
+  options = grl_operation_options_copy (priv->options);
+  grl_operation_options_set_skip (options, priv->skip);
+  grl_operation_options_set_count (options, priv->requested);
+  grl_operation_options_set_continuation (options, priv->continuation);
+
+  GRL_DEBUG ("media iterator: requesting %u elements (skip=%u%s) from '%s'",
+             priv->requested, priv->skip,
+             priv->continuation ? ", continued" : "",
+             grl_source_get_id (priv->source));
+
+  switch (priv->operation) {
+  case GRL_OP_BROWSE:
+    grl_source_browse_async (priv->source, priv->container, priv->keys,
+                             options, cancellable,
+                             media_iterator_page_cb, task);
+    break;
+  case GRL_OP_SEARCH:
+    grl_source_search_async (priv->source, priv->text, priv->keys,
+                             options, cancellable,
+                             media_iterator_page_cb, task);
+    break;
+  case GRL_OP_QUERY:
+    grl_source_query_async (priv->source, priv->text, priv->keys,
+                            options, cancellable,
+                            media_iterator_page_cb, task);
+    break;
+  default:
+    g_assert_not_reached ();
+  }
+
+  g_object_unref (options);
+}
+
+/**
+ * grl_media_iterator_next_finish:
+ * @iterator: an iterator
+ * @result: the #GAsyncResult passed to the callback
+ * @error: a #GError, or @NULL
+ *
+ * Finishes a request started with grl_media_iterator_next_async().
+ *
+ * Returns: (element-type GrlMedia) (transfer full): a #GList with the
+ * following elements, or %NULL if there are no more elements or an error
+ * happened. After use g_object_unref() every element and g_list_free() the
+ * list.
+ *
+ * Since: 0.3.20
+ */
+GList *
+grl_media_iterator_next_finish (GrlMediaIterator *iterator,
+                                GAsyncResult *result,
+                                GError **error)
+{
+  g_return_val_if_fail (GRL_IS_MEDIA_ITERATOR (iterator), NULL);
+  g_return_val_if_fail (g_task_is_valid (result, iterator), NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+/**
+ * grl_media_iterator_is_done:
+ * @iterator: an iterator
+ *
+ * Returns: %TRUE if the source has no more elements for @iterator, or the
+ * requested number of elements was already received.
+ *
+ * Since: 0.3.20
+ */
+gboolean
+grl_media_iterator_is_done (GrlMediaIterator *iterator)
+{
+  g_return_val_if_fail (GRL_IS_MEDIA_ITERATOR (iterator), TRUE);
+
+  return iterator->priv->done;
+}
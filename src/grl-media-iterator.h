@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2026 Grilo Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#if !defined (_GRILO_H_INSIDE_) && !defined (GRILO_COMPILATION)
+#error "Only <grilo.h> can be included directly."
+#endif
+
+#ifndef _GRL_MEDIA_ITERATOR_H_
+#define _GRL_MEDIA_ITERATOR_H_
+
+#include <glib.h>
+#include <glib-object.h>
+#include <gio/gio.h>
+#include <grl-source.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GrlMediaIteratorPrivate GrlMediaIteratorPrivate;
+
+typedef struct {
+  GObject parent;
+
+  /*< private >*/
+  GrlMediaIteratorPrivate *priv;
+
+  gpointer _grl_reserved[GRL_PADDING_SMALL];
+} GrlMediaIterator;
+
+/**
+ * GrlMediaIteratorClass:
+ * @parent: the parent class structure
+ *
+ * Grilo media iterator class.
+ */
+typedef struct {
+  GObjectClass parent;
+
+  /*< private >*/
+  gpointer _grl_reserved[GRL_PADDING];
+} GrlMediaIteratorClass;
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GrlMediaIterator, g_object_unref)
+
+#define GRL_TYPE_MEDIA_ITERATOR (grl_media_iterator_get_type ())
+#define GRL_MEDIA_ITERATOR(obj) (G_TYPE_CHECK_INSTANCE_CAST ((obj), GRL_TYPE_MEDIA_ITERATOR, GrlMediaIterator))
+#define GRL_MEDIA_ITERATOR_CLASS(klass) (G_TYPE_CHECK_CLASS_CAST ((klass), GRL_TYPE_MEDIA_ITERATOR, GrlMediaIteratorClass))
+#define GRL_IS_MEDIA_ITERATOR(obj) (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GRL_TYPE_MEDIA_ITERATOR))
+#define GRL_IS_MEDIA_ITERATOR_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), GRL_TYPE_MEDIA_ITERATOR))
+#define GRL_MEDIA_ITERATOR_GET_CLASS(obj) (G_TYPE_INSTANCE_GET_CLASS ((obj), GRL_TYPE_MEDIA_ITERATOR, GrlMediaIteratorClass))
+
+GType grl_media_iterator_get_type (void);
+
+GrlMediaIterator *grl_media_iterator_new_browse (GrlSource *source,
+                                                 GrlMedia *container,
+                                                 const GList *keys,
+                                                 GrlOperationOptions *options);
+
+GrlMediaIterator *grl_media_iterator_new_search (GrlSource *source,
+                                                 const gchar *text,
+                                                 const GList *keys,
+                                                 GrlOperationOptions *options);
+
+GrlMediaIterator *grl_media_iterator_new_query (GrlSource *source,
+                                                const gchar *query,
+                                                const GList *keys,
+                                                GrlOperationOptions *options);
+
+void grl_media_iterator_next_async (GrlMediaIterator *iterator,
+                                    guint count,
+                                    GCancellable *cancellable,
+                                    GAsyncReadyCallback callback,
+                                    gpointer user_data);
+
+GList *grl_media_iterator_next_finish (GrlMediaIterator *iterator,
+                                       GAsyncResult *result,
+                                       GError **error);
+
+gboolean grl_media_iterator_is_done (GrlMediaIterator *iterator);
+
+G_END_DECLS
+
+#endif /* _GRL_MEDIA_ITERATOR_H_ */
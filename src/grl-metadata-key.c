@@ -689,6 +689,16 @@ grl_metadata_key_setup_system_keys (GrlRegistry *registry)
                                              GRL_METADATA_KEY_ALBUM_DISC_NUMBER,
                                              GRL_METADATA_KEY_URL,
                                              NULL);
+
+  grl_registry_register_metadata_key_system (registry,
+                                             g_param_spec_string ("continuation",
+                                                                  "Continuation",
+                                                                  "Opaque token to get the elements following this one from its source",
+                                                                  NULL,
+                                                                  G_PARAM_STATIC_STRINGS | G_PARAM_READWRITE),
+                                             GRL_METADATA_KEY_CONTINUATION,
+                                             GRL_METADATA_KEY_INVALID,
+                                             NULL);
 }
 
 /**
@@ -127,6 +127,7 @@ typedef enum {
 #define GRL_METADATA_KEY_ALBUM_ARTIST         60
 #define GRL_METADATA_KEY_MB_RELEASE_ID        61
 #define GRL_METADATA_KEY_MB_RELEASE_GROUP_ID  62
+#define GRL_METADATA_KEY_CONTINUATION         63
 
 /* END CORE KEYS */
 
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2026 Grilo Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifndef _GRL_METADATA_STORE_PRIV_H_
+#define _GRL_METADATA_STORE_PRIV_H_
+
+#include <glib.h>
+#include <grl-metadata-key.h>
+
+#define GRL_METADATA_STORE_VAR "GRL_METADATA_STORE"
+
+/* On-disk log of resolved metadata. Records can be added from any thread;
+   they are written by a thread of the store */
+typedef struct _GrlMetadataStore GrlMetadataStore;
+
+/* @relkeys is a list of GrlRelatedKeys, owned by the callee; @stored is a
+   wall-clock time as returned by g_get_real_time() */
+typedef void (*GrlMetadataStoreValueFunc) (gint64 stored,
+                                           const gchar *resolver,
+                                           const gchar *media_source,
+                                           const gchar *media_id,
+                                           GrlKeyID key,
+                                           GList *relkeys,
+                                           gpointer user_data);
+
+typedef void (*GrlMetadataStoreInvalidateFunc) (const gchar *source_id,
+                                                const gchar *media_id,
+                                                gpointer user_data);
+
+GrlMetadataStore *grl_metadata_store_open (const gchar *path,
+                                           GrlMetadataStoreValueFunc value_func,
+                                           GrlMetadataStoreInvalidateFunc invalidate_func,
+                                           gpointer user_data,
+                                           GError **error);
+
+void grl_metadata_store_close (GrlMetadataStore *store);
+
+void grl_metadata_store_add_value (GrlMetadataStore *store,
+                                   gint64 stored,
+                                   const gchar *resolver,
+                                   const gchar *media_source,
+                                   const gchar *media_id,
+                                   GrlKeyID key,
+                                   GList *relkeys);
+
+void grl_metadata_store_add_invalidation (GrlMetadataStore *store,
+                                          const gchar *source_id,
+                                          const gchar *media_id);
+
+void grl_metadata_store_flush (GrlMetadataStore *store);
+
+gboolean grl_metadata_store_compact (GrlMetadataStore *store,
+                                     GError **error);
+
+#endif /* _GRL_METADATA_STORE_PRIV_H_ */
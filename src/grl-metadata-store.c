@@ -0,0 +1,1124 @@
+/*
+ * Copyright (C) 2026 Grilo Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/*
+ * Persistent log of the metadata kept by the resolve cache, so it survives
+ * restarts.
+ *
+ * The file starts with a magic string, followed by records. Each record is
+ * its payload length and a checksum of the payload, both 32-bit little
+ * endian, and the payload itself. A payload either sets the value of a key
+ * for a media, as resolved by a source, or drops what was known about a
+ * media or a source. Keys are stored by name, as their ids change between
+ * runs.
+ *
+ * Records are only appended. They are queued, and a thread of the store
+ * writes them in batches, so resolving metadata never waits for the disk.
+ * If a write fails, the file is truncated back to the end of the last
+ * complete record. When loading, the file is mapped in memory and replayed;
+ * a truncated or corrupted record, as left by a crash in the middle of a
+ * write, ends the replay, and the file is truncated there too.
+ *
+ * Once the file has doubled since it was last compacted, its records are
+ * scanned again, without decoding the values, to find those superseded by a
+ * later value of the same key or dropped by a later invalidation. A new
+ * file with the rest atomically replaces the old one. This does not depend
+ * on what the resolve cache keeps in memory, so values it evicted are still
+ * there after a restart.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <glib/gstdio.h>
+
+#ifdef G_OS_WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "grl-metadata-store-priv.h"
+#include "grl-registry.h"
+#include "grl-log-priv.h"
+#include "data/grl-related-keys.h"
+
+#define GRL_LOG_DOMAIN_DEFAULT cache_log_domain
+
+#define STORE_MAGIC "GRLMDS\001\000"
+#define STORE_MAGIC_SIZE 8
+#define RECORD_HEADER_SIZE 8
+
+/* Records are compacted when there are more than twice the ones left by
+   the last compaction, and at least this many were added since */
+#define COMPACTION_MIN_RECORDS 256
+
+/* Time records are held so those added together are written at once */
+#define STORE_WRITE_DELAY (100 * G_TIME_SPAN_MILLISECOND)
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+enum {
+  RECORD_VALUE = 1,
+  RECORD_INVALIDATE = 2
+};
+
+enum {
+  VALUE_STRING = 1,
+  VALUE_INT,
+  VALUE_INT64,
+  VALUE_FLOAT,
+  VALUE_BOOLEAN,
+  VALUE_DATE_TIME,
+  VALUE_BINARY
+};
+
+struct _GrlMetadataStore {
+  gchar *path;
+  GThread *writer;
+
+  /* Only used by the writer thread once the store is open */
+  gint fd;
+  gsize size;
+  guint records;
+  guint compacted_records;
+
+  /* Guarded by @lock */
+  GMutex lock;
+  GCond cond;
+  GByteArray *pending;
+  guint pending_records;
+  gboolean writing;
+  guint flushing;
+  gboolean closing;
+  guint compactions_requested;
+  guint compactions_done;
+  GError *compaction_error;
+};
+
+typedef struct {
+  gsize offset;
+  gsize length;
+  gboolean live;
+} RecordSpan;
+
+typedef struct {
+  const guint8 *data;
+  gsize size;
+  gsize pos;
+  gboolean error;
+} Reader;
+
+static guint32
+checksum (const guint8 *data,
+          gsize size)
+{
+  /* FNV-1a; it is only meant to catch torn writes */
+  guint32 hash = 2166136261U;
+  gsize i;
+
+  for (i = 0; i < size; i++) {
+    hash ^= data[i];
+    hash *= 16777619U;
+  }
+
+  return hash;
+}
+
+/* ================ Encoding ================ */
+
+static void
+put_u8 (GByteArray *buffer,
+        guint8 value)
+{
+  g_byte_array_append (buffer, &value, 1);
+}
+
+static void
+put_u32 (GByteArray *buffer,
+         guint32 value)
+{
+  value = GUINT32_TO_LE (value);
+  g_byte_array_append (buffer, (guint8 *) &value, sizeof (value));
+}
+
+static void
+put_i64 (GByteArray *buffer,
+         gint64 value)
+{
+  guint64 le = GUINT64_TO_LE ((guint64) value);
+
+  g_byte_array_append (buffer, (guint8 *) &le, sizeof (le));
+}
+
+static void
+put_data (GByteArray *buffer,
+          const guint8 *data,
+          gsize size)
+{
+  put_u32 (buffer, size);
+  g_byte_array_append (buffer, data, size);
+}
+
+static void
+put_string (GByteArray *buffer,
+            const gchar *str)
+{
+  if (!str) {
+    put_u32 (buffer, G_MAXUINT32);
+    return;
+  }
+
+  put_data (buffer, (const guint8 *) str, strlen (str));
+}
+
+static gboolean
+put_value (GByteArray *buffer,
+           const GValue *value)
+{
+  GByteArray *array;
+  GDateTime *date_time;
+  gchar *str;
+  union {
+    gfloat f;
+    guint32 u;
+  } float_bits;
+
+  if (G_VALUE_HOLDS_STRING (value)) {
+    put_u8 (buffer, VALUE_STRING);
+    put_string (buffer, g_value_get_string (value));
+  } else if (G_VALUE_HOLDS_INT (value)) {
+    put_u8 (buffer, VALUE_INT);
+    put_u32 (buffer, (guint32) g_value_get_int (value));
+  } else if (G_VALUE_HOLDS_INT64 (value)) {
+    put_u8 (buffer, VALUE_INT64);
+    put_i64 (buffer, g_value_get_int64 (value));
+  } else if (G_VALUE_HOLDS_FLOAT (value)) {
+    put_u8 (buffer, VALUE_FLOAT);
+    float_bits.f = g_value_get_float (value);
+    put_u32 (buffer, float_bits.u);
+  } else if (G_VALUE_HOLDS_BOOLEAN (value)) {
+    put_u8 (buffer, VALUE_BOOLEAN);
+    put_u8 (buffer, g_value_get_boolean (value));
+  } else if (G_VALUE_HOLDS (value, G_TYPE_DATE_TIME)) {
+    date_time = g_value_get_boxed (value);
+    if (!date_time) {
+      return FALSE;
+    }
+    str = g_date_time_format_iso8601 (date_time);
+    put_u8 (buffer, VALUE_DATE_TIME);
+    put_string (buffer, str);
+    g_free (str);
+  } else if (G_VALUE_HOLDS (value, G_TYPE_BYTE_ARRAY)) {
+    array = g_value_get_boxed (value);
+    if (!array) {
+      return FALSE;
+    }
+    put_u8 (buffer, VALUE_BINARY);
+    put_data (buffer, array->data, array->len);
+  } else {
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* ================ Decoding ================ */
+
+static gboolean
+reader_ensure (Reader *reader,
+               gsize size)
+{
+  if (reader->error || reader->size - reader->pos < size) {
+    reader->error = TRUE;
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static guint8
+get_u8 (Reader *reader)
+{
+  if (!reader_ensure (reader, 1)) {
+    return 0;
+  }
+
+  return reader->data[reader->pos++];
+}
+
+static guint32
+get_u32 (Reader *reader)
+{
+  guint32 value;
+
+  if (!reader_ensure (reader, sizeof (value))) {
+    return 0;
+  }
+
+  memcpy (&value, reader->data + reader->pos, sizeof (value));
+  reader->pos += sizeof (value);
+
+  return GUINT32_FROM_LE (value);
+}
+
+static gint64
+get_i64 (Reader *reader)
+{
+  guint64 value;
+
+  if (!reader_ensure (reader, sizeof (value))) {
+    return 0;
+  }
+
+  memcpy (&value, reader->data + reader->pos, sizeof (value));
+  reader->pos += sizeof (value);
+
+  return (gint64) GUINT64_FROM_LE (value);
+}
+
+static const guint8 *
+get_data (Reader *reader,
+          gsize *size)
+{
+  const guint8 *data;
+
+  *size = get_u32 (reader);
+  if (*size == G_MAXUINT32 || !reader_ensure (reader, *size)) {
+    return NULL;
+  }
+
+  data = reader->data + reader->pos;
+  reader->pos += *size;
+
+  return data;
+}
+
+static gchar *
+get_string (Reader *reader)
+{
+  const guint8 *data;
+  gsize size;
+
+  data = get_data (reader, &size);
+  if (!data) {
+    return NULL;
+  }
+
+  return g_strndup ((const gchar *) data, size);
+}
+
+static gboolean
+get_value (Reader *reader,
+           GValue *value)
+{
+  GByteArray *array;
+  GDateTime *date_time;
+  const guint8 *data;
+  gsize size;
+  gchar *str;
+  union {
+    gfloat f;
+    guint32 u;
+  } float_bits;
+
+  switch (get_u8 (reader)) {
+  case VALUE_STRING:
+    g_value_init (value, G_TYPE_STRING);
+    g_value_take_string (value, get_string (reader));
+    break;
+  case VALUE_INT:
+    g_value_init (value, G_TYPE_INT);
+    g_value_set_int (value, (gint) get_u32 (reader));
+    break;
+  case VALUE_INT64:
+    g_value_init (value, G_TYPE_INT64);
+    g_value_set_int64 (value, get_i64 (reader));
+    break;
+  case VALUE_FLOAT:
+    g_value_init (value, G_TYPE_FLOAT);
+    float_bits.u = get_u32 (reader);
+    g_value_set_float (value, float_bits.f);
+    break;
+  case VALUE_BOOLEAN:
+    g_value_init (value, G_TYPE_BOOLEAN);
+    g_value_set_boolean (value, get_u8 (reader) != 0);
+    break;
+  case VALUE_DATE_TIME:
+    str = get_string (reader);
+    date_time = str ? g_date_time_new_from_iso8601 (str, NULL) : NULL;
+    g_free (str);
+    if (!date_time) {
+      return FALSE;
+    }
+    g_value_init (value, G_TYPE_DATE_TIME);
+    g_value_take_boxed (value, date_time);
+    break;
+  case VALUE_BINARY:
+    data = get_data (reader, &size);
+    if (!data) {
+      return FALSE;
+    }
+    array = g_byte_array_sized_new (size);
+    g_byte_array_append (array, data, size);
+    g_value_init (value, G_TYPE_BYTE_ARRAY);
+    g_value_take_boxed (value, array);
+    break;
+  default:
+    return FALSE;
+  }
+
+  return !reader->error;
+}
+
+static GrlKeyID
+get_key (Reader *reader)
+{
+  GrlKeyID key = GRL_METADATA_KEY_INVALID;
+  gchar *name;
+
+  name = get_string (reader);
+  if (name) {
+    key = grl_registry_lookup_metadata_key (grl_registry_get_default (), name);
+    g_free (name);
+  }
+
+  return key;
+}
+
+static GrlRelatedKeys *
+get_related_keys (Reader *reader,
+                  gboolean *valid)
+{
+  GrlRelatedKeys *relkeys;
+  GValue value = G_VALUE_INIT;
+  GrlKeyID key;
+  guint32 i, n_keys;
+
+  relkeys = grl_related_keys_new ();
+  n_keys = get_u32 (reader);
+  for (i = 0; i < n_keys && !reader->error; i++) {
+    key = get_key (reader);
+    if (!get_value (reader, &value)) {
+      *valid = FALSE;
+      break;
+    }
+    /* Keys that are not registered in this run are dropped */
+    if (key == GRL_METADATA_KEY_INVALID) {
+      *valid = FALSE;
+    } else {
+      grl_related_keys_set (relkeys, key, &value);
+    }
+    g_value_unset (&value);
+  }
+
+  return relkeys;
+}
+
+static void
+replay_record (Reader *reader,
+               GrlMetadataStoreValueFunc value_func,
+               GrlMetadataStoreInvalidateFunc invalidate_func,
+               gpointer user_data)
+{
+  gchar *resolver, *media_source, *media_id;
+  GList *relkeys = NULL;
+  gboolean valid = TRUE;
+  GrlKeyID key;
+  gint64 stored;
+  guint32 i, n_relkeys;
+
+  switch (get_u8 (reader)) {
+  case RECORD_VALUE:
+    stored = get_i64 (reader);
+    resolver = get_string (reader);
+    media_source = get_string (reader);
+    media_id = get_string (reader);
+    key = get_key (reader);
+    n_relkeys = get_u32 (reader);
+    for (i = 0; i < n_relkeys && !reader->error; i++) {
+      relkeys = g_list_prepend (relkeys, get_related_keys (reader, &valid));
+    }
+    relkeys = g_list_reverse (relkeys);
+
+    if (valid && !reader->error && resolver && media_id &&
+        key != GRL_METADATA_KEY_INVALID) {
+      value_func (stored, resolver, media_source, media_id, key, relkeys, user_data);
+    } else {
+      g_list_free_full (relkeys, g_object_unref);
+    }
+    g_free (resolver);
+    g_free (media_source);
+    g_free (media_id);
+    break;
+  case RECORD_INVALIDATE:
+    media_source = get_string (reader);
+    media_id = get_string (reader);
+    if (!reader->error) {
+      invalidate_func (media_source, media_id, user_data);
+    }
+    g_free (media_source);
+    g_free (media_id);
+    break;
+  default:
+    GRL_DEBUG ("Unknown record in metadata store");
+    break;
+  }
+}
+
+/* ================ Compaction ================ */
+
+/* Values of a media: resolver and key name -> index + 1 of their span */
+static GHashTable *
+index_get_values (GHashTable *medias,
+                  const gchar *media_source,
+                  const gchar *media_id)
+{
+  GHashTable *values;
+  gchar *media_key;
+
+  media_key = g_strconcat (media_source ? media_source : "", "\x1f", media_id, NULL);
+  values = g_hash_table_lookup (medias, media_key);
+  if (!values) {
+    values = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    g_hash_table_insert (medias, media_key, values);
+  } else {
+    g_free (media_key);
+  }
+
+  return values;
+}
+
+static void
+index_drop_value (GArray *spans,
+                  gpointer index)
+{
+  g_array_index (spans, RecordSpan, GPOINTER_TO_UINT (index) - 1).live = FALSE;
+}
+
+static void
+index_drop_values (GArray *spans,
+                   GHashTable *values)
+{
+  GHashTableIter iter;
+  gpointer index;
+
+  g_hash_table_iter_init (&iter, values);
+  while (g_hash_table_iter_next (&iter, NULL, &index)) {
+    index_drop_value (spans, index);
+  }
+}
+
+/* Drops what is known about @media_id of @source_id, as
+   grl_resolve_cache_invalidate() does in memory */
+static void
+index_invalidate (GArray *spans,
+                  GHashTable *medias,
+                  const gchar *source_id,
+                  const gchar *media_id)
+{
+  GHashTableIter media_iter, value_iter;
+  GHashTable *values;
+  const gchar *media_key, *value_key;
+  gpointer index;
+  gchar *prefix;
+
+  prefix = g_strconcat (source_id ? source_id : "", "\x1f", media_id, NULL);
+
+  if (media_id) {
+    values = g_hash_table_lookup (medias, prefix);
+    if (values) {
+      index_drop_values (spans, values);
+      g_hash_table_remove (medias, prefix);
+    }
+    g_free (prefix);
+    return;
+  }
+
+  g_hash_table_iter_init (&media_iter, medias);
+  while (g_hash_table_iter_next (&media_iter, (gpointer *) &media_key, (gpointer *) &values)) {
+    if (g_str_has_prefix (media_key, prefix)) {
+      index_drop_values (spans, values);
+      g_hash_table_iter_remove (&media_iter);
+      continue;
+    }
+    g_hash_table_iter_init (&value_iter, values);
+    while (g_hash_table_iter_next (&value_iter, (gpointer *) &value_key, &index)) {
+      if (g_str_has_prefix (value_key, prefix)) {
+        index_drop_value (spans, index);
+        g_hash_table_iter_remove (&value_iter);
+      }
+    }
+  }
+  g_free (prefix);
+}
+
+/* Finds out which records the one at @index makes dead, and whether it is
+   live itself. Invalidations only affect the records before them, so they
+   are never needed once applied */
+static void
+index_record (Reader *reader,
+              GArray *spans,
+              GHashTable *medias,
+              guint index)
+{
+  gchar *resolver, *media_source, *media_id, *key, *value_key;
+  GHashTable *values;
+  gpointer old_index;
+
+  switch (get_u8 (reader)) {
+  case RECORD_VALUE:
+    get_i64 (reader);
+    resolver = get_string (reader);
+    media_source = get_string (reader);
+    media_id = get_string (reader);
+    key = get_string (reader);
+    if (!reader->error && resolver && media_id && key) {
+      values = index_get_values (medias, media_source, media_id);
+      value_key = g_strconcat (resolver, "\x1f", key, NULL);
+      old_index = g_hash_table_lookup (values, value_key);
+      if (old_index) {
+        index_drop_value (spans, old_index);
+      }
+      g_hash_table_insert (values, value_key, GUINT_TO_POINTER (index + 1));
+      g_array_index (spans, RecordSpan, index).live = TRUE;
+    }
+    g_free (resolver);
+    g_free (media_source);
+    g_free (media_id);
+    g_free (key);
+    break;
+  case RECORD_INVALIDATE:
+    media_source = get_string (reader);
+    media_id = get_string (reader);
+    if (!reader->error) {
+      index_invalidate (spans, medias, media_source, media_id);
+    }
+    g_free (media_source);
+    g_free (media_id);
+    break;
+  default:
+    break;
+  }
+}
+
+/* ================ Store ================ */
+
+static gboolean
+store_write_all (gint fd,
+                 const guint8 *data,
+                 gsize size)
+{
+  gssize written;
+
+  while (size > 0) {
+    written = write (fd, data, size);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return FALSE;
+    }
+    data += written;
+    size -= written;
+  }
+
+  return TRUE;
+}
+
+static gboolean
+store_truncate (gint fd,
+                gsize size)
+{
+#ifdef G_OS_WIN32
+  return _chsize_s (fd, size) == 0;
+#else
+  return ftruncate (fd, size) == 0;
+#endif
+}
+
+/* Opens the file to append records after the first @size bytes, dropping
+   whatever follows them */
+static gboolean
+store_open_file (GrlMetadataStore *store,
+                 gsize size,
+                 GError **error)
+{
+  gchar *dir;
+
+  dir = g_path_get_dirname (store->path);
+  g_mkdir_with_parents (dir, 0700);
+  g_free (dir);
+
+  store->fd = g_open (store->path, O_WRONLY | O_CREAT | O_APPEND | O_BINARY, 0600);
+  if (store->fd < 0) {
+    g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+                 "Could not open metadata store '%s'", store->path);
+    return FALSE;
+  }
+
+  if (!store_truncate (store->fd, size) ||
+      (size == 0 &&
+       !store_write_all (store->fd, (const guint8 *) STORE_MAGIC, STORE_MAGIC_SIZE))) {
+    g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+                 "Could not write metadata store '%s'", store->path);
+    close (store->fd);
+    store->fd = -1;
+    return FALSE;
+  }
+  store->size = MAX (size, STORE_MAGIC_SIZE);
+
+  return TRUE;
+}
+
+static void
+store_append (GrlMetadataStore *store,
+              GByteArray *batch,
+              guint records)
+{
+  if (store->fd < 0) {
+    return;
+  }
+
+  if (store_write_all (store->fd, batch->data, batch->len)) {
+    store->size += batch->len;
+    store->records += records;
+    return;
+  }
+
+  GRL_WARNING ("Could not write to metadata store '%s': %s",
+               store->path, g_strerror (errno));
+
+  /* Records appended after an incomplete one would be lost */
+  if (!store_truncate (store->fd, store->size)) {
+    GRL_WARNING ("Could not truncate metadata store '%s', not writing to it any more",
+                 store->path);
+    close (store->fd);
+    store->fd = -1;
+  }
+}
+
+static gboolean
+store_needs_compaction (GrlMetadataStore *store)
+{
+  return store->records > 2 * store->compacted_records &&
+    store->records - store->compacted_records >= COMPACTION_MIN_RECORDS;
+}
+
+/* Rewrites the file with only the records that are still live */
+static gboolean
+store_compact (GrlMetadataStore *store,
+               GError **error)
+{
+  GMappedFile *mapped;
+  GHashTable *medias;
+  GByteArray *compacted;
+  GArray *spans;
+  RecordSpan span;
+  Reader reader;
+  const guint8 *data;
+  gsize size, pos;
+  guint32 length;
+  guint i, live = 0;
+  gboolean success = TRUE;
+
+  if (store->fd < 0) {
+    return TRUE;
+  }
+
+  mapped = g_mapped_file_new (store->path, FALSE, error);
+  if (!mapped) {
+    return FALSE;
+  }
+
+  /* Only the writer thread appends, so the file holds complete records up
+     to the size known to be good */
+  data = (const guint8 *) g_mapped_file_get_contents (mapped);
+  size = MIN (g_mapped_file_get_length (mapped), store->size);
+
+  spans = g_array_new (FALSE, FALSE, sizeof (RecordSpan));
+  medias = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                  g_free,
+                                  (GDestroyNotify) g_hash_table_unref);
+
+  for (pos = STORE_MAGIC_SIZE; size - pos >= RECORD_HEADER_SIZE; pos += span.length) {
+    memcpy (&length, data + pos, sizeof (length));
+    length = GUINT32_FROM_LE (length);
+    if (size - pos - RECORD_HEADER_SIZE < length) {
+      break;
+    }
+
+    span.offset = pos;
+    span.length = RECORD_HEADER_SIZE + length;
+    span.live = FALSE;
+    g_array_append_val (spans, span);
+
+    reader.data = data + pos + RECORD_HEADER_SIZE;
+    reader.size = length;
+    reader.pos = 0;
+    reader.error = FALSE;
+    index_record (&reader, spans, medias, spans->len - 1);
+  }
+  g_hash_table_unref (medias);
+
+  for (i = 0; i < spans->len; i++) {
+    if (g_array_index (spans, RecordSpan, i).live) {
+      live++;
+    }
+  }
+
+  if (live < spans->len) {
+    compacted = g_byte_array_new ();
+    g_byte_array_append (compacted, (const guint8 *) STORE_MAGIC, STORE_MAGIC_SIZE);
+    for (i = 0; i < spans->len; i++) {
+      span = g_array_index (spans, RecordSpan, i);
+      if (span.live) {
+        g_byte_array_append (compacted, data + span.offset, span.length);
+      }
+    }
+
+    /* Replaces the old file atomically */
+    success = g_file_set_contents (store->path,
+                                   (const gchar *) compacted->data,
+                                   compacted->len,
+                                   error);
+    if (success) {
+      close (store->fd);
+      success = store_open_file (store, compacted->len, error);
+    }
+    g_byte_array_unref (compacted);
+  }
+
+  g_mapped_file_unref (mapped);
+  g_array_unref (spans);
+
+  if (success) {
+    GRL_DEBUG ("Compacted metadata store '%s' from %u to %u records",
+               store->path, store->records, live);
+    store->records = live;
+    store->compacted_records = live;
+  }
+
+  return success;
+}
+
+static gpointer
+store_writer_thread (gpointer user_data)
+{
+  GrlMetadataStore *store = user_data;
+  GByteArray *batch;
+  GError *error = NULL;
+  guint records;
+  guint compactions;
+  gboolean compact;
+  gint64 deadline;
+
+  g_mutex_lock (&store->lock);
+
+  for (;;) {
+    while (!store->pending_records && !store->closing &&
+           store->compactions_done == store->compactions_requested) {
+      g_cond_wait (&store->cond, &store->lock);
+    }
+
+    if (!store->pending_records &&
+        store->compactions_done == store->compactions_requested) {
+      break;
+    }
+
+    /* Let the records added together go in the same write */
+    deadline = g_get_monotonic_time () + STORE_WRITE_DELAY;
+    while (!store->closing && !store->flushing &&
+           store->compactions_done == store->compactions_requested &&
+           g_cond_wait_until (&store->cond, &store->lock, deadline));
+
+    batch = store->pending;
+    records = store->pending_records;
+    store->pending = g_byte_array_new ();
+    store->pending_records = 0;
+    compactions = store->compactions_requested;
+    compact = compactions != store->compactions_done;
+    store->writing = TRUE;
+    g_mutex_unlock (&store->lock);
+
+    if (records > 0) {
+      store_append (store, batch, records);
+    }
+    g_byte_array_unref (batch);
+
+    if (compact || store_needs_compaction (store)) {
+      if (!store_compact (store, &error)) {
+        GRL_WARNING ("Could not compact metadata store '%s': %s",
+                     store->path, error->message);
+      }
+    }
+
+    g_mutex_lock (&store->lock);
+    if (compact) {
+      g_clear_error (&store->compaction_error);
+      store->compaction_error = error;
+      store->compactions_done = compactions;
+    } else {
+      g_clear_error (&error);
+    }
+    error = NULL;
+    store->writing = FALSE;
+    g_cond_broadcast (&store->cond);
+  }
+
+  g_mutex_unlock (&store->lock);
+
+  return NULL;
+}
+
+static void
+store_queue (GrlMetadataStore *store,
+             GByteArray *payload)
+{
+  g_mutex_lock (&store->lock);
+  put_u32 (store->pending, payload->len);
+  put_u32 (store->pending, checksum (payload->data, payload->len));
+  g_byte_array_append (store->pending, payload->data, payload->len);
+  store->pending_records++;
+  g_cond_broadcast (&store->cond);
+  g_mutex_unlock (&store->lock);
+}
+
+/*
+ * Opens the store in @path, creating it if needed, and replays its records
+ * through @value_func and @invalidate_func.
+ */
+GrlMetadataStore *
+grl_metadata_store_open (const gchar *path,
+                         GrlMetadataStoreValueFunc value_func,
+                         GrlMetadataStoreInvalidateFunc invalidate_func,
+                         gpointer user_data,
+                         GError **error)
+{
+  GrlMetadataStore *store;
+  GMappedFile *mapped;
+  Reader reader;
+  const guint8 *data;
+  gsize size, pos;
+  guint32 length;
+  guint32 sum;
+
+  g_return_val_if_fail (path != NULL, NULL);
+
+  store = g_slice_new0 (GrlMetadataStore);
+  store->path = g_strdup (path);
+  store->fd = -1;
+  store->pending = g_byte_array_new ();
+  g_mutex_init (&store->lock);
+  g_cond_init (&store->cond);
+
+  mapped = g_mapped_file_new (path, FALSE, NULL);
+  if (mapped) {
+    data = (const guint8 *) g_mapped_file_get_contents (mapped);
+    size = g_mapped_file_get_length (mapped);
+  } else {
+    data = NULL;
+    size = 0;
+  }
+
+  if (!mapped) {
+    /* New store */
+    pos = 0;
+  } else if (size < STORE_MAGIC_SIZE || memcmp (data, STORE_MAGIC, STORE_MAGIC_SIZE) != 0) {
+    GRL_WARNING ("'%s' is not a metadata store, overwriting it", path);
+    pos = 0;
+  } else {
+    pos = STORE_MAGIC_SIZE;
+  }
+
+  while (pos > 0 && pos < size) {
+    if (size - pos < RECORD_HEADER_SIZE) {
+      break;
+    }
+    memcpy (&length, data + pos, sizeof (length));
+    memcpy (&sum, data + pos + sizeof (length), sizeof (sum));
+    length = GUINT32_FROM_LE (length);
+    sum = GUINT32_FROM_LE (sum);
+    if (size - pos - RECORD_HEADER_SIZE < length ||
+        checksum (data + pos + RECORD_HEADER_SIZE, length) != sum) {
+      break;
+    }
+
+    reader.data = data + pos + RECORD_HEADER_SIZE;
+    reader.size = length;
+    reader.pos = 0;
+    reader.error = FALSE;
+    replay_record (&reader, value_func, invalidate_func, user_data);
+
+    store->records++;
+    pos += RECORD_HEADER_SIZE + length;
+  }
+
+  if (pos > 0 && pos < size) {
+    GRL_DEBUG ("Dropping %" G_GSIZE_FORMAT " bytes at the end of metadata store '%s'",
+               size - pos, path);
+  }
+
+  g_clear_pointer (&mapped, g_mapped_file_unref);
+
+  GRL_DEBUG ("Loaded %u records from metadata store '%s'", store->records, path);
+
+  /* Appending after an incomplete record would make the new ones be lost
+     too, so the file is truncated after the last complete one */
+  if (!store_open_file (store, pos, error)) {
+    grl_metadata_store_close (store);
+    return NULL;
+  }
+
+  store->writer = g_thread_new ("grl-metadata-store", store_writer_thread, store);
+
+  return store;
+}
+
+/*
+ * Writes the records still queued and closes the store.
+ */
+void
+grl_metadata_store_close (GrlMetadataStore *store)
+{
+  if (store->writer) {
+    g_mutex_lock (&store->lock);
+    store->closing = TRUE;
+    g_cond_broadcast (&store->cond);
+    g_mutex_unlock (&store->lock);
+    g_thread_join (store->writer);
+  }
+
+  if (store->fd >= 0) {
+    close (store->fd);
+  }
+  g_byte_array_unref (store->pending);
+  g_clear_error (&store->compaction_error);
+  g_mutex_clear (&store->lock);
+  g_cond_clear (&store->cond);
+  g_free (store->path);
+  g_slice_free (GrlMetadataStore, store);
+}
+
+/*
+ * Waits until the records added so far are written.
+ */
+void
+grl_metadata_store_flush (GrlMetadataStore *store)
+{
+  g_mutex_lock (&store->lock);
+  store->flushing++;
+  g_cond_broadcast (&store->cond);
+  while (store->pending_records || store->writing) {
+    g_cond_wait (&store->cond, &store->lock);
+  }
+  store->flushing--;
+  g_mutex_unlock (&store->lock);
+}
+
+void
+grl_metadata_store_add_value (GrlMetadataStore *store,
+                              gint64 stored,
+                              const gchar *resolver,
+                              const gchar *media_source,
+                              const gchar *media_id,
+                              GrlKeyID key,
+                              GList *relkeys)
+{
+  GByteArray *payload;
+  GList *each_relkeys, *related, *each_related;
+  GrlKeyID related_key;
+  gboolean valid = TRUE;
+
+  payload = g_byte_array_new ();
+  put_u8 (payload, RECORD_VALUE);
+  put_i64 (payload, stored);
+  put_string (payload, resolver);
+  put_string (payload, media_source);
+  put_string (payload, media_id);
+  put_string (payload, grl_metadata_key_get_name (key));
+  put_u32 (payload, g_list_length (relkeys));
+  for (each_relkeys = relkeys;
+       each_relkeys && valid;
+       each_relkeys = g_list_next (each_relkeys)) {
+    related = grl_related_keys_get_keys (each_relkeys->data);
+    put_u32 (payload, g_list_length (related));
+    for (each_related = related;
+         each_related && valid;
+         each_related = g_list_next (each_related)) {
+      related_key = GRLPOINTER_TO_KEYID (each_related->data);
+      put_string (payload, grl_metadata_key_get_name (related_key));
+      valid = put_value (payload,
+                         grl_related_keys_get (each_relkeys->data, related_key));
+    }
+    g_list_free (related);
+  }
+
+  /* Values that can not be serialized are just not persisted */
+  if (valid) {
+    store_queue (store, payload);
+  }
+
+  g_byte_array_unref (payload);
+}
+
+void
+grl_metadata_store_add_invalidation (GrlMetadataStore *store,
+                                     const gchar *source_id,
+                                     const gchar *media_id)
+{
+  GByteArray *payload;
+
+  payload = g_byte_array_new ();
+  put_u8 (payload, RECORD_INVALIDATE);
+  put_string (payload, source_id);
+  put_string (payload, media_id);
+  store_queue (store, payload);
+  g_byte_array_unref (payload);
+}
+
+/*
+ * Writes the records added so far, and rewrites the file without the
+ * records that are not live any more. This is done on its own when the file
+ * grows too much.
+ */
+gboolean
+grl_metadata_store_compact (GrlMetadataStore *store,
+                            GError **error)
+{
+  gboolean success;
+  guint compaction;
+
+  g_mutex_lock (&store->lock);
+  compaction = ++store->compactions_requested;
+  g_cond_broadcast (&store->cond);
+  while (store->compactions_done < compaction) {
+    g_cond_wait (&store->cond, &store->lock);
+  }
+  success = store->compaction_error == NULL;
+  if (!success) {
+    g_propagate_error (error, g_error_copy (store->compaction_error));
+  }
+  g_mutex_unlock (&store->lock);
+
+  return success;
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2026 Grilo Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifndef _GRL_METRICS_PRIV_H_
+#define _GRL_METRICS_PRIV_H_
+
+#include <glib.h>
+#include <grilo.h>
+
+#define GRL_METRICS_VAR "GRL_METRICS"
+
+/* Start time of a sample, or 0 if metrics are disabled */
+gint64 grl_metrics_start (void);
+
+void grl_metrics_record (GrlSource *source,
+                         GrlSupportedOps operation,
+                         GrlMetricsKind kind,
+                         gint64 start,
+                         guint results,
+                         gboolean failed);
+
+/* Requests sent to sources, identified by their operation */
+void grl_metrics_call_start (GrlSource *source,
+                             GrlSupportedOps operation,
+                             guint operation_id);
+
+void grl_metrics_call_result (guint operation_id,
+                              guint results,
+                              gboolean last,
+                              const GError *error);
+
+void grl_metrics_call_forget (guint operation_id);
+
+#endif /* _GRL_METRICS_PRIV_H_ */
@@ -0,0 +1,474 @@
+/*
+ * Copyright (C) 2026 Grilo Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/**
+ * SECTION:grl-metrics
+ * @short_description: Latencies and counters of the sources
+ *
+ * When enabled, either with grl_metrics_set_enabled(), the
+ * <literal>--grl-metrics</literal> option or the
+ * <literal>GRL_METRICS</literal> environment variable, Grilo measures how
+ * long the sources take to answer requests, how long they take to complete
+ * the elements of other sources, and how long results wait in the core
+ * before being delivered. Measures are grouped by source, type of operation
+ * and kind of work, and can be read with grl_metrics_get_entries().
+ */
+
+#include "grl-metrics.h"
+#include "grl-metrics-priv.h"
+
+/* Time a source has been working on a request */
+struct MetricsCall {
+  gchar *source_id;
+  GrlSupportedOps operation;
+  gint64 start;
+  guint results;
+};
+
+G_DEFINE_BOXED_TYPE (GrlMetricsEntry, grl_metrics_entry,
+                     (GBoxedCopyFunc) grl_metrics_entry_dup,
+                     (GBoxedFreeFunc) grl_metrics_entry_free)
+
+static gint metrics_enabled = FALSE;
+static GMutex metrics_lock;
+/* Entries by source, operation and kind */
+static GHashTable *metrics_entries = NULL;
+/* Ongoing requests by operation id */
+static GHashTable *metrics_calls = NULL;
+
+static void
+metrics_call_free (struct MetricsCall *call)
+{
+  g_free (call->source_id);
+  g_slice_free (struct MetricsCall, call);
+}
+
+static guint
+metrics_bucket (gint64 elapsed)
+{
+  guint bucket = 0;
+
+  while (bucket < GRL_METRICS_N_BUCKETS - 1 &&
+         elapsed >= grl_metrics_get_bucket_limit (bucket)) {
+    bucket++;
+  }
+
+  return bucket;
+}
+
+/* Must be called with the lock held */
+static void
+metrics_add_sample (const gchar *source_id,
+                    GrlSupportedOps operation,
+                    GrlMetricsKind kind,
+                    gint64 elapsed,
+                    guint results,
+                    gboolean failed)
+{
+  GrlMetricsEntry *entry;
+  gchar *key;
+
+  if (!metrics_entries) {
+    metrics_entries = g_hash_table_new_full (g_str_hash,
+                                             g_str_equal,
+                                             g_free,
+                                             (GDestroyNotify) grl_metrics_entry_free);
+  }
+
+  key = g_strdup_printf ("%s:%u:%u", source_id, operation, kind);
+  entry = g_hash_table_lookup (metrics_entries, key);
+  if (!entry) {
+    entry = g_slice_new0 (GrlMetricsEntry);
+    entry->source_id = g_strdup (source_id);
+    entry->operation = operation;
+    entry->kind = kind;
+    entry->min_time = G_MAXINT64;
+    g_hash_table_insert (metrics_entries, key, entry);
+  } else {
+    g_free (key);
+  }
+
+  entry->count++;
+  entry->errors += failed? 1: 0;
+  entry->results += results;
+  entry->total_time += elapsed;
+  entry->min_time = MIN (entry->min_time, elapsed);
+  entry->max_time = MAX (entry->max_time, elapsed);
+  entry->buckets[metrics_bucket (elapsed)]++;
+}
+
+static const gchar *
+metrics_operation_name (GrlSupportedOps operation)
+{
+  switch (operation) {
+  case GRL_OP_RESOLVE:
+    return "resolve";
+  case GRL_OP_BROWSE:
+    return "browse";
+  case GRL_OP_SEARCH:
+    return "search";
+  case GRL_OP_QUERY:
+    return "query";
+  case GRL_OP_STORE:
+    return "store";
+  case GRL_OP_STORE_PARENT:
+    return "store-parent";
+  case GRL_OP_STORE_METADATA:
+    return "store-metadata";
+  case GRL_OP_REMOVE:
+    return "remove";
+  case GRL_OP_MEDIA_FROM_URI:
+    return "media-from-uri";
+  default:
+    return "other";
+  }
+}
+
+static const gchar *
+metrics_kind_name (GrlMetricsKind kind)
+{
+  switch (kind) {
+  case GRL_METRICS_KIND_CALL:
+    return "call";
+  case GRL_METRICS_KIND_DECORATE:
+    return "decorate";
+  case GRL_METRICS_KIND_QUEUE:
+    return "queue";
+  default:
+    return "other";
+  }
+}
+
+static gint
+metrics_entry_compare (const GrlMetricsEntry *a,
+                       const GrlMetricsEntry *b)
+{
+  gint result;
+
+  result = g_strcmp0 (a->source_id, b->source_id);
+  if (result == 0) {
+    result = (gint) a->operation - (gint) b->operation;
+  }
+  if (result == 0) {
+    result = (gint) a->kind - (gint) b->kind;
+  }
+
+  return result;
+}
+
+gint64
+grl_metrics_start (void)
+{
+  if (!g_atomic_int_get (&metrics_enabled)) {
+    return 0;
+  }
+
+  return g_get_monotonic_time ();
+}
+
+void
+grl_metrics_record (GrlSource *source,
+                    GrlSupportedOps operation,
+                    GrlMetricsKind kind,
+                    gint64 start,
+                    guint results,
+                    gboolean failed)
+{
+  gint64 elapsed;
+
+  if (start == 0 || !g_atomic_int_get (&metrics_enabled)) {
+    return;
+  }
+
+  elapsed = g_get_monotonic_time () - start;
+
+  g_mutex_lock (&metrics_lock);
+  metrics_add_sample (grl_source_get_id (source), operation, kind,
+                      elapsed, results, failed);
+  g_mutex_unlock (&metrics_lock);
+}
+
+void
+grl_metrics_call_start (GrlSource *source,
+                        GrlSupportedOps operation,
+                        guint operation_id)
+{
+  struct MetricsCall *call;
+
+  if (!g_atomic_int_get (&metrics_enabled)) {
+    return;
+  }
+
+  call = g_slice_new (struct MetricsCall);
+  call->source_id = g_strdup (grl_source_get_id (source));
+  call->operation = operation;
+  call->start = g_get_monotonic_time ();
+  call->results = 0;
+
+  g_mutex_lock (&metrics_lock);
+  if (!metrics_calls) {
+    metrics_calls = g_hash_table_new_full (g_direct_hash,
+                                           g_direct_equal,
+                                           NULL,
+                                           (GDestroyNotify) metrics_call_free);
+  }
+  g_hash_table_insert (metrics_calls, GUINT_TO_POINTER (operation_id), call);
+  g_mutex_unlock (&metrics_lock);
+}
+
+void
+grl_metrics_call_result (guint operation_id,
+                         guint results,
+                         gboolean last,
+                         const GError *error)
+{
+  struct MetricsCall *call;
+
+  if (!metrics_calls) {
+    return;
+  }
+
+  g_mutex_lock (&metrics_lock);
+  call = g_hash_table_lookup (metrics_calls, GUINT_TO_POINTER (operation_id));
+  if (call) {
+    call->results += results;
+    if (last) {
+      metrics_add_sample (call->source_id, call->operation,
+                          GRL_METRICS_KIND_CALL,
+                          g_get_monotonic_time () - call->start,
+                          call->results, error != NULL);
+      g_hash_table_remove (metrics_calls, GUINT_TO_POINTER (operation_id));
+    }
+  }
+  g_mutex_unlock (&metrics_lock);
+}
+
+void
+grl_metrics_call_forget (guint operation_id)
+{
+  if (!metrics_calls) {
+    return;
+  }
+
+  g_mutex_lock (&metrics_lock);
+  g_hash_table_remove (metrics_calls, GUINT_TO_POINTER (operation_id));
+  g_mutex_unlock (&metrics_lock);
+}
+
+/**
+ * grl_metrics_set_enabled:
+ * @enabled: whether metrics must be recorded
+ *
+ * Starts or stops recording metrics. Metrics already recorded are kept.
+ *
+ * Since: 0.3.20
+ */
+void
+grl_metrics_set_enabled (gboolean enabled)
+{
+  g_atomic_int_set (&metrics_enabled, enabled);
+}
+
+/**
+ * grl_metrics_get_enabled:
+ *
+ * Returns: %TRUE if metrics are being recorded.
+ *
+ * Since: 0.3.20
+ */
+gboolean
+grl_metrics_get_enabled (void)
+{
+  return g_atomic_int_get (&metrics_enabled);
+}
+
+/**
+ * grl_metrics_reset:
+ *
+ * Drops all the metrics recorded so far.
+ *
+ * Since: 0.3.20
+ */
+void
+grl_metrics_reset (void)
+{
+  g_mutex_lock (&metrics_lock);
+  if (metrics_entries) {
+    g_hash_table_remove_all (metrics_entries);
+  }
+  g_mutex_unlock (&metrics_lock);
+}
+
+/**
+ * grl_metrics_get_entries:
+ *
+ * Takes a snapshot of the metrics recorded so far.
+ *
+ * Returns: (transfer full) (element-type GrlMetricsEntry): the metrics,
+ * sorted by source, operation and kind. Free it with
+ * <literal>g_list_free_full (list, (GDestroyNotify) grl_metrics_entry_free)</literal>.
+ *
+ * Since: 0.3.20
+ */
+GList *
+grl_metrics_get_entries (void)
+{
+  GHashTableIter iter;
+  GrlMetricsEntry *entry;
+  GList *entries = NULL;
+
+  g_mutex_lock (&metrics_lock);
+  if (metrics_entries) {
+    g_hash_table_iter_init (&iter, metrics_entries);
+    while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry)) {
+      entries = g_list_prepend (entries, grl_metrics_entry_dup (entry));
+    }
+  }
+  g_mutex_unlock (&metrics_lock);
+
+  return g_list_sort (entries, (GCompareFunc) metrics_entry_compare);
+}
+
+/**
+ * grl_metrics_get_bucket_limit:
+ * @bucket: a bucket of the histograms, lower than %GRL_METRICS_N_BUCKETS
+ *
+ * Bucket 0 holds the samples shorter than a millisecond; each of the next
+ * ones holds the samples shorter than twice the limit of the previous one.
+ * The last bucket holds all the longer samples.
+ *
+ * Returns: the limit, in microseconds, of the samples in @bucket, or
+ * %G_MAXINT64 for the last one.
+ *
+ * Since: 0.3.20
+ */
+gint64
+grl_metrics_get_bucket_limit (guint bucket)
+{
+  g_return_val_if_fail (bucket < GRL_METRICS_N_BUCKETS, G_MAXINT64);
+
+  if (bucket == GRL_METRICS_N_BUCKETS - 1) {
+    return G_MAXINT64;
+  }
+
+  return (gint64) 1000 << bucket;
+}
+
+/**
+ * grl_metrics_dump:
+ *
+ * Formats the metrics recorded so far as a human readable table.
+ *
+ * Returns: (transfer full): the table. Free it with g_free().
+ *
+ * Since: 0.3.20
+ */
+gchar *
+grl_metrics_dump (void)
+{
+  GString *dump;
+  GList *entries;
+  GList *each;
+  guint i;
+
+  dump = g_string_new (NULL);
+  g_string_append_printf (dump, "%-24s %-15s %-9s %8s %7s %8s %10s %10s %10s %10s\n",
+                          "Source", "Operation", "Kind", "Count", "Errors",
+                          "Results", "Avg (ms)", "Min (ms)", "Max (ms)",
+                          "Results/s");
+
+  entries = grl_metrics_get_entries ();
+  for (each = entries; each; each = g_list_next (each)) {
+    GrlMetricsEntry *entry = each->data;
+    gdouble total_ms = entry->total_time / 1000.0;
+
+    g_string_append_printf (dump, "%-24s %-15s %-9s %8" G_GUINT64_FORMAT
+                            " %7" G_GUINT64_FORMAT " %8" G_GUINT64_FORMAT
+                            " %10.2f %10.2f %10.2f %10.1f\n",
+                            entry->source_id,
+                            metrics_operation_name (entry->operation),
+                            metrics_kind_name (entry->kind),
+                            entry->count,
+                            entry->errors,
+                            entry->results,
+                            entry->count? total_ms / entry->count: 0.0,
+                            entry->min_time / 1000.0,
+                            entry->max_time / 1000.0,
+                            total_ms > 0? entry->results * 1000.0 / total_ms: 0.0);
+
+    g_string_append (dump, "  histogram:");
+    for (i = 0; i < GRL_METRICS_N_BUCKETS; i++) {
+      if (entry->buckets[i] == 0) {
+        continue;
+      }
+      if (i == GRL_METRICS_N_BUCKETS - 1) {
+        g_string_append_printf (dump, " >=%" G_GINT64_FORMAT "ms:%" G_GUINT64_FORMAT,
+                                grl_metrics_get_bucket_limit (i - 1) / 1000,
+                                entry->buckets[i]);
+      } else {
+        g_string_append_printf (dump, " <%" G_GINT64_FORMAT "ms:%" G_GUINT64_FORMAT,
+                                grl_metrics_get_bucket_limit (i) / 1000,
+                                entry->buckets[i]);
+      }
+    }
+    g_string_append_c (dump, '\n');
+  }
+  g_list_free_full (entries, (GDestroyNotify) grl_metrics_entry_free);
+
+  return g_string_free (dump, FALSE);
+}
+
+/**
+ * grl_metrics_entry_dup:
+ * @entry: a #GrlMetricsEntry
+ *
+ * Returns: (transfer full): a copy of @entry.
+ *
+ * Since: 0.3.20
+ */
+GrlMetricsEntry *
+grl_metrics_entry_dup (const GrlMetricsEntry *entry)
+{
+  GrlMetricsEntry *copy;
+
+  g_return_val_if_fail (entry != NULL, NULL);
+
+  copy = g_slice_dup (GrlMetricsEntry, entry);
+  copy->source_id = g_strdup (entry->source_id);
+
+  return copy;
+}
+
+/**
+ * grl_metrics_entry_free:
+ * @entry: a #GrlMetricsEntry
+ *
+ * Frees @entry.
+ *
+ * Since: 0.3.20
+ */
+void
+grl_metrics_entry_free (GrlMetricsEntry *entry)
+{
+  g_return_if_fail (entry != NULL);
+
+  g_free (entry->source_id);
+  g_slice_free (GrlMetricsEntry, entry);
+}
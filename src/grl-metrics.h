@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2026 Grilo Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#if !defined (_GRILO_H_INSIDE_) && !defined (GRILO_COMPILATION)
+#error "Only <grilo.h> can be included directly."
+#endif
+
+#ifndef _GRL_METRICS_H_
+#define _GRL_METRICS_H_
+
+#include <glib.h>
+#include <glib-object.h>
+#include <grl-source.h>
+
+G_BEGIN_DECLS
+
+/**
+ * GRL_METRICS_N_BUCKETS:
+ *
+ * Number of buckets in the latency histograms of #GrlMetricsEntry.
+ *
+ * Since: 0.3.20
+ */
+#define GRL_METRICS_N_BUCKETS 16
+
+/**
+ * GrlMetricsKind:
+ * @GRL_METRICS_KIND_CALL: Time a source takes to answer a request, from the
+ * call to its last result.
+ * @GRL_METRICS_KIND_DECORATE: Time a source takes to complete the elements
+ * of operations in other sources, including the wait for a free slot.
+ * @GRL_METRICS_KIND_QUEUE: Time the results of a source wait in the core
+ * before being delivered to the user.
+ *
+ * What the samples of a #GrlMetricsEntry measure.
+ *
+ * Since: 0.3.20
+ */
+typedef enum {
+  GRL_METRICS_KIND_CALL,
+  GRL_METRICS_KIND_DECORATE,
+  GRL_METRICS_KIND_QUEUE
+} GrlMetricsKind;
+
+/**
+ * GrlMetricsEntry:
+ * @source_id: the identifier of the source
+ * @operation: the type of operation
+ * @kind: what the samples measure
+ * @count: number of samples
+ * @errors: number of samples that ended with an error
+ * @results: number of elements sent by the source
+ * @total_time: sum of the samples, in microseconds
+ * @min_time: shortest sample, in microseconds
+ * @max_time: longest sample, in microseconds
+ * @buckets: number of samples in each bucket of the histogram, see
+ * grl_metrics_get_bucket_limit()
+ *
+ * Latencies and counters of a kind of work of a source.
+ *
+ * Since: 0.3.20
+ */
+typedef struct {
+  gchar *source_id;
+  GrlSupportedOps operation;
+  GrlMetricsKind kind;
+  guint64 count;
+  guint64 errors;
+  guint64 results;
+  gint64 total_time;
+  gint64 min_time;
+  gint64 max_time;
+  guint64 buckets[GRL_METRICS_N_BUCKETS];
+} GrlMetricsEntry;
+
+#define GRL_TYPE_METRICS_ENTRY (grl_metrics_entry_get_type ())
+
+GType grl_metrics_entry_get_type (void);
+
+GrlMetricsEntry *grl_metrics_entry_dup (const GrlMetricsEntry *entry);
+
+void grl_metrics_entry_free (GrlMetricsEntry *entry);
+
+void grl_metrics_set_enabled (gboolean enabled);
+
+gboolean grl_metrics_get_enabled (void);
+
+void grl_metrics_reset (void);
+
+GList *grl_metrics_get_entries (void);
+
+gint64 grl_metrics_get_bucket_limit (guint bucket);
+
+gchar *grl_metrics_dump (void);
+
+G_END_DECLS
+
+#endif /* _GRL_METRICS_H_ */
@@ -43,6 +43,7 @@
 #include "grl-operation.h"
 #include "grl-operation-priv.h"
 #include "grl-registry.h"
+#include "grl-registry-priv.h"
 #include "grl-error.h"
 #include "grl-log.h"
 
@@ -66,6 +67,9 @@ struct MultipleSearchData {
   gchar *text;
   GrlOperationOptions *options;
   GrlSourceResultCb user_callback;
+  GrlSourceBatchResultCb batch_callback;
+  GPtrArray *batch;
+  guint batch_remaining;
   gpointer user_data;
 };
 
@@ -74,16 +78,25 @@ struct ResultCount {
   guint remaining;
   guint received;
   guint skip;
+  /* Token the request started from, and token sent in its last element if
+     the source declares them in its caps */
+  gboolean use_continuation;
+  gchar *continuation;
+  gchar *next_continuation;
 };
 
 struct CallbackData {
   GrlSourceResultCb user_callback;
+  GrlSourceBatchResultCb batch_callback;
   gpointer user_data;
 };
 
 struct MediaFromUriCallbackData {
   GList/*<unowned GrlSource>*/ *sources;  /* owned */
   GList/*<unowned GrlSource>*/ *iter;  /* unowned */
+  /* Sources from here on did not declare a prefix of the URI */
+  GList/*<unowned GrlSource>*/ *untested;  /* unowned */
+  gboolean testing;
   gchar *uri;  /* owned */
   GList/*<int>*/ *keys;  /* owned */
   GrlOperationOptions *options;  /* owned */
@@ -91,6 +104,27 @@ struct MediaFromUriCallbackData {
   gpointer user_data;
 };
 
+/* A media_from_uri request to one of the sources probed in parallel */
+struct MediaFromUriProbe {
+  struct MediaFromUriParallelData *mfupd;
+  GrlSource *source;
+  guint operation_id;
+  gboolean finished;
+  GrlMedia *media;
+};
+
+struct MediaFromUriParallelData {
+  struct MediaFromUriProbe *probes;  /* owned, in order of preference */
+  guint n_probes;
+  guint pending;
+  /* Most preferred probe that might still succeed */
+  guint best;
+  gboolean done;
+  gchar *uri;  /* owned */
+  GrlSourceResolveCb user_callback;
+  gpointer user_data;
+};
+
 static void multiple_search_cb (GrlSource *source,
                                 guint search_id,
                                 GrlMedia *media,
@@ -98,6 +132,13 @@ static void multiple_search_cb (GrlSource *source,
                                 gpointer user_data,
                                 const GError *error);
 
+static void multiple_search_batch_cb (GrlSource *source,
+                                      guint search_id,
+                                      GPtrArray *medias,
+                                      guint remaining,
+                                      gpointer user_data,
+                                      const GError *error);
+
 static void multiple_search_cancel_cb (struct MultipleSearchData *msd);
 
 /* ================ Utitilies ================ */
@@ -112,15 +153,73 @@ free_multiple_search_data (struct MultipleSearchData *msd)
   g_list_free (msd->sources_more);
   g_list_free (msd->keys);
   g_object_unref (msd->options);
+  g_clear_pointer (&msd->batch, g_ptr_array_unref);
   g_free (msd->text);
   g_free (msd);
 }
 
+/* Sends the results accumulated in a batched multiple search. If @last is
+   TRUE the batch is sent even if empty, telling the user the operation is
+   finished */
+static void
+multiple_search_flush (struct MultipleSearchData *msd,
+                       GrlSource *source,
+                       gboolean last)
+{
+  GPtrArray *batch;
+
+  if (msd->batch->len == 0 && !last) {
+    return;
+  }
+
+  batch = msd->batch;
+  msd->batch = g_ptr_array_new_with_free_func (g_object_unref);
+  msd->batch_callback (source,
+                       msd->search_id,
+                       batch,
+                       last ? 0 : msd->batch_remaining,
+                       msd->user_data,
+                       NULL);
+}
+
+static void
+multiple_search_emit (struct MultipleSearchData *msd,
+                      GrlSource *source,
+                      GrlMedia *media,
+                      guint remaining)
+{
+  if (media) {
+    grl_operation_add_delivered (msd->search_id, 1);
+  }
+
+  if (!msd->batch_callback) {
+    msd->user_callback (source, msd->search_id, media, remaining,
+                        msd->user_data, NULL);
+    return;
+  }
+
+  if (media) {
+    g_ptr_array_add (msd->batch, media);
+  }
+  msd->batch_remaining = remaining;
+
+  if (remaining == 0) {
+    multiple_search_flush (msd, source, TRUE);
+  }
+}
+
 static gboolean
 confirm_cancel_idle (gpointer user_data)
 {
   struct MultipleSearchData *msd = (struct MultipleSearchData *) user_data;
-  msd->user_callback (NULL, msd->search_id, NULL, 0, msd->user_data, NULL);
+
+  if (msd->batch_callback) {
+    /* Results not sent yet are discarded */
+    g_ptr_array_set_size (msd->batch, 0);
+    multiple_search_flush (msd, NULL, TRUE);
+  } else {
+    msd->user_callback (NULL, msd->search_id, NULL, 0, msd->user_data, NULL);
+  }
   return FALSE;
 }
 
@@ -132,7 +231,13 @@ handle_no_searchable_sources_idle (gpointer user_data)
 
   error = g_error_new (GRL_CORE_ERROR, GRL_CORE_ERROR_SEARCH_FAILED,
                        _("No searchable sources available"));
-  callback_data->user_callback (NULL, 0, NULL, 0, callback_data->user_data, error);
+  if (callback_data->batch_callback) {
+    callback_data->batch_callback (NULL, 0,
+                                   g_ptr_array_new_with_free_func (g_object_unref),
+                                   0, callback_data->user_data, error);
+  } else {
+    callback_data->user_callback (NULL, 0, NULL, 0, callback_data->user_data, error);
+  }
 
   g_error_free (error);
   g_free (callback_data);
@@ -141,14 +246,27 @@ handle_no_searchable_sources_idle (gpointer user_data)
 }
 
 static void
-handle_no_searchable_sources (GrlSourceResultCb callback, gpointer user_data)
+handle_no_searchable_sources (GrlSourceResultCb callback,
+                              GrlSourceBatchResultCb batch_callback,
+                              gpointer user_data)
 {
   struct CallbackData *callback_data = g_new0 (struct CallbackData, 1);
-  guint id;
   callback_data->user_callback = callback;
+  callback_data->batch_callback = batch_callback;
   callback_data->user_data = user_data;
-  id = g_idle_add (handle_no_searchable_sources_idle, callback_data);
-  g_source_set_name_by_id (id, "[grilo] handle_no_searchable_sources_idle");
+  grl_operation_idle_add (G_PRIORITY_DEFAULT_IDLE,
+                          handle_no_searchable_sources_idle,
+                          callback_data,
+                          NULL,
+                          "[grilo] handle_no_searchable_sources_idle");
+}
+
+static void
+result_count_free (struct ResultCount *rc)
+{
+  g_free (rc->continuation);
+  g_free (rc->next_continuation);
+  g_free (rc);
 }
 
 static struct MultipleSearchData *
@@ -156,23 +274,24 @@ start_multiple_search_operation (guint search_id,
 				 const GList *sources,
 				 const gchar *text,
 				 const GList *keys,
-				 const GList *skip_counts,
+				 const GList *previous_counts,
 				 gint count,
 				 GrlOperationOptions *options,
 				 GrlSourceResultCb user_callback,
+				 GrlSourceBatchResultCb batch_callback,
 				 gpointer user_data)
 {
   GRL_DEBUG ("start_multiple_search_operation");
 
   struct MultipleSearchData *msd;
-  GList *iter_sources, *iter_skips;
+  GList *iter_sources, *iter_previous;
   guint n;
   gint first_count, individual_count;
 
   /* Prepare data required to execute the operation */
   msd = g_new0 (struct MultipleSearchData, 1);
   msd->table = g_hash_table_new_full (g_direct_hash, g_direct_equal,
-				      NULL, g_free);
+				      NULL, (GDestroyNotify) result_count_free);
   msd->remaining =
       (count == GRL_COUNT_INFINITY) ? GRL_COUNT_INFINITY : (count - 1);
   msd->search_id = search_id;
@@ -180,7 +299,11 @@ start_multiple_search_operation (guint search_id,
   msd->keys = g_list_copy ((GList *) keys);
   msd->options = g_object_ref (options);
   msd->user_callback = user_callback;
+  msd->batch_callback = batch_callback;
   msd->user_data = user_data;
+  if (batch_callback) {
+    msd->batch = g_ptr_array_new_with_free_func (g_object_unref);
+  }
 
   /* Compute the # of items to request by each source */
   n = g_list_length ((GList *) sources);
@@ -194,12 +317,13 @@ start_multiple_search_operation (guint search_id,
 
   /* Issue search operations on each source */
   iter_sources = (GList *) sources;
-  iter_skips = (GList *) skip_counts;
+  iter_previous = (GList *) previous_counts;
   n = 0;
   while (iter_sources) {
     GrlSource *source;
     guint c, id;
-    struct ResultCount *rc;
+    struct ResultCount *rc, *previous;
+    const gchar *continuation;
     guint skip;
 
     source = GRL_SOURCE (iter_sources->data);
@@ -214,30 +338,50 @@ start_multiple_search_operation (guint search_id,
       GrlCaps *source_caps;
 
       /* We use ResultCount to keep track of results emitted by this source */
+      source_caps = grl_source_get_caps (source, GRL_OP_SEARCH);
       rc = g_new0 (struct ResultCount, 1);
       rc->count = c;
+      rc->use_continuation = grl_caps_get_continuation_supported (source_caps);
       g_hash_table_insert (msd->table, source, rc);
 
-      /* Check if we have to apply a "skip" parameter to this source
-	 (useful when we are chaining queries to complete the result count) */
-      if (iter_skips) {
-	skip = GPOINTER_TO_INT (iter_skips->data);
+      /* Check if we have to continue after the results already sent by this
+	 source (useful when we are chaining queries to complete the result
+	 count). The source token is preferred to skipping the results */
+      previous = iter_previous ? iter_previous->data : NULL;
+      if (previous && previous->next_continuation) {
+        continuation = previous->next_continuation;
+        skip = 0;
+      } else if (previous) {
+        continuation = previous->continuation;
+        skip = previous->skip + previous->count;
       } else {
-	skip = 0;
+        continuation = NULL;
+        skip = 0;
       }
+      rc->skip = skip;
+      rc->continuation = g_strdup (continuation);
 
-      source_caps = grl_source_get_caps (source, GRL_OP_SEARCH);
       grl_operation_options_obey_caps (options, source_caps, &source_options, NULL);
       grl_operation_options_set_skip (source_options, skip);
       grl_operation_options_set_count (source_options, rc->count);
+      grl_operation_options_set_continuation (source_options, continuation);
 
       /* Execute the search on this source */
-      id = grl_source_search (source,
-				    msd->text,
-				    msd->keys,
-				    source_options,
-				    multiple_search_cb,
-				    msd);
+      if (msd->batch_callback) {
+        id = grl_source_search_batch (source,
+                                      msd->text,
+                                      msd->keys,
+                                      source_options,
+                                      multiple_search_batch_cb,
+                                      msd);
+      } else {
+        id = grl_source_search (source,
+                                msd->text,
+                                msd->keys,
+                                source_options,
+                                multiple_search_cb,
+                                msd);
+      }
 
       GRL_DEBUG ("Operation %s:%u: Searching %u items from offset %u",
                  grl_source_get_name (GRL_SOURCE (source)),
@@ -253,7 +397,7 @@ start_multiple_search_operation (guint search_id,
 
     /* Move to the next source */
     iter_sources = g_list_next (iter_sources);
-    iter_skips = g_list_next (iter_skips);
+    iter_previous = g_list_next (iter_previous);
   }
 
   /* This frees the previous msd structure (if this operation is chained) */
@@ -268,25 +412,24 @@ start_multiple_search_operation (guint search_id,
 static struct MultipleSearchData *
 chain_multiple_search_operation (struct MultipleSearchData *old_msd)
 {
-  GList *skip_list = NULL;
+  GList *previous_list = NULL;
   GList *source_iter;
   struct ResultCount *rc;
   GrlSource *source;
   struct MultipleSearchData *msd;
 
-  /* Compute skip parameter for each of the sources that can still
-     provide more results */
+  /* Collect where each of the sources that can still provide more results
+     stopped */
   source_iter = old_msd->sources_more;
   while (source_iter) {
     source = GRL_SOURCE (source_iter->data);
     rc = (struct ResultCount *)
       g_hash_table_lookup (old_msd->table, (gpointer) source);
-    skip_list = g_list_prepend (skip_list,
-				GINT_TO_POINTER (rc->count + rc->skip));
+    previous_list = g_list_prepend (previous_list, rc);
     source_iter = g_list_next (source_iter);
   }
 
-  /* Reverse the sources list so that they match the skip list */
+  /* Reverse the sources list so that they match the previous list */
   old_msd->sources_more = g_list_reverse (old_msd->sources_more);
 
   /* Continue the search process with the same search_id */
@@ -294,12 +437,13 @@ chain_multiple_search_operation (struct MultipleSearchData *old_msd)
 					 old_msd->sources_more,
 					 old_msd->text,
 					 old_msd->keys,
-					 skip_list,
+					 previous_list,
 					 old_msd->pending,
 					 old_msd->options,
 					 old_msd->user_callback,
+					 old_msd->batch_callback,
 					 old_msd->user_data);
-  g_list_free (skip_list);
+  g_list_free (previous_list);
 
   return msd;
 }
@@ -391,6 +535,10 @@ multiple_search_cb (GrlSource *source,
 
   if (media) {
     rc->received++;
+    if (rc->use_continuation) {
+      g_free (rc->next_continuation);
+      rc->next_continuation = g_strdup (grl_media_get_continuation (media));
+    }
   }
 
   rc->remaining = remaining;
@@ -424,12 +572,13 @@ multiple_search_cb (GrlSource *source,
   /* --- Result emission --- */
 
   if (emit) {
-    msd->user_callback (source,
-  		        msd->search_id,
- 		        media,
-		        msd->remaining--,
-		        msd->user_data,
-		        NULL);
+    multiple_search_emit (msd, source, media, msd->remaining--);
+  }
+
+  /* Batched results are sent when a source finishes, before the operation
+     data can be replaced by a chained operation or released */
+  if (msd->batch_callback && remaining == 0) {
+    multiple_search_flush (msd, source, FALSE);
   }
 
   /* --- Manage pending results --- */
@@ -443,12 +592,7 @@ multiple_search_cb (GrlSource *source,
   } else if (operation_done && msd->pending > 0) {
     /* We don't have sources capable of providing more results,
        finish operation now */
-    msd->user_callback (source,
-			msd->search_id,
-			NULL,
-			0,
-			msd->user_data,
-			NULL);
+    multiple_search_emit (msd, source, NULL, 0);
     goto operation_done;
   } else if (operation_done) {
     /* We provided all the results */
@@ -463,6 +607,39 @@ multiple_search_cb (GrlSource *source,
   grl_operation_remove (msd->search_id);
 }
 
+static void
+multiple_search_batch_cb (GrlSource *source,
+                          guint search_id,
+                          GPtrArray *medias,
+                          guint remaining,
+                          gpointer user_data,
+                          const GError *error)
+{
+  struct MultipleSearchData *msd = (struct MultipleSearchData *) user_data;
+  guint i;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  /* Account each element of the batch as if it was sent individually; only the
+     last one can finish the operation */
+  for (i = 0; i < medias->len; i++) {
+    multiple_search_cb (source,
+                        search_id,
+                        g_object_ref (g_ptr_array_index (medias, i)),
+                        remaining + medias->len - 1 - i,
+                        msd,
+                        error);
+  }
+
+  if (medias->len == 0) {
+    multiple_search_cb (source, search_id, NULL, remaining, msd, error);
+  } else if (remaining > 0) {
+    multiple_search_flush (msd, source, FALSE);
+  }
+
+  g_ptr_array_unref (medias);
+}
+
 static void
 free_media_from_uri_data (struct MediaFromUriCallbackData *mfucd)
 {
@@ -492,11 +669,17 @@ media_from_uri_cb (GrlSource *source,
     return;
   }
 
-  /* Try the next source. */
+  /* Try the next source. Sources found by the prefix of the URI do not need
+   * to be tested. */
   for (; !found && mfucd->iter != NULL; mfucd->iter = mfucd->iter->next) {
     GrlSource *next_source = GRL_SOURCE (mfucd->iter->data);
 
-    if (grl_source_test_media_from_uri (next_source, mfucd->uri)) {
+    if (mfucd->iter == mfucd->untested) {
+      mfucd->testing = TRUE;
+    }
+
+    if (!mfucd->testing ||
+        grl_source_test_media_from_uri (next_source, mfucd->uri)) {
       grl_source_get_media_from_uri (next_source, mfucd->uri, mfucd->keys,
                                      mfucd->options, media_from_uri_cb, mfucd);
       found = TRUE;
@@ -520,38 +703,93 @@ media_from_uri_cb (GrlSource *source,
   }
 }
 
+static void
+free_media_from_uri_parallel_data (struct MediaFromUriParallelData *mfupd)
+{
+  guint i;
+
+  GRL_DEBUG ("free_media_from_uri_parallel_data");
+  for (i = 0; i < mfupd->n_probes; i++) {
+    g_clear_object (&mfupd->probes[i].media);
+  }
+  g_free (mfupd->probes);
+  g_free (mfupd->uri);
+  g_free (mfupd);
+}
+
+static void
+media_from_uri_parallel_cb (GrlSource *source,
+                            guint operation_id,
+                            GrlMedia *media,
+                            gpointer user_data,
+                            const GError *error)
+{
+  struct MediaFromUriProbe *probe = (struct MediaFromUriProbe *) user_data;
+  struct MediaFromUriParallelData *mfupd = probe->mfupd;
+  struct MediaFromUriProbe *best;
+  GError *_error;
+  guint i;
+
+  probe->finished = TRUE;
+  mfupd->pending--;
+
+  if (error) {
+    g_clear_object (&media);
+  }
+  probe->media = media;
+
+  if (!mfupd->done) {
+    /* Skip the failed ones; a success is only delivered once the sources
+     * preferred to it have failed */
+    while (mfupd->best < mfupd->n_probes &&
+           mfupd->probes[mfupd->best].finished &&
+           !mfupd->probes[mfupd->best].media) {
+      mfupd->best++;
+    }
+
+    if (mfupd->best == mfupd->n_probes) {
+      mfupd->done = TRUE;
+      _error = g_error_new (GRL_CORE_ERROR,
+                            GRL_CORE_ERROR_MEDIA_FROM_URI_FAILED,
+                            _("Could not resolve media for URI “%s”"),
+                            mfupd->uri);
+      mfupd->user_callback (NULL, 0, NULL, mfupd->user_data, _error);
+      g_error_free (_error);
+    } else if (mfupd->probes[mfupd->best].finished) {
+      mfupd->done = TRUE;
+      best = &mfupd->probes[mfupd->best];
+
+      GRL_DEBUG ("media from uri: '%s' answered by '%s'",
+                 mfupd->uri, grl_source_get_id (best->source));
+
+      for (i = 0; i < mfupd->n_probes; i++) {
+        if (!mfupd->probes[i].finished) {
+          grl_operation_cancel (mfupd->probes[i].operation_id);
+        }
+      }
+
+      media = best->media;
+      best->media = NULL;
+      mfupd->user_callback (best->source, 0, media, mfupd->user_data, NULL);
+    }
+  }
+
+  /* Cancelled requests still answer */
+  if (mfupd->pending == 0) {
+    free_media_from_uri_parallel_data (mfupd);
+  }
+}
+
 /* ================ API ================ */
 
-/**
- * grl_multiple_search:
- * @sources: (element-type GrlSource) (allow-none):
- * a #GList of #GrlSource<!-- -->s to search from (%NULL for all
- * searchable sources)
- * @text: the text to search for
- * @keys: (element-type GrlKeyID): the #GList of
- * #GrlKeyID to retrieve
- * @options: options wanted for that operation
- * @callback: (scope notified): the user defined callback
- * @user_data: the user data to pass to the user callback
- *
- * Search for @text in all the sources specified in @sources.
- *
- * If @text is @NULL then NULL-text searchs will be used for each searchable
- * plugin (see #grl_source_search for more details).
- *
- * This method is asynchronous.
- *
- * Returns: the operation identifier
- *
- * Since: 0.2.0
- */
-guint
-grl_multiple_search (const GList *sources,
-		     const gchar *text,
-		     const GList *keys,
-		     GrlOperationOptions *options,
-		     GrlSourceResultCb callback,
-		     gpointer user_data)
+static guint
+run_multiple_search (const GList *sources,
+                     const gchar *text,
+                     const GList *keys,
+                     GrlOperationOptions *options,
+                     GrlSourceResultCb callback,
+                     GrlSourceBatchResultCb batch_callback,
+                     gpointer user_data)
 {
   GrlRegistry *registry;
   GList *sources_list;
@@ -559,9 +797,7 @@ grl_multiple_search (const GList *sources,
   gboolean allocated_sources_list = FALSE;
   guint operation_id;
 
-  GRL_DEBUG ("grl_multiple_search");
-
-  g_return_val_if_fail (callback != NULL, 0);
+  g_return_val_if_fail (callback != NULL || batch_callback != NULL, 0);
   g_return_val_if_fail (GRL_IS_OPERATION_OPTIONS (options), 0);
 
   /* If no sources have been provided then get the list of all
@@ -575,7 +811,7 @@ grl_multiple_search (const GList *sources,
     if (sources_list == NULL) {
       /* No searchable sources? Raise error and bail out */
       g_list_free (sources_list);
-      handle_no_searchable_sources (callback, user_data);
+      handle_no_searchable_sources (callback, batch_callback, user_data);
       return 0;
     } else {
       sources = sources_list;
@@ -585,6 +821,8 @@ grl_multiple_search (const GList *sources,
 
   /* Start multiple search operation */
   operation_id = grl_operation_generate_id ();
+  grl_operation_set_info (operation_id, GRL_OP_SEARCH, NULL);
+  grl_operation_set_state (operation_id, GRL_OPERATION_STATE_RUNNING);
   msd = start_multiple_search_operation (operation_id,
 					 sources,
 					 text,
@@ -593,6 +831,7 @@ grl_multiple_search (const GList *sources,
 					 grl_operation_options_get_count (options),
 					 options,
 					 callback,
+					 batch_callback,
 					 user_data);
   if  (allocated_sources_list) {
     g_list_free ((GList *) sources);
@@ -601,11 +840,91 @@ grl_multiple_search (const GList *sources,
   return msd->search_id;
 }
 
+/**
+ * grl_multiple_search:
+ * @sources: (element-type GrlSource) (allow-none):
+ * a #GList of #GrlSource<!-- -->s to search from (%NULL for all
+ * searchable sources)
+ * @text: the text to search for
+ * @keys: (element-type GrlKeyID): the #GList of
+ * #GrlKeyID to retrieve
+ * @options: options wanted for that operation
+ * @callback: (scope notified): the user defined callback
+ * @user_data: the user data to pass to the user callback
+ *
+ * Search for @text in all the sources specified in @sources.
+ *
+ * If @text is @NULL then NULL-text searchs will be used for each searchable
+ * plugin (see #grl_source_search for more details).
+ *
+ * This method is asynchronous.
+ *
+ * Returns: the operation identifier
+ *
+ * Since: 0.2.0
+ */
+guint
+grl_multiple_search (const GList *sources,
+		     const gchar *text,
+		     const GList *keys,
+		     GrlOperationOptions *options,
+		     GrlSourceResultCb callback,
+		     gpointer user_data)
+{
+  GRL_DEBUG ("grl_multiple_search");
+
+  g_return_val_if_fail (callback != NULL, 0);
+
+  return run_multiple_search (sources, text, keys, options,
+                              callback, NULL, user_data);
+}
+
+/**
+ * grl_multiple_search_batch:
+ * @sources: (element-type GrlSource) (allow-none):
+ * a #GList of #GrlSource<!-- -->s to search from (%NULL for all
+ * searchable sources)
+ * @text: the text to search for
+ * @keys: (element-type GrlKeyID): the #GList of
+ * #GrlKeyID to retrieve
+ * @options: options wanted for that operation
+ * @callback: (scope notified): the user defined callback
+ * @user_data: the user data to pass to the user callback
+ *
+ * Search for @text in all the sources specified in @sources, delivering the
+ * results in batches.
+ *
+ * Works like grl_multiple_search(), but @callback receives a #GPtrArray with
+ * the elements that were received from the sources since the previous
+ * invocation, instead of being invoked once per element. The last invocation
+ * of @callback has @remaining set to 0.
+ *
+ * This method is asynchronous.
+ *
+ * Returns: the operation identifier
+ *
+ * Since: 0.3.20
+ */
+guint
+grl_multiple_search_batch (const GList *sources,
+                           const gchar *text,
+                           const GList *keys,
+                           GrlOperationOptions *options,
+                           GrlSourceBatchResultCb callback,
+                           gpointer user_data)
+{
+  GRL_DEBUG ("grl_multiple_search_batch");
+
+  g_return_val_if_fail (callback != NULL, 0);
+
+  return run_multiple_search (sources, text, keys, options,
+                              NULL, callback, user_data);
+}
+
 static void
 multiple_search_cancel_cb (struct MultipleSearchData *msd)
 {
   GList *sources, *ids;
-  guint id;
 
   /* Go through all the sources involved in that operation and issue
      cancel() operations for each one */
@@ -623,8 +942,11 @@ multiple_search_cancel_cb (struct MultipleSearchData *msd)
   msd->cancelled = TRUE;
 
   /* Send operation finished message now to client (remaining == 0) */
-  id = g_idle_add (confirm_cancel_idle, msd);
-  g_source_set_name_by_id (id, "[grilo] confirm_cancel_idle");
+  grl_operation_idle_add (G_PRIORITY_DEFAULT_IDLE,
+                          confirm_cancel_idle,
+                          msd,
+                          NULL,
+                          "[grilo] confirm_cancel_idle");
 }
 
 /**
@@ -692,6 +1014,11 @@ grl_multiple_search_sync (const GList *sources,
  * constructing a GrlMedia object representing the media resource exposed
  * by @uri.
  *
+ * Sources declaring a prefix of @uri in #GrlSource:uri-prefixes are tried
+ * first, the ones with the longest prefix before. Then the rest of sources
+ * that declare no prefixes or implement test_media_from_uri are tried if
+ * grl_source_test_media_from_uri() is %TRUE for them.
+ *
  * This method is asynchronous.
  *
  * Since: 0.2.0
@@ -705,6 +1032,7 @@ grl_multiple_get_media_from_uri (const gchar *uri,
 {
   GrlRegistry *registry;
   GList *sources;
+  GList *untested;
   struct MediaFromUriCallbackData *mfucd;
 
   g_return_if_fail (uri != NULL);
@@ -713,17 +1041,15 @@ grl_multiple_get_media_from_uri (const gchar *uri,
   g_return_if_fail (GRL_IS_OPERATION_OPTIONS (options));
 
   registry = grl_registry_get_default ();
-  sources =
-    grl_registry_get_sources_by_operations (registry,
-                                            GRL_OP_MEDIA_FROM_URI,
-                                            TRUE);
+  sources = grl_registry_get_sources_for_uri (registry, uri, &untested);
 
   /* Iterate through the sources, trying each one which knows how to deal with
    * @uri, and continuing if it then returns %NULL for the media. */
   mfucd = g_new0 (struct MediaFromUriCallbackData, 1);
 
-  mfucd->sources = sources;  /* transfer */
-  mfucd->iter = sources;
+  mfucd->sources = g_list_concat (sources, untested);  /* transfer */
+  mfucd->iter = mfucd->sources;
+  mfucd->untested = untested;
   mfucd->user_callback = callback;
   mfucd->user_data = user_data;
   mfucd->uri = g_strdup (uri);
@@ -733,3 +1059,90 @@ grl_multiple_get_media_from_uri (const gchar *uri,
   /* Start the first iteration off. */
   media_from_uri_cb (NULL, 0, NULL, mfucd, NULL);
 }
+
+/**
+ * grl_multiple_get_media_from_uri_parallel:
+ * @uri: A URI that can be used to identify a media resource
+ * @keys: (element-type GrlKeyID): List of metadata keys we want to obtain.
+ * @options: options wanted for that operation
+ * @callback: (scope notified): the user defined callback
+ * @user_data: the user data to pass to the user callback
+ *
+ * Like grl_multiple_get_media_from_uri(), but asks all the sources capable of
+ * constructing a #GrlMedia for @uri at the same time instead of one after
+ * another.
+ *
+ * The media of the first source, in the order of
+ * grl_multiple_get_media_from_uri(), that constructs it is passed to
+ * @callback. It is delivered as soon as that source answers and the sources
+ * before it have failed, so misses of the preferred sources cost the time of
+ * the slowest of them rather than the sum of their times. The requests to the
+ * rest of sources are then cancelled.
+ *
+ * This method is asynchronous.
+ *
+ * Since: 0.3.20
+ */
+void
+grl_multiple_get_media_from_uri_parallel (const gchar *uri,
+                                          const GList *keys,
+                                          GrlOperationOptions *options,
+                                          GrlSourceResolveCb callback,
+                                          gpointer user_data)
+{
+  GrlRegistry *registry;
+  GList *sources;
+  GList *untested;
+  GList *source;
+  struct MediaFromUriParallelData *mfupd;
+  struct MediaFromUriProbe *probe;
+  GError *error;
+  guint i;
+
+  g_return_if_fail (uri != NULL);
+  g_return_if_fail (keys != NULL);
+  g_return_if_fail (callback != NULL);
+  g_return_if_fail (GRL_IS_OPERATION_OPTIONS (options));
+
+  registry = grl_registry_get_default ();
+  sources = grl_registry_get_sources_for_uri (registry, uri, &untested);
+
+  for (source = untested; source; source = g_list_next (source)) {
+    if (grl_source_test_media_from_uri (source->data, uri)) {
+      sources = g_list_append (sources, source->data);
+    }
+  }
+  g_list_free (untested);
+
+  if (!sources) {
+    error = g_error_new (GRL_CORE_ERROR,
+                         GRL_CORE_ERROR_MEDIA_FROM_URI_FAILED,
+                         _("Could not resolve media for URI “%s”"),
+                         uri);
+    callback (NULL, 0, NULL, user_data, error);
+    g_error_free (error);
+    return;
+  }
+
+  mfupd = g_new0 (struct MediaFromUriParallelData, 1);
+  mfupd->n_probes = g_list_length (sources);
+  mfupd->probes = g_new0 (struct MediaFromUriProbe, mfupd->n_probes);
+  mfupd->pending = mfupd->n_probes;
+  mfupd->uri = g_strdup (uri);
+  mfupd->user_callback = callback;
+  mfupd->user_data = user_data;
+
+  for (source = sources, i = 0; source; source = g_list_next (source), i++) {
+    probe = &mfupd->probes[i];
+    probe->mfupd = mfupd;
+    probe->source = GRL_SOURCE (source->data);
+  }
+  g_list_free (sources);
+
+  for (i = 0; i < mfupd->n_probes; i++) {
+    probe = &mfupd->probes[i];
+    probe->operation_id =
+      grl_source_get_media_from_uri (probe->source, uri, keys, options,
+                                     media_from_uri_parallel_cb, probe);
+  }
+}
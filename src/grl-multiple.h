@@ -41,6 +41,13 @@ guint grl_multiple_search (const GList *sources,
 			   GrlSourceResultCb callback,
 			   gpointer user_data);
 
+guint grl_multiple_search_batch (const GList *sources,
+                                 const gchar *text,
+                                 const GList *keys,
+                                 GrlOperationOptions *options,
+                                 GrlSourceBatchResultCb callback,
+                                 gpointer user_data);
+
 GList *grl_multiple_search_sync (const GList *sources,
                                  const gchar *text,
                                  const GList *keys,
@@ -53,6 +60,12 @@ void grl_multiple_get_media_from_uri (const gchar *uri,
 				      GrlSourceResolveCb callback,
 				      gpointer user_data);
 
+void grl_multiple_get_media_from_uri_parallel (const gchar *uri,
+                                               const GList *keys,
+                                               GrlOperationOptions *options,
+                                               GrlSourceResolveCb callback,
+                                               gpointer user_data);
+
 G_END_DECLS
 
 #endif
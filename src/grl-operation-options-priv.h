@@ -33,7 +33,10 @@
  * GQuarks */
 #define GRL_OPERATION_OPTION_SKIP "skip"
 #define GRL_OPERATION_OPTION_COUNT "count"
+#define GRL_OPERATION_OPTION_CONTINUATION "continuation"
 #define GRL_OPERATION_OPTION_RESOLUTION_FLAGS "resolution-flags"
+#define GRL_OPERATION_OPTION_DEADLINE "deadline"
+#define GRL_OPERATION_OPTION_PRIORITY "priority"
 #define GRL_OPERATION_OPTION_TYPE_FILTER "type-filter"
 #define GRL_OPERATION_OPTION_KEY_EQUAL_FILTER "key-equal-filter"
 #define GRL_OPERATION_OPTION_KEY_RANGE_FILTER "key-range-filter"
@@ -49,6 +49,8 @@ G_DEFINE_TYPE_WITH_PRIVATE (GrlOperationOptions, grl_operation_options, G_TYPE_O
 #define SKIP_DEFAULT 0;
 #define COUNT_DEFAULT GRL_COUNT_INFINITY;
 #define RESOLUTION_FLAGS_DEFAULT GRL_RESOLVE_NORMAL;
+#define DEADLINE_DEFAULT 0;
+#define PRIORITY_DEFAULT GRL_OPERATION_PRIORITY_NORMAL;
 #define TYPE_FILTER_DEFAULT GRL_TYPE_FILTER_ALL;
 
 static void
@@ -208,11 +210,19 @@ grl_operation_options_obey_caps (GrlOperationOptions *options,
     copy_option (options, *supported_options, GRL_OPERATION_OPTION_SKIP);
     copy_option (options, *supported_options, GRL_OPERATION_OPTION_COUNT);
     copy_option (options, *supported_options, GRL_OPERATION_OPTION_RESOLUTION_FLAGS);
+    copy_option (options, *supported_options, GRL_OPERATION_OPTION_DEADLINE);
+    copy_option (options, *supported_options, GRL_OPERATION_OPTION_PRIORITY);
   }
 
   if (unsupported_options)
     *unsupported_options = grl_operation_options_new (NULL);
 
+  ret &= check_and_copy_option (options,
+                                caps,
+                                GRL_OPERATION_OPTION_CONTINUATION,
+                                supported_options,
+                                unsupported_options);
+
   ret &= check_and_copy_option (options,
                                 caps,
                                 GRL_OPERATION_OPTION_TYPE_FILTER,
@@ -278,8 +288,11 @@ grl_operation_options_copy (GrlOperationOptions *options)
 
   copy_option (options, copy, GRL_OPERATION_OPTION_SKIP);
   copy_option (options, copy, GRL_OPERATION_OPTION_COUNT);
+  copy_option (options, copy, GRL_OPERATION_OPTION_CONTINUATION);
   copy_option (options, copy, GRL_OPERATION_OPTION_RESOLUTION_FLAGS);
   copy_option (options, copy, GRL_OPERATION_OPTION_TYPE_FILTER);
+  copy_option (options, copy, GRL_OPERATION_OPTION_DEADLINE);
+  copy_option (options, copy, GRL_OPERATION_OPTION_PRIORITY);
 
   g_hash_table_foreach (options->priv->key_filter,
                         (GHFunc) key_filter_dup,
@@ -411,6 +424,73 @@ grl_operation_options_get_count (GrlOperationOptions *options)
   return COUNT_DEFAULT;
 }
 
+/**
+ * grl_operation_options_set_continuation:
+ * @options: a #GrlOperationOptions instance
+ * @continuation: (allow-none): a continuation token, or %NULL to unset it
+ *
+ * Set the continuation token of a browse, search or query operation, as found
+ * with grl_media_get_continuation() in the last element of the previous page.
+ * The source then starts right after that element, and the skip option counts
+ * from there. This lets sources backed by cursors get deep pages without
+ * going through all the previous elements.
+ *
+ * Tokens belong to the source that sent them, and only make sense in the same
+ * operation with the same parameters. They can only be used with sources
+ * declaring them in their caps, see grl_caps_set_continuation_supported().
+ *
+ * Returns: %TRUE if @continuation could be set, %FALSE otherwise.
+ *
+ * Since: 0.3.20
+ */
+gboolean
+grl_operation_options_set_continuation (GrlOperationOptions *options,
+                                        const gchar *continuation)
+{
+  GValue value = { 0, };
+  gboolean ret;
+
+  if (!continuation) {
+    g_hash_table_remove (options->priv->data, GRL_OPERATION_OPTION_CONTINUATION);
+    return TRUE;
+  }
+
+  g_value_init (&value, G_TYPE_STRING);
+  g_value_set_string (&value, continuation);
+
+  ret = (options->priv->caps == NULL) ||
+      grl_caps_test_option (options->priv->caps,
+                            GRL_OPERATION_OPTION_CONTINUATION, &value);
+
+  if (ret)
+    set_value (options, GRL_OPERATION_OPTION_CONTINUATION, &value);
+
+  g_value_unset (&value);
+
+  return ret;
+}
+
+/**
+ * grl_operation_options_get_continuation:
+ * @options: a #GrlOperationOptions instance
+ *
+ * Returns: the continuation token of operations done with @options, or %NULL
+ *
+ * Since: 0.3.20
+ */
+const gchar *
+grl_operation_options_get_continuation (GrlOperationOptions *options)
+{
+  const GValue *value;
+
+  value = g_hash_table_lookup (options->priv->data,
+                               GRL_OPERATION_OPTION_CONTINUATION);
+  if (value)
+    return g_value_get_string (value);
+
+  return NULL;
+}
+
 /**
  * grl_operation_options_set_resolution_flags:
  * @options: a #GrlOperationOptions instance
@@ -465,6 +545,110 @@ grl_operation_options_get_resolution_flags (GrlOperationOptions *options)
   return RESOLUTION_FLAGS_DEFAULT;
 }
 
+/**
+ * grl_operation_options_set_deadline:
+ * @options: a #GrlOperationOptions instance
+ * @deadline: time in milliseconds the operation may take, or 0 for no limit
+ *
+ * Set the deadline of an operation, counted from its start. When it passes,
+ * browse, search and query operations send the elements collected so far with
+ * the keys known at that moment, and finish with a
+ * %GRL_CORE_ERROR_DEADLINE_EXCEEDED error; resolve operations send the media
+ * with that error, and with the keys already resolved.
+ *
+ * Returns: %TRUE if @deadline could be set, %FALSE otherwise.
+ *
+ * Since: 0.3.20
+ */
+gboolean
+grl_operation_options_set_deadline (GrlOperationOptions *options,
+                                    guint deadline)
+{
+  GValue value = { 0, };
+
+  g_value_init (&value, G_TYPE_UINT);
+  g_value_set_uint (&value, deadline);
+  set_value (options, GRL_OPERATION_OPTION_DEADLINE, &value);
+  g_value_unset (&value);
+
+  return TRUE;
+}
+
+/**
+ * grl_operation_options_get_deadline:
+ * @options: a #GrlOperationOptions instance
+ *
+ * Returns: the deadline of operations done with @options, in milliseconds, or
+ * 0 if they have no limit.
+ *
+ * Since: 0.3.20
+ */
+guint
+grl_operation_options_get_deadline (GrlOperationOptions *options)
+{
+  const GValue *value;
+
+  value = g_hash_table_lookup (options->priv->data,
+                               GRL_OPERATION_OPTION_DEADLINE);
+  if (value)
+    return g_value_get_uint (value);
+
+  return DEADLINE_DEFAULT;
+}
+
+/**
+ * grl_operation_options_set_priority:
+ * @options: a #GrlOperationOptions instance
+ * @priority: the priority class of the operation
+ *
+ * Set the priority class of an operation. The core relays the results of
+ * operations, decorates their elements and sends their network requests
+ * before those of less urgent operations. That work is never dispatched with
+ * a priority higher than %G_PRIORITY_HIGH_IDLE, though.
+ *
+ * Returns: %TRUE if @priority could be set, %FALSE otherwise.
+ *
+ * Since: 0.3.20
+ */
+gboolean
+grl_operation_options_set_priority (GrlOperationOptions *options,
+                                    GrlOperationPriority priority)
+{
+  GValue value = { 0, };
+
+  g_value_init (&value, G_TYPE_INT);
+  g_value_set_int (&value, priority);
+  set_value (options, GRL_OPERATION_OPTION_PRIORITY, &value);
+  g_value_unset (&value);
+
+  return TRUE;
+}
+
+/**
+ * grl_operation_options_get_priority:
+ * @options: a #GrlOperationOptions instance
+ *
+ * Returns: the priority class of operations done with @options.
+ *
+ * Since: 0.3.20
+ */
+GrlOperationPriority
+grl_operation_options_get_priority (GrlOperationOptions *options)
+{
+  const GValue *value;
+
+  if (options)
+    value = g_hash_table_lookup (options->priv->data,
+                                 GRL_OPERATION_OPTION_PRIORITY);
+  else
+    value = NULL;
+
+  if (value)
+    return g_value_get_int (value);
+
+  return PRIORITY_DEFAULT;
+}
+
 /**
  * grl_operation_options_set_type_filter:
  * @options: a #GrlOperationOptions instance
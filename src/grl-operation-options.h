@@ -71,6 +71,9 @@ G_DEFINE_AUTOPTR_CLEANUP_FUNC (GrlOperationOptions, g_object_unref)
  * @GRL_RESOLVE_FULL: Try other plugins if necessary.
  * @GRL_RESOLVE_IDLE_RELAY: Use idle loop to relay results.
  * @GRL_RESOLVE_FAST_ONLY: Only resolve fast metadata keys.
+ * @GRL_RESOLVE_PROGRESSIVE: Together with %GRL_RESOLVE_FULL, send the
+ * elements once their fast metadata keys are known, and resolve the slow ones
+ * afterwards, announcing them with #GrlMedia::keys-updated. Since: 0.3.20
  *
  * Resolution flags
  */
@@ -78,7 +81,8 @@ typedef enum {
   GRL_RESOLVE_NORMAL     = 0,        /* Normal mode */
   GRL_RESOLVE_FULL       = (1 << 0), /* Try other plugins if necessary */
   GRL_RESOLVE_IDLE_RELAY = (1 << 1), /* Use idle loop to relay results */
-  GRL_RESOLVE_FAST_ONLY  = (1 << 2)  /* Only resolve fast metadata keys */
+  GRL_RESOLVE_FAST_ONLY  = (1 << 2), /* Only resolve fast metadata keys */
+  GRL_RESOLVE_PROGRESSIVE = (1 << 3) /* Resolve slow metadata keys later */
 } GrlResolutionFlags;
 
 /**
@@ -93,6 +97,24 @@ typedef enum {
   GRL_WRITE_FULL       = (1 << 0)  /* Try other plugins if necessary */
 } GrlWriteFlags;
 
+/**
+ * GrlOperationPriority:
+ * @GRL_OPERATION_PRIORITY_INTERACTIVE: The user is waiting for the results.
+ * @GRL_OPERATION_PRIORITY_NORMAL: Default priority.
+ * @GRL_OPERATION_PRIORITY_BACKGROUND: Bulk work, like indexing, that can
+ * wait for the other operations.
+ *
+ * Priority classes of operations. Pending work of operations with a more
+ * urgent class is dispatched first.
+ *
+ * Since: 0.3.20
+ */
+typedef enum {
+  GRL_OPERATION_PRIORITY_INTERACTIVE = -1,
+  GRL_OPERATION_PRIORITY_NORMAL      = 0,
+  GRL_OPERATION_PRIORITY_BACKGROUND  = 1
+} GrlOperationPriority;
+
 #define GRL_COUNT_INFINITY (-1)
 
 GType grl_operation_options_get_type (void);
@@ -112,11 +134,24 @@ guint grl_operation_options_get_skip (GrlOperationOptions *options);
 gboolean grl_operation_options_set_count (GrlOperationOptions *options, gint count);
 gint grl_operation_options_get_count (GrlOperationOptions *options);
 
+gboolean grl_operation_options_set_continuation (GrlOperationOptions *options,
+                                                 const gchar *continuation);
+const gchar *grl_operation_options_get_continuation (GrlOperationOptions *options);
+
 gboolean grl_operation_options_set_resolution_flags (GrlOperationOptions *options,
                                                      GrlResolutionFlags flags);
 GrlResolutionFlags
     grl_operation_options_get_resolution_flags (GrlOperationOptions *options);
 
+gboolean grl_operation_options_set_deadline (GrlOperationOptions *options,
+                                             guint deadline);
+guint grl_operation_options_get_deadline (GrlOperationOptions *options);
+
+gboolean grl_operation_options_set_priority (GrlOperationOptions *options,
+                                             GrlOperationPriority priority);
+GrlOperationPriority
+    grl_operation_options_get_priority (GrlOperationOptions *options);
+
 gboolean grl_operation_options_set_type_filter (GrlOperationOptions *options,
                                                 GrlTypeFilter filter);
 
@@ -24,6 +24,8 @@
 #define _GRL_OPERATION_PRIV_H_
 
 #include <glib.h>
+#include <grl-source.h>
+#include <grl-operation.h>
 
 typedef void (*GrlOperationCancelCb) (gpointer data);
 
@@ -40,4 +42,33 @@ gpointer grl_operation_get_private_data (guint operation_id);
 
 void grl_operation_remove (guint operation_id);
 
+void grl_operation_set_info (guint            operation_id,
+                             GrlSupportedOps  operation,
+                             GrlSource       *source);
+
+void grl_operation_set_state (guint             operation_id,
+                              GrlOperationState state);
+
+gboolean grl_operation_get_state (guint              operation_id,
+                                  GrlOperationState *state);
+
+void grl_operation_add_delivered (guint operation_id,
+                                  guint count);
+
+/* Sources attached to the thread-default main context */
+guint grl_operation_idle_add (gint           priority,
+                              GSourceFunc    function,
+                              gpointer       data,
+                              GDestroyNotify notify,
+                              const gchar   *name);
+
+guint grl_operation_timeout_add (guint        interval,
+                                 GSourceFunc  function,
+                                 gpointer     data,
+                                 const gchar *name);
+
+void grl_operation_source_remove (guint id);
+
+GMainContext *grl_operation_ref_foreign_context (guint operation_id);
+
 #endif /* _GRL_OPERATION_PRIV_H_ */
@@ -22,8 +22,11 @@
 
 #include "grl-operation.h"
 #include "grl-operation-priv.h"
+#include "grl-metrics-priv.h"
 #include "grl-log.h"
 
+#include <string.h>
+
 typedef struct
 {
   GrlOperationCancelCb cancel_cb;
@@ -31,10 +34,52 @@ typedef struct
   gpointer             private_data;
   gpointer             user_data;
   GDestroyNotify       user_data_destroy_func;
+  GrlSupportedOps      operation;
+  GrlSource           *source;
+  gint64               start_time;
+  guint                delivered;
+  GrlOperationState    state;
+  GMainContext        *context;
 } OperationData;
 
-static guint       operations_id;
-static GHashTable *operations;
+typedef struct
+{
+  OperationData data;
+  /* Incremented each time the slot is given to a new operation */
+  guint         generation;
+  gboolean      in_use;
+  /* Index + 1 of the next free slot, or 0 */
+  guint         next_free;
+} OperationSlot;
+
+G_DEFINE_BOXED_TYPE (GrlOperationInfo, grl_operation_info,
+                     (GBoxedCopyFunc) grl_operation_info_dup,
+                     (GBoxedFreeFunc) grl_operation_info_free)
+
+/* An operation identifier is the index + 1 of its slot in the table, with
+   the generation of the slot in the upper bits. Looking an operation up is
+   then indexing the table, and the identifier of a finished operation is not
+   given to another one until its slot has been reused as many times as
+   there are generations */
+#define OPERATION_INDEX_BITS 20
+#define OPERATION_INDEX_MASK ((1u << OPERATION_INDEX_BITS) - 1)
+#define OPERATION_MAX_SLOTS  OPERATION_INDEX_MASK
+#define OPERATION_GENERATION_MASK ((1u << (32 - OPERATION_INDEX_BITS)) - 1)
+
+#define OPERATION_ID(index, generation)                                 \
+  ((((generation) & OPERATION_GENERATION_MASK) << OPERATION_INDEX_BITS) | \
+   ((index) + 1))
+
+/* Operations can be started and looked up from several threads, each running
+   its own main context. The table is guarded by @operations_lock, which is
+   never held while running callbacks; entries must not be used once it is
+   released, as other threads might grow the table */
+static GMutex      operations_lock;
+static GArray     *operations;
+/* Free slots are reused in the order they were released, so their
+   generations wrap around as late as possible */
+static guint       free_head;
+static guint       free_tail;
 
 static void
 operation_data_free (OperationData *data)
@@ -48,7 +93,35 @@ operation_data_free (OperationData *data)
     data->destroy_cb (data->private_data);
   }
 
-  g_slice_free (OperationData, data);
+  g_clear_object (&data->source);
+  g_clear_pointer (&data->context, g_main_context_unref);
+}
+
+static OperationSlot *
+operation_slot_lookup (guint operation_id)
+{
+  OperationSlot *slot;
+  guint index = operation_id & OPERATION_INDEX_MASK;
+
+  if (!index || index > operations->len) {
+    return NULL;
+  }
+
+  slot = &g_array_index (operations, OperationSlot, index - 1);
+  if (!slot->in_use ||
+      OPERATION_ID (index - 1, slot->generation) != operation_id) {
+    return NULL;
+  }
+
+  return slot;
+}
+
+static OperationData *
+operation_lookup (guint operation_id)
+{
+  OperationSlot *slot = operation_slot_lookup (operation_id);
+
+  return slot? &slot->data: NULL;
 }
 
 void
@@ -60,21 +133,50 @@ grl_operation_init (void)
     return;
 
   initialized = TRUE;
-  operations = g_hash_table_new_full (g_direct_hash, g_direct_equal,
-                                      NULL,
-                                      (GDestroyNotify) operation_data_free);
-  operations_id = 1;
+  operations = g_array_new (FALSE, TRUE, sizeof (OperationSlot));
+  free_head = 0;
+  free_tail = 0;
 }
 
 guint
 grl_operation_generate_id (void)
 {
-  guint operation_id = operations_id++;
-  OperationData *data = g_slice_new0 (OperationData);
+  OperationSlot *slot;
+  GMainContext *context;
+  guint index;
+
+  /* Operations are run and cancelled in the context they were started from */
+  context = g_main_context_ref_thread_default ();
+
+  g_mutex_lock (&operations_lock);
+
+  if (free_head) {
+    index = free_head - 1;
+    slot = &g_array_index (operations, OperationSlot, index);
+    free_head = slot->next_free;
+    if (!free_head) {
+      free_tail = 0;
+    }
+    slot->generation++;
+  } else if (operations->len < OPERATION_MAX_SLOTS) {
+    index = operations->len;
+    g_array_set_size (operations, index + 1);
+    slot = &g_array_index (operations, OperationSlot, index);
+  } else {
+    g_mutex_unlock (&operations_lock);
+    g_main_context_unref (context);
+    g_return_val_if_reached (0);
+  }
 
-  g_hash_table_insert (operations, GUINT_TO_POINTER (operation_id), data);
+  slot->in_use = TRUE;
+  slot->next_free = 0;
+  memset (&slot->data, 0, sizeof (OperationData));
+  slot->data.start_time = g_get_monotonic_time ();
+  slot->data.state = GRL_OPERATION_STATE_QUEUED;
+  slot->data.context = context;
+  g_mutex_unlock (&operations_lock);
 
-  return operation_id;
+  return OPERATION_ID (index, slot->generation);
 }
 
 void
@@ -83,14 +185,18 @@ grl_operation_set_private_data (guint                operation_id,
                                 GrlOperationCancelCb cancel_cb,
                                 GDestroyNotify       destroy_cb)
 {
-  OperationData *data = g_hash_table_lookup (operations,
-                                             GUINT_TO_POINTER (operation_id));
+  OperationData *data;
+
+  g_mutex_lock (&operations_lock);
+  data = operation_lookup (operation_id);
+  if (data) {
+    data->cancel_cb    = cancel_cb;
+    data->destroy_cb   = destroy_cb;
+    data->private_data = private_data;
+  }
+  g_mutex_unlock (&operations_lock);
 
   g_return_if_fail (data != NULL);
-
-  data->cancel_cb    = cancel_cb;
-  data->destroy_cb   = destroy_cb;
-  data->private_data = private_data;
 }
 
 /**
@@ -100,18 +206,253 @@ grl_operation_set_private_data (guint                operation_id,
 gpointer
 grl_operation_get_private_data (guint operation_id)
 {
-  OperationData *data = g_hash_table_lookup (operations,
-                                             GUINT_TO_POINTER (operation_id));
+  OperationData *data;
+  gpointer private_data = NULL;
+
+  g_mutex_lock (&operations_lock);
+  data = operation_lookup (operation_id);
+  if (data) {
+    private_data = data->private_data;
+  }
+  g_mutex_unlock (&operations_lock);
 
   g_return_val_if_fail (data != NULL, NULL);
 
-  return data->private_data;
+  return private_data;
 }
 
 void
 grl_operation_remove (guint operation_id)
 {
-  g_hash_table_remove (operations, GUINT_TO_POINTER (operation_id));
+  OperationData removed;
+  OperationSlot *slot;
+  guint index;
+
+  g_mutex_lock (&operations_lock);
+  slot = operation_slot_lookup (operation_id);
+  if (!slot) {
+    g_mutex_unlock (&operations_lock);
+    return;
+  }
+  index = (operation_id & OPERATION_INDEX_MASK) - 1;
+
+  /* Release the slot before running the destroy functions, as they might
+     start new operations and move the table */
+  removed = slot->data;
+  slot->in_use = FALSE;
+  slot->next_free = 0;
+  if (free_tail) {
+    g_array_index (operations, OperationSlot, free_tail - 1).next_free = index + 1;
+  } else {
+    free_head = index + 1;
+  }
+  free_tail = index + 1;
+  g_mutex_unlock (&operations_lock);
+
+  /* Sources that never answered do not leave samples behind */
+  grl_metrics_call_forget (operation_id);
+
+  operation_data_free (&removed);
+}
+
+void
+grl_operation_set_info (guint            operation_id,
+                        GrlSupportedOps  operation,
+                        GrlSource       *source)
+{
+  OperationData *data;
+
+  g_mutex_lock (&operations_lock);
+  data = operation_lookup (operation_id);
+  if (data) {
+    data->operation = operation;
+    g_set_object (&data->source, source);
+  }
+  g_mutex_unlock (&operations_lock);
+
+  g_return_if_fail (data != NULL);
+}
+
+void
+grl_operation_set_state (guint             operation_id,
+                         GrlOperationState state)
+{
+  OperationData *data;
+
+  g_mutex_lock (&operations_lock);
+  data = operation_lookup (operation_id);
+  /* A cancelled operation stays so until it finishes */
+  if (data && data->state != GRL_OPERATION_STATE_CANCELLED) {
+    data->state = state;
+  }
+  g_mutex_unlock (&operations_lock);
+}
+
+/* Returns whether @operation_id is active, storing its state in @state */
+gboolean
+grl_operation_get_state (guint              operation_id,
+                         GrlOperationState *state)
+{
+  OperationData *data;
+
+  g_mutex_lock (&operations_lock);
+  data = operation_lookup (operation_id);
+  if (data && state) {
+    *state = data->state;
+  }
+  g_mutex_unlock (&operations_lock);
+
+  return data != NULL;
+}
+
+void
+grl_operation_add_delivered (guint operation_id,
+                             guint count)
+{
+  OperationData *data;
+
+  g_mutex_lock (&operations_lock);
+  data = operation_lookup (operation_id);
+  if (data) {
+    data->delivered += count;
+  }
+  g_mutex_unlock (&operations_lock);
+}
+
+static guint
+operation_source_attach (GSource       *source,
+                         gint           priority,
+                         GSourceFunc    function,
+                         gpointer       data,
+                         GDestroyNotify notify,
+                         const gchar   *name)
+{
+  GMainContext *context;
+  guint id;
+
+  g_source_set_priority (source, priority);
+  g_source_set_callback (source, function, data, notify);
+  g_source_set_name (source, name);
+
+  context = g_main_context_ref_thread_default ();
+  id = g_source_attach (source, context);
+  g_main_context_unref (context);
+  g_source_unref (source);
+
+  return id;
+}
+
+/* The core dispatches the work of an operation in the main context of the
+   thread that runs it, so several threads can run operations at once, each
+   one iterating its own context */
+guint
+grl_operation_idle_add (gint           priority,
+                        GSourceFunc    function,
+                        gpointer       data,
+                        GDestroyNotify notify,
+                        const gchar   *name)
+{
+  return operation_source_attach (g_idle_source_new (), priority,
+                                  function, data, notify, name);
+}
+
+guint
+grl_operation_timeout_add (guint        interval,
+                           GSourceFunc  function,
+                           gpointer     data,
+                           const gchar *name)
+{
+  return operation_source_attach (g_timeout_source_new (interval),
+                                  G_PRIORITY_DEFAULT,
+                                  function, data, NULL, name);
+}
+
+void
+grl_operation_source_remove (guint id)
+{
+  GMainContext *context;
+  GSource *source;
+
+  context = g_main_context_ref_thread_default ();
+  source = g_main_context_find_source_by_id (context, id);
+  g_main_context_unref (context);
+
+  g_return_if_fail (source != NULL);
+
+  g_source_destroy (source);
+}
+
+/* Returns the main context @operation_id was started from if the caller is
+   not running in it, as when a plugin answers from its own thread or from an
+   idle attached to the global default context, or %NULL otherwise */
+GMainContext *
+grl_operation_ref_foreign_context (guint operation_id)
+{
+  OperationData *data;
+  GMainContext *context = NULL;
+  GMainContext *thread_context;
+  gboolean foreign;
+
+  g_mutex_lock (&operations_lock);
+  data = operation_lookup (operation_id);
+  if (data) {
+    context = g_main_context_ref (data->context);
+  }
+  g_mutex_unlock (&operations_lock);
+
+  if (!context || g_main_context_is_owner (context)) {
+    g_clear_pointer (&context, g_main_context_unref);
+    return NULL;
+  }
+
+  /* Results can also come before the context is iterated, straight from the
+     call starting the operation */
+  thread_context = g_main_context_ref_thread_default ();
+  foreign = thread_context != context || !g_main_context_acquire (context);
+  if (!foreign) {
+    g_main_context_release (context);
+  }
+  g_main_context_unref (thread_context);
+
+  if (!foreign) {
+    g_clear_pointer (&context, g_main_context_unref);
+  }
+
+  return context;
+}
+
+static gint
+operation_info_compare (const GrlOperationInfo *a,
+                        const GrlOperationInfo *b)
+{
+  if (a->start_time != b->start_time) {
+    return a->start_time < b->start_time ? -1 : 1;
+  }
+
+  return 0;
+}
+
+static gboolean
+operation_cancel_in_context (gpointer user_data)
+{
+  guint operation_id = GPOINTER_TO_UINT (user_data);
+  GrlOperationCancelCb cancel_cb = NULL;
+  gpointer private_data = NULL;
+  OperationData *data;
+
+  g_mutex_lock (&operations_lock);
+  data = operation_lookup (operation_id);
+  if (data) {
+    cancel_cb = data->cancel_cb;
+    private_data = data->private_data;
+  }
+  g_mutex_unlock (&operations_lock);
+
+  if (cancel_cb) {
+    cancel_cb (private_data);
+  }
+
+  return FALSE;
 }
 
 /*** PUBLIC API ***/
@@ -121,23 +462,32 @@ grl_operation_remove (guint operation_id)
  * @operation_id: the identifier of a running operation
  *
  * Cancel an operation.
+ *
+ * It can be called from any thread. If the main context the operation was
+ * started from is running in another thread, the operation is cancelled
+ * there, once this function has returned.
  */
 void
 grl_operation_cancel (guint operation_id)
 {
-  OperationData *data = g_hash_table_lookup (operations,
-                                             GUINT_TO_POINTER (operation_id));
+  OperationData *data;
+  GMainContext *context = NULL;
 
-  if (!data) {
+  g_mutex_lock (&operations_lock);
+  data = operation_lookup (operation_id);
+  if (data) {
+    context = g_main_context_ref (data->context);
+  }
+  g_mutex_unlock (&operations_lock);
+
+  if (!context) {
     GRL_WARNING ("Invalid operation %u", operation_id);
     return;
   }
 
-  g_return_if_fail (data != NULL);
-
-  if (data->cancel_cb) {
-    data->cancel_cb (data->private_data);
-  }
+  g_main_context_invoke (context, operation_cancel_in_context,
+                         GUINT_TO_POINTER (operation_id));
+  g_main_context_unref (context);
 }
 
 /**
@@ -151,15 +501,21 @@ grl_operation_cancel (guint operation_id)
 gpointer
 grl_operation_get_data (guint operation_id)
 {
-  OperationData *data = g_hash_table_lookup (operations,
-                                             GUINT_TO_POINTER (operation_id));
+  OperationData *data;
+  gpointer user_data = NULL;
+
+  g_mutex_lock (&operations_lock);
+  data = operation_lookup (operation_id);
+  if (data) {
+    user_data = data->user_data;
+  }
+  g_mutex_unlock (&operations_lock);
 
   if (!data) {
     GRL_WARNING ("Invalid operation %u", operation_id);
-    return NULL;
   }
 
-  return data->user_data;
+  return user_data;
 }
 
 /**
@@ -190,17 +546,108 @@ grl_operation_set_data (guint operation_id, gpointer user_data)
 void
 grl_operation_set_data_full (guint operation_id, gpointer user_data, GDestroyNotify destroy_func)
 {
-  OperationData *data = g_hash_table_lookup (operations,
-                                             GUINT_TO_POINTER (operation_id));
+  OperationData *data;
 
-  if (!data) {
-    GRL_WARNING ("Invalid operation %u", operation_id);
-  } else {
-    if (data->user_data_destroy_func && data->user_data)
-      data->user_data_destroy_func (data->user_data);
+  gpointer old_user_data = NULL;
+  GDestroyNotify old_destroy_func = NULL;
+
+  g_mutex_lock (&operations_lock);
+  data = operation_lookup (operation_id);
+  if (data) {
+    old_user_data = data->user_data;
+    old_destroy_func = data->user_data_destroy_func;
 
     data->user_data = user_data;
     data->user_data_destroy_func = destroy_func;
   }
+  g_mutex_unlock (&operations_lock);
+
+  if (!data) {
+    GRL_WARNING ("Invalid operation %u", operation_id);
+  } else if (old_destroy_func && old_user_data) {
+    old_destroy_func (old_user_data);
+  }
+}
+
+/**
+ * grl_operation_info_dup:
+ * @info: a #GrlOperationInfo
+ *
+ * Returns: (transfer full): a copy of @info.
+ *
+ * Since: 0.3.20
+ */
+GrlOperationInfo *
+grl_operation_info_dup (const GrlOperationInfo *info)
+{
+  GrlOperationInfo *copy;
+
+  g_return_val_if_fail (info != NULL, NULL);
+
+  copy = g_slice_dup (GrlOperationInfo, info);
+  if (copy->source) {
+    g_object_ref (copy->source);
+  }
+
+  return copy;
+}
+
+/**
+ * grl_operation_info_free:
+ * @info: a #GrlOperationInfo
+ *
+ * Frees @info.
+ *
+ * Since: 0.3.20
+ */
+void
+grl_operation_info_free (GrlOperationInfo *info)
+{
+  g_return_if_fail (info != NULL);
+
+  g_clear_object (&info->source);
+  g_slice_free (GrlOperationInfo, info);
+}
+
+/**
+ * grl_operation_list_active:
+ *
+ * Takes a snapshot of the operations that have not finished yet, including
+ * those the core runs on behalf of others, like the resolves completing the
+ * results of a browse. This is meant to diagnose stuck and slow operations.
+ *
+ * Returns: (transfer full) (element-type GrlOperationInfo): the active
+ * operations, oldest first. Free it with
+ * <literal>g_list_free_full (list, (GDestroyNotify) grl_operation_info_free)</literal>.
+ *
+ * Since: 0.3.20
+ */
+GList *
+grl_operation_list_active (void)
+{
+  GrlOperationInfo *info;
+  OperationSlot *slot;
+  GList *list = NULL;
+  guint i;
+
+  g_mutex_lock (&operations_lock);
+  for (i = 0; i < operations->len; i++) {
+    slot = &g_array_index (operations, OperationSlot, i);
+    if (!slot->in_use) {
+      continue;
+    }
+
+    info = g_slice_new (GrlOperationInfo);
+    info->operation_id = OPERATION_ID (i, slot->generation);
+    info->operation = slot->data.operation;
+    info->source = slot->data.source? g_object_ref (slot->data.source): NULL;
+    info->start_time = slot->data.start_time;
+    info->delivered = slot->data.delivered;
+    info->state = slot->data.state;
+    list = g_list_prepend (list, info);
+  }
+  g_mutex_unlock (&operations_lock);
+
+  return g_list_sort (list, (GCompareFunc) operation_info_compare);
 }
 
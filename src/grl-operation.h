@@ -28,9 +28,65 @@
 #define _GRL_OPERATION_H_
 
 #include <glib.h>
+#include <grl-source.h>
 
 G_BEGIN_DECLS
 
+/**
+ * GrlOperationState:
+ * @GRL_OPERATION_STATE_QUEUED: The operation has not been sent to its source
+ * yet.
+ * @GRL_OPERATION_STATE_RUNNING: The source is working on the operation.
+ * @GRL_OPERATION_STATE_COMPLETED: The source sent all its results, and they
+ * are being delivered.
+ * @GRL_OPERATION_STATE_CANCELLED: The operation was cancelled, and it is
+ * finishing.
+ *
+ * State of an active operation.
+ *
+ * Since: 0.3.20
+ */
+typedef enum {
+  GRL_OPERATION_STATE_QUEUED,
+  GRL_OPERATION_STATE_RUNNING,
+  GRL_OPERATION_STATE_COMPLETED,
+  GRL_OPERATION_STATE_CANCELLED
+} GrlOperationState;
+
+/**
+ * GrlOperationInfo:
+ * @operation_id: the identifier of the operation
+ * @operation: the type of the operation, or %GRL_OP_NONE if it is unknown
+ * @source: (allow-none): the source running the operation, or %NULL if it
+ * involves several sources
+ * @start_time: monotonic time, in microseconds, when the operation started
+ * @delivered: number of elements delivered to the user so far
+ * @state: the state of the operation
+ *
+ * Snapshot of an active operation, as returned by
+ * grl_operation_list_active().
+ *
+ * Since: 0.3.20
+ */
+typedef struct {
+  guint operation_id;
+  GrlSupportedOps operation;
+  GrlSource *source;
+  gint64 start_time;
+  guint delivered;
+  GrlOperationState state;
+} GrlOperationInfo;
+
+#define GRL_TYPE_OPERATION_INFO (grl_operation_info_get_type ())
+
+GType grl_operation_info_get_type (void);
+
+GrlOperationInfo *grl_operation_info_dup (const GrlOperationInfo *info);
+
+void grl_operation_info_free (GrlOperationInfo *info);
+
+GList *grl_operation_list_active (void);
+
 void grl_operation_cancel (guint operation_id);
 
 gpointer grl_operation_get_data (guint operation_id);
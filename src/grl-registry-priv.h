@@ -37,6 +37,12 @@ GrlKeyID grl_registry_register_metadata_key_system (GrlRegistry *registry,
 
 void grl_registry_shutdown (GrlRegistry *registry);
 
+guint grl_registry_get_sources_generation (GrlRegistry *registry);
+
+GList *grl_registry_get_sources_for_uri (GrlRegistry *registry,
+                                         const gchar *uri,
+                                         GList **untested);
+
 GrlKeyID grl_registry_register_metadata_key_for_type (GrlRegistry *registry,
                                                       const gchar *key_name,
                                                       GType type,
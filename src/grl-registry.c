@@ -45,6 +45,7 @@
 
 #include "grl-registry-priv.h"
 #include "grl-plugin-priv.h"
+#include "grl-uri-index-priv.h"
 #include "grl-log.h"
 #include "grl-error.h"
 
@@ -77,7 +78,12 @@ struct KeyIDHandler {
   gint last_id;
 };
 
+/* Sources, plugins and keys can be looked up from several threads at once.
+   @sources_lock guards the tables of sources and plugins, @keys_lock the
+   metadata keys. Signals and plugin code are never run with a lock held. */
 struct _GrlRegistryPrivate {
+  GRWLock sources_lock;
+  GRWLock keys_lock;
   GHashTable *configs;
   GHashTable *plugins;
   GHashTable *sources;
@@ -87,6 +93,9 @@ struct _GrlRegistryPrivate {
   GSList *plugins_dir;
   GSList *allowed_plugins;
   gboolean all_plugins_preloaded;
+  guint sources_generation;
+  /* Sources by the URI prefixes they declare, protected by sources_lock */
+  GrlUriIndex *uri_index;
   struct KeyIDHandler key_id_handler;
   GNetworkMonitor *netmon;
 };
@@ -226,7 +235,12 @@ network_changed_cb (GObject     *gobject,
   GRL_DEBUG ("Network availability changed");
   get_connectivity (registry, &connectivity, &network_available);
 
+  /* Sources might be hidden or shown */
+  g_atomic_int_inc (&registry->priv->sources_generation);
+
+  g_rw_lock_reader_lock (&registry->priv->sources_lock);
   sources = g_hash_table_get_values (registry->priv->sources);
+  g_rw_lock_reader_unlock (&registry->priv->sources_lock);
   if (!sources)
     return;
 
@@ -308,12 +322,16 @@ grl_registry_init (GrlRegistry *registry)
 {
   registry->priv = grl_registry_get_instance_private (registry);
 
+  g_rw_lock_init (&registry->priv->sources_lock);
+  g_rw_lock_init (&registry->priv->keys_lock);
+
   registry->priv->configs =
     g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) configs_free);
   registry->priv->plugins =
     g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
   registry->priv->sources =
     g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  registry->priv->uri_index = grl_uri_index_new ();
   registry->priv->related_keys =
     g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, NULL);
   registry->priv->system_keys =
@@ -532,19 +550,17 @@ activate_plugin (GrlRegistry *registry,
   return TRUE;
 }
 
+/* Must be called with the keys lock held for writing */
 static GrlKeyID
-grl_registry_register_metadata_key_full (GrlRegistry *registry,
-                                         GParamSpec *param_spec,
-                                         GrlKeyID key,
-                                         GrlKeyID bind_key,
-                                         GError **error)
+register_metadata_key_locked (GrlRegistry *registry,
+                              GParamSpec *param_spec,
+                              GrlKeyID key,
+                              GrlKeyID bind_key,
+                              GError **error)
 {
   GList *bound_partners;
   GList *partner;
   const gchar *key_name;
-
-  g_return_val_if_fail (GRL_IS_REGISTRY (registry), 0);
-  g_return_val_if_fail (G_IS_PARAM_SPEC (param_spec), 0);
   GrlKeyID registered_key;
 
   key_name = g_param_spec_get_name (param_spec);
@@ -607,6 +623,45 @@ grl_registry_register_metadata_key_full (GrlRegistry *registry,
   return registered_key;
 }
 
+static GrlKeyID
+grl_registry_register_metadata_key_full (GrlRegistry *registry,
+                                         GParamSpec *param_spec,
+                                         GrlKeyID key,
+                                         GrlKeyID bind_key,
+                                         GError **error)
+{
+  GrlKeyID registered_key;
+
+  g_return_val_if_fail (GRL_IS_REGISTRY (registry), 0);
+  g_return_val_if_fail (G_IS_PARAM_SPEC (param_spec), 0);
+
+  g_rw_lock_writer_lock (&registry->priv->keys_lock);
+  registered_key = register_metadata_key_locked (registry, param_spec,
+                                                 key, bind_key, error);
+  g_rw_lock_writer_unlock (&registry->priv->keys_lock);
+
+  return registered_key;
+}
+
+/* Specs are only released on shutdown, so they can be used once the lock is
+   dropped */
+static GParamSpec *
+lookup_key_pspec (GrlRegistry *registry,
+                  GrlKeyID key)
+{
+  const gchar *key_name;
+  GParamSpec *key_pspec = NULL;
+
+  g_rw_lock_reader_lock (&registry->priv->keys_lock);
+  key_name = key_id_handler_get_name (&registry->priv->key_id_handler, key);
+  if (key_name) {
+    key_pspec = g_hash_table_lookup (registry->priv->system_keys, key_name);
+  }
+  g_rw_lock_reader_unlock (&registry->priv->keys_lock);
+
+  return key_pspec;
+}
+
 G_GNUC_INTERNAL GrlKeyID
 grl_registry_register_metadata_key_for_type (GrlRegistry *registry,
                                              const gchar *key_name,
@@ -997,6 +1052,7 @@ grl_registry_shutdown (GrlRegistry *registry)
     }
     g_clear_pointer (&registry->priv->sources, g_hash_table_unref);
   }
+  g_clear_pointer (&registry->priv->uri_index, grl_uri_index_free);
 
   g_clear_pointer (&registry->priv->ranks, g_hash_table_unref);
   g_clear_pointer (&registry->priv->configs, g_hash_table_unref);
@@ -1024,6 +1080,9 @@ grl_registry_shutdown (GrlRegistry *registry)
   key_id_handler_free (&registry->priv->key_id_handler);
   g_clear_pointer (&registry->priv->system_keys, g_hash_table_unref);
 
+  g_rw_lock_clear (&registry->priv->sources_lock);
+  g_rw_lock_clear (&registry->priv->keys_lock);
+
   g_object_unref (registry);
 }
 
@@ -1074,6 +1133,7 @@ grl_registry_register_source (GrlRegistry *registry,
                               GrlSource *source,
                               GError **error)
 {
+  const gchar **prefix;
   gchar *id;
 
   g_return_val_if_fail (GRL_IS_REGISTRY (registry), FALSE);
@@ -1089,7 +1149,13 @@ grl_registry_register_source (GrlRegistry *registry,
 
   /* Do not free id, since g_hash_table_insert does not copy,
      it will be freed when removed from the hash table */
+  g_rw_lock_writer_lock (&registry->priv->sources_lock);
   g_hash_table_insert (registry->priv->sources, id, source);
+  prefix = grl_source_get_uri_prefixes (source);
+  for (; prefix && *prefix; prefix++) {
+    grl_uri_index_add (registry->priv->uri_index, *prefix, source);
+  }
+  g_rw_lock_writer_unlock (&registry->priv->sources_lock);
 
   /* Set the plugin as owner of source */
   g_object_set (source, "plugin", plugin, NULL);
@@ -1100,6 +1166,8 @@ grl_registry_register_source (GrlRegistry *registry,
   /* Update whether it should be invisible */
   update_source_visibility (registry, source);
 
+  g_atomic_int_inc (&registry->priv->sources_generation);
+
   if (!SOURCE_IS_INVISIBLE(source))
     g_signal_emit (registry, registry_signals[SIG_SOURCE_ADDED], 0, source);
 
@@ -1125,6 +1193,7 @@ grl_registry_unregister_source (GrlRegistry *registry,
 {
   gchar *id;
   gboolean ret = TRUE;
+  gboolean removed;
 
   g_return_val_if_fail (GRL_IS_REGISTRY (registry), FALSE);
   g_return_val_if_fail (GRL_IS_SOURCE (source), FALSE);
@@ -1132,8 +1201,16 @@ grl_registry_unregister_source (GrlRegistry *registry,
   g_object_get (source, "source-id", &id, NULL);
   GRL_DEBUG ("Unregistering source '%s'", id);
 
-  if (g_hash_table_remove (registry->priv->sources, id)) {
+  g_rw_lock_writer_lock (&registry->priv->sources_lock);
+  removed = g_hash_table_remove (registry->priv->sources, id);
+  if (removed) {
+    grl_uri_index_remove (registry->priv->uri_index, source);
+  }
+  g_rw_lock_writer_unlock (&registry->priv->sources_lock);
+
+  if (removed) {
     GRL_DEBUG ("source '%s' is no longer available", id);
+    g_atomic_int_inc (&registry->priv->sources_generation);
     g_signal_emit (registry, registry_signals[SIG_SOURCE_REMOVED], 0, source);
     g_object_unref (source);
   } else {
@@ -1149,6 +1226,22 @@ grl_registry_unregister_source (GrlRegistry *registry,
   return ret;
 }
 
+/*
+ * grl_registry_get_sources_generation:
+ * @registry: the registry instance
+ *
+ * Returns a counter that changes every time a source is registered,
+ * unregistered, shown or hidden. It allows caching results that depend on the
+ * set of available sources.
+ */
+guint
+grl_registry_get_sources_generation (GrlRegistry *registry)
+{
+  g_return_val_if_fail (GRL_IS_REGISTRY (registry), 0);
+
+  return g_atomic_int_get (&registry->priv->sources_generation);
+}
+
 /**
  * grl_registry_add_directory:
  * @registry: the registry instance
@@ -1241,8 +1334,10 @@ grl_registry_prepare_plugin (GrlRegistry *registry,
   }
 
   /* Check if plugin is preloaded; if not, then create one */
+  g_rw_lock_reader_lock (&registry->priv->sources_lock);
   plugin = g_hash_table_lookup (registry->priv->plugins,
                                 plugin_desc->id);
+  g_rw_lock_reader_unlock (&registry->priv->sources_lock);
 
   if (plugin) {
     g_module_close (module);
@@ -1277,7 +1372,9 @@ grl_registry_prepare_plugin (GrlRegistry *registry,
   /* Make plugin resident */
   g_module_make_resident (module);
 
+  g_rw_lock_writer_lock (&registry->priv->sources_lock);
   g_hash_table_insert (registry->priv->plugins, g_strdup (plugin_desc->id), plugin);
+  g_rw_lock_writer_unlock (&registry->priv->sources_lock);
 
   /* Register custom keys */
   grl_plugin_register_keys (plugin);
@@ -1304,7 +1401,9 @@ grl_registry_activate_all_plugins (GrlRegistry *registry)
 
   g_return_val_if_fail (GRL_IS_REGISTRY (registry), FALSE);
 
+  g_rw_lock_reader_lock (&registry->priv->sources_lock);
   all_plugins = g_hash_table_get_values (registry->priv->plugins);
+  g_rw_lock_reader_unlock (&registry->priv->sources_lock);
   for (l = all_plugins; l; l = l->next) {
     GrlPlugin *plugin = l->data;
     plugin_activated |= activate_plugin (registry, plugin, NULL);
@@ -1518,7 +1617,7 @@ grl_registry_activate_plugin_by_id (GrlRegistry *registry,
 
 
   /* Check if plugin is available */
-  plugin = g_hash_table_lookup (registry->priv->plugins, plugin_id);
+  plugin = grl_registry_lookup_plugin (registry, plugin_id);
   if (!plugin) {
     GRL_WARNING ("Plugin '%s' not available", plugin_id);
     g_set_error (error,
@@ -1563,8 +1662,11 @@ grl_registry_lookup_source (GrlRegistry *registry,
   g_return_val_if_fail (GRL_IS_REGISTRY (registry), NULL);
   g_return_val_if_fail (source_id != NULL, NULL);
 
+  g_rw_lock_reader_lock (&registry->priv->sources_lock);
   source = (GrlSource *) g_hash_table_lookup (registry->priv->sources,
                                               source_id);
+  g_rw_lock_reader_unlock (&registry->priv->sources_lock);
+
   if (source && !SOURCE_IS_INVISIBLE(source))
     return source;
   return NULL;
@@ -1595,11 +1697,13 @@ grl_registry_get_sources (GrlRegistry *registry,
 
   g_return_val_if_fail (GRL_IS_REGISTRY (registry), NULL);
 
+  g_rw_lock_reader_lock (&registry->priv->sources_lock);
   g_hash_table_iter_init (&iter, registry->priv->sources);
   while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &current_source)) {
     if (!SOURCE_IS_INVISIBLE(current_source))
       source_list = g_list_prepend (source_list, current_source);
   }
+  g_rw_lock_reader_unlock (&registry->priv->sources_lock);
 
   if (ranked) {
     source_list = g_list_sort (source_list, (GCompareFunc) compare_by_rank);
@@ -1636,6 +1740,7 @@ grl_registry_get_sources_by_operations (GrlRegistry *registry,
 
   g_return_val_if_fail (GRL_IS_REGISTRY (registry), NULL);
 
+  g_rw_lock_reader_lock (&registry->priv->sources_lock);
   g_hash_table_iter_init (&iter, registry->priv->sources);
   while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &source)) {
     GrlSupportedOps source_ops;
@@ -1646,6 +1751,7 @@ grl_registry_get_sources_by_operations (GrlRegistry *registry,
       source_list = g_list_prepend (source_list, source);
     }
   }
+  g_rw_lock_reader_unlock (&registry->priv->sources_lock);
 
   if (ranked) {
     source_list = g_list_sort (source_list, compare_by_rank);
@@ -1654,6 +1760,71 @@ grl_registry_get_sources_by_operations (GrlRegistry *registry,
   return source_list;
 }
 
+/*
+ * grl_registry_get_sources_for_uri:
+ * @registry: the registry instance
+ * @uri: a URI
+ * @untested: (out) (transfer container): sources that might create a media
+ * for @uri, to be tested with grl_source_test_media_from_uri()
+ *
+ * Finds the sources that can create a media for @uri. Sources declaring
+ * URI prefixes are found with the prefixes of @uri, without asking them;
+ * the ones declaring a longer prefix come first, and then the ones with a
+ * higher rank. Sources that declare no prefixes are returned in @untested,
+ * ordered by rank, along with the ones that declare other prefixes but
+ * implement test_media_from_uri.
+ *
+ * Returns: (transfer container): the sources declaring a prefix of @uri
+ */
+GList *
+grl_registry_get_sources_for_uri (GrlRegistry *registry,
+                                  const gchar *uri,
+                                  GList **untested)
+{
+  GHashTableIter iter;
+  GrlSource *source;
+  GList *routed, *l, *next;
+
+  g_return_val_if_fail (GRL_IS_REGISTRY (registry), NULL);
+  g_return_val_if_fail (uri != NULL, NULL);
+  g_return_val_if_fail (untested != NULL, NULL);
+
+  *untested = NULL;
+
+  g_rw_lock_reader_lock (&registry->priv->sources_lock);
+  routed = grl_uri_index_lookup (registry->priv->uri_index, uri,
+                                 compare_by_rank);
+
+  g_hash_table_iter_init (&iter, registry->priv->sources);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &source)) {
+    if (SOURCE_IS_INVISIBLE (source) ||
+        !(grl_source_supported_operations (source) & GRL_OP_MEDIA_FROM_URI)) {
+      continue;
+    }
+
+    /* Prefixes take precedence, but do not keep the source from being
+       asked about the rest of URIs */
+    if (!grl_source_get_uri_prefixes (source) ||
+        (GRL_SOURCE_GET_CLASS (source)->test_media_from_uri &&
+         !g_list_find (routed, source))) {
+      *untested = g_list_prepend (*untested, source);
+    }
+  }
+  g_rw_lock_reader_unlock (&registry->priv->sources_lock);
+
+  for (l = routed; l; l = next) {
+    next = g_list_next (l);
+    if (SOURCE_IS_INVISIBLE (l->data) ||
+        !(grl_source_supported_operations (l->data) & GRL_OP_MEDIA_FROM_URI)) {
+      routed = g_list_delete_link (routed, l);
+    }
+  }
+
+  *untested = g_list_sort (*untested, compare_by_rank);
+
+  return routed;
+}
+
 /**
  * grl_registry_lookup_plugin:
  * @registry: the registry instance
@@ -1669,11 +1840,16 @@ GrlPlugin *
 grl_registry_lookup_plugin (GrlRegistry *registry,
                             const gchar *plugin_id)
 {
+  GrlPlugin *plugin;
+
   g_return_val_if_fail (GRL_IS_REGISTRY (registry), NULL);
   g_return_val_if_fail (plugin_id, NULL);
 
-  return (GrlPlugin *) g_hash_table_lookup (registry->priv->plugins,
-                                            plugin_id);
+  g_rw_lock_reader_lock (&registry->priv->sources_lock);
+  plugin = g_hash_table_lookup (registry->priv->plugins, plugin_id);
+  g_rw_lock_reader_unlock (&registry->priv->sources_lock);
+
+  return plugin;
 }
 
 /**
@@ -1703,6 +1879,7 @@ grl_registry_get_plugins (GrlRegistry *registry,
 
   g_return_val_if_fail (GRL_IS_REGISTRY (registry), NULL);
 
+  g_rw_lock_reader_lock (&registry->priv->sources_lock);
   if (only_loaded) {
     g_hash_table_iter_init (&iter, registry->priv->plugins);
     while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &current_plugin)) {
@@ -1714,6 +1891,7 @@ grl_registry_get_plugins (GrlRegistry *registry,
   } else {
     plugin_list = g_hash_table_get_values (registry->priv->plugins);
   }
+  g_rw_lock_reader_unlock (&registry->priv->sources_lock);
 
   return plugin_list;
 }
@@ -1746,7 +1924,7 @@ grl_registry_unload_plugin (GrlRegistry *registry,
   g_return_val_if_fail (plugin_id != NULL, FALSE);
 
   /* First check the plugin is valid  */
-  plugin = g_hash_table_lookup (registry->priv->plugins, plugin_id);
+  plugin = grl_registry_lookup_plugin (registry, plugin_id);
   if (!plugin) {
     GRL_WARNING ("Could not deinit plugin '%s'. Plugin not found.", plugin_id);
     g_set_error (error,
@@ -1863,10 +2041,16 @@ GrlKeyID
 grl_registry_lookup_metadata_key (GrlRegistry *registry,
                                   const gchar *key_name)
 {
+  GrlKeyID key;
+
   g_return_val_if_fail (GRL_IS_REGISTRY (registry), 0);
   g_return_val_if_fail (key_name, 0);
 
-  return key_id_handler_get_key (&registry->priv->key_id_handler, key_name);
+  g_rw_lock_reader_lock (&registry->priv->keys_lock);
+  key = key_id_handler_get_key (&registry->priv->key_id_handler, key_name);
+  g_rw_lock_reader_unlock (&registry->priv->keys_lock);
+
+  return key;
 }
 
 /**
@@ -1884,9 +2068,15 @@ const gchar *
 grl_registry_lookup_metadata_key_name (GrlRegistry *registry,
                                        GrlKeyID key)
 {
+  const gchar *key_name;
+
   g_return_val_if_fail (GRL_IS_REGISTRY (registry), 0);
 
-  return key_id_handler_get_name (&registry->priv->key_id_handler, key);
+  g_rw_lock_reader_lock (&registry->priv->keys_lock);
+  key_name = key_id_handler_get_name (&registry->priv->key_id_handler, key);
+  g_rw_lock_reader_unlock (&registry->priv->keys_lock);
+
+  return key_name;
 }
 
 /**
@@ -1904,16 +2094,11 @@ const gchar *
 grl_registry_lookup_metadata_key_desc (GrlRegistry *registry,
                                        GrlKeyID key)
 {
-  const gchar *key_name;
   GParamSpec *key_pspec;
 
   g_return_val_if_fail (GRL_IS_REGISTRY (registry), 0);
 
-  key_name = key_id_handler_get_name (&registry->priv->key_id_handler, key);
-  if (!key_name) {
-    return NULL;
-  }
-  key_pspec = g_hash_table_lookup (registry->priv->system_keys, key_name);
+  key_pspec = lookup_key_pspec (registry, key);
 
   if (key_pspec) {
     return g_param_spec_get_blurb (key_pspec);
@@ -1937,16 +2122,11 @@ GType
 grl_registry_lookup_metadata_key_type (GrlRegistry *registry,
                                        GrlKeyID key)
 {
-  const gchar *key_name;
   GParamSpec *key_pspec;
 
   g_return_val_if_fail (GRL_IS_REGISTRY (registry), 0);
 
-  key_name = key_id_handler_get_name (&registry->priv->key_id_handler, key);
-  if (!key_name) {
-    return G_TYPE_INVALID;
-  }
-  key_pspec = g_hash_table_lookup (registry->priv->system_keys, key_name);
+  key_pspec = lookup_key_pspec (registry, key);
 
   if (key_pspec) {
     return G_PARAM_SPEC_VALUE_TYPE (key_pspec);
@@ -1974,17 +2154,12 @@ grl_registry_metadata_key_validate (GrlRegistry *registry,
                                     GrlKeyID key,
                                     GValue *value)
 {
-  const gchar *key_name;
   GParamSpec *key_pspec;
 
   g_return_val_if_fail (GRL_IS_REGISTRY (registry), FALSE);
   g_return_val_if_fail (G_IS_VALUE (value), FALSE);
 
-  key_name = key_id_handler_get_name (&registry->priv->key_id_handler, key);
-  if (!key_name) {
-    return FALSE;
-  }
-  key_pspec = g_hash_table_lookup (registry->priv->system_keys, key_name);
+  key_pspec = lookup_key_pspec (registry, key);
 
   if (key_pspec) {
     return !g_param_value_validate (key_pspec, value);
@@ -2011,9 +2186,16 @@ const GList *
 grl_registry_lookup_metadata_key_relation (GrlRegistry *registry,
                                            GrlKeyID key)
 {
+  const GList *related_keys;
+
   g_return_val_if_fail (GRL_IS_REGISTRY (registry), NULL);
 
-  return g_hash_table_lookup (registry->priv->related_keys, GRLKEYID_TO_POINTER (key));
+  g_rw_lock_reader_lock (&registry->priv->keys_lock);
+  related_keys = g_hash_table_lookup (registry->priv->related_keys,
+                                      GRLKEYID_TO_POINTER (key));
+  g_rw_lock_reader_unlock (&registry->priv->keys_lock);
+
+  return related_keys;
 }
 
 /**
@@ -2031,7 +2213,15 @@ grl_registry_lookup_metadata_key_relation (GrlRegistry *registry,
 GList *
 grl_registry_get_metadata_keys (GrlRegistry *registry)
 {
-  return key_id_handler_get_all_keys (&registry->priv->key_id_handler);
+  GList *keys;
+
+  g_return_val_if_fail (GRL_IS_REGISTRY (registry), NULL);
+
+  g_rw_lock_reader_lock (&registry->priv->keys_lock);
+  keys = key_id_handler_get_all_keys (&registry->priv->key_id_handler);
+  g_rw_lock_reader_unlock (&registry->priv->keys_lock);
+
+  return keys;
 }
 
 /**
@@ -2251,15 +2441,9 @@ grl_registry_metadata_key_get_limits(GrlRegistry *registry,
                                      GValue *max)
 {
   GParamSpec *key_pspec;
-  const gchar *key_name;
   GType key_type;
 
-  key_name = key_id_handler_get_name (&registry->priv->key_id_handler, key);
-  if (!key_name) {
-    return FALSE;
-  }
-
-  key_pspec = g_hash_table_lookup (registry->priv->system_keys, key_name);
+  key_pspec = lookup_key_pspec (registry, key);
   if (!key_pspec) {
     return FALSE;
   }
@@ -2299,7 +2483,7 @@ grl_registry_metadata_key_clamp(GrlRegistry *registry,
                                 GValue *value,
                                 GValue *max)
 {
-  const gchar *key_name;
+  GParamSpec *key_pspec;
 
   g_return_val_if_fail (min != NULL, FALSE);
   g_return_val_if_fail (max != NULL, FALSE);
@@ -2308,21 +2492,16 @@ grl_registry_metadata_key_clamp(GrlRegistry *registry,
     return FALSE;
   }
 
-  key_name = key_id_handler_get_name (&registry->priv->key_id_handler, key);
-  if (key_name) {
-    GParamSpec *key_pspec;
-
-    key_pspec = g_hash_table_lookup (registry->priv->system_keys, key_name);
-    if (key_pspec) {
-      if (g_param_values_cmp(key_pspec, value, min) < 0) {
-        GRL_DEBUG("reset value to min");
-        g_value_transform(min, value);
-        return TRUE;
-      } else if (g_param_values_cmp(key_pspec, value, max) > 0) {
-        GRL_DEBUG("reset value to max");
-        g_value_transform(max, value);
-        return TRUE;
-      }
+  key_pspec = lookup_key_pspec (registry, key);
+  if (key_pspec) {
+    if (g_param_values_cmp(key_pspec, value, min) < 0) {
+      GRL_DEBUG("reset value to min");
+      g_value_transform(min, value);
+      return TRUE;
+    } else if (g_param_values_cmp(key_pspec, value, max) > 0) {
+      GRL_DEBUG("reset value to max");
+      g_value_transform(max, value);
+      return TRUE;
     }
   }
   return FALSE;
@@ -2338,23 +2517,18 @@ grl_registry_metadata_key_is_max_valid(GrlRegistry *registry,
                                        GValue *min,
                                        GValue *max)
 {
-  const gchar *key_name;
+  GParamSpec *key_pspec;
 
   if (min == NULL || max == NULL) {
     return TRUE;
   }
 
-  key_name = key_id_handler_get_name (&registry->priv->key_id_handler, key);
-  if (key_name) {
-    GParamSpec *key_pspec;
-
-    key_pspec = g_hash_table_lookup (registry->priv->system_keys, key_name);
-    if (key_pspec) {
-      if (g_param_values_cmp(key_pspec, max, min) < 0) {
-        GRL_DEBUG("Max value not valid: max < min");
+  key_pspec = lookup_key_pspec (registry, key);
+  if (key_pspec) {
+    if (g_param_values_cmp(key_pspec, max, min) < 0) {
+      GRL_DEBUG("Max value not valid: max < min");
 
-        return FALSE;
-      }
+      return FALSE;
     }
   }
   return TRUE;
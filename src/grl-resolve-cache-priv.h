@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2026 Grilo Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifndef _GRL_RESOLVE_CACHE_PRIV_H_
+#define _GRL_RESOLVE_CACHE_PRIV_H_
+
+#include <glib.h>
+#include <grl-media.h>
+
+#define GRL_RESOLVE_CACHE_SIZE_VAR "GRL_RESOLVE_CACHE_SIZE"
+
+/* Default bound of the cache, in bytes */
+#define GRL_RESOLVE_CACHE_DEFAULT_SIZE (4 * 1024 * 1024)
+
+/* Time-to-live, in seconds, of the metadata of sources that do not set
+   their own once a metadata store is configured */
+#define GRL_RESOLVE_CACHE_STORE_TTL (24 * 60 * 60)
+
+void grl_resolve_cache_set_max_size (gsize max_size);
+
+gsize grl_resolve_cache_get_max_size (void);
+
+void grl_resolve_cache_set_store_path (const gchar *path);
+
+guint grl_resolve_cache_get_default_ttl (void);
+
+gboolean grl_resolve_cache_lookup (const gchar *source_id,
+                                   GrlMedia *media,
+                                   const GList *keys,
+                                   guint ttl);
+
+void grl_resolve_cache_store (const gchar *source_id,
+                              GrlMedia *media,
+                              const GList *keys);
+
+void grl_resolve_cache_invalidate (const gchar *source_id,
+                                   const gchar *media_id);
+
+void grl_resolve_cache_clear (void);
+
+#endif /* _GRL_RESOLVE_CACHE_PRIV_H_ */
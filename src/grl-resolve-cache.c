@@ -0,0 +1,562 @@
+/*
+ * Copyright (C) 2026 Grilo Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/*
+ * Cache of the metadata obtained when resolving medias.
+ *
+ * Values are stored per media (identified by its source and id), and inside
+ * it per source that resolved them and per key. Keys a source was asked for
+ * but did not provide are stored too, so they are not asked again. Each
+ * value remembers when it was stored, and it is used only while it is not
+ * older than the time-to-live of the source that resolved it.
+ *
+ * Medias are kept in least-recently-used order, and the oldest ones are
+ * dropped when the size of the cached values goes beyond the limit.
+ *
+ * If a metadata store is configured, values and invalidations are also
+ * written to it, and it is loaded the first time the cache is used, so the
+ * cache survives restarts. Sources that do not set a time-to-live of their
+ * own then keep their values for GRL_RESOLVE_CACHE_STORE_TTL seconds.
+ */
+
+#include <string.h>
+
+#include "grl-resolve-cache-priv.h"
+#include "grl-metadata-store-priv.h"
+#include "grl-key-set-priv.h"
+#include "grl-log.h"
+
+#define GRL_LOG_DOMAIN_DEFAULT cache_log_domain
+GRL_LOG_DOMAIN(cache_log_domain);
+
+typedef struct {
+  gint64 stored;
+  GList *relkeys;
+  gsize size;
+} CacheValue;
+
+typedef struct {
+  gchar *key;
+  gchar *media_source;
+  gchar *media_id;
+  /* source id -> (GrlKeyID -> CacheValue) */
+  GHashTable *resolvers;
+  GList link;
+  gsize size;
+} CacheEntry;
+
+G_LOCK_DEFINE_STATIC (resolve_cache);
+
+static GHashTable *entries = NULL;
+static GQueue lru = G_QUEUE_INIT;
+static gsize total_size = 0;
+static gsize max_size = GRL_RESOLVE_CACHE_DEFAULT_SIZE;
+
+static gchar *store_path = NULL;
+static GrlMetadataStore *store = NULL;
+static gboolean store_loaded = FALSE;
+
+static gchar *
+entry_key_new (const gchar *media_source,
+               const gchar *media_id)
+{
+  /* Use a separator that can not be part of ids in practice */
+  return g_strconcat (media_source ? media_source : "", "\x1f", media_id, NULL);
+}
+
+static gsize
+value_size (const GValue *value)
+{
+  gsize size = sizeof (GValue);
+
+  if (G_VALUE_HOLDS_STRING (value) && g_value_get_string (value)) {
+    size += strlen (g_value_get_string (value)) + 1;
+  } else if (G_VALUE_HOLDS (value, G_TYPE_BYTE_ARRAY) && g_value_get_boxed (value)) {
+    size += ((GByteArray *) g_value_get_boxed (value))->len;
+  } else if (G_VALUE_HOLDS (value, G_TYPE_BYTES) && g_value_get_boxed (value)) {
+    size += g_bytes_get_size (g_value_get_boxed (value));
+  }
+
+  return size;
+}
+
+static void
+cache_value_free (CacheValue *cvalue)
+{
+  g_list_free_full (cvalue->relkeys, g_object_unref);
+  g_slice_free (CacheValue, cvalue);
+}
+
+static CacheValue *
+cache_value_new (gint64 stored,
+                 GList *relkeys)
+{
+  CacheValue *cvalue;
+  GList *each_relkeys, *related, *each_related;
+
+  cvalue = g_slice_new0 (CacheValue);
+  cvalue->stored = stored;
+  cvalue->relkeys = relkeys;
+  cvalue->size = sizeof (CacheValue);
+
+  for (each_relkeys = relkeys; each_relkeys; each_relkeys = g_list_next (each_relkeys)) {
+    related = grl_related_keys_get_keys (each_relkeys->data);
+    for (each_related = related; each_related; each_related = g_list_next (each_related)) {
+      cvalue->size += value_size (grl_related_keys_get (each_relkeys->data,
+                                                        GRLPOINTER_TO_KEYID (each_related->data)));
+    }
+    g_list_free (related);
+    cvalue->size += sizeof (GList);
+  }
+
+  return cvalue;
+}
+
+/* Copies the values of @key in @media */
+static GList *
+media_get_related_keys (GrlMedia *media,
+                        GrlKeyID key)
+{
+  GList *relkeys = NULL;
+  guint i, length;
+
+  length = grl_data_length (GRL_DATA (media), key);
+  for (i = 0; i < length; i++) {
+    relkeys = g_list_prepend (relkeys,
+                              grl_related_keys_dup (grl_data_get_related_keys (GRL_DATA (media), key, i)));
+  }
+
+  return g_list_reverse (relkeys);
+}
+
+/* Converts between the monotonic times used in memory and the wall-clock
+   times written in the store */
+static gint64
+stored_to_real (gint64 stored)
+{
+  return g_get_real_time () - (g_get_monotonic_time () - stored);
+}
+
+static gint64
+stored_from_real (gint64 real)
+{
+  return g_get_monotonic_time () - (g_get_real_time () - real);
+}
+
+static void
+cache_entry_free (CacheEntry *entry)
+{
+  g_free (entry->key);
+  g_free (entry->media_source);
+  g_free (entry->media_id);
+  g_hash_table_unref (entry->resolvers);
+  g_slice_free (CacheEntry, entry);
+}
+
+static gsize
+resolver_size (GHashTable *values)
+{
+  GHashTableIter iter;
+  CacheValue *cvalue;
+  gsize size = 0;
+
+  g_hash_table_iter_init (&iter, values);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &cvalue)) {
+    size += cvalue->size;
+  }
+
+  return size;
+}
+
+static void
+cache_entry_remove (CacheEntry *entry)
+{
+  g_queue_unlink (&lru, &entry->link);
+  total_size -= entry->size;
+  g_hash_table_remove (entries, entry->key);
+}
+
+static void
+cache_evict (void)
+{
+  CacheEntry *entry;
+
+  while (total_size > max_size && lru.tail) {
+    entry = lru.tail->data;
+    cache_entry_remove (entry);
+  }
+}
+
+/* Returns the entry of the media, creating it if needed, as the most
+   recently used one */
+static CacheEntry *
+cache_entry_get (const gchar *media_source,
+                 const gchar *media_id)
+{
+  CacheEntry *entry;
+  gchar *key;
+
+  key = entry_key_new (media_source, media_id);
+  entry = g_hash_table_lookup (entries, key);
+  if (entry) {
+    g_free (key);
+    g_queue_unlink (&lru, &entry->link);
+  } else {
+    entry = g_slice_new0 (CacheEntry);
+    entry->key = key;
+    entry->media_source = g_strdup (media_source);
+    entry->media_id = g_strdup (media_id);
+    entry->resolvers = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                              g_free,
+                                              (GDestroyNotify) g_hash_table_unref);
+    entry->link.data = entry;
+    entry->size = sizeof (CacheEntry) + strlen (key) + 1;
+    total_size += entry->size;
+    g_hash_table_insert (entries, entry->key, entry);
+  }
+  g_queue_push_head_link (&lru, &entry->link);
+
+  return entry;
+}
+
+static void
+cache_entry_set (CacheEntry *entry,
+                 const gchar *resolver,
+                 GrlKeyID key,
+                 CacheValue *cvalue)
+{
+  CacheValue *old_value;
+  GHashTable *values;
+
+  values = g_hash_table_lookup (entry->resolvers, resolver);
+  if (!values) {
+    values = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                    NULL,
+                                    (GDestroyNotify) cache_value_free);
+    g_hash_table_insert (entry->resolvers, g_strdup (resolver), values);
+  }
+
+  old_value = g_hash_table_lookup (values, GRLKEYID_TO_POINTER (key));
+  if (old_value) {
+    entry->size -= old_value->size;
+    total_size -= old_value->size;
+  }
+  entry->size += cvalue->size;
+  total_size += cvalue->size;
+  g_hash_table_insert (values, GRLKEYID_TO_POINTER (key), cvalue);
+}
+
+static void
+cache_invalidate (const gchar *source_id,
+                  const gchar *media_id)
+{
+  GHashTableIter iter;
+  CacheEntry *entry;
+  GHashTable *values;
+  gsize size;
+  gchar *key;
+
+  if (media_id) {
+    key = entry_key_new (source_id, media_id);
+    entry = g_hash_table_lookup (entries, key);
+    g_free (key);
+    if (entry) {
+      cache_entry_remove (entry);
+    }
+    return;
+  }
+
+  g_hash_table_iter_init (&iter, entries);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry)) {
+    if (g_strcmp0 (entry->media_source, source_id) == 0) {
+      g_queue_unlink (&lru, &entry->link);
+      total_size -= entry->size;
+      g_hash_table_iter_remove (&iter);
+      continue;
+    }
+    values = g_hash_table_lookup (entry->resolvers, source_id);
+    if (values) {
+      size = resolver_size (values);
+      entry->size -= size;
+      total_size -= size;
+      g_hash_table_remove (entry->resolvers, source_id);
+    }
+  }
+}
+
+static void
+store_load_value (gint64 stored,
+                  const gchar *resolver,
+                  const gchar *media_source,
+                  const gchar *media_id,
+                  GrlKeyID key,
+                  GList *relkeys,
+                  gpointer user_data)
+{
+  cache_entry_set (cache_entry_get (media_source, media_id),
+                   resolver,
+                   key,
+                   cache_value_new (stored_from_real (stored), relkeys));
+}
+
+static void
+store_load_invalidation (const gchar *source_id,
+                         const gchar *media_id,
+                         gpointer user_data)
+{
+  cache_invalidate (source_id, media_id);
+}
+
+static void
+cache_ensure (void)
+{
+  GError *error = NULL;
+
+  if (!entries) {
+    entries = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                     NULL,
+                                     (GDestroyNotify) cache_entry_free);
+  }
+
+  /* The store is loaded on first use, so keys registered by plugins are
+     already known */
+  if (store_path && !store_loaded) {
+    store_loaded = TRUE;
+    store = grl_metadata_store_open (store_path,
+                                     store_load_value,
+                                     store_load_invalidation,
+                                     NULL,
+                                     &error);
+    if (!store) {
+      GRL_WARNING ("Could not open metadata store: %s", error->message);
+      g_error_free (error);
+      return;
+    }
+    cache_evict ();
+  }
+}
+
+/*
+ * Makes the cache persistent in the file at @path, or only in memory if
+ * @path is %NULL.
+ */
+void
+grl_resolve_cache_set_store_path (const gchar *path)
+{
+  G_LOCK (resolve_cache);
+  g_clear_pointer (&store, grl_metadata_store_close);
+  g_free (store_path);
+  store_path = g_strdup (path);
+  store_loaded = FALSE;
+  G_UNLOCK (resolve_cache);
+}
+
+/*
+ * Returns the time-to-live of the metadata of sources that do not set one.
+ * Metadata is only cached by default if it is also kept on disk.
+ */
+guint
+grl_resolve_cache_get_default_ttl (void)
+{
+  guint ttl;
+
+  G_LOCK (resolve_cache);
+  ttl = store_path ? GRL_RESOLVE_CACHE_STORE_TTL : 0;
+  G_UNLOCK (resolve_cache);
+
+  return ttl;
+}
+
+void
+grl_resolve_cache_set_max_size (gsize size)
+{
+  G_LOCK (resolve_cache);
+  max_size = size;
+  if (entries) {
+    cache_evict ();
+  }
+  G_UNLOCK (resolve_cache);
+}
+
+gsize
+grl_resolve_cache_get_max_size (void)
+{
+  return max_size;
+}
+
+/*
+ * Adds to @media the values of @keys that @source_id stored for it, if all
+ * of them are fresh. Returns %FALSE, leaving @media untouched, otherwise.
+ */
+gboolean
+grl_resolve_cache_lookup (const gchar *source_id,
+                          GrlMedia *media,
+                          const GList *keys,
+                          guint ttl)
+{
+  CacheEntry *entry;
+  CacheValue *cvalue;
+  GHashTable *values;
+  GrlKeySet *added;
+  const GList *each_key;
+  GList *each_relkeys;
+  GList *related, *each_related;
+  const gchar *media_id;
+  gchar *key;
+  GrlKeyID key_id;
+  gint64 now;
+  gboolean hit = FALSE;
+
+  media_id = grl_media_get_id (media);
+  if (!media_id || ttl == 0 || !keys) {
+    return FALSE;
+  }
+
+  G_LOCK (resolve_cache);
+
+  cache_ensure ();
+
+  key = entry_key_new (grl_media_get_source (media), media_id);
+  entry = g_hash_table_lookup (entries, key);
+  g_free (key);
+  if (!entry) {
+    goto out;
+  }
+
+  values = g_hash_table_lookup (entry->resolvers, source_id);
+  if (!values) {
+    goto out;
+  }
+
+  now = g_get_monotonic_time ();
+  for (each_key = keys; each_key; each_key = g_list_next (each_key)) {
+    cvalue = g_hash_table_lookup (values, each_key->data);
+    if (!cvalue || now - cvalue->stored > (gint64) ttl * G_USEC_PER_SEC) {
+      goto out;
+    }
+  }
+
+  /* Related keys are added together, so a group is added only once */
+  added = grl_key_set_new ();
+  for (each_key = keys; each_key; each_key = g_list_next (each_key)) {
+    key_id = GRLPOINTER_TO_KEYID (each_key->data);
+    if (grl_key_set_contains (added, key_id) ||
+        grl_data_has_key (GRL_DATA (media), key_id)) {
+      continue;
+    }
+    cvalue = g_hash_table_lookup (values, each_key->data);
+    for (each_relkeys = cvalue->relkeys; each_relkeys; each_relkeys = g_list_next (each_relkeys)) {
+      related = grl_related_keys_get_keys (each_relkeys->data);
+      for (each_related = related; each_related; each_related = g_list_next (each_related)) {
+        grl_key_set_add (added, GRLPOINTER_TO_KEYID (each_related->data));
+      }
+      g_list_free (related);
+      grl_data_add_related_keys (GRL_DATA (media),
+                                 grl_related_keys_dup (each_relkeys->data));
+    }
+  }
+  grl_key_set_unref (added);
+
+  g_queue_unlink (&lru, &entry->link);
+  g_queue_push_head_link (&lru, &entry->link);
+  hit = TRUE;
+
+ out:
+  G_UNLOCK (resolve_cache);
+
+  return hit;
+}
+
+/*
+ * Stores the values of @keys in @media as resolved by @source_id. Keys that
+ * @media does not have are stored as known to be missing.
+ */
+void
+grl_resolve_cache_store (const gchar *source_id,
+                         GrlMedia *media,
+                         const GList *keys)
+{
+  CacheEntry *entry;
+  CacheValue *cvalue;
+  const GList *each_key;
+  const gchar *media_id;
+  GrlKeyID key;
+
+  media_id = grl_media_get_id (media);
+  if (!media_id || !keys || max_size == 0) {
+    return;
+  }
+
+  G_LOCK (resolve_cache);
+
+  cache_ensure ();
+
+  entry = cache_entry_get (grl_media_get_source (media), media_id);
+  for (each_key = keys; each_key; each_key = g_list_next (each_key)) {
+    key = GRLPOINTER_TO_KEYID (each_key->data);
+    cvalue = cache_value_new (g_get_monotonic_time (),
+                              media_get_related_keys (media, key));
+    cache_entry_set (entry, source_id, key, cvalue);
+    if (store) {
+      grl_metadata_store_add_value (store, g_get_real_time (), source_id,
+                                    entry->media_source, media_id,
+                                    key, cvalue->relkeys);
+    }
+  }
+
+  cache_evict ();
+
+  G_UNLOCK (resolve_cache);
+}
+
+/*
+ * Drops the values cached for the media @media_id of @source_id. If
+ * @media_id is %NULL, drops everything related to @source_id: the medias
+ * coming from it, and the values it resolved for other medias.
+ */
+void
+grl_resolve_cache_invalidate (const gchar *source_id,
+                              const gchar *media_id)
+{
+  G_LOCK (resolve_cache);
+
+  cache_ensure ();
+  cache_invalidate (source_id, media_id);
+  if (store) {
+    grl_metadata_store_add_invalidation (store, source_id, media_id);
+  }
+
+  G_UNLOCK (resolve_cache);
+}
+
+void
+grl_resolve_cache_clear (void)
+{
+  G_LOCK (resolve_cache);
+  if (entries) {
+    g_queue_init (&lru);
+    g_hash_table_remove_all (entries);
+    total_size = 0;
+  }
+  /* The store is kept on disk, and loaded again on next use */
+  g_clear_pointer (&store, grl_metadata_store_close);
+  store_loaded = FALSE;
+  G_UNLOCK (resolve_cache);
+}
@@ -33,6 +33,7 @@
  */
 
 #include "grl-source.h"
+#include "grl-source-priv.h"
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -44,7 +45,12 @@
 #include "grl-type-builtins.h"
 #include "grl-sync-priv.h"
 #include "grl-registry.h"
+#include "grl-registry-priv.h"
 #include "grl-error.h"
+#include "grl-key-set-priv.h"
+#include "grl-resolve-cache-priv.h"
+#include "grl-uri-index-priv.h"
+#include "grl-metrics-priv.h"
 #include "grl-log.h"
 #include "data/grl-media.h"
 
@@ -54,6 +60,18 @@
 #define GRL_LOG_DOMAIN_DEFAULT  source_log_domain
 GRL_LOG_DOMAIN(source_log_domain);
 
+/* Maximum time (in microseconds) spent sending queued results to the user in a
+   single main loop iteration */
+#define QUEUE_PROCESS_TIME_BUDGET (5 * 1000)
+
+/* Distance between the GLib priorities of two consecutive operation priority
+   classes */
+#define OPERATION_PRIORITY_STEP 50
+
+/* Default maximum number of single removes running at once when removing
+   several medias from a source without remove_batch */
+#define REMOVE_BATCH_CONCURRENCY 4
+
 enum {
   PROP_0,
   PROP_ID,
@@ -64,7 +82,18 @@ enum {
   PROP_RANK,
   PROP_AUTO_SPLIT_THRESHOLD,
   PROP_SUPPORTED_MEDIA,
-  PROP_SOURCE_TAGS
+  PROP_SOURCE_TAGS,
+  PROP_RESOLVE_CONCURRENCY,
+  PROP_THREAD_SAFE_OPERATIONS,
+  PROP_AUTO_SPLIT_PREFETCH,
+  PROP_AUTO_SPLIT_MIN_THRESHOLD,
+  PROP_AUTO_SPLIT_MAX_THRESHOLD,
+  PROP_RESOLVE_CACHE_TTL,
+  PROP_WRITE_BEHIND_MAX_PENDING,
+  PROP_WRITE_BEHIND_DELAY,
+  PROP_URI_PREFIXES,
+  PROP_PLAN_CACHEABLE,
+  PROP_REMOVE_CONCURRENCY
 };
 
 enum {
@@ -78,6 +107,13 @@ typedef void (*MediaDecorateCb) (GrlMedia *media,
                                  gpointer user_data,
                                  const GError *error);
 
+/* A key list of a source as a set, along with the keys it was built from */
+typedef struct {
+  GrlKeySet *set;
+  GrlKeyID *keys;
+  guint n_keys;
+} KeyListSet;
+
 struct _GrlSourcePrivate {
   gchar *id;
   gchar *name;
@@ -85,9 +121,36 @@ struct _GrlSourcePrivate {
   gint rank;
   GrlSupportedMedia supported_media;
   guint auto_split_threshold;
+  guint auto_split_prefetch;
+  guint auto_split_min_threshold;
+  guint auto_split_max_threshold;
+  gdouble auto_split_throughput;
+  gboolean auto_split_shrinking;
+  guint resolve_concurrency;
+  guint remove_concurrency;
+  guint resolve_cache_ttl;
+  gboolean resolve_cache_ttl_set;
+  GrlSupportedOps thread_safe_operations;
+  /* Protects the adaptive auto-split state and the decoration slots, shared
+     by the operations of all the threads */
+  GMutex lock;
+  guint resolves_running;
+  GQueue *resolves_waiting;
   GrlPlugin *plugin;
   GIcon *icon;
   GPtrArray *tags;
+  gchar **uri_prefixes;
+  gboolean plan_cacheable;
+  /* Key lists as sets, protected by lock */
+  KeyListSet supported_keys;
+  KeyListSet slow_keys;
+  KeyListSet writable_keys;
+  /* Edits waiting to be stored, by media id, protected by lock */
+  guint write_behind_max_pending;
+  guint write_behind_delay;
+  guint write_behind_generation;
+  GHashTable *write_behind_entries;
+  GQueue *write_behind_queue;
 };
 
 typedef struct {
@@ -95,6 +158,7 @@ typedef struct {
   gboolean is_ready;
   gint remaining;
   GError *error;
+  gint64 queued;
 } QueueElement;
 
 typedef struct {
@@ -103,6 +167,13 @@ typedef struct {
   gboolean being_queried;
 } MapNode;
 
+/* Times of a chunk, from the moment it is requested */
+struct AutoSplitTiming {
+  gint64 requested;
+  gint64 first_item;
+  guint items;
+};
+
 struct AutoSplitCtl {
   gboolean chunk_first;
   guint chunk_requested;
@@ -111,6 +182,36 @@ struct AutoSplitCtl {
   guint count;
   guint total_remaining;
   guint chunk_remaining;
+  gboolean chunk_deferred;
+  guint next_skip;
+  /* Token in the last element received, if the source sent one and declares
+     them in its caps */
+  gboolean use_continuation;
+  gchar *continuation;
+  guint to_request;
+  guint prefetch_depth;
+  GQueue *prefetched;
+  struct AutoSplitTiming timing;
+};
+
+/* A chunk requested in advance. Its results are kept until it becomes the
+   live one, that is, until all the previous chunks have been sent */
+struct AutoSplitChunk {
+  struct BrowseRelayCb *brc;
+  GrlSupportedOps operation_type;
+  guint operation_id;
+  guint count;
+  union {
+    GrlSourceBrowseSpec *browse;
+    GrlSourceSearchSpec *search;
+    GrlSourceQuerySpec *query;
+  } spec;
+  GQueue *results;
+  struct AutoSplitTiming timing;
+  guint replay_id;
+  gboolean replaying;
+  gboolean live;
+  gboolean done;
 };
 
 struct OperationState {
@@ -119,6 +220,15 @@ struct OperationState {
   gboolean cancelled;
   gboolean completed;
   gboolean started;
+  /* Live operations issued on behalf of this one, and the one this was
+     issued on behalf of */
+  GHashTable *linked;
+  guint linked_to;
+  struct ResolveFlight *flight;
+  gboolean deadline_exceeded;
+  /* Work still done for the operation after its last result */
+  guint background;
+  gboolean finish_deferred;
 };
 
 struct ResolveRelayCb {
@@ -134,6 +244,9 @@ struct ResolveRelayCb {
   GHashTable *resolve_specs;
   GList *specs_to_invoke;
   gboolean cancel_invoked;
+  gboolean cache_hit;
+  guint deadline_id;
+  gboolean deadline_exceeded;
   GError *error;
   union {
     GrlSourceResolveSpec *res;
@@ -141,6 +254,25 @@ struct ResolveRelayCb {
   } spec;
 };
 
+/* A resolve request sent to a source, shared by the identical requests that
+   arrive while it is running. If it was sent along with others in a single
+   request to resolve_batch(), @batch is that request */
+struct ResolveFlight {
+  gchar *key;
+  GMainContext *context;
+  GrlSourceResolveSpec *spec;
+  GList *waiters;
+  struct ResolveBatchFlights *batch;
+};
+
+/* A request to resolve_batch() made of the flights in @flights, which is
+   cancelled once none of them has anybody waiting for it */
+struct ResolveBatchFlights {
+  GrlSourceResolveBatchSpec *spec;
+  GPtrArray *flights;
+  guint waited;
+};
+
 struct BrowseRelayCb {
   GrlSource *source;
   GrlSupportedOps operation_type;
@@ -148,6 +280,7 @@ struct BrowseRelayCb {
   GList *keys;
   GrlOperationOptions *options;
   GrlSourceResultCb user_callback;
+  GrlSourceBatchResultCb batch_callback;
   gpointer user_data;
   union {
     GrlSourceBrowseSpec *browse;
@@ -155,8 +288,30 @@ struct BrowseRelayCb {
     GrlSourceQuerySpec *query;
   } spec;
   GQueue *queue;
+  GHashTable *queue_pending;
+  GPtrArray *decorate_pending;
+  guint decorate_id;
   gboolean dispatcher_running;
   struct AutoSplitCtl *auto_split;
+  struct ProgressiveData *progressive;
+  guint deadline_id;
+  /* The deadline passed before the source finished: its results are
+     discarded, and the relay is freed once both the source and the user got
+     their last element */
+  gboolean deadline_closed;
+  gboolean user_done;
+};
+
+/* Elements already sent to the user, waiting to get their slow keys */
+struct ProgressiveData {
+  GrlSource *source;
+  guint operation_id;
+  GPtrArray *medias;
+  /* media -> keys it was missing when sent */
+  GHashTable *missing;
+  GList *keys;
+  GrlOperationOptions *options;
+  guint pending;
 };
 
 struct RemoveRelayCb {
@@ -166,6 +321,31 @@ struct RemoveRelayCb {
   gpointer user_data;
   GrlSourceRemoveSpec *spec;
   GError *error;
+  gint64 started;
+};
+
+struct RemoveBatchRelayCb {
+  GrlSource *source;
+  GPtrArray *medias;
+  GPtrArray *errors;
+  guint failed;
+  GrlSourceRemoveBatchCb user_callback;
+  gpointer user_data;
+  gint64 started;
+  /* Batched removal: the indexes of the elements sent to the source */
+  GrlSourceRemoveBatchSpec *spec;
+  GArray *sent;
+  /* Single removes */
+  GList *items;
+  guint next;
+  guint running;
+  gboolean scheduled;
+};
+
+struct RemoveBatchItem {
+  struct RemoveBatchRelayCb *rbrc;
+  guint index;
+  GrlSourceRemoveSpec *spec;
 };
 
 struct StoreRelayCb {
@@ -173,6 +353,7 @@ struct StoreRelayCb {
   GrlSourceStoreCb user_callback;
   gpointer user_data;
   GrlSourceStoreSpec *spec;
+  gint64 started;
 };
 
 struct StoreMetadataRelayCb {
@@ -184,6 +365,72 @@ struct StoreMetadataRelayCb {
   GList *specs;
   GrlSourceStoreCb user_callback;
   gpointer user_data;
+  gint64 started;
+};
+
+struct StoreMetadataBatchRelayCb {
+  GrlSource *source;
+  GPtrArray *medias;
+  GHashTable *map;
+  GList *failed_keys;
+  guint pending;
+  GList *specs;
+  GrlSourceStoreMetadataBatchCb user_callback;
+  gpointer user_data;
+  gint64 started;
+};
+
+/* A source without store_metadata_batch, given the elements one by one */
+struct StoreMetadataBatchEach {
+  struct StoreMetadataBatchRelayCb *smbrc;
+  GrlSource *source;
+  GList *keys;
+  guint next;
+  gboolean failed;
+  GrlSourceStoreMetadataSpec *spec;
+};
+
+/* Edits of a media waiting to be stored, and who is waiting for them */
+typedef struct {
+  GrlMedia *media;
+  GList *keys;
+  GrlWriteFlags flags;
+  GList *waiters;
+} WriteBehindEntry;
+
+typedef struct {
+  GrlSource *source;
+  GrlMedia *media;
+  GList *keys;
+  GrlSourceStoreCb callback;
+  gpointer user_data;
+  GMainContext *context;
+  GList *failed_keys;
+  GError *error;
+} WriteBehindWaiter;
+
+/* Entries with the same keys and flags, stored together */
+typedef struct {
+  GList *entries;
+  GList *keys;
+  GrlWriteFlags flags;
+} WriteBehindBatch;
+
+typedef struct {
+  GrlSource *source;
+  guint generation;
+} WriteBehindTimer;
+
+/* A result sent by a plugin outside the context of its operation */
+struct RelayRedirect {
+  GrlSource *source;
+  guint operation_id;
+  GrlMedia *media;
+  guint remaining;
+  gpointer user_data;
+  GError *error;
+  GrlSourceResultCb result_cb;
+  GrlSourceResolveCb resolve_cb;
 };
 
 struct ResolveFullResolutionCtlCb {
@@ -212,6 +459,30 @@ struct MediaDecorateData {
   gpointer user_data;
 };
 
+struct DecorateResolveData {
+  GrlSource *source;
+  GPtrArray *medias;
+  GPtrArray *mdds;
+  GList *keys;
+  GrlOperationOptions *options;
+  GMainContext *context;
+  gint64 started;
+};
+
+struct ResolveBatchRelayCb {
+  GrlSource *source;
+  guint operation_id;
+  GPtrArray *medias;
+  GList *keys;
+  GrlOperationOptions *options;
+  GrlSourceResolveBatchCb user_callback;
+  gpointer user_data;
+  GList *waiters;
+  GHashTable *pending;
+  gboolean cancelled;
+  GError *error;
+};
+
 static void grl_source_finalize (GObject *plugin);
 
 static void grl_source_dispose (GObject *objct);
@@ -249,10 +520,28 @@ static void resolve_result_relay_cb (GrlSource *source,
 
 static gboolean resolve_idle (gpointer user_data);
 
+static void resolve_flight_leave (struct ResolveFlight *flight,
+                                  guint operation_id);
+
+static void operation_stop (struct OperationState *op_state);
+
 static gboolean resolve_all_done (gpointer user_data);
 
 static void source_cancel_cb (struct OperationState *op_state);
 
+static void auto_split_run_next_chunk (struct BrowseRelayCb *brc);
+
+static void auto_split_free (struct AutoSplitCtl *as_ctl);
+
+static void key_list_set_clear (KeyListSet *cached);
+
+static void browse_result_relay_cb (GrlSource *source,
+                                    guint operation_id,
+                                    GrlMedia *media,
+                                    guint remaining,
+                                    gpointer user_data,
+                                    const GError *error);
+
 /* ================ GrlSource GObject ================ */
 
 G_DEFINE_ABSTRACT_TYPE_WITH_CODE (GrlSource,
@@ -386,6 +675,61 @@ grl_source_class_init (GrlSourceClass *source_class)
                                                       0, G_MAXUINT, 0,
                                                       G_PARAM_READWRITE |
                                                       G_PARAM_STATIC_STRINGS));
+  /**
+   * GrlSource:auto-split-prefetch:
+   *
+   * Number of chunks of an auto-split query that are requested in advance,
+   * while the results of the previous ones are still being delivered.
+   * Results are sent in order in any case. 0 means the next chunk is only
+   * requested once the current one has been consumed.
+   *
+   * Since: 0.3.20
+   */
+  g_object_class_install_property (gobject_class,
+                                   PROP_AUTO_SPLIT_PREFETCH,
+                                   g_param_spec_uint ("auto-split-prefetch",
+                                                      "Auto-split prefetch",
+                                                      "Number of auto-split chunks requested in advance",
+                                                      0, G_MAXUINT, 0,
+                                                      G_PARAM_READWRITE |
+                                                      G_PARAM_STATIC_STRINGS));
+  /**
+   * GrlSource:auto-split-min-threshold:
+   *
+   * Lower bound of the auto-split threshold when it is adapted to the
+   * observed performance of the source.
+   *
+   * See grl_source_set_auto_split_limits().
+   *
+   * Since: 0.3.20
+   */
+  g_object_class_install_property (gobject_class,
+                                   PROP_AUTO_SPLIT_MIN_THRESHOLD,
+                                   g_param_spec_uint ("auto-split-min-threshold",
+                                                      "Auto-split minimum threshold",
+                                                      "Lower bound of the adaptive auto-split threshold",
+                                                      0, G_MAXUINT, 0,
+                                                      G_PARAM_READWRITE |
+                                                      G_PARAM_STATIC_STRINGS));
+  /**
+   * GrlSource:auto-split-max-threshold:
+   *
+   * Upper bound of the auto-split threshold when it is adapted to the
+   * observed performance of the source. 0 means the threshold is not
+   * adapted.
+   *
+   * See grl_source_set_auto_split_limits().
+   *
+   * Since: 0.3.20
+   */
+  g_object_class_install_property (gobject_class,
+                                   PROP_AUTO_SPLIT_MAX_THRESHOLD,
+                                   g_param_spec_uint ("auto-split-max-threshold",
+                                                      "Auto-split maximum threshold",
+                                                      "Upper bound of the adaptive auto-split threshold",
+                                                      0, G_MAXUINT, 0,
+                                                      G_PARAM_READWRITE |
+                                                      G_PARAM_STATIC_STRINGS));
   /**
    * GrlSource:supported-media:
    *
@@ -475,6 +819,176 @@ grl_source_class_init (GrlSourceClass *source_class)
                                                        G_PARAM_CONSTRUCT |
                                                        G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GrlSource:uri-prefixes:
+   *
+   * URI prefixes this source creates medias for, such as
+   * <literal>"file:"</literal> for a URI scheme or
+   * <literal>"https://www.example.com/media/"</literal>. The registry sends
+   * URIs starting with them straight to this source in
+   * grl_multiple_get_media_from_uri(), without calling
+   * grl_source_test_media_from_uri() on every source.
+   *
+   * Prefixes take precedence: the sources declaring one of @uri are tried
+   * before the sources that need testing. If the source also implements
+   * test_media_from_uri, it is still tested for the URIs outside its
+   * prefixes.
+   *
+   * Since: 0.3.20
+   */
+  g_object_class_install_property (gobject_class,
+                                   PROP_URI_PREFIXES,
+                                   g_param_spec_boxed ("uri-prefixes",
+                                                       "URI prefixes",
+                                                       "URI prefixes this source creates medias for",
+                                                       G_TYPE_STRV,
+                                                       G_PARAM_READWRITE |
+                                                       G_PARAM_CONSTRUCT_ONLY |
+                                                       G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GrlSource:plan-cacheable:
+   *
+   * Whether the answers of the may_resolve vmethod of the source only depend
+   * on the type of the media, the source it comes from, the scheme of its
+   * URL and which keys it has, rather than on their values. The sources to
+   * ask for the keys of a media are then worked out once for all the medias
+   * alike. Sources not implementing may_resolve are always considered so.
+   * The answers of the rest are checked again for each media before reusing
+   * what was worked out.
+   *
+   * Since: 0.3.20
+   */
+  g_object_class_install_property (gobject_class,
+                                   PROP_PLAN_CACHEABLE,
+                                   g_param_spec_boolean ("plan-cacheable",
+                                                         "Plan cacheable",
+                                                         "Whether may_resolve only depends on the keys a media has",
+                                                         FALSE,
+                                                         G_PARAM_READWRITE |
+                                                         G_PARAM_CONSTRUCT_ONLY |
+                                                         G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GrlSource:resolve-concurrency:
+   *
+   * Maximum number of resolve operations that can be running at the same
+   * time in this source to complete results of other sources, when they
+   * are requested with %GRL_RESOLVE_FULL. Further requests wait until a
+   * running one finishes. 0 means there is no limit.
+   *
+   * Since: 0.3.20
+   */
+  g_object_class_install_property (gobject_class,
+                                   PROP_RESOLVE_CONCURRENCY,
+                                   g_param_spec_uint ("resolve-concurrency",
+                                                      "Resolve concurrency",
+                                                      "Maximum number of concurrent resolves to complete other sources results",
+                                                      0, G_MAXUINT, 0,
+                                                      G_PARAM_READWRITE |
+                                                      G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GrlSource:remove-concurrency:
+   *
+   * Maximum number of remove operations that can be running at the same
+   * time in this source when removing several elements with
+   * grl_source_remove_batch() and the source does not implement
+   * remove_batch. 0 means there is no limit.
+   *
+   * Since: 0.3.20
+   */
+  g_object_class_install_property (gobject_class,
+                                   PROP_REMOVE_CONCURRENCY,
+                                   g_param_spec_uint ("remove-concurrency",
+                                                      "Remove concurrency",
+                                                      "Maximum number of concurrent removes of a batch",
+                                                      0, G_MAXUINT,
+                                                      REMOVE_BATCH_CONCURRENCY,
+                                                      G_PARAM_READWRITE |
+                                                      G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GrlSource:resolve-cache-ttl:
+   *
+   * Number of seconds the metadata resolved by this source is kept in the
+   * resolve cache. 0 means it is not cached. Unless it is set, it is 0, or
+   * one day if a metadata store is configured.
+   *
+   * Since: 0.3.20
+   */
+  g_object_class_install_property (gobject_class,
+                                   PROP_RESOLVE_CACHE_TTL,
+                                   g_param_spec_uint ("resolve-cache-ttl",
+                                                      "Resolve cache TTL",
+                                                      "Seconds resolved metadata is cached",
+                                                      0, G_MAXUINT, 0,
+                                                      G_PARAM_READWRITE |
+                                                      G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GrlSource:thread-safe-operations:
+   *
+   * Operations whose implementation can run in a thread other than the
+   * main one. They are run in a pool of threads shared by all sources, and
+   * their results are sent back to the main context of the thread that
+   * requested the operation. Only %GRL_OP_RESOLVE, %GRL_OP_BROWSE,
+   * %GRL_OP_SEARCH, %GRL_OP_QUERY and %GRL_OP_MEDIA_FROM_URI are considered.
+   *
+   * Cancellations are not sent to their thread: the #GrlSourceClass.cancel
+   * implementation may run while the call is still running, and must be
+   * safe to use concurrently with it. Calls cancelled before a thread picks
+   * them up are not run.
+   *
+   * Since: 0.3.20
+   */
+  g_object_class_install_property (gobject_class,
+                                   PROP_THREAD_SAFE_OPERATIONS,
+                                   g_param_spec_flags ("thread-safe-operations",
+                                                       "Thread-safe operations",
+                                                       "Operations that can run in a thread",
+                                                       GRL_TYPE_SUPPORTED_OPS,
+                                                       GRL_OP_NONE,
+                                                       G_PARAM_READWRITE |
+                                                       G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GrlSource:write-behind-max-pending:
+   *
+   * Number of edited medias kept before storing them together. 0 means
+   * edits are stored as soon as they are requested.
+   *
+   * See grl_source_set_write_behind().
+   *
+   * Since: 0.3.20
+   */
+  g_object_class_install_property (gobject_class,
+                                   PROP_WRITE_BEHIND_MAX_PENDING,
+                                   g_param_spec_uint ("write-behind-max-pending",
+                                                      "Write-behind maximum pending",
+                                                      "Edited medias kept before storing them",
+                                                      0, G_MAXUINT, 0,
+                                                      G_PARAM_READWRITE |
+                                                      G_PARAM_STATIC_STRINGS));
+  /**
+   * GrlSource:write-behind-delay:
+   *
+   * Milliseconds edits are kept before storing them. 0 means they are kept
+   * until there are enough of them.
+   *
+   * See grl_source_set_write_behind().
+   *
+   * Since: 0.3.20
+   */
+  g_object_class_install_property (gobject_class,
+                                   PROP_WRITE_BEHIND_DELAY,
+                                   g_param_spec_uint ("write-behind-delay",
+                                                      "Write-behind delay",
+                                                      "Milliseconds edits are kept before storing them",
+                                                      0, G_MAXUINT, 0,
+                                                      G_PARAM_READWRITE |
+                                                      G_PARAM_STATIC_STRINGS));
+
   /**
    * GrlSource::content-changed:
    * @source: source that has changed
@@ -521,6 +1035,14 @@ grl_source_init (GrlSource *source)
 {
   source->priv = grl_source_get_instance_private (source);
   source->priv->tags = g_ptr_array_new_with_free_func (g_free);
+  source->priv->resolves_waiting = g_queue_new ();
+  source->priv->remove_concurrency = REMOVE_BATCH_CONCURRENCY;
+  source->priv->write_behind_entries = g_hash_table_new_full (g_str_hash,
+                                                              g_str_equal,
+                                                              g_free,
+                                                              NULL);
+  source->priv->write_behind_queue = g_queue_new ();
+  g_mutex_init (&source->priv->lock);
 }
 
 static void
@@ -540,6 +1062,15 @@ grl_source_finalize (GObject *object)
 
   g_clear_object (&source->priv->icon);
   g_clear_pointer (&source->priv->tags, g_ptr_array_unref);
+  g_clear_pointer (&source->priv->resolves_waiting, g_queue_free);
+  /* Pending edits keep the source alive, so there are none left here */
+  g_clear_pointer (&source->priv->write_behind_entries, g_hash_table_unref);
+  g_clear_pointer (&source->priv->write_behind_queue, g_queue_free);
+  g_mutex_clear (&source->priv->lock);
+  key_list_set_clear (&source->priv->supported_keys);
+  key_list_set_clear (&source->priv->slow_keys);
+  key_list_set_clear (&source->priv->writable_keys);
+  g_strfreev (source->priv->uri_prefixes);
   g_free (source->priv->id);
   g_free (source->priv->name);
   g_free (source->priv->desc);
@@ -601,12 +1132,58 @@ grl_source_set_property (GObject *object,
   case PROP_AUTO_SPLIT_THRESHOLD:
     source->priv->auto_split_threshold = g_value_get_uint (value);
     break;
+  case PROP_AUTO_SPLIT_PREFETCH:
+    source->priv->auto_split_prefetch = g_value_get_uint (value);
+    break;
+  case PROP_AUTO_SPLIT_MIN_THRESHOLD:
+    grl_source_set_auto_split_limits (source,
+                                      g_value_get_uint (value),
+                                      source->priv->auto_split_max_threshold);
+    break;
+  case PROP_AUTO_SPLIT_MAX_THRESHOLD:
+    grl_source_set_auto_split_limits (source,
+                                      source->priv->auto_split_min_threshold,
+                                      g_value_get_uint (value));
+    break;
   case PROP_SUPPORTED_MEDIA:
     source->priv->supported_media = g_value_get_flags (value);
     break;
   case PROP_SOURCE_TAGS:
     grl_source_set_tags (source, g_value_get_boxed (value));
     break;
+  case PROP_URI_PREFIXES:
+    g_strfreev (source->priv->uri_prefixes);
+    source->priv->uri_prefixes = g_value_dup_boxed (value);
+    /* An empty list declares nothing */
+    if (source->priv->uri_prefixes && !source->priv->uri_prefixes[0]) {
+      g_clear_pointer (&source->priv->uri_prefixes, g_strfreev);
+    }
+    break;
+  case PROP_PLAN_CACHEABLE:
+    source->priv->plan_cacheable = g_value_get_boolean (value);
+    break;
+  case PROP_RESOLVE_CONCURRENCY:
+    grl_source_set_resolve_concurrency (source, g_value_get_uint (value));
+    break;
+  case PROP_REMOVE_CONCURRENCY:
+    grl_source_set_remove_concurrency (source, g_value_get_uint (value));
+    break;
+  case PROP_THREAD_SAFE_OPERATIONS:
+    grl_source_set_thread_safe_operations (source, g_value_get_flags (value));
+    break;
+  case PROP_RESOLVE_CACHE_TTL:
+    grl_source_set_resolve_cache_ttl (source, g_value_get_uint (value));
+    break;
+  case PROP_WRITE_BEHIND_MAX_PENDING:
+    grl_source_set_write_behind (source,
+                                 g_value_get_uint (value),
+                                 source->priv->write_behind_delay);
+    break;
+  case PROP_WRITE_BEHIND_DELAY:
+    grl_source_set_write_behind (source,
+                                 source->priv->write_behind_max_pending,
+                                 g_value_get_uint (value));
+    break;
   default:
     G_OBJECT_WARN_INVALID_PROPERTY_ID (source, prop_id, pspec);
     break;
@@ -645,12 +1222,45 @@ grl_source_get_property (GObject *object,
   case PROP_AUTO_SPLIT_THRESHOLD:
     g_value_set_uint (value, source->priv->auto_split_threshold);
     break;
+  case PROP_AUTO_SPLIT_PREFETCH:
+    g_value_set_uint (value, source->priv->auto_split_prefetch);
+    break;
+  case PROP_AUTO_SPLIT_MIN_THRESHOLD:
+    g_value_set_uint (value, source->priv->auto_split_min_threshold);
+    break;
+  case PROP_AUTO_SPLIT_MAX_THRESHOLD:
+    g_value_set_uint (value, source->priv->auto_split_max_threshold);
+    break;
   case PROP_SUPPORTED_MEDIA:
     g_value_set_flags (value, source->priv->supported_media);
     break;
   case PROP_SOURCE_TAGS:
     g_value_set_boxed (value, source->priv->tags->pdata);
     break;
+  case PROP_URI_PREFIXES:
+    g_value_set_boxed (value, source->priv->uri_prefixes);
+    break;
+  case PROP_PLAN_CACHEABLE:
+    g_value_set_boolean (value, source->priv->plan_cacheable);
+    break;
+  case PROP_RESOLVE_CONCURRENCY:
+    g_value_set_uint (value, source->priv->resolve_concurrency);
+    break;
+  case PROP_REMOVE_CONCURRENCY:
+    g_value_set_uint (value, source->priv->remove_concurrency);
+    break;
+  case PROP_THREAD_SAFE_OPERATIONS:
+    g_value_set_flags (value, source->priv->thread_safe_operations);
+    break;
+  case PROP_RESOLVE_CACHE_TTL:
+    g_value_set_uint (value, grl_source_get_resolve_cache_ttl (source));
+    break;
+  case PROP_WRITE_BEHIND_MAX_PENDING:
+    g_value_set_uint (value, source->priv->write_behind_max_pending);
+    break;
+  case PROP_WRITE_BEHIND_DELAY:
+    g_value_set_uint (value, source->priv->write_behind_delay);
+    break;
   default:
     G_OBJECT_WARN_INVALID_PROPERTY_ID (source, prop_id, pspec);
     break;
@@ -662,47 +1272,106 @@ grl_source_get_property (GObject *object,
 static void
 operation_state_free (struct OperationState *op_state)
 {
+  struct OperationState *parent_state;
+
+  /* Finished operations do not need to be cancelled any more */
+  if (op_state->linked_to) {
+    parent_state = grl_operation_get_private_data (op_state->linked_to);
+    if (parent_state && parent_state->linked) {
+      g_hash_table_remove (parent_state->linked,
+                           GUINT_TO_POINTER (op_state->operation_id));
+    }
+  }
+
   g_object_unref (op_state->source);
+  g_clear_pointer (&op_state->linked, g_hash_table_unref);
   g_free (op_state);
 }
 
+static void
+key_list_set_clear (KeyListSet *cached)
+{
+  g_clear_pointer (&cached->set, grl_key_set_unref);
+  g_clear_pointer (&cached->keys, g_free);
+  cached->n_keys = 0;
+}
+
+/* Compares the keys, as sources may change their lists in place */
+static gboolean
+key_list_set_matches (const KeyListSet *cached,
+                      const GList *list)
+{
+  guint i = 0;
+
+  if (!cached->set) {
+    return FALSE;
+  }
+
+  for (; list; list = g_list_next (list), i++) {
+    if (i == cached->n_keys ||
+        cached->keys[i] != GRLPOINTER_TO_KEYID (list->data)) {
+      return FALSE;
+    }
+  }
+
+  return i == cached->n_keys;
+}
+
 /*
- * This method will _intersect two key lists_:
+ * Returns a reference to @list as a set, reusing the one in @cached if it was
+ * built from the same keys. Sources usually return always the same key lists,
+ * so they are converted only once.
  *
- * @keys_to_filter: user provided set we want to filter leaving only
- * the keys that intersects with the @source_keys set.
- *
- * @source_keys: the %GrlSource<!-- -->'s key set if
- * @return_filtered is %TRUE a copy of the filtered set *complement*
- * will be returned (a list of the filtered out keys).
+ * The set is shared by all the threads, so it must not be modified.
  */
-static GList *
-filter_key_list (GrlSource *source,
-                 GList **keys_to_filter,
-                 gboolean return_filtered,
-                 GList *source_keys)
-{
-  GList *iter_keys, *found;
-  GList *in_source = NULL;
-  GList *out_source = NULL;
-
-  for (iter_keys = *keys_to_filter;
-       iter_keys;
-       iter_keys = g_list_next (iter_keys)) {
-    found = g_list_find (source_keys, iter_keys->data);
-    if (found) {
-      in_source = g_list_prepend (in_source, iter_keys->data);
-    } else {
-      if (return_filtered) {
-        out_source = g_list_prepend (out_source, iter_keys->data);
-      }
+static GrlKeySet *
+key_list_as_set (GrlSource *source,
+                 KeyListSet *cached,
+                 const GList *list)
+{
+  GrlKeySet *set;
+  guint i;
+
+  g_mutex_lock (&source->priv->lock);
+
+  if (!key_list_set_matches (cached, list)) {
+    key_list_set_clear (cached);
+    cached->set = grl_key_set_new_from_list (list);
+    cached->n_keys = g_list_length ((GList *) list);
+    cached->keys = g_new (GrlKeyID, cached->n_keys);
+    for (i = 0; list; list = g_list_next (list), i++) {
+      cached->keys[i] = GRLPOINTER_TO_KEYID (list->data);
     }
   }
+  set = grl_key_set_ref (cached->set);
 
-  g_list_free (*keys_to_filter);
-  *keys_to_filter = g_list_reverse (in_source);
+  g_mutex_unlock (&source->priv->lock);
 
-  return g_list_reverse (out_source);
+  return set;
+}
+
+static GrlKeySet *
+supported_key_set (GrlSource *source)
+{
+  return key_list_as_set (source,
+                          &source->priv->supported_keys,
+                          grl_source_supported_keys (source));
+}
+
+static GrlKeySet *
+slow_key_set (GrlSource *source)
+{
+  return key_list_as_set (source,
+                          &source->priv->slow_keys,
+                          grl_source_slow_keys (source));
+}
+
+static GrlKeySet *
+writable_key_set (GrlSource *source)
+{
+  return key_list_as_set (source,
+                          &source->priv->writable_keys,
+                          grl_source_writable_keys (source));
 }
 
 static GList *
@@ -733,32 +1402,21 @@ filter_known_keys (GrlMedia *media,
 static GList *
 filter_unresolvable_keys (GList *sourcelist, GList **keys)
 {
-  GList *each_key;
-  GList *delete_key;
   GList *each_source;
-  gboolean supported;
+  GrlKeySet *resolvable;
+  GrlKeySet *supported;
+
+  resolvable = grl_key_set_new ();
+  for (each_source = sourcelist;
+       each_source;
+       each_source = g_list_next (each_source)) {
+    supported = supported_key_set (each_source->data);
+    grl_key_set_union (resolvable, supported);
+    grl_key_set_unref (supported);
+  }
 
-  each_key = *keys;
-  while (each_key) {
-    supported = FALSE;
-
-    for (each_source = sourcelist;
-         each_source;
-         each_source = g_list_next (each_source)) {
-      if (g_list_find ((GList *) grl_source_supported_keys (each_source->data),
-                       each_key->data)) {
-        supported = TRUE;
-        break;
-      }
-    }
-    if (!supported) {
-      delete_key = each_key;
-      each_key = g_list_next (each_key);
-      *keys = g_list_delete_link (*keys, delete_key);
-    } else {
-      each_key = g_list_next (each_key);
-    }
-  }
+  grl_key_set_filter_list (resolvable, keys, FALSE);
+  grl_key_set_unref (resolvable);
 
   return *keys;
 }
@@ -783,13 +1441,16 @@ filter_supported (GrlSource *source,
                   GList **keys,
                   gboolean return_filtered)
 {
-  const GList *supported_keys;
+  GrlKeySet *supported;
+  GList *filtered;
 
   g_return_val_if_fail (GRL_IS_SOURCE (source), NULL);
 
-  supported_keys = grl_source_supported_keys (source);
+  supported = supported_key_set (source);
+  filtered = grl_key_set_filter_list (supported, keys, return_filtered);
+  grl_key_set_unref (supported);
 
-  return filter_key_list (source, keys, return_filtered, (GList *) supported_keys);
+  return filtered;
 }
 
 /*
@@ -813,15 +1474,15 @@ filter_slow (GrlSource *source,
              GList **keys,
              gboolean return_filtered)
 {
-  const GList *slow_keys;
   GList *fastest_keys, *tmp;
+  GrlKeySet *slow;
 
   g_return_val_if_fail (GRL_IS_SOURCE (source), NULL);
 
-  slow_keys = grl_source_slow_keys (source);
-
   /* Note that we want to do the opposite */
-  fastest_keys = filter_key_list (source, keys, TRUE, (GList *) slow_keys);
+  slow = slow_key_set (source);
+  fastest_keys = grl_key_set_filter_list (slow, keys, TRUE);
+  grl_key_set_unref (slow);
   tmp = *keys;
   *keys = fastest_keys;
 
@@ -857,14 +1518,17 @@ filter_writable (GrlSource *source,
                             GList **keys,
                             gboolean return_filtered)
 {
-  const GList *writable_keys;
+  GrlKeySet *writable;
+  GList *filtered;
 
   g_return_val_if_fail (GRL_IS_SOURCE (source), NULL);
   g_return_val_if_fail (keys != NULL, NULL);
 
-  writable_keys = grl_source_writable_keys (source);
+  writable = writable_key_set (source);
+  filtered = grl_key_set_filter_list (writable, keys, return_filtered);
+  grl_key_set_unref (writable);
 
-  return filter_key_list (source, keys, return_filtered, (GList *) writable_keys);
+  return filtered;
 }
 
 /*
@@ -896,6 +1560,7 @@ operation_set_started (guint operation_id)
   if (op_state) {
     op_state->started = TRUE;
   }
+  grl_operation_set_state (operation_id, GRL_OPERATION_STATE_RUNNING);
 }
 
 /*
@@ -923,11 +1588,51 @@ operation_is_started (guint operation_id)
 static void
 operation_set_finished (guint operation_id)
 {
+  struct OperationState *op_state;
+
   GRL_DEBUG ("%s (%d)", __FUNCTION__, operation_id);
 
+  op_state = grl_operation_get_private_data (operation_id);
+
+  if (op_state && op_state->background > 0) {
+    op_state->finish_deferred = TRUE;
+    return;
+  }
+
   grl_operation_remove (operation_id);
 }
 
+/*
+ * operation_background_start:
+ *
+ * Keeps the operation registered, and so it can still be cancelled, until the
+ * work started now ends with operation_background_end(), even if it is
+ * finished in the meantime.
+ */
+static void
+operation_background_start (guint operation_id)
+{
+  struct OperationState *op_state;
+
+  op_state = grl_operation_get_private_data (operation_id);
+
+  if (op_state) {
+    op_state->background++;
+  }
+}
+
+static void
+operation_background_end (guint operation_id)
+{
+  struct OperationState *op_state;
+
+  op_state = grl_operation_get_private_data (operation_id);
+
+  if (op_state && --op_state->background == 0 && op_state->finish_deferred) {
+    grl_operation_remove (operation_id);
+  }
+}
+
 /*
  * operation_is_finished:
  *
@@ -962,6 +1667,7 @@ operation_set_completed (guint operation_id)
   if (op_state) {
     op_state->completed = TRUE;
   }
+  grl_operation_set_state (operation_id, GRL_OPERATION_STATE_COMPLETED);
 }
 
 /*
@@ -981,6 +1687,76 @@ operation_is_completed (guint operation_id)
   return !op_state || op_state->completed;
 }
 
+/*
+ * operation_is_deadline_exceeded:
+ *
+ * Checks if the deadline of the operation passed before it finished.
+ */
+static gboolean
+operation_is_deadline_exceeded (guint operation_id)
+{
+  struct OperationState *op_state;
+
+  op_state = grl_operation_get_private_data (operation_id);
+
+  return op_state && op_state->deadline_exceeded;
+}
+
+/*
+ * operation_deadline_start:
+ *
+ * Runs @func once the deadline set in @options passes, if any.
+ */
+static guint
+operation_deadline_start (GrlOperationOptions *options,
+                          GSourceFunc func,
+                          gpointer user_data)
+{
+  guint deadline;
+  guint id;
+
+  deadline = grl_operation_options_get_deadline (options);
+  if (deadline == 0) {
+    return 0;
+  }
+
+  id = grl_operation_timeout_add (deadline, func, user_data,
+                                  "[grilo] operation_deadline");
+
+  return id;
+}
+
+/*
+ * operation_priority:
+ *
+ * Shifts @priority, the GLib idle priority of some work of an operation done
+ * with @options, according to the priority class of the operation. The result
+ * is never above G_PRIORITY_HIGH_IDLE, so no class overtakes the I/O of the
+ * sources nor the redrawing of the application.
+ */
+static gint
+operation_priority (GrlOperationOptions *options,
+                    gint priority)
+{
+  priority += grl_operation_options_get_priority (options) * OPERATION_PRIORITY_STEP;
+
+  return MAX (priority, G_PRIORITY_HIGH_IDLE);
+}
+
+/*
+ * operation_relay_priority:
+ *
+ * Returns the priority of the idle handlers running and relaying the
+ * operation done with @options.
+ */
+static gint
+operation_relay_priority (GrlOperationOptions *options)
+{
+  return operation_priority (options,
+                             grl_operation_options_get_resolution_flags (options) & GRL_RESOLVE_IDLE_RELAY?
+                             G_PRIORITY_DEFAULT_IDLE: G_PRIORITY_HIGH_IDLE);
+}
+
 /*
  * operation_set_cancelled:
  *
@@ -999,6 +1775,7 @@ operation_set_cancelled (guint operation_id)
   if (op_state) {
     op_state->cancelled = TRUE;
   }
+  grl_operation_set_state (operation_id, GRL_OPERATION_STATE_CANCELLED);
 }
 
 /*
@@ -1024,7 +1801,9 @@ operation_is_cancelled (guint operation_id)
  * and not cancelled)
  */
 static void
-operation_set_ongoing (GrlSource *source, guint operation_id)
+operation_set_ongoing (GrlSource *source,
+                       guint operation_id,
+                       GrlSupportedOps operation)
 {
   struct OperationState *op_state;
 
@@ -1038,6 +1817,31 @@ operation_set_ongoing (GrlSource *source, guint operation_id)
                                   op_state,
                                   (GrlOperationCancelCb) source_cancel_cb,
                                   (GDestroyNotify) operation_state_free);
+  grl_operation_set_info (operation_id, operation, source);
+}
+
+/*
+ * operation_link:
+ *
+ * Makes @linked_id to be cancelled along with @operation_id.
+ */
+static void
+operation_link (guint operation_id,
+                guint linked_id)
+{
+  struct OperationState *op_state, *linked_state;
+
+  op_state = grl_operation_get_private_data (operation_id);
+  linked_state = grl_operation_get_private_data (linked_id);
+  if (!op_state || !linked_state) {
+    return;
+  }
+
+  if (!op_state->linked) {
+    op_state->linked = g_hash_table_new (g_direct_hash, g_direct_equal);
+  }
+  g_hash_table_add (op_state->linked, GUINT_TO_POINTER (linked_id));
+  linked_state->linked_to = operation_id;
 }
 
 /*
@@ -1059,8 +1863,6 @@ operation_is_ongoing (guint operation_id)
 static void
 source_cancel_cb (struct OperationState *op_state)
 {
-  GrlSource *source = op_state->source;
-
   if (!operation_is_ongoing (op_state->operation_id)) {
     GRL_DEBUG ("Tried to cancel invalid or already cancelled operation. "
                "Skipping...");
@@ -1077,22 +1879,57 @@ source_cancel_cb (struct OperationState *op_state)
      signaling so) */
   operation_set_cancelled (op_state->operation_id);
 
+  /* Requests sharing a resolve are cancelled only when all of them are */
+  if (op_state->flight) {
+    resolve_flight_leave (op_state->flight, op_state->operation_id);
+    op_state->flight = NULL;
+    return;
+  }
+
+  operation_stop (op_state);
+}
+
+/*
+ * operation_stop:
+ *
+ * Asks the source to stop working on the operation, and cancels the
+ * operations issued on behalf of it.
+ */
+static void
+operation_stop (struct OperationState *op_state)
+{
+  GrlSource *source = op_state->source;
+
   /* If the source provides an implementation for operation cancellation,
      let's use that to avoid further unnecessary processing in the plugin */
   if (GRL_SOURCE_GET_CLASS (source)->cancel) {
     GRL_SOURCE_GET_CLASS (source)->cancel (source,
                                            op_state->operation_id);
   }
+
+  /* Cancel also the operations issued on behalf of this one that are still
+     running */
+  if (op_state->linked) {
+    GList *linked, *each_linked;
+    guint linked_id;
+
+    /* Cancelled operations can finish right away, leaving the set */
+    linked = g_hash_table_get_keys (op_state->linked);
+    for (each_linked = linked; each_linked; each_linked = g_list_next (each_linked)) {
+      linked_id = GPOINTER_TO_UINT (each_linked->data);
+      if (operation_is_ongoing (linked_id)) {
+        grl_operation_cancel (linked_id);
+      }
+    }
+    g_list_free (linked);
+  }
 }
 
 static void
 cancel_resolve (gpointer source, gpointer operation_id, gpointer user_data)
 {
-  struct OperationState *op_state;
-
-  op_state = grl_operation_get_private_data (GPOINTER_TO_UINT (operation_id));
-  if (op_state) {
-    source_cancel_cb (op_state);
+  if (GPOINTER_TO_UINT (operation_id) > 0) {
+    grl_operation_cancel (GPOINTER_TO_UINT (operation_id));
   }
 }
 
@@ -1182,6 +2019,9 @@ resolve_relay_free (struct ResolveRelayCb *rrc)
     g_hash_table_unref (rrc->map);
   }
   g_clear_pointer (&rrc->resolve_specs, g_hash_table_unref);
+  if (rrc->deadline_id) {
+    grl_operation_source_remove (rrc->deadline_id);
+  }
 
   g_slice_free (struct ResolveRelayCb, rrc);
 }
@@ -1192,10 +2032,13 @@ browse_relay_free (struct BrowseRelayCb *brc)
   g_object_unref (brc->source);
   g_object_unref (brc->options);
   g_list_free (brc->keys);
-  if (brc->auto_split) {
-    g_slice_free (struct AutoSplitCtl, brc->auto_split);
-  }
+  g_clear_pointer (&brc->auto_split, auto_split_free);
   g_clear_pointer (&brc->queue, g_queue_free);
+  g_clear_pointer (&brc->queue_pending, g_hash_table_unref);
+  g_clear_pointer (&brc->decorate_pending, g_ptr_array_unref);
+  if (brc->deadline_id) {
+    grl_operation_source_remove (brc->deadline_id);
+  }
 
   g_slice_free (struct BrowseRelayCb, brc);
 }
@@ -1261,16 +2104,66 @@ source_supports (GrlSource *source,
                  const GList *keys)
 {
   const GList *iter;
-  GList *supported;
+  GrlKeySet *supported;
+  gboolean supports = TRUE;
 
-  supported = (GList *) grl_source_supported_keys (source);
+  supported = supported_key_set (source);
 
-  for (iter = keys; iter; iter = g_list_next (iter)) {
-    if (!g_list_find (supported, iter->data)) {
-      return FALSE;
-    }
+  for (iter = keys; supports && iter; iter = g_list_next (iter)) {
+    supports = grl_key_set_contains (supported,
+                                     GRLPOINTER_TO_KEYID (iter->data));
   }
-  return TRUE;
+  grl_key_set_unref (supported);
+
+  return supports;
+}
+
+/* Answer of may_resolve() a resolution plan relies on, for a source whose
+   answers might depend on more than what identifies the plan */
+typedef struct {
+  GrlSource *source;
+  GrlKeyID key;
+  gboolean may_resolve;
+  GList *missing_keys;
+} PlanCheck;
+
+static gboolean source_is_plan_cacheable (GrlSource *source);
+
+static void
+plan_check_free (PlanCheck *check)
+{
+  g_object_unref (check->source);
+  g_list_free (check->missing_keys);
+  g_slice_free (PlanCheck, check);
+}
+
+/*
+ * Same as grl_source_may_resolve(), but if @checks is not %NULL, the answer
+ * of sources that are not plan-cacheable is recorded in it, so a plan built
+ * from it can be checked to be still right for another media.
+ */
+static gboolean
+plan_may_resolve (GrlSource *source,
+                  GrlMedia *media,
+                  GrlKeyID key,
+                  GList **missing_keys,
+                  GList **checks)
+{
+  PlanCheck *check;
+  gboolean may_resolve;
+
+  may_resolve = grl_source_may_resolve (source, media, key, missing_keys);
+
+  if (checks && !source_is_plan_cacheable (source)) {
+    check = g_slice_new (PlanCheck);
+    check->source = g_object_ref (source);
+    check->key = key;
+    check->may_resolve = may_resolve;
+    check->missing_keys = missing_keys? g_list_copy (*missing_keys): NULL;
+    *checks = g_list_prepend (*checks, check);
+  }
+
+  return may_resolve;
 }
 
 /*
@@ -1299,7 +2192,8 @@ get_additional_source_for_key (GrlSource *source,
                                GrlMedia *media,
                                GrlKeyID key,
                                GList **additional_keys,
-                               gboolean main_source_is_only_resolver)
+                               gboolean main_source_is_only_resolver,
+                               GList **checks)
 {
   GList *iter;
 
@@ -1314,7 +2208,7 @@ get_additional_source_for_key (GrlSource *source,
       continue;
     }
 
-    if (grl_source_may_resolve (_source, media, key, &_additional_keys)) {
+    if (plan_may_resolve (_source, media, key, &_additional_keys, checks)) {
       return _source;
     }
 
@@ -1381,13 +2275,16 @@ list_union (GList *original_set, GList *additional_set, GDestroyNotify free_func
  * returned list.
  *
  * Ignore elements of @keys that are already in @media.
+ *
+ * If @checks is not %NULL, the answers the result depends on are added to it.
  */
 static GList *
 get_additional_sources (GrlSource *source,
                         GrlMedia *media,
                         GList *keys,
                         GList **additional_keys,
-                        gboolean main_source_is_only_resolver)
+                        gboolean main_source_is_only_resolver,
+                        GList **checks)
 {
   GList *missing_keys, *iter, *result = NULL, *sources;
   GrlRegistry *registry;
@@ -1408,7 +2305,8 @@ get_additional_sources (GrlSource *source,
 
     _source = get_additional_source_for_key (source, sources, media, key,
                                              additional_keys?&needed_keys:NULL,
-                                             main_source_is_only_resolver);
+                                             main_source_is_only_resolver,
+                                             checks);
     if (_source) {
       result = g_list_append (result, _source);
 
@@ -1463,7 +2361,7 @@ expand_operation_keys (GrlSource *source,
 
   sources =
     get_additional_sources (source, media, unsupported_keys,
-                            &additional_keys, TRUE);
+                            &additional_keys, TRUE, NULL);
   g_list_free (sources);
 
   /* Merge back the supported and unsupported list, and add also the additional keys */
@@ -1479,8 +2377,14 @@ expand_operation_keys (GrlSource *source,
 static gboolean
 is_slow_key (GrlSource *source, GrlKeyID key)
 {
-  return (g_list_find ((GList *) grl_source_slow_keys (source),
-                       GRLKEYID_TO_POINTER (key)) != NULL);
+  GrlKeySet *slow;
+  gboolean is_slow;
+
+  slow = slow_key_set (source);
+  is_slow = grl_key_set_contains (slow, key);
+  grl_key_set_unref (slow);
+
+  return is_slow;
 }
 
 /*
@@ -1533,7 +2437,7 @@ map_keys_new (void)
  * dependencies is added
  */
 static void
-map_keys_to_sources (GHashTable *map, GList *keys, GList *sources, GrlMedia *media, gboolean filter_slow_keys)
+map_keys_to_sources (GHashTable *map, GList *keys, GList *sources, GrlMedia *media, gboolean filter_slow_keys, GList **checks)
 {
   GList *each_source;
   GList *resolvable_sources;
@@ -1557,10 +2461,11 @@ map_keys_to_sources (GHashTable *map, GList *keys, GList *sources, GrlMedia *med
         continue;
       }
       required_keys = NULL;
-      if (grl_source_may_resolve (each_source->data,
-                                  media,
-                                  GRLPOINTER_TO_KEYID (each_key->data),
-                                  &required_keys)) {
+      if (plan_may_resolve (each_source->data,
+                            media,
+                            GRLPOINTER_TO_KEYID (each_key->data),
+                            &required_keys,
+                            checks)) {
         resolvable_sources = g_list_prepend (resolvable_sources, map_node_new (each_source->data, NULL));
       } else if (required_keys) {
         resolvable_sources = g_list_prepend (resolvable_sources, map_node_new (each_source->data, required_keys));
@@ -1573,7 +2478,7 @@ map_keys_to_sources (GHashTable *map, GList *keys, GList *sources, GrlMedia *med
   }
 
   if (keys_to_map_later) {
-    map_keys_to_sources (map, keys_to_map_later, sources, media, filter_slow_keys);
+    map_keys_to_sources (map, keys_to_map_later, sources, media, filter_slow_keys, checks);
     g_list_free (keys_to_map_later);
   }
 }
@@ -1779,1626 +2684,6570 @@ map_update_unknown_key (GHashTable *map, GrlKeyID key, GrlSource *source)
   }
 }
 
-static void
-send_decorated_media (GrlMedia *media,
-                      gpointer user_data,
-                      const GError *error)
-{
-  struct ResolveRelayCb *mrc = (struct ResolveRelayCb *) user_data;
+/* ================ Resolution plans cache ================ */
 
-  mrc->user_callback (mrc->spec.res->source, mrc->spec.res->operation_id,
-                      media, mrc->user_data, error);
-  resolve_relay_free (mrc);
+/* Planning which sources must be asked for which keys requires querying every
+   source about every key. As the elements sent by a browse, search or query
+   are usually alike, the resulting plans are kept and reused for elements
+   with the same type, source, URI scheme, known keys and requested keys.
+
+   That is only right for the sources that do not look at anything else, the
+   "plan-cacheable" ones. The answers of the rest are kept along with the
+   plan, and asked again for each element; the plan is reused only if they
+   are the same. A few plans with different answers are kept for each kind
+   of element. Plans also depend on the set of registered sources, so the
+   cache is dropped whenever it changes. */
+
+#define PLAN_CACHE_MAX_SIZE 64
+#define PLAN_CACHE_MAX_VARIANTS 4
+
+typedef struct {
+  GrlSource *source;
+  GList *keys;
+} PlanSpec;
+
+typedef struct {
+  /* Resolve: (key, [sources]) map as left after building the specs, keys that
+     can be resolved, and specs to run */
+  GHashTable *map;
+  GList *keys;
+  GList *specs;
+  /* Decoration: sources to ask */
+  GList *sources;
+  /* Answers of the sources that are not plan-cacheable */
+  GList *checks;
+  gint ref_count;
+} ResolutionPlan;
+
+/* Shared by all the threads running operations; it maps plan keys to lists
+   of plans, most recent first. Plans are reference counted so they outlive
+   the cache while in use */
+G_LOCK_DEFINE_STATIC (plan_cache);
+static GHashTable *plan_cache = NULL;
+static guint plan_cache_generation = 0;
+
+static gint
+compare_keys (gconstpointer a,
+              gconstpointer b)
+{
+  return GRLPOINTER_TO_KEYID (a) - GRLPOINTER_TO_KEYID (b);
 }
 
-static void
-media_decorate_cb (GrlSource *source,
-                   guint operation_id,
-                   GrlMedia *media,
-                   gpointer user_data,
-                   const GError *error)
+static gboolean
+source_is_plan_cacheable (GrlSource *source)
 {
-  struct MediaDecorateData *mdd = (struct MediaDecorateData *) user_data;
-  GError *_error = NULL;
-  GRL_DEBUG (__FUNCTION__);
+  return source->priv->plan_cacheable ||
+    !GRL_SOURCE_GET_CLASS (source)->may_resolve;
+}
 
-  if (operation_id > 0) {
-    g_hash_table_remove (mdd->pending_callbacks, source);
+/*
+ * Builds the key identifying the plan to obtain @keys for @media. The
+ * @prefix distinguishes the different kinds of plans.
+ */
+static gchar *
+plan_key_new (const gchar *prefix,
+              GrlSource *source,
+              GrlMedia *media,
+              GList *keys,
+              GrlResolutionFlags flags)
+{
+  GString *plan_key;
+  GList *known_keys, *k;
+  const gchar *media_source;
+  const gchar *url;
+  const gchar *scheme_end = NULL;
+
+  plan_key = g_string_new (prefix);
+  media_source = grl_media_get_source (media);
+  g_string_append_printf (plan_key, ":%s:%u:%d:%s:",
+                          grl_source_get_id (source),
+                          flags & (GRL_RESOLVE_FULL | GRL_RESOLVE_FAST_ONLY),
+                          grl_media_get_media_type (media),
+                          media_source? media_source: "");
+
+  /* Sources often check the kind of URI they can work with */
+  url = grl_media_get_url (media);
+  if (url) {
+    scheme_end = strchr (url, ':');
+  }
+  if (scheme_end) {
+    g_string_append_len (plan_key, url, scheme_end - url);
   }
 
-  /* Check if pending resolutions must be cancelled */
-  if (!mdd->cancelled &&
-      operation_is_cancelled (mdd->operation_id)) {
-    mdd->cancelled = TRUE;
-    g_hash_table_foreach (mdd->pending_callbacks, cancel_resolve, NULL);
+  g_string_append_c (plan_key, ':');
+  for (k = keys; k; k = g_list_next (k)) {
+    g_string_append_printf (plan_key, "%u,", GRLPOINTER_TO_KEYID (k->data));
   }
 
-  /* If all operations are complete, send the element */
-  if (g_hash_table_size (mdd->pending_callbacks) == 0) {
-    if (mdd->cancelled) {
-      _error = g_error_new (GRL_CORE_ERROR,
-                            GRL_CORE_ERROR_OPERATION_CANCELLED,
-                            _("Operation was cancelled"));
-    }
-    mdd->callback (media, mdd->user_data, _error);
-    g_clear_error (&_error);
-    g_object_unref (mdd->source);
-    g_hash_table_unref (mdd->pending_callbacks);
-    g_slice_free (struct MediaDecorateData, mdd);
+  g_string_append_c (plan_key, ':');
+  known_keys = g_list_sort (grl_data_get_keys (GRL_DATA (media)), compare_keys);
+  for (k = known_keys; k; k = g_list_next (k)) {
+    g_string_append_printf (plan_key, "%u,", GRLPOINTER_TO_KEYID (k->data));
   }
+  g_list_free (known_keys);
+
+  return g_string_free (plan_key, FALSE);
 }
 
-static void
-media_decorate (GrlSource *main_source,
-                guint main_operation_id,
-                GrlMedia *media,
-                GList *keys,
-                GrlOperationOptions *options,
-                MediaDecorateCb callback,
-                gpointer user_data)
+static GHashTable *
+map_keys_copy (GHashTable *map)
 {
-  struct MediaDecorateData *mdd;
-  GList *s, *sources;
-  guint operation_id;
-  GrlOperationOptions *decorate_options;
-  GrlOperationOptions *supported_options;
-  GrlResolutionFlags flags;
-
-  flags = grl_operation_options_get_resolution_flags (options);
-  if (flags & GRL_RESOLVE_FULL) {
-    decorate_options = grl_operation_options_copy (options);
-    grl_operation_options_set_resolution_flags (decorate_options,
-                                                flags & ~GRL_RESOLVE_FULL);
-  } else {
-    decorate_options = g_object_ref (options);
+  GHashTable *copy;
+  GHashTableIter iter;
+  gpointer key, value;
+  GList *nodes, *each_node;
+  MapNode *node, *node_copy;
+
+  copy = map_keys_new ();
+  g_hash_table_iter_init (&iter, map);
+  while (g_hash_table_iter_next (&iter, &key, &value)) {
+    nodes = NULL;
+    for (each_node = value; each_node; each_node = g_list_next (each_node)) {
+      node = (MapNode *) each_node->data;
+      node_copy = map_node_new (node->source, node->required_keys);
+      node_copy->being_queried = node->being_queried;
+      nodes = g_list_prepend (nodes, node_copy);
+    }
+    g_hash_table_insert (copy, key, g_list_reverse (nodes));
   }
 
-  sources = get_additional_sources (main_source, media,
-                                    keys, NULL, FALSE);
+  return copy;
+}
 
-  mdd = g_slice_new (struct MediaDecorateData);
-  mdd->source = g_object_ref (main_source);
-  mdd->operation_id = main_operation_id;
-  mdd->callback = callback;
-  mdd->user_data = user_data;
-  mdd->pending_callbacks = g_hash_table_new (g_direct_hash, g_direct_equal);
-  mdd->cancelled = FALSE;
+static void
+plan_spec_free (PlanSpec *plan_spec)
+{
+  g_object_unref (plan_spec->source);
+  g_list_free (plan_spec->keys);
+  g_slice_free (PlanSpec, plan_spec);
+}
 
-  for (s = sources; s; s = g_list_next (s)) {
-    if (grl_source_supported_operations (s->data) & GRL_OP_RESOLVE) {
-      grl_operation_options_obey_caps (decorate_options,
-                                       grl_source_get_caps (s->data, GRL_OP_RESOLVE),
-                                       &supported_options,
-                                       NULL);
-      operation_id = grl_source_resolve (s->data, media, keys, supported_options,
-                                         media_decorate_cb, mdd);
-      g_object_unref (supported_options);
-      if (operation_id > 0) {
-        g_hash_table_insert (mdd->pending_callbacks,
-                             s->data,
-                             GUINT_TO_POINTER (operation_id));
-      }
-    }
-  }
+static ResolutionPlan *
+resolution_plan_new (void)
+{
+  ResolutionPlan *plan = g_slice_new0 (ResolutionPlan);
 
-  /* Check if nobody can solve the keys */
-  if (g_hash_table_size (mdd->pending_callbacks) == 0) {
-    media_decorate_cb (NULL, 0, media, mdd, NULL);
-  }
+  plan->ref_count = 1;
 
-  g_object_unref (decorate_options);
-  g_list_free (sources);
+  return plan;
 }
 
-static void
-media_from_uri_result_relay_cb (GrlSource *source,
-                                guint operation_id,
-                                GrlMedia *media,
-                                gpointer user_data,
-                                const GError *error)
+static ResolutionPlan *
+resolution_plan_ref (ResolutionPlan *plan)
 {
-  struct ResolveRelayCb *rrc = (struct ResolveRelayCb *) user_data;
-  GError *_error = (GError *) error;
-  GList *unknown_keys;
+  g_atomic_int_inc (&plan->ref_count);
 
-  GRL_DEBUG (__FUNCTION__);
+  return plan;
+}
 
-  /* Free specs */
-  media_from_uri_spec_free (rrc->spec.mfu);
+static void
+resolution_plan_unref (ResolutionPlan *plan)
+{
+  GHashTableIter iter;
+  gpointer value;
 
-  /* Append the source-id in case it is not set */
-  if (media && !grl_data_get_string (GRL_DATA (media), GRL_METADATA_KEY_SOURCE)) {
-    grl_data_set_string (GRL_DATA (media), GRL_METADATA_KEY_SOURCE, grl_source_get_id (source));
+  if (!g_atomic_int_dec_and_test (&plan->ref_count)) {
+    return;
   }
 
-  /* Check if cancelled */
-  if (operation_is_cancelled (rrc->operation_id)) {
-    /* if the plugin already set an error, we don't care because we're
-     * cancelled */
-    GRL_DEBUG ("operation was cancelled");
-    _error = g_error_new (GRL_CORE_ERROR,
-                          GRL_CORE_ERROR_OPERATION_CANCELLED,
-                          _("Operation was cancelled"));
-  }
-
-  if (_error) {
-    rrc->user_callback (source, rrc->operation_id, media, rrc->user_data, _error);
-    if (_error != error) {
-      g_error_free (_error);
-    }
-    operation_set_finished (rrc->operation_id);
-    resolve_relay_free (rrc);
-    return;
-  }
-
-  if (grl_operation_options_get_resolution_flags (rrc->options) & GRL_RESOLVE_FULL) {
-    /* Check if there are unsolved keys that need to be solved by other
-       sources */
-    unknown_keys = filter_known_keys (media, rrc->keys);
-    if (unknown_keys) {
-      media_decorate (source, operation_id, media, unknown_keys, rrc->options,
-                      send_decorated_media, rrc);
-      g_list_free (unknown_keys);
-      return;
+  if (plan->map) {
+    g_hash_table_iter_init (&iter, plan->map);
+    while (g_hash_table_iter_next (&iter, NULL, &value)) {
+      map_list_nodes_free ((GList *) value);
     }
+    g_hash_table_unref (plan->map);
   }
-
-  rrc->user_callback (source, rrc->operation_id, media, rrc->user_data, error);
-  operation_set_finished (rrc->operation_id);
-  resolve_relay_free (rrc);
+  g_list_free (plan->keys);
+  g_list_free_full (plan->specs, (GDestroyNotify) plan_spec_free);
+  g_list_free_full (plan->sources, g_object_unref);
+  g_list_free_full (plan->checks, (GDestroyNotify) plan_check_free);
+  g_slice_free (ResolutionPlan, plan);
 }
 
 static void
-cancel_resolve_spec (GrlSource *source, GrlSourceResolveSpec *spec)
+resolution_plan_variants_free (GList *variants)
 {
-  struct OperationState *op_state;
-
-  op_state = grl_operation_get_private_data (spec->operation_id);
-  if (op_state) {
-    source_cancel_cb (op_state);
-  }
+  g_list_free_full (variants, (GDestroyNotify) resolution_plan_unref);
 }
 
-static void
-resolve_result_relay_cb (GrlSource *source,
-                         guint operation_id,
-                         GrlMedia *media,
-                         gpointer user_data,
-                         const GError *error)
+static gboolean
+key_lists_same_set (GList *a,
+                    GList *b)
 {
-  struct ResolveRelayCb *rrc = (struct ResolveRelayCb *) user_data;
-  GList *each_key;
-  GList *delete_key;
-
-  GRL_DEBUG (__FUNCTION__);
-
-  if (!operation_is_cancelled (operation_id)) {
-    /* Check which keys are now known */
-    each_key = rrc->keys;
-    while (each_key) {
-      if (grl_data_has_key (GRL_DATA (media), GRLPOINTER_TO_KEYID (each_key->data))) {
-        map_update_known_key (rrc->map, GRLPOINTER_TO_KEYID (each_key->data), media);
-        delete_key = each_key;
-        each_key = g_list_next (each_key);
-        rrc->keys = g_list_delete_link (rrc->keys, delete_key);
-      } else {
-        map_update_unknown_key (rrc->map, GRLPOINTER_TO_KEYID (each_key->data), source);
-        each_key = g_list_next (each_key);
-      }
-    }
-
-    g_hash_table_remove (rrc->resolve_specs, source);
-  }
-
-  operation_set_finished (operation_id);
-
-  if (operation_is_cancelled (rrc->operation_id) &&
-      !rrc->cancel_invoked) {
-    rrc->cancel_invoked = TRUE;
-    g_hash_table_foreach (rrc->resolve_specs, (GHFunc) cancel_resolve_spec, NULL);
-  }
+  GList *each;
 
-  if (error && source == rrc->source && !rrc->error) {
-    /* Save error for further sending */
-    rrc->error = g_error_copy (error);
+  if (g_list_length (a) != g_list_length (b)) {
+    return FALSE;
   }
 
-  if (g_hash_table_size (rrc->resolve_specs) == 0 && !rrc->specs_to_invoke) {
-    /* All sources have replied. Let's run another round if not cancelled */
-    if (!operation_is_cancelled (rrc->operation_id)) {
-      each_key = rrc->keys;
-      while (each_key) {
-        if (map_sources_to_specs (rrc->resolve_specs, rrc->map, media,
-                                  GRLPOINTER_TO_KEYID (each_key->data),
-                                  rrc->options, rrc)) {
-          each_key = g_list_next (each_key);
-        } else {
-          delete_key = each_key;
-          each_key = g_list_next (each_key);
-          rrc->keys = g_list_delete_link (rrc->keys, delete_key);
-        }
-      }
-
-    }
-
-    rrc->specs_to_invoke = g_hash_table_get_values (rrc->resolve_specs);
-    if (rrc->specs_to_invoke) {
-      guint id;
-      id = g_idle_add_full (grl_operation_options_get_resolution_flags (rrc->options) & GRL_RESOLVE_IDLE_RELAY?
-                            G_PRIORITY_DEFAULT_IDLE: G_PRIORITY_HIGH_IDLE,
-                            resolve_idle,
-                            rrc,
-                            NULL);
-      g_source_set_name_by_id (id, "[grilo] resolve_idle");
-    } else {
-      guint id;
-      id = g_idle_add_full (grl_operation_options_get_resolution_flags (rrc->options) & GRL_RESOLVE_IDLE_RELAY?
-                            G_PRIORITY_DEFAULT_IDLE: G_PRIORITY_HIGH_IDLE,
-                            resolve_all_done,
-                            rrc,
-                            NULL);
-      g_source_set_name_by_id (id, "[grilo] resolve_all_done");
+  for (each = a; each; each = g_list_next (each)) {
+    if (!g_list_find (b, each->data)) {
+      return FALSE;
     }
   }
+
+  return TRUE;
 }
 
+/* Whether the sources that are not plan-cacheable answer the same for
+   @media as they did for the media @plan was built for */
 static gboolean
-queue_process (gpointer user_data)
+resolution_plan_holds (ResolutionPlan *plan,
+                       GrlMedia *media)
 {
-  QueueElement *qelement;
-  GError *error;
-  gint remaining;
-  struct BrowseRelayCb *brc = (struct BrowseRelayCb *) user_data;
-
-  /* Check if operation is cancelled */
-  if (operation_is_cancelled (brc->operation_id)) {
-    /* This is how this works: if operation is cancelled, no one will add more
-       elements to queue. If one with remaining=0 is found, means that the
-       browse/search/query operation finished before operation is cancelled. So we
-       need to emit this result to user to tell him that operation is cancelled. For
-       elements that are not ready, means that a source_resolve() was run to get
-       solve more keys. So the algorithm is freeing all elements that are ready, and
-       if some of them has remaining==0, sending the cancel signal to user */
-    while ((qelement = (QueueElement *) g_queue_peek_head (brc->queue)) &&
-           qelement->is_ready) {
-      g_queue_pop_head (brc->queue);
-      if (qelement->remaining == 0) {
-        error = g_error_new (GRL_CORE_ERROR,
-                             GRL_CORE_ERROR_OPERATION_CANCELLED,
-                             _("Operation was cancelled"));
-        brc->user_callback (brc->source, brc->operation_id, NULL,
-                            0, brc->user_data, error);
-        g_error_free (error);
-      }
-      g_clear_error (&qelement->error);
-      g_free (qelement);
-    }
-    if (g_queue_is_empty (brc->queue)) {
-      operation_set_finished (brc->operation_id);
-      browse_relay_free (brc);
-      return FALSE;
-    }
-    brc->dispatcher_running = FALSE;
-    return FALSE;
+  GList *each_check;
+  GList *missing_keys;
+  PlanCheck *check;
+  gboolean holds = TRUE;
+
+  for (each_check = plan->checks;
+       each_check && holds;
+       each_check = g_list_next (each_check)) {
+    check = (PlanCheck *) each_check->data;
+    missing_keys = NULL;
+    holds = grl_source_may_resolve (check->source, media, check->key,
+                                    &missing_keys) == check->may_resolve &&
+      key_lists_same_set (missing_keys, check->missing_keys);
+    g_list_free (missing_keys);
   }
 
-  /* Send the last element */
-  qelement = (QueueElement *) g_queue_pop_head (brc->queue);
-  remaining = qelement->remaining;
-  brc->user_callback (brc->source, brc->operation_id, qelement->media,
-                      remaining, brc->user_data, qelement->error);
-  g_clear_error (&qelement->error);
-  g_free (qelement);
+  return holds;
+}
 
-  if (remaining == 0) {
-    operation_set_finished (brc->operation_id);
-    browse_relay_free (brc);
-    return FALSE;
+/* Must be called with the plan_cache lock held. @generation is the one of
+   the registered sources, obtained before taking the lock */
+static GHashTable *
+plan_cache_get (guint generation)
+{
+  if (plan_cache && plan_cache_generation == generation) {
+    return plan_cache;
   }
 
-  /* Check if should keep running */
-  qelement = (QueueElement *) g_queue_peek_head (brc->queue);
-  brc->dispatcher_running = qelement && qelement->is_ready;
+  if (!plan_cache) {
+    plan_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                        g_free,
+                                        (GDestroyNotify) resolution_plan_variants_free);
+  } else {
+    GRL_DEBUG ("Sources changed, dropping resolution plans");
+    g_hash_table_remove_all (plan_cache);
+  }
+  plan_cache_generation = generation;
 
-  return brc->dispatcher_running;
+  return plan_cache;
 }
 
-static void
-queue_start_process (struct BrowseRelayCb *brc)
+/* Returns a new reference to a plan for @media, or NULL */
+static ResolutionPlan *
+plan_cache_lookup (const gchar *plan_key,
+                   GrlMedia *media)
 {
-  QueueElement *qelement;
+  ResolutionPlan *plan = NULL;
+  GList *variants, *each_variant;
+  guint generation;
 
-  if (!brc->dispatcher_running) {
-    qelement = g_queue_peek_head (brc->queue);
-    if (qelement && qelement->is_ready) {
-      guint id = g_idle_add (queue_process,  brc);
-      g_source_set_name_by_id (id, "[grilo] queue_process");
-      brc->dispatcher_running = TRUE;
+  if (!plan_key) {
+    return NULL;
+  }
+
+  generation = grl_registry_get_sources_generation (grl_registry_get_default ());
+
+  G_LOCK (plan_cache);
+  variants = g_list_copy_deep (g_hash_table_lookup (plan_cache_get (generation),
+                                                    plan_key),
+                               (GCopyFunc) resolution_plan_ref, NULL);
+  G_UNLOCK (plan_cache);
+
+  /* Checking the plans runs code of the sources, so it is done without the
+     lock */
+  for (each_variant = variants;
+       each_variant && !plan;
+       each_variant = g_list_next (each_variant)) {
+    if (resolution_plan_holds (each_variant->data, media)) {
+      plan = resolution_plan_ref (each_variant->data);
     }
   }
-}
+  resolution_plan_variants_free (variants);
 
-static gint
-compare_queue_element (QueueElement *qelement,
-                       GrlMedia *media)
-{
-  return qelement->media != media;	//return 0 when equal
+  return plan;
 }
 
+/* Takes ownership of @plan_key and of a reference to @plan */
 static void
-media_ready_cb (GrlMedia *media,
-                gpointer user_data,
-                const GError *error)
+plan_cache_insert (gchar *plan_key,
+                   ResolutionPlan *plan)
 {
-  GList *element;
-  QueueElement *qelement;
-  struct BrowseRelayCb *brc = (struct BrowseRelayCb *) user_data;
+  GHashTable *cache;
+  GList *variants = NULL;
+  GList *oldest;
+  gpointer old_key;
+  guint generation;
 
-  /* Mark element as ready */
-  element = g_queue_find_custom (brc->queue, media,
-                                 (GCompareFunc) compare_queue_element);
-  if (!element) {
-    GRL_WARNING ("Media not found in the queue!");
+  if (!plan_key) {
+    resolution_plan_unref (plan);
     return;
   }
 
-  qelement = (QueueElement *) element->data;
-  qelement->is_ready = TRUE;
-  queue_start_process (brc);
+  generation = grl_registry_get_sources_generation (grl_registry_get_default ());
+
+  G_LOCK (plan_cache);
+  cache = plan_cache_get (generation);
+  /* Plans are cheap to rebuild; just start over when full */
+  if (g_hash_table_size (cache) >= PLAN_CACHE_MAX_SIZE) {
+    g_hash_table_remove_all (cache);
+  }
+  if (g_hash_table_steal_extended (cache, plan_key, &old_key, (gpointer *) &variants)) {
+    g_free (old_key);
+  }
+  variants = g_list_prepend (variants, plan);
+  if (g_list_length (variants) > PLAN_CACHE_MAX_VARIANTS) {
+    oldest = g_list_last (variants);
+    resolution_plan_unref (oldest->data);
+    variants = g_list_delete_link (variants, oldest);
+  }
+  g_hash_table_insert (cache, plan_key, variants);
+  G_UNLOCK (plan_cache);
 }
 
+/*
+ * Stores the plan computed by grl_source_resolve() in @rrc, which relies on
+ * the answers in @checks. Takes ownership of @checks.
+ */
 static void
-queue_add_media (struct BrowseRelayCb *brc,
-                 GrlMedia *media,
-                 guint remaining,
-                 const GError *error)
+resolution_plan_store (gchar *plan_key,
+                       struct ResolveRelayCb *rrc,
+                       GList *checks)
 {
-  QueueElement *qelement;
-  GList *unknown_keys = NULL;
+  ResolutionPlan *plan;
+  GHashTableIter iter;
+  gpointer value;
 
-  if (!brc->queue) {
-    brc->queue = g_queue_new ();
+  if (!plan_key) {
+    g_list_free_full (checks, (GDestroyNotify) plan_check_free);
+    return;
   }
 
-  /* Add element */
-  qelement = g_new (QueueElement, 1);
-  qelement->media = media;
-  qelement->remaining = remaining;
-  /* Media is ready if we do not need to ask other sources to complete it */
-  qelement->is_ready = TRUE;
-  if (grl_operation_options_get_resolution_flags (brc->options) & GRL_RESOLVE_FULL) {
-    unknown_keys = filter_known_keys (media, brc->keys);
-    if (unknown_keys) {
-      qelement->is_ready = FALSE;
-    }
-  }
-  if (error) {
-    qelement->error = g_error_copy (error);
-  } else {
-    qelement->error = NULL;
-  }
-  g_queue_push_tail (brc->queue, qelement);
+  plan = resolution_plan_new ();
+  plan->map = map_keys_copy (rrc->map);
+  plan->keys = g_list_copy (rrc->keys);
+  plan->checks = checks;
 
-  if (!qelement->is_ready) {
-    media_decorate (brc->source, brc->operation_id, media, unknown_keys,
-                    brc->options, media_ready_cb, brc);
+  g_hash_table_iter_init (&iter, rrc->resolve_specs);
+  while (g_hash_table_iter_next (&iter, NULL, &value)) {
+    GrlSourceResolveSpec *rs = (GrlSourceResolveSpec *) value;
+    PlanSpec *plan_spec = g_slice_new (PlanSpec);
+
+    plan_spec->source = g_object_ref (rs->source);
+    plan_spec->keys = g_list_copy (rs->keys);
+    plan->specs = g_list_prepend (plan->specs, plan_spec);
   }
 
-  queue_start_process (brc);
+  plan_cache_insert (plan_key, plan);
 }
 
-static struct AutoSplitCtl *
-auto_split_setup (GrlSource *source,
-                  GrlOperationOptions *options)
+/*
+ * Fills @rrc with a copy of @plan, building the specs to resolve @media
+ */
+static void
+resolution_plan_apply (ResolutionPlan *plan,
+                       struct ResolveRelayCb *rrc,
+                       GrlMedia *media)
 {
-  struct AutoSplitCtl *as_ctl = NULL;
-  gint count = grl_operation_options_get_count (options);
+  GList *each_spec;
 
-  if (source->priv->auto_split_threshold > 0 &&
-      count > source->priv->auto_split_threshold) {
-    GRL_DEBUG ("auto-split: enabled");
+  rrc->keys = g_list_copy (plan->keys);
+  rrc->map = map_keys_copy (plan->map);
+  rrc->resolve_specs = map_sources_new ();
 
-    as_ctl = g_slice_new (struct AutoSplitCtl);
-    as_ctl->threshold = source->priv->auto_split_threshold;
-    as_ctl->total_remaining = count;
-    as_ctl->chunk_remaining = as_ctl->threshold;
-    count = as_ctl->chunk_remaining;
-    grl_operation_options_set_count (options, count);
-    GRL_DEBUG ("auto-split: requesting chunk (skip=%u, count=%u)",
-               grl_operation_options_get_skip (options),
-               count);
+  for (each_spec = plan->specs; each_spec; each_spec = g_list_next (each_spec)) {
+    PlanSpec *plan_spec = (PlanSpec *) each_spec->data;
+    GrlSourceResolveSpec *rs;
+
+    rs = g_new (GrlSourceResolveSpec, 1);
+    rs->source = g_object_ref (plan_spec->source);
+    rs->media = g_object_ref (media);
+    rs->operation_id = grl_operation_generate_id ();
+    rs->keys = g_list_copy (plan_spec->keys);
+    rs->options = g_object_ref (rrc->options);
+    rs->callback = resolve_result_relay_cb;
+    rs->user_data = rrc;
+    g_hash_table_insert (rrc->resolve_specs, g_object_ref (plan_spec->source), rs);
   }
+}
 
-  return as_ctl;
+/*
+ * Same as get_additional_sources() without additional keys, but reusing the
+ * result for alike elements
+ */
+static GList *
+get_additional_sources_cached (GrlSource *source,
+                               GrlMedia *media,
+                               GList *keys)
+{
+  ResolutionPlan *plan;
+  gchar *plan_key;
+  GList *sources;
+
+  plan_key = plan_key_new ("decorate", source, media, keys, 0);
+  plan = plan_cache_lookup (plan_key, media);
+  if (!plan) {
+    plan = resolution_plan_new ();
+    plan->sources = get_additional_sources (source, media, keys, NULL, FALSE,
+                                            &plan->checks);
+    g_list_foreach (plan->sources, (GFunc) g_object_ref, NULL);
+    g_atomic_int_inc (&plan->ref_count);
+    plan_cache_insert (plan_key, plan);
+  } else {
+    g_free (plan_key);
+  }
+
+  sources = g_list_copy (plan->sources);
+  resolution_plan_unref (plan);
+
+  return sources;
 }
 
 static void
-auto_split_run_next_chunk (struct BrowseRelayCb *brc)
-{
-  guint id;
-  brc->auto_split->chunk_remaining = MIN (brc->auto_split->threshold,
-                                          brc->auto_split->total_remaining);
-
-  switch (brc->operation_type) {
-  case GRL_OP_BROWSE:
-    grl_operation_options_set_skip (brc->spec.browse->options,
-                                    grl_operation_options_get_skip (brc->spec.browse->options) +
-                                    brc->auto_split->threshold);
-    grl_operation_options_set_count (brc->spec.browse->options,
-                                     brc->auto_split->chunk_remaining);
-    GRL_DEBUG ("auto-split: requesting chunk (skip=%u, count=%u)",
-               grl_operation_options_get_skip (brc->spec.browse->options),
-               grl_operation_options_get_count (brc->spec.browse->options));
-    id = g_idle_add_full (grl_operation_options_get_resolution_flags (brc->options) & GRL_RESOLVE_IDLE_RELAY?
-                          G_PRIORITY_DEFAULT_IDLE: G_PRIORITY_HIGH_IDLE,
-                          browse_idle,
-                          brc->spec.browse,
-                          NULL);
-    g_source_set_name_by_id (id, "[grilo] browse_idle");
-    break;
-  case GRL_OP_SEARCH:
-    grl_operation_options_set_skip (brc->spec.search->options,
-                                    grl_operation_options_get_skip (brc->spec.search->options) +
-                                    brc->auto_split->threshold);
-    grl_operation_options_set_count (brc->spec.search->options,
-                                     brc->auto_split->chunk_remaining);
-    GRL_DEBUG ("auto-split: requesting chunk (skip=%u, count=%u)",
-               grl_operation_options_get_skip (brc->spec.search->options),
-               grl_operation_options_get_count (brc->spec.search->options));
-    id = g_idle_add_full (grl_operation_options_get_resolution_flags (brc->options) & GRL_RESOLVE_IDLE_RELAY?
-                          G_PRIORITY_DEFAULT_IDLE: G_PRIORITY_HIGH_IDLE,
-                          search_idle,
-                          brc->spec.search,
-                          NULL);
-    g_source_set_name_by_id (id, "[grilo] search_idle");
-    break;
-  case GRL_OP_QUERY:
-    grl_operation_options_set_skip (brc->spec.query->options,
-                                    grl_operation_options_get_skip (brc->spec.query->options) +
-                                    brc->auto_split->threshold);
-    grl_operation_options_set_count (brc->spec.query->options,
-                                     brc->auto_split->chunk_remaining);
-    GRL_DEBUG ("auto-split: requesting chunk (skip=%u, count=%u)",
-               grl_operation_options_get_skip (brc->spec.query->options),
-               grl_operation_options_get_count (brc->spec.query->options));
-    id = g_idle_add_full (grl_operation_options_get_resolution_flags (brc->options) & GRL_RESOLVE_IDLE_RELAY?
-                          G_PRIORITY_DEFAULT_IDLE: G_PRIORITY_HIGH_IDLE,
-                          query_idle,
-                          brc->spec.query,
-                          NULL);
-    g_source_set_name_by_id (id, "[grilo] query_idle");
-    break;
-  default:
-    g_assert_not_reached ();
-    break;
-  }
-}
-
-static void
-warn_if_no_id (GrlMedia *media,
-               GrlSource *source)
+send_decorated_media (GrlMedia *media,
+                      gpointer user_data,
+                      const GError *error)
 {
-  const char *id;
-
-  if (media == NULL || !grl_media_is_container (media))
-    return;
+  struct ResolveRelayCb *mrc = (struct ResolveRelayCb *) user_data;
 
-  id = grl_media_get_id (media);
-  if (id == NULL || *id == '\0')
-    GRL_WARNING ("Media container is not browsable, has no ID: %s (source: %s)",
-                 grl_media_get_title (media),
-                 grl_source_get_id (source));
+  mrc->user_callback (mrc->spec.res->source, mrc->spec.res->operation_id,
+                      media, mrc->user_data, error);
+  resolve_relay_free (mrc);
 }
 
 static void
-browse_result_relay_cb (GrlSource *source,
-                        guint operation_id,
-                        GrlMedia *media,
-                        guint remaining,
-                        gpointer user_data,
-                        const GError *error)
+media_decorate_cb (GrlSource *source,
+                   guint operation_id,
+                   GrlMedia *media,
+                   gpointer user_data,
+                   const GError *error)
 {
-  GError *_error;
-  struct BrowseRelayCb *brc = (struct BrowseRelayCb *) user_data;
-
+  struct MediaDecorateData *mdd = (struct MediaDecorateData *) user_data;
+  GError *_error = NULL;
   GRL_DEBUG (__FUNCTION__);
 
-  /* Ignore elements after operation has completed */
-  if (operation_is_completed (operation_id)) {
-    GRL_WARNING ("Source '%s' emitted 'remaining=0' more than once "
-                 "for operation %d",
-                 grl_source_get_id (source), operation_id);
-    g_clear_object (&media);
-    return;
+  if (operation_id > 0) {
+    g_hash_table_remove (mdd->pending_callbacks, source);
   }
 
-  /* Check if cancelled */
-  if (operation_is_cancelled (operation_id)) {
-    GRL_DEBUG ("Operation is cancelled, skipping result until getting the last one");
-    g_clear_object (&media);
-    /* Wait for the last element */
-    if (remaining > 0) {
-      return;
-    } else {
+  /* Check if pending resolutions must be cancelled */
+  if (!mdd->cancelled &&
+      (operation_is_cancelled (mdd->operation_id) ||
+       operation_is_deadline_exceeded (mdd->operation_id))) {
+    mdd->cancelled = TRUE;
+    g_hash_table_foreach (mdd->pending_callbacks, cancel_resolve, NULL);
+  }
+
+  /* If all operations are complete, send the element; after the deadline, with
+     the keys already known */
+  if (g_hash_table_size (mdd->pending_callbacks) == 0) {
+    if (mdd->cancelled && operation_is_cancelled (mdd->operation_id)) {
       _error = g_error_new (GRL_CORE_ERROR,
                             GRL_CORE_ERROR_OPERATION_CANCELLED,
                             _("Operation was cancelled"));
-      brc->user_callback (source, operation_id, NULL, 0,
-                          brc->user_data, _error);
-      g_error_free (_error);
-      goto free_resources;
     }
+    mdd->callback (media, mdd->user_data, _error);
+    g_clear_error (&_error);
+    g_object_unref (mdd->source);
+    g_hash_table_unref (mdd->pending_callbacks);
+    g_slice_free (struct MediaDecorateData, mdd);
   }
+}
 
-  /* Auto-split management */
-  if (brc->auto_split) {
-    brc->auto_split->chunk_remaining--;
-    brc->auto_split->total_remaining--;
-    /* On last element, check if more elements should be asked: if source
-       satisfied all requested elements, but we need to get more */
-    if (remaining == 0) {
-      if (brc->auto_split->chunk_remaining == 0 &&
-          brc->auto_split->total_remaining > 0) {
-        auto_split_run_next_chunk (brc);
-        remaining = brc->auto_split->total_remaining;
-      }
-    } else {
-      remaining = brc->auto_split->total_remaining;
-    }
-  }
+static void decorate_resolve_release (GrlSource *source);
 
-  /* Set the source */
-  if (media && !grl_media_get_source (media)) {
-    grl_media_set_source (media, grl_source_get_id (source));
-  }
+static struct DecorateResolveData *
+decorate_resolve_data_new (GrlSource *source,
+                           GList *keys,
+                           GrlOperationOptions *options)
+{
+  struct DecorateResolveData *drd;
 
-  /* If we need further processing of media, put it in a queue */
-  if (grl_operation_options_get_resolution_flags (brc->options) &
-      (GRL_RESOLVE_FULL | GRL_RESOLVE_IDLE_RELAY)) {
-    queue_add_media (brc, media, remaining, error);
-  } else {
-    warn_if_no_id (media, source);
-    brc->user_callback (source, operation_id, media, remaining,
-                        brc->user_data, error);
-  }
+  drd = g_slice_new (struct DecorateResolveData);
+  drd->source = g_object_ref (source);
+  drd->medias = g_ptr_array_new_with_free_func (g_object_unref);
+  drd->mdds = g_ptr_array_new ();
+  drd->keys = g_list_copy (keys);
+  drd->options = g_object_ref (options);
+  drd->context = g_main_context_ref_thread_default ();
+  drd->started = grl_metrics_start ();
 
-  if (remaining == 0) {
-  free_resources:
-    browse_relay_spec_free (brc);
-    if (!brc->queue || g_queue_is_empty (brc->queue)) {
-      operation_set_finished (operation_id);
-      browse_relay_free (brc);
-    } else {
-      /* There are elements pending to be processed; let's wait to free it in
-         the queue */
-      operation_set_completed (operation_id);
-    }
-  }
+  return drd;
 }
 
 static void
-remove_result_relay_cb (GrlSource *source,
-                        GrlMedia *media,
-                        gpointer user_data,
-                        const GError *error)
+decorate_resolve_data_free (struct DecorateResolveData *drd)
 {
-  struct RemoveRelayCb *rrc = (struct RemoveRelayCb *) user_data;
-
-  rrc->user_callback (source, media, rrc->user_data, error);
-  remove_relay_free (rrc);
+  g_object_unref (drd->source);
+  g_ptr_array_unref (drd->medias);
+  g_ptr_array_unref (drd->mdds);
+  g_list_free (drd->keys);
+  g_object_unref (drd->options);
+  g_main_context_unref (drd->context);
+  g_slice_free (struct DecorateResolveData, drd);
 }
 
-static gboolean
-resolve_idle (gpointer user_data)
+static void
+decorate_resolve_cb (GrlSource *source,
+                     guint operation_id,
+                     GrlMedia *media,
+                     gpointer user_data,
+                     const GError *error)
 {
-  struct ResolveRelayCb *rrc = (struct ResolveRelayCb *) user_data;
-  GrlSourceResolveSpec *rs;
-  GList *spec;
-  GList *key;
-  gboolean run_next;
-
-  GRL_DEBUG (__FUNCTION__);
-
-  /* Abort if operation was cancelled */
-  if (operation_is_cancelled (rrc->operation_id)) {
-    for (spec = rrc->specs_to_invoke;
-         spec;
-         spec = g_list_next (rs)) {
-      rs = (GrlSourceResolveSpec *) spec->data;
-      g_hash_table_remove (rrc->resolve_specs, rs->source);
-    }
-    g_list_free (rrc->specs_to_invoke);
-    rrc->specs_to_invoke = NULL;
-    run_next = FALSE;
-    resolve_result_relay_cb (rrc->source, rrc->operation_id, rrc->media, rrc, NULL);
-  } else {
-    rs = rrc->specs_to_invoke->data;
-    rrc->specs_to_invoke = g_list_delete_link (rrc->specs_to_invoke,
-                                               rrc->specs_to_invoke);
-    run_next = (rrc->specs_to_invoke != NULL);
+  struct DecorateResolveData *drd = (struct DecorateResolveData *) user_data;
 
-    /* Put the specific keys in rs also into rrc */
-    for (key = rs->keys; key; key = g_list_next (key)) {
-      if (!g_list_find (rrc->keys, key->data)) {
-        rrc->keys = g_list_prepend (rrc->keys, key->data);
-      }
-    }
+  grl_metrics_record (drd->source, GRL_OP_RESOLVE, GRL_METRICS_KIND_DECORATE,
+                      drd->started, 1, error != NULL);
 
-    operation_set_ongoing (rs->source, rs->operation_id);
-    operation_set_started (rs->operation_id);
-    GRL_SOURCE_GET_CLASS (rs->source)->resolve (rs->source, rs);
-  }
+  decorate_resolve_release (drd->source);
 
-  return run_next;
+  media_decorate_cb (source, operation_id, media,
+                     g_ptr_array_index (drd->mdds, 0), error);
+  decorate_resolve_data_free (drd);
 }
 
-static gboolean
-resolve_all_done (gpointer user_data)
+static void
+decorate_resolve_batch_cb (GrlSource *source,
+                           guint operation_id,
+                           GPtrArray *medias,
+                           gpointer user_data,
+                           const GError *error)
 {
-  struct ResolveRelayCb *rrc = (struct ResolveRelayCb *) user_data;
-
-  GRL_DEBUG (__FUNCTION__);
+  struct DecorateResolveData *drd = (struct DecorateResolveData *) user_data;
+  guint i;
 
-  if (operation_is_cancelled (rrc->operation_id)) {
-    g_clear_error (&rrc->error);
-    rrc->error = g_error_new (GRL_CORE_ERROR,
-                              GRL_CORE_ERROR_OPERATION_CANCELLED,
-                              _("Operation was cancelled"));
-  }
+  grl_metrics_record (drd->source, GRL_OP_RESOLVE, GRL_METRICS_KIND_DECORATE,
+                      drd->started, drd->medias->len, error != NULL);
 
-  rrc->user_callback (rrc->source, rrc->operation_id, rrc->media, rrc->user_data, rrc->error);
-  operation_set_finished (rrc->operation_id);
-  resolve_relay_free (rrc);
+  decorate_resolve_release (drd->source);
 
-  return FALSE;
+  for (i = 0; i < drd->medias->len; i++) {
+    media_decorate_cb (source, operation_id,
+                       g_ptr_array_index (drd->medias, i),
+                       g_ptr_array_index (drd->mdds, i),
+                       error);
+  }
+  decorate_resolve_data_free (drd);
 }
 
+/* Must be called with a slot of the source reserved for @drd */
 static gboolean
-media_from_uri_idle (gpointer user_data)
+decorate_resolve_start (struct DecorateResolveData *drd)
 {
-  GrlSourceMediaFromUriSpec *mfus = (GrlSourceMediaFromUriSpec *) user_data;
-
-  GRL_DEBUG (__FUNCTION__);
+  guint operation_id;
+  guint i;
 
-  /* Abort if operation is cancelled */
-  if (operation_is_cancelled (mfus->operation_id)) {
-    mfus->callback (mfus->source, mfus->operation_id,
-                    NULL, mfus->user_data, NULL);
+  if (drd->medias->len == 1) {
+    operation_id = grl_source_resolve (drd->source,
+                                       g_ptr_array_index (drd->medias, 0),
+                                       drd->keys, drd->options,
+                                       decorate_resolve_cb, drd);
   } else {
-    operation_set_started (mfus->operation_id);
-    GRL_SOURCE_GET_CLASS (mfus->source)->media_from_uri (mfus->source, mfus);
+    operation_id = grl_source_resolve_batch (drd->source, drd->medias,
+                                             drd->keys, drd->options,
+                                             decorate_resolve_batch_cb, drd);
+  }
+  if (operation_id == 0) {
+    return FALSE;
   }
 
-  return FALSE;
+  /* Stopping the operation stops its decoration too */
+  operation_link (((struct MediaDecorateData *) g_ptr_array_index (drd->mdds, 0))->operation_id,
+                  operation_id);
+
+  for (i = 0; i < drd->mdds->len; i++) {
+    struct MediaDecorateData *mdd = g_ptr_array_index (drd->mdds, i);
+    g_hash_table_insert (mdd->pending_callbacks,
+                         drd->source,
+                         GUINT_TO_POINTER (operation_id));
+  }
+  return TRUE;
 }
 
+/* Runs in the context of the operation that queued @drd, with a slot of the
+   source already reserved for it. Requests belonging to cancelled operations
+   are just discarded */
 static gboolean
-browse_idle (gpointer user_data)
+decorate_resolve_resume (gpointer user_data)
 {
-  GrlSourceBrowseSpec *bs = (GrlSourceBrowseSpec *) user_data;
-
-  GRL_DEBUG (__FUNCTION__);
+  struct DecorateResolveData *drd = (struct DecorateResolveData *) user_data;
+  struct MediaDecorateData *mdd;
+  guint i;
 
-  /* Abort if operation is cancelled */
-  if (operation_is_cancelled (bs->operation_id)) {
-    bs->callback (bs->source, bs->operation_id, NULL, 0, bs->user_data, NULL);
-  } else {
-    operation_set_started (bs->operation_id);
-    GRL_SOURCE_GET_CLASS (bs->source)->browse (bs->source, bs);
+  /* All the elements in a request belong to the same operation */
+  mdd = g_ptr_array_index (drd->mdds, 0);
+  if (mdd->cancelled ||
+      operation_is_cancelled (mdd->operation_id) ||
+      operation_is_deadline_exceeded (mdd->operation_id) ||
+      !decorate_resolve_start (drd)) {
+    decorate_resolve_release (drd->source);
+    for (i = 0; i < drd->medias->len; i++) {
+      mdd = g_ptr_array_index (drd->mdds, i);
+      g_hash_table_remove (mdd->pending_callbacks, drd->source);
+      media_decorate_cb (NULL, 0, g_ptr_array_index (drd->medias, i),
+                         mdd, NULL);
+    }
+    decorate_resolve_data_free (drd);
   }
 
-  return FALSE;
+  return G_SOURCE_REMOVE;
 }
 
-static gboolean
-search_idle (gpointer user_data)
+/* Hands the free slots of @source to the resolves waiting for them, each in
+   the context of its operation */
+static void
+decorate_resolve_run_waiting (GrlSource *source)
+{
+  GrlSourcePrivate *priv = source->priv;
+  struct DecorateResolveData *drd;
+  guint limit = priv->resolve_concurrency;
+
+  g_mutex_lock (&priv->lock);
+  while ((limit == 0 || priv->resolves_running < limit) &&
+         (drd = g_queue_pop_head (priv->resolves_waiting))) {
+    priv->resolves_running++;
+    g_mutex_unlock (&priv->lock);
+    g_main_context_invoke_full (drd->context,
+                                operation_priority (drd->options,
+                                                    G_PRIORITY_DEFAULT_IDLE),
+                                decorate_resolve_resume,
+                                drd,
+                                NULL);
+    g_mutex_lock (&priv->lock);
+  }
+  g_mutex_unlock (&priv->lock);
+}
+
+/* Frees the slot of a finished resolve in @source */
+static void
+decorate_resolve_release (GrlSource *source)
 {
-  GrlSourceSearchSpec *ss = (GrlSourceSearchSpec *) user_data;
+  g_mutex_lock (&source->priv->lock);
+  source->priv->resolves_running--;
+  g_mutex_unlock (&source->priv->lock);
 
-  GRL_DEBUG (__FUNCTION__);
+  decorate_resolve_run_waiting (source);
+}
 
-  /* Abort if operation is cancelled */
-  if (operation_is_cancelled (ss->operation_id)) {
-    ss->callback (ss->source, ss->operation_id, NULL, 0, ss->user_data, NULL);
-  } else {
-    operation_set_started (ss->operation_id);
-    GRL_SOURCE_GET_CLASS (ss->source)->search (ss->source, ss);
+/* Orders the waiting resolves by the priority of their operations, keeping
+   the arrival order among those with the same priority */
+static gint
+decorate_resolve_compare (gconstpointer a,
+                          gconstpointer b,
+                          gpointer user_data)
+{
+  const struct DecorateResolveData *waiting = a;
+  const struct DecorateResolveData *drd = b;
+
+  if (grl_operation_options_get_priority (waiting->options) <=
+      grl_operation_options_get_priority (drd->options)) {
+    return -1;
   }
 
-  return FALSE;
+  return 1;
 }
 
-static gboolean
-query_idle (gpointer user_data)
+/* Asks the source in @drd to resolve its keys in its elements, unless it has
+   already reached its limit of concurrent resolves; in that case the request
+   waits for a free slot, behind those of more urgent operations */
+static void
+decorate_resolve (struct DecorateResolveData *drd)
 {
-  GrlSourceQuerySpec *qs = (GrlSourceQuerySpec *) user_data;
-  GRL_DEBUG (__FUNCTION__);
+  GrlSource *source = drd->source;
+  GrlSourcePrivate *priv = source->priv;
+  guint limit = priv->resolve_concurrency;
+  guint i;
 
-  /* Abort if operation is cancelled */
-  if (operation_is_cancelled (qs->operation_id)) {
-    qs->callback (qs->source, qs->operation_id, NULL, 0, qs->user_data, NULL);
-  } else {
-    operation_set_started (qs->operation_id);
-    GRL_SOURCE_GET_CLASS (qs->source)->query (qs->source, qs);
+  g_mutex_lock (&priv->lock);
+  if (limit > 0 && priv->resolves_running >= limit) {
+    GRL_DEBUG ("%s: delaying resolve, %u already running",
+               grl_source_get_id (source), priv->resolves_running);
+    for (i = 0; i < drd->mdds->len; i++) {
+      struct MediaDecorateData *mdd = g_ptr_array_index (drd->mdds, i);
+      g_hash_table_insert (mdd->pending_callbacks, source, NULL);
+    }
+    g_queue_insert_sorted (priv->resolves_waiting,
+                           drd,
+                           decorate_resolve_compare,
+                           NULL);
+    g_mutex_unlock (&priv->lock);
+    return;
   }
+  priv->resolves_running++;
+  g_mutex_unlock (&priv->lock);
 
-  return FALSE;
+  if (!decorate_resolve_start (drd)) {
+    decorate_resolve_release (source);
+    decorate_resolve_data_free (drd);
+  }
 }
 
-static gboolean
-remove_idle (gpointer user_data)
-{
-  struct RemoveRelayCb *rrc = (struct RemoveRelayCb *) user_data;
-  GRL_DEBUG (__FUNCTION__);
+/* Completes @keys in all @medias. Sources able to resolve several elements at
+   once get a single request with all the elements they can complete; the
+   rest get one request per element. @callback is invoked once per element */
+static void
+media_decorate_batch (GrlSource *main_source,
+                      guint main_operation_id,
+                      GPtrArray *medias,
+                      GList *keys,
+                      GrlOperationOptions *options,
+                      MediaDecorateCb callback,
+                      gpointer user_data)
+{
+  struct MediaDecorateData *mdd;
+  struct DecorateResolveData *drd;
+  GHashTable *groups;
+  GHashTableIter iter;
+  GPtrArray *mdds;
+  GList *s, *sources;
+  GrlOperationOptions *decorate_options;
+  GrlOperationOptions *supported_options;
+  GrlResolutionFlags flags;
+  guint i;
 
-  if (rrc->error) {
-    rrc->user_callback (rrc->source, rrc->media, rrc->user_data, rrc->error);
-    remove_relay_free (rrc);
+  /* The deadline of the main operation also bounds its decoration */
+  flags = grl_operation_options_get_resolution_flags (options);
+  if (flags & GRL_RESOLVE_FULL ||
+      grl_operation_options_get_deadline (options) > 0) {
+    decorate_options = grl_operation_options_copy (options);
+    grl_operation_options_set_resolution_flags (decorate_options,
+                                                flags & ~GRL_RESOLVE_FULL);
+    grl_operation_options_set_deadline (decorate_options, 0);
   } else {
-    GRL_SOURCE_GET_CLASS (rrc->source)->remove (rrc->source, rrc->spec);
+    decorate_options = g_object_ref (options);
   }
 
-  return FALSE;
-}
+  /* Batch-capable source -> request with all the elements it can complete */
+  groups = g_hash_table_new (g_direct_hash, g_direct_equal);
+  mdds = g_ptr_array_sized_new (medias->len);
 
-static void
-resolve_result_async_cb (GrlSource *source,
-                         guint operation_id,
-                         GrlMedia *media,
-                         gpointer user_data,
-                         const GError *error)
-{
-  GrlDataSync *ds = (GrlDataSync *) user_data;
+  for (i = 0; i < medias->len; i++) {
+    GrlMedia *media = g_ptr_array_index (medias, i);
 
-  GRL_DEBUG (__FUNCTION__);
+    mdd = g_slice_new (struct MediaDecorateData);
+    mdd->source = g_object_ref (main_source);
+    mdd->operation_id = main_operation_id;
+    mdd->callback = callback;
+    mdd->user_data = user_data;
+    mdd->pending_callbacks = g_hash_table_new (g_direct_hash, g_direct_equal);
+    mdd->cancelled = FALSE;
+    g_ptr_array_add (mdds, mdd);
 
-  if (error) {
-    ds->error = g_error_copy (error);
-  }
+    sources = get_additional_sources_cached (main_source, media, keys);
 
-  ds->data = media;
-  ds->complete = TRUE;
-}
+    for (s = sources; s; s = g_list_next (s)) {
+      GrlSource *source = GRL_SOURCE (s->data);
+      gboolean batch;
 
-static void
-multiple_result_async_cb (GrlSource *source,
-                          guint op_id,
-                          GrlMedia *media,
-                          guint remaining,
-                          gpointer user_data,
-                          const GError *error)
-{
-  GrlDataSync *ds = (GrlDataSync *) user_data;
+      if (!(grl_source_supported_operations (source) & GRL_OP_RESOLVE)) {
+        continue;
+      }
 
-  GRL_DEBUG (__FUNCTION__);
+      batch = GRL_SOURCE_GET_CLASS (source)->resolve_batch != NULL;
+      drd = batch? g_hash_table_lookup (groups, source): NULL;
+      if (!drd) {
+        grl_operation_options_obey_caps (decorate_options,
+                                         grl_source_get_caps (source, GRL_OP_RESOLVE),
+                                         &supported_options,
+                                         NULL);
+        drd = decorate_resolve_data_new (source, keys, supported_options);
+        g_object_unref (supported_options);
+        if (batch) {
+          g_hash_table_insert (groups, source, drd);
+        }
+      }
 
-  if (error) {
-    ds->error = g_error_copy (error);
+      g_ptr_array_add (drd->medias, g_object_ref (media));
+      g_ptr_array_add (drd->mdds, mdd);
 
-    /* Free previous results */
-    g_list_free_full (ds->data, g_object_unref);
+      if (!batch) {
+        decorate_resolve (drd);
+      }
+    }
 
-    ds->data = NULL;
-    ds->complete = TRUE;
-    return;
+    g_list_free (sources);
   }
 
-  if (media) {
-    ds->data = g_list_prepend (ds->data, media);
+  g_hash_table_iter_init (&iter, groups);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &drd)) {
+    decorate_resolve (drd);
   }
+  g_hash_table_unref (groups);
 
-  if (remaining == 0) {
-    ds->data = g_list_reverse (ds->data);
-    ds->complete = TRUE;
+  /* Check the elements nobody can solve */
+  for (i = 0; i < mdds->len; i++) {
+    mdd = g_ptr_array_index (mdds, i);
+    if (g_hash_table_size (mdd->pending_callbacks) == 0) {
+      media_decorate_cb (NULL, 0, g_ptr_array_index (medias, i), mdd, NULL);
+    }
   }
+
+  g_ptr_array_unref (mdds);
+  g_object_unref (decorate_options);
 }
 
 static void
-remove_async_cb (GrlSource *source,
-                 GrlMedia *media,
-                 gpointer user_data,
-                 const GError *error)
+media_decorate (GrlSource *main_source,
+                guint main_operation_id,
+                GrlMedia *media,
+                GList *keys,
+                GrlOperationOptions *options,
+                MediaDecorateCb callback,
+                gpointer user_data)
 {
-  GrlDataSync *ds = (GrlDataSync *) user_data;
-
-  GRL_DEBUG (__FUNCTION__);
-
-  if (error) {
-    ds->error = g_error_copy (error);
-  }
+  GPtrArray *medias;
 
-  ds->complete = TRUE;
+  medias = g_ptr_array_sized_new (1);
+  g_ptr_array_add (medias, media);
+  media_decorate_batch (main_source, main_operation_id, medias, keys,
+                        options, callback, user_data);
+  g_ptr_array_unref (medias);
 }
 
 static void
-store_result_async_cb (GrlSource *source,
-                       GrlMedia *media,
-                       GList *failed_keys,
-                       gpointer user_data,
-                       const GError *error)
+relay_redirect_free (struct RelayRedirect *rr)
 {
-  GrlDataSync *ds = (GrlDataSync *) user_data;
+  g_object_unref (rr->source);
+  g_clear_object (&rr->media);
+  g_clear_error (&rr->error);
+  g_slice_free (struct RelayRedirect, rr);
+}
 
-  GRL_DEBUG (__FUNCTION__);
+static gboolean
+relay_redirect_run (gpointer user_data)
+{
+  struct RelayRedirect *rr = user_data;
 
-  if (error) {
-    ds->error = g_error_copy (error);
+  if (rr->result_cb) {
+    /* Browse results are owned by the relay */
+    rr->result_cb (rr->source, rr->operation_id, g_steal_pointer (&rr->media),
+                   rr->remaining, rr->user_data, rr->error);
+  } else {
+    rr->resolve_cb (rr->source, rr->operation_id, rr->media,
+                    rr->user_data, rr->error);
   }
 
-  ds->data = g_list_copy (failed_keys);
-  ds->complete = TRUE;
+  return G_SOURCE_REMOVE;
 }
 
+/* Plugins may answer from any main context, usually the global default one
+   they add their idles and timeouts to. Results are sent back to the main
+   context the operation was started from, so the relays and the user
+   callbacks never run concurrently with the rest of the operation. Returns
+   %TRUE if the result was redirected. */
+static gboolean
+relay_redirect (GrlSource *source,
+                guint operation_id,
+                GrlMedia *media,
+                guint remaining,
+                gpointer user_data,
+                const GError *error,
+                GrlSourceResultCb result_cb,
+                GrlSourceResolveCb resolve_cb)
+{
+  struct RelayRedirect *rr;
+  GMainContext *context;
+
+  context = grl_operation_ref_foreign_context (operation_id);
+  if (!context) {
+    return FALSE;
+  }
+
+  rr = g_slice_new0 (struct RelayRedirect);
+  rr->source = g_object_ref (source);
+  rr->operation_id = operation_id;
+  /* Browse results are transferred, resolved ones are only borrowed */
+  rr->media = result_cb ? media : (media ? g_object_ref (media) : NULL);
+  rr->remaining = remaining;
+  rr->user_data = user_data;
+  rr->error = error ? g_error_copy (error) : NULL;
+  rr->result_cb = result_cb;
+  rr->resolve_cb = resolve_cb;
+
+  g_main_context_invoke_full (context, G_PRIORITY_DEFAULT,
+                              relay_redirect_run, rr,
+                              (GDestroyNotify) relay_redirect_free);
+  g_main_context_unref (context);
+
+  return TRUE;
+}
 
 static void
-store_metadata_result_async_cb (GrlSource *source,
+media_from_uri_result_relay_cb (GrlSource *source,
+                                guint operation_id,
                                 GrlMedia *media,
-                                GList *failed_keys,
                                 gpointer user_data,
                                 const GError *error)
 {
-  GrlDataSync *ds = (GrlDataSync *) user_data;
+  struct ResolveRelayCb *rrc = (struct ResolveRelayCb *) user_data;
+  GError *_error = (GError *) error;
+  GList *unknown_keys;
 
   GRL_DEBUG (__FUNCTION__);
 
-  if (error) {
-    ds->error = g_error_copy (error);
+  if (relay_redirect (source, operation_id, media, 0, user_data, error,
+                      NULL, media_from_uri_result_relay_cb)) {
+    return;
   }
 
-  ds->data = g_list_copy (failed_keys);
-  ds->complete = TRUE;
-}
-
-static GHashTable *
-map_writable_keys (GrlSource *source,
-                   GList *keys,
-                   GrlWriteFlags flags,
-                   GList **failed_keys)
-{
-  GHashTable *map;
-  GrlRegistry *registry;
-  GList *sources = NULL;
-  GList *sources_iter;
-  GList *unsupported_keys;
-  GrlSource *_source;
+  grl_metrics_call_result (operation_id, media? 1: 0, TRUE, error);
 
-  map = g_hash_table_new_full (g_direct_hash, g_direct_equal,
-                               g_object_unref,
-                               (GDestroyNotify) g_list_free);
+  /* Free specs */
+  media_from_uri_spec_free (rrc->spec.mfu);
 
-  /* 'key_list' holds keys that can be written by this source
-     'unsupportedy_keys' holds those that must be handled by other sources */
-  GList *key_list = g_list_copy (keys);
-  if (grl_source_supported_operations (source) & GRL_OP_STORE_METADATA) {
-    unsupported_keys = filter_writable (source, &key_list, TRUE);
-  } else {
-    unsupported_keys = key_list;
-    key_list = NULL;
+  /* Append the source-id in case it is not set */
+  if (media && !grl_data_get_string (GRL_DATA (media), GRL_METADATA_KEY_SOURCE)) {
+    grl_data_set_string (GRL_DATA (media), GRL_METADATA_KEY_SOURCE, grl_source_get_id (source));
   }
 
-  if (key_list) {
-    g_hash_table_insert (map, g_object_ref (source), key_list);
+  /* Check if cancelled */
+  if (operation_is_cancelled (rrc->operation_id)) {
+    /* if the plugin already set an error, we don't care because we're
+     * cancelled */
+    GRL_DEBUG ("operation was cancelled");
+    _error = g_error_new (GRL_CORE_ERROR,
+                          GRL_CORE_ERROR_OPERATION_CANCELLED,
+                          _("Operation was cancelled"));
   }
 
-  if (!unsupported_keys || !(flags & GRL_WRITE_FULL)) {
-    /* We are done! */
-    goto done;
+  if (_error) {
+    rrc->user_callback (source, rrc->operation_id, media, rrc->user_data, _error);
+    if (_error != error) {
+      g_error_free (_error);
+    }
+    operation_set_finished (rrc->operation_id);
+    resolve_relay_free (rrc);
+    return;
   }
 
-  /* Check if other sources can write the missing keys */
-  registry = grl_registry_get_default ();
-  sources =
-    grl_registry_get_sources_by_operations (registry,
-                                            GRL_OP_STORE_METADATA,
-                                            TRUE);
-
-  for (sources_iter = sources; unsupported_keys && sources_iter;
-       sources_iter = g_list_next (sources_iter)) {
-    _source = GRL_SOURCE (sources_iter->data);
-
-    if (_source == source) {
-      continue;
+  if (grl_operation_options_get_resolution_flags (rrc->options) & GRL_RESOLVE_FULL) {
+    /* Check if there are unsolved keys that need to be solved by other
+       sources */
+    unknown_keys = filter_known_keys (media, rrc->keys);
+    if (unknown_keys) {
+      media_decorate (source, operation_id, media, unknown_keys, rrc->options,
+                      send_decorated_media, rrc);
+      g_list_free (unknown_keys);
+      return;
     }
+  }
 
-    key_list = unsupported_keys;
-    unsupported_keys = filter_writable (_source, &key_list, TRUE);
-
-    if (!key_list) {
-      continue;
-    }
+  rrc->user_callback (source, rrc->operation_id, media, rrc->user_data, error);
+  operation_set_finished (rrc->operation_id);
+  resolve_relay_free (rrc);
+}
 
-    g_hash_table_insert (map, g_object_ref (_source), key_list);
+static void
+cancel_resolve_spec (GrlSource *source, GrlSourceResolveSpec *spec)
+{
+  struct OperationState *op_state;
 
-    if (!unsupported_keys) {
-      break;
-    }
+  op_state = grl_operation_get_private_data (spec->operation_id);
+  if (op_state) {
+    source_cancel_cb (op_state);
   }
-
-  g_list_free (sources);
-
- done:
-  *failed_keys = unsupported_keys;
-  return map;
 }
 
 static void
-store_relay_cb (GrlSource *source,
-                GrlMedia *media,
-                GList *failed_keys,
-                gpointer user_data,
-                const GError *error)
+resolve_result_relay_cb (GrlSource *source,
+                         guint operation_id,
+                         GrlMedia *media,
+                         gpointer user_data,
+                         const GError *error)
 {
-  struct StoreRelayCb *src = (struct StoreRelayCb *) user_data;
-  GrlSourceStoreSpec *ss  = src->spec;
+  struct ResolveRelayCb *rrc = (struct ResolveRelayCb *) user_data;
+  GList *each_key;
+  GList *delete_key;
 
   GRL_DEBUG (__FUNCTION__);
 
-  if (error || !(src->flags & GRL_WRITE_FULL)) {
-    if (src->user_callback)
-      src->user_callback (source, media, failed_keys, src->user_data, error);
-  } else if (failed_keys != NULL) {
-    run_store_metadata (source, media, failed_keys, GRL_WRITE_FULL,
-                        src->user_callback, src->user_data);
+  if (relay_redirect (source, operation_id, media, 0, user_data, error,
+                      NULL, resolve_result_relay_cb)) {
+    return;
   }
-  store_relay_free (src);
-  store_spec_free (ss);
-}
 
-static void
-store_metadata_ctl_cb (GrlSource *source,
-                       GrlMedia *media,
-                       GList *failed_keys,
-                       gpointer user_data,
-                       const GError *error)
-{
-  struct StoreMetadataRelayCb *smrc;
-  GError *own_error = NULL;
+  grl_metrics_call_result (operation_id, media? 1: 0, TRUE, error);
 
-  GRL_DEBUG (__FUNCTION__);
+  if (!operation_is_cancelled (operation_id) && !rrc->deadline_exceeded) {
+    /* Keep what the source answered, unless it comes from the cache */
+    if (!error && !rrc->cache_hit && grl_source_get_resolve_cache_ttl (source) > 0) {
+      GrlSourceResolveSpec *rs = g_hash_table_lookup (rrc->resolve_specs, source);
 
-  smrc = (struct StoreMetadataRelayCb *) user_data;
+      if (rs) {
+        grl_resolve_cache_store (grl_source_get_id (source), media, rs->keys);
+      }
+    }
 
-  if (failed_keys) {
-    smrc->failed_keys = g_list_concat (smrc->failed_keys, failed_keys);
+    /* Check which keys are now known */
+    each_key = rrc->keys;
+    while (each_key) {
+      if (grl_data_has_key (GRL_DATA (media), GRLPOINTER_TO_KEYID (each_key->data))) {
+        map_update_known_key (rrc->map, GRLPOINTER_TO_KEYID (each_key->data), media);
+        delete_key = each_key;
+        each_key = g_list_next (each_key);
+        rrc->keys = g_list_delete_link (rrc->keys, delete_key);
+      } else {
+        map_update_unknown_key (rrc->map, GRLPOINTER_TO_KEYID (each_key->data), source);
+        each_key = g_list_next (each_key);
+      }
+    }
   }
 
-  g_hash_table_remove (smrc->map, source);
+  /* The source is done, even if it was cancelled */
+  if (operation_id != rrc->operation_id) {
+    g_hash_table_remove (rrc->resolve_specs, source);
+  }
 
-  /* If we all sources have answered */
-  if (g_hash_table_size (smrc->map) == 0) {
-    /* We ignore the plugin errors, instead we create an own error
-       if some keys were not written */
-    if (smrc->user_callback) {
-      if (smrc->failed_keys) {
-        own_error = g_error_new (GRL_CORE_ERROR,
-                                 GRL_CORE_ERROR_STORE_METADATA_FAILED,
-                                 _("Some keys could not be written"));
+  operation_set_finished (operation_id);
+
+  if (operation_is_cancelled (rrc->operation_id) &&
+      !rrc->cancel_invoked) {
+    rrc->cancel_invoked = TRUE;
+    g_hash_table_foreach (rrc->resolve_specs, (GHFunc) cancel_resolve_spec, NULL);
+  }
+
+  if (error && source == rrc->source && !rrc->error) {
+    /* Save error for further sending */
+    rrc->error = g_error_copy (error);
+  }
+
+  if (g_hash_table_size (rrc->resolve_specs) == 0 && !rrc->specs_to_invoke) {
+    /* All sources have replied. Let's run another round if not cancelled */
+    if (!operation_is_cancelled (rrc->operation_id) && !rrc->deadline_exceeded) {
+      each_key = rrc->keys;
+      while (each_key) {
+        if (map_sources_to_specs (rrc->resolve_specs, rrc->map, media,
+                                  GRLPOINTER_TO_KEYID (each_key->data),
+                                  rrc->options, rrc)) {
+          each_key = g_list_next (each_key);
+        } else {
+          delete_key = each_key;
+          each_key = g_list_next (each_key);
+          rrc->keys = g_list_delete_link (rrc->keys, delete_key);
+        }
       }
-      smrc->user_callback (smrc->source,
-                           media,
-                           smrc->failed_keys,
-                           smrc->user_data,
-                           own_error);
-      g_clear_error (&own_error);
+
+    }
+
+    rrc->specs_to_invoke = g_hash_table_get_values (rrc->resolve_specs);
+    if (rrc->specs_to_invoke) {
+      grl_operation_idle_add (operation_relay_priority (rrc->options),
+                              resolve_idle,
+                              rrc,
+                              NULL,
+                              "[grilo] resolve_idle");
+    } else {
+      grl_operation_idle_add (operation_relay_priority (rrc->options),
+                              resolve_all_done,
+                              rrc,
+                              NULL,
+                              "[grilo] resolve_all_done");
     }
-    store_metadata_relay_free (smrc);
   }
 }
 
-static gboolean
-store_idle (gpointer user_data)
+static void
+browse_relay_send_cancelled (struct BrowseRelayCb *brc)
 {
-  GrlSourceStoreSpec *ss = (GrlSourceStoreSpec *) user_data;
-
-  GRL_DEBUG (__FUNCTION__);
-
-  GRL_SOURCE_GET_CLASS (ss->source)->store(ss->source, ss);
+  GError *error;
 
-  return FALSE;
+  error = g_error_new (GRL_CORE_ERROR,
+                       GRL_CORE_ERROR_OPERATION_CANCELLED,
+                       _("Operation was cancelled"));
+  if (brc->batch_callback) {
+    brc->batch_callback (brc->source, brc->operation_id,
+                         g_ptr_array_new_with_free_func (g_object_unref),
+                         0, brc->user_data, error);
+  } else {
+    brc->user_callback (brc->source, brc->operation_id, NULL,
+                        0, brc->user_data, error);
+  }
+  g_error_free (error);
 }
 
-static gboolean
-store_metadata_idle (gpointer user_data)
+static void
+progressive_data_free (struct ProgressiveData *pd)
 {
-  GrlSourceStoreMetadataSpec *sms;
-  gboolean stop;
-  struct StoreMetadataRelayCb *smrc;
-
-  GRL_DEBUG (__FUNCTION__);
+  GHashTableIter iter;
+  gpointer value;
 
-  smrc = (struct StoreMetadataRelayCb *) user_data;
+  operation_background_end (pd->operation_id);
+  g_object_unref (pd->source);
+  g_ptr_array_unref (pd->medias);
+  g_hash_table_iter_init (&iter, pd->missing);
+  while (g_hash_table_iter_next (&iter, NULL, &value)) {
+    g_list_free ((GList *) value);
+  }
+  g_hash_table_unref (pd->missing);
+  g_list_free (pd->keys);
+  g_object_unref (pd->options);
+  g_slice_free (struct ProgressiveData, pd);
+}
 
-  sms = g_new (GrlSourceStoreMetadataSpec, 1);
+/* Keeps @media to be completed after it is sent, if it was sent without some
+   of its slow keys */
+static void
+progressive_add_media (struct BrowseRelayCb *brc,
+                       GrlMedia *media)
+{
+  struct ProgressiveData *pd;
+  GrlResolutionFlags flags;
+  GList *missing;
 
-  sms->source = g_object_ref (g_list_first (smrc->use_sources)->data);
-  sms->keys = g_hash_table_lookup (smrc->map, sms->source);
-  sms->media = g_object_ref (smrc->media);
-  sms->callback = store_metadata_ctl_cb;
-  sms->user_data = smrc;
+  flags = grl_operation_options_get_resolution_flags (brc->options);
+  if ((flags & (GRL_RESOLVE_FULL | GRL_RESOLVE_PROGRESSIVE)) !=
+      (GRL_RESOLVE_FULL | GRL_RESOLVE_PROGRESSIVE)) {
+    return;
+  }
 
-  /* Remove list header */
-  smrc->use_sources = g_list_remove_link (smrc->use_sources, smrc->use_sources);
-  smrc->specs = g_list_prepend (smrc->specs, sms);
+  missing = filter_known_keys (media, brc->keys);
+  if (!missing) {
+    return;
+  }
 
-  stop = smrc->use_sources == NULL;
-  GRL_SOURCE_GET_CLASS (sms->source)->store_metadata (sms->source, sms);
+  if (!brc->progressive) {
+    pd = g_slice_new0 (struct ProgressiveData);
+    pd->source = g_object_ref (brc->source);
+    pd->operation_id = brc->operation_id;
+    pd->medias = g_ptr_array_new_with_free_func (g_object_unref);
+    pd->missing = g_hash_table_new (g_direct_hash, g_direct_equal);
+    pd->keys = g_list_copy (brc->keys);
+    /* Slow keys are not in a hurry */
+    pd->options = grl_operation_options_copy (brc->options);
+    grl_operation_options_set_resolution_flags (pd->options,
+                                                (flags & ~(GRL_RESOLVE_PROGRESSIVE |
+                                                           GRL_RESOLVE_FAST_ONLY)) |
+                                                GRL_RESOLVE_IDLE_RELAY);
+    brc->progressive = pd;
+  }
 
-  return !stop;
+  pd = brc->progressive;
+  g_ptr_array_add (pd->medias, g_object_ref (media));
+  g_hash_table_insert (pd->missing, media, missing);
 }
 
 static void
-run_store_metadata (GrlSource *source,
-                    GrlMedia *media,
-                    GList *keys,
-                    GrlWriteFlags flags,
-                    GrlSourceStoreCb callback,
-                    gpointer user_data)
+progressive_media_cb (GrlMedia *media,
+                      gpointer user_data,
+                      const GError *error)
 {
-  GHashTable *map;
-  GList *failed_keys = NULL;
-  GError *error;
-  struct StoreMetadataRelayCb *smrc;
-  guint id;
+  struct ProgressiveData *pd = (struct ProgressiveData *) user_data;
+  GList *missing, *each_key, *updated = NULL;
 
-  map = map_writable_keys (source, keys, flags, &failed_keys);
+  if (error) {
+    GRL_DEBUG ("progressive: %s", error->message);
+  }
 
-  if (g_hash_table_size (map) == 0) {
-    error = g_error_new (GRL_CORE_ERROR,
-                         GRL_CORE_ERROR_STORE_METADATA_FAILED,
-                         _("None of the specified keys are writable"));
-    if (callback) {
-      callback (source, media, failed_keys, user_data, error);
+  missing = g_hash_table_lookup (pd->missing, media);
+  for (each_key = missing; each_key; each_key = g_list_next (each_key)) {
+    if (grl_data_has_key (GRL_DATA (media), GRLPOINTER_TO_KEYID (each_key->data))) {
+      updated = g_list_prepend (updated, each_key->data);
     }
+  }
 
-    g_error_free (error);
-    g_list_free (failed_keys);
-    g_hash_table_unref (map);
+  if (updated) {
+    updated = g_list_reverse (updated);
+    g_signal_emit_by_name (media, "keys-updated", updated);
+    g_list_free (updated);
+  }
 
-    return;
+  if (--pd->pending == 0) {
+    progressive_data_free (pd);
   }
+}
 
-  smrc = g_slice_new (struct StoreMetadataRelayCb);
-  smrc->source = g_object_ref (source);
-  smrc->media = g_object_ref (media);
-  smrc->map = map;
-  smrc->use_sources = g_hash_table_get_keys (map);
-  smrc->failed_keys = failed_keys;
-  smrc->specs = NULL;
-  smrc->user_callback = callback;
-  smrc->user_data = user_data;
+/* Completes the slow keys of the elements already sent */
+static gboolean
+progressive_idle (gpointer user_data)
+{
+  struct ProgressiveData *pd = (struct ProgressiveData *) user_data;
+
+  GRL_DEBUG (__FUNCTION__);
 
-  id = g_idle_add (store_metadata_idle, smrc);
-  g_source_set_name_by_id (id, "[grilo] store_metadata_idle");
+  if (operation_is_cancelled (pd->operation_id)) {
+    progressive_data_free (pd);
+    return G_SOURCE_REMOVE;
+  }
+
+  pd->pending = pd->medias->len;
+  media_decorate_batch (pd->source, pd->operation_id, pd->medias, pd->keys,
+                        pd->options, progressive_media_cb, pd);
+
+  return G_SOURCE_REMOVE;
 }
 
 static gboolean
-check_options (GrlSource *source,
-               GrlSupportedOps operation,
-               GrlOperationOptions *options)
+queue_process (gpointer user_data)
 {
-  GrlCaps *caps;
+  QueueElement *qelement;
+  GError *error = NULL;
+  GPtrArray *batch = NULL;
+  gint remaining;
+  gint64 deadline;
+  struct BrowseRelayCb *brc = (struct BrowseRelayCb *) user_data;
 
-  /* FIXME: that check should be in somewhere in GrlOperationOptions */
-  if (grl_operation_options_get_count (options) == 0)
+  /* Check if operation is cancelled */
+  if (operation_is_cancelled (brc->operation_id)) {
+    /* This is how this works: if operation is cancelled, no one will add more
+       elements to queue. If one with remaining=0 is found, means that the
+       browse/search/query operation finished before operation is cancelled. So we
+       need to emit this result to user to tell him that operation is cancelled. For
+       elements that are not ready, means that a source_resolve() was run to get
+       solve more keys. So the algorithm is freeing all elements that are ready, and
+       if some of them has remaining==0, sending the cancel signal to user */
+    while ((qelement = (QueueElement *) g_queue_peek_head (brc->queue)) &&
+           qelement->is_ready) {
+      g_queue_pop_head (brc->queue);
+      if (qelement->remaining == 0) {
+        browse_relay_send_cancelled (brc);
+      }
+      g_clear_error (&qelement->error);
+      g_free (qelement);
+    }
+    if (g_queue_is_empty (brc->queue)) {
+      operation_set_finished (brc->operation_id);
+      browse_relay_free (brc);
+      return FALSE;
+    }
+    brc->dispatcher_running = FALSE;
     return FALSE;
+  }
 
-  /* Check only if the source supports the operation */
-  if (grl_source_supported_operations (source) & operation) {
-    caps = grl_source_get_caps (source, operation);
-
-    return grl_operation_options_obey_caps (options, caps, NULL, NULL);
-  } else {
-    return TRUE;
+  if (brc->batch_callback) {
+    batch = g_ptr_array_new_with_free_func (g_object_unref);
   }
-}
 
-/* ============= API ============= */
+  /* Send the ready elements, until the time budget for this main loop
+     iteration is exhausted */
+  deadline = g_get_monotonic_time () + QUEUE_PROCESS_TIME_BUDGET;
+  do {
+    qelement = (QueueElement *) g_queue_pop_head (brc->queue);
+    remaining = qelement->remaining;
+    if (qelement->media) {
+      progressive_add_media (brc, qelement->media);
+      grl_operation_add_delivered (brc->operation_id, 1);
+    }
+    grl_metrics_record (brc->source, brc->operation_type,
+                        GRL_METRICS_KIND_QUEUE, qelement->queued,
+                        qelement->media? 1: 0, qelement->error != NULL);
+    if (batch) {
+      if (qelement->media) {
+        g_ptr_array_add (batch, qelement->media);
+      }
+      error = qelement->error;
+    } else {
+      brc->user_callback (brc->source, brc->operation_id, qelement->media,
+                          remaining, brc->user_data, qelement->error);
+      g_clear_error (&qelement->error);
+    }
+    g_free (qelement);
 
-/**
- * grl_source_supported_keys:
- * @source: a source
- *
- * Get a list of #GrlKeyID, which describe a metadata types that this
- * source can fetch and store.
- *
- * Returns: (element-type GrlKeyID) (transfer none): a #GList with the keys
- *
- * Since: 0.2.0
- */
-const GList *
-grl_source_supported_keys (GrlSource *source)
-{
-  g_return_val_if_fail (GRL_IS_SOURCE (source), NULL);
+    /* A batch is closed by an error, so it is delivered with it */
+    if (remaining == 0 || error ||
+        operation_is_cancelled (brc->operation_id)) {
+      break;
+    }
 
-  if (GRL_SOURCE_GET_CLASS (source)->supported_keys) {
-    return GRL_SOURCE_GET_CLASS (source)->supported_keys (source);
-  } else {
-    return NULL;
+    qelement = (QueueElement *) g_queue_peek_head (brc->queue);
+  } while (qelement && qelement->is_ready &&
+           g_get_monotonic_time () < deadline);
+
+  if (batch) {
+    brc->batch_callback (brc->source, brc->operation_id, batch,
+                         remaining, brc->user_data, error);
+    g_clear_error (&error);
   }
-}
 
-/**
- * grl_source_slow_keys:
- * @source: a source
- *
- * Similar to grl_source_supported_keys(), but these keys
- * are marked as slow because of the amount of traffic/processing needed
- * to fetch them.
- *
- * Returns: (element-type GrlKeyID) (transfer none): a #GList with the keys
- *
- * Since: 0.2.0
- */
-const GList *
-grl_source_slow_keys (GrlSource *source)
-{
-  g_return_val_if_fail (GRL_IS_SOURCE (source), NULL);
+  /* The operation is not finished until the elements are completed */
+  if (brc->progressive) {
+    operation_background_start (brc->operation_id);
+    grl_operation_idle_add (operation_priority (brc->options,
+                                                G_PRIORITY_LOW),
+                            progressive_idle,
+                            brc->progressive,
+                            NULL,
+                            "[grilo] progressive_idle");
+    brc->progressive = NULL;
+  }
 
-  if (GRL_SOURCE_GET_CLASS (source)->slow_keys) {
+  if (remaining == 0) {
+    /* Wait for the source to finish, if it was stopped by the deadline */
+    if (brc->deadline_closed && !operation_is_completed (brc->operation_id)) {
+      brc->user_done = TRUE;
+      brc->dispatcher_running = FALSE;
+      return FALSE;
+    }
+    operation_set_finished (brc->operation_id);
+    browse_relay_free (brc);
+    return FALSE;
+  }
+
+  /* Check if should keep running */
+  qelement = (QueueElement *) g_queue_peek_head (brc->queue);
+  brc->dispatcher_running = qelement && qelement->is_ready;
+
+  return brc->dispatcher_running;
+}
+
+static void
+queue_start_process (struct BrowseRelayCb *brc)
+{
+  QueueElement *qelement;
+
+  if (!brc->dispatcher_running) {
+    qelement = g_queue_peek_head (brc->queue);
+    if (qelement && qelement->is_ready) {
+      guint id = grl_operation_idle_add (operation_priority (brc->options,
+                                                             G_PRIORITY_DEFAULT_IDLE),
+                                         queue_process,
+                                         brc,
+                                         NULL,
+                                         "[grilo] queue_process");
+      brc->dispatcher_running = TRUE;
+    }
+  }
+}
+
+/* Returns TRUE if too many elements of the current chunk are still waiting to be
+   completed by other sources to ask for the next one */
+static gboolean
+auto_split_must_wait (struct BrowseRelayCb *brc)
+{
+  return brc->queue_pending &&
+    g_hash_table_size (brc->queue_pending) > brc->auto_split->threshold / 2 &&
+    !operation_is_cancelled (brc->operation_id);
+}
+
+static void
+media_ready_cb (GrlMedia *media,
+                gpointer user_data,
+                const GError *error)
+{
+  GList *element;
+  QueueElement *qelement;
+  struct BrowseRelayCb *brc = (struct BrowseRelayCb *) user_data;
+
+  /* Mark element as ready */
+  element = g_hash_table_lookup (brc->queue_pending, media);
+  if (!element) {
+    GRL_WARNING ("Media not found in the queue!");
+    return;
+  }
+  g_hash_table_remove (brc->queue_pending, media);
+
+  qelement = (QueueElement *) element->data;
+  qelement->is_ready = TRUE;
+
+  if (brc->auto_split &&
+      brc->auto_split->chunk_deferred &&
+      !brc->deadline_closed &&
+      !auto_split_must_wait (brc)) {
+    brc->auto_split->chunk_deferred = FALSE;
+    auto_split_run_next_chunk (brc);
+  }
+
+  queue_start_process (brc);
+}
+
+/* Sends the elements collected by queue_add_media() to be completed. Elements
+   missing the same keys are decorated together */
+static gboolean
+queue_decorate_idle (gpointer user_data)
+{
+  struct BrowseRelayCb *brc = (struct BrowseRelayCb *) user_data;
+  GPtrArray *pending;
+  GPtrArray *group_keys;
+  GPtrArray *group_medias;
+  GrlOperationOptions *options;
+  GrlResolutionFlags flags;
+  guint i, g;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  pending = brc->decorate_pending;
+  brc->decorate_pending = g_ptr_array_new ();
+  brc->decorate_id = 0;
+
+  if (operation_is_cancelled (brc->operation_id) ||
+      operation_is_deadline_exceeded (brc->operation_id)) {
+    /* Nothing to complete; just let the queue send or discard them */
+    for (i = 0; i < pending->len; i++) {
+      media_ready_cb (g_ptr_array_index (pending, i), brc, NULL);
+    }
+    g_ptr_array_unref (pending);
+    return G_SOURCE_REMOVE;
+  }
+
+  group_keys = g_ptr_array_new ();
+  group_medias = g_ptr_array_new_with_free_func ((GDestroyNotify) g_ptr_array_unref);
+
+  for (i = 0; i < pending->len; i++) {
+    GrlMedia *media = g_ptr_array_index (pending, i);
+    GList *unknown_keys = filter_known_keys (media, brc->keys);
+
+    for (g = 0; g < group_keys->len; g++) {
+      if (key_lists_same_set (unknown_keys, g_ptr_array_index (group_keys, g))) {
+        break;
+      }
+    }
+    if (g == group_keys->len) {
+      g_ptr_array_add (group_keys, unknown_keys);
+      g_ptr_array_add (group_medias, g_ptr_array_new ());
+    } else {
+      g_list_free (unknown_keys);
+    }
+    g_ptr_array_add (g_ptr_array_index (group_medias, g), media);
+  }
+
+  /* In progressive mode elements are sent once their fast keys are known */
+  flags = grl_operation_options_get_resolution_flags (brc->options);
+  if (flags & GRL_RESOLVE_PROGRESSIVE) {
+    options = grl_operation_options_copy (brc->options);
+    grl_operation_options_set_resolution_flags (options,
+                                                (flags & ~GRL_RESOLVE_PROGRESSIVE) |
+                                                GRL_RESOLVE_FAST_ONLY);
+  } else {
+    options = g_object_ref (brc->options);
+  }
+
+  for (g = 0; g < group_keys->len; g++) {
+    media_decorate_batch (brc->source, brc->operation_id,
+                          g_ptr_array_index (group_medias, g),
+                          g_ptr_array_index (group_keys, g),
+                          options, media_ready_cb, brc);
+    g_list_free (g_ptr_array_index (group_keys, g));
+  }
+
+  g_object_unref (options);
+  g_ptr_array_unref (group_keys);
+  g_ptr_array_unref (group_medias);
+  g_ptr_array_unref (pending);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+queue_add_media (struct BrowseRelayCb *brc,
+                 GrlMedia *media,
+                 guint remaining,
+                 const GError *error)
+{
+  QueueElement *qelement;
+  GList *unknown_keys = NULL;
+
+  if (!brc->queue) {
+    brc->queue = g_queue_new ();
+    /* Elements waiting for decoration, indexed by media, pointing to their
+       link in the queue */
+    brc->queue_pending = g_hash_table_new (g_direct_hash, g_direct_equal);
+    brc->decorate_pending = g_ptr_array_new ();
+  }
+
+  /* Add element */
+  qelement = g_new (QueueElement, 1);
+  qelement->media = media;
+  qelement->remaining = remaining;
+  qelement->queued = grl_metrics_start ();
+  /* Media is ready if we do not need to ask other sources to complete it */
+  qelement->is_ready = TRUE;
+  if (grl_operation_options_get_resolution_flags (brc->options) & GRL_RESOLVE_FULL) {
+    unknown_keys = filter_known_keys (media, brc->keys);
+    if (unknown_keys) {
+      qelement->is_ready = FALSE;
+    }
+  }
+  if (error) {
+    qelement->error = g_error_copy (error);
+  } else {
+    qelement->error = NULL;
+  }
+  g_queue_push_tail (brc->queue, qelement);
+
+  if (!qelement->is_ready) {
+    g_hash_table_insert (brc->queue_pending, media,
+                         g_queue_peek_tail_link (brc->queue));
+    /* Collect the elements the source sends in a row, so they can be
+       completed together */
+    g_ptr_array_add (brc->decorate_pending, media);
+    if (!brc->decorate_id) {
+      brc->decorate_id = grl_operation_idle_add (operation_priority (brc->options,
+                                                                     G_PRIORITY_HIGH_IDLE),
+                                                 queue_decorate_idle,
+                                                 brc,
+                                                 NULL,
+                                                 "[grilo] queue_decorate_idle");
+    }
+  }
+  g_list_free (unknown_keys);
+
+  queue_start_process (brc);
+}
+
+/* Sends what was collected so far, and stops the source and the decoration
+   of the pending elements */
+static gboolean
+browse_deadline_cb (gpointer user_data)
+{
+  struct BrowseRelayCb *brc = (struct BrowseRelayCb *) user_data;
+  struct OperationState *op_state;
+  QueueElement *qelement;
+  GError *error;
+
+  brc->deadline_id = 0;
+
+  op_state = grl_operation_get_private_data (brc->operation_id);
+  if (!op_state || op_state->cancelled) {
+    return G_SOURCE_REMOVE;
+  }
+
+  GRL_DEBUG ("%s: deadline exceeded for operation %u",
+             grl_source_get_id (brc->source), brc->operation_id);
+
+  op_state->deadline_exceeded = TRUE;
+  operation_stop (op_state);
+
+  error = g_error_new (GRL_CORE_ERROR,
+                       GRL_CORE_ERROR_DEADLINE_EXCEEDED,
+                       _("Operation did not finish before its deadline"));
+
+  if (operation_is_completed (brc->operation_id)) {
+    /* Only the decoration was pending; the last element tells about it */
+    qelement = g_queue_peek_tail (brc->queue);
+    if (qelement && !qelement->error) {
+      qelement->error = g_error_copy (error);
+    }
+  } else {
+    brc->deadline_closed = TRUE;
+    queue_add_media (brc, NULL, 0, error);
+  }
+
+  g_error_free (error);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+auto_split_timing_start (struct AutoSplitTiming *timing)
+{
+  timing->requested = g_get_monotonic_time ();
+  timing->first_item = 0;
+  timing->items = 0;
+}
+
+/*
+ * Adapts the auto-split threshold of @source to the chunk that has just been
+ * received. This is a hill climbing: the threshold keeps moving in the same
+ * direction while the throughput (items per second) improves, and turns back
+ * when it gets worse. The first direction is chosen depending on whether the
+ * time spent until the first item dominates the time spent per item.
+ */
+static void
+auto_split_adapt (GrlSource *source,
+                  struct AutoSplitTiming *timing,
+                  gint64 now)
+{
+  GrlSourcePrivate *priv = source->priv;
+  gdouble throughput;
+  gint64 latency;
+  gint64 transfer;
+  guint threshold;
+  guint min_threshold;
+
+  if (timing->items == 0) {
+    return;
+  }
+
+  g_mutex_lock (&priv->lock);
+  if (priv->auto_split_max_threshold == 0) {
+    g_mutex_unlock (&priv->lock);
+    return;
+  }
+
+  latency = timing->first_item - timing->requested;
+  transfer = now - timing->first_item;
+  throughput = (gdouble) timing->items * G_USEC_PER_SEC / MAX (now - timing->requested, 1);
+
+  if (priv->auto_split_throughput == 0) {
+    priv->auto_split_shrinking = latency < transfer;
+  } else if (throughput < priv->auto_split_throughput) {
+    priv->auto_split_shrinking = !priv->auto_split_shrinking;
+  }
+  priv->auto_split_throughput = throughput;
+
+  min_threshold = MAX (priv->auto_split_min_threshold, 1);
+  threshold = priv->auto_split_threshold;
+  if (priv->auto_split_shrinking) {
+    threshold = MAX (threshold * 2 / 3, min_threshold);
+  } else {
+    threshold = MIN (threshold + MAX (threshold / 2, 1),
+                     priv->auto_split_max_threshold);
+  }
+
+  /* Turn back when reaching a limit */
+  if (threshold == min_threshold ||
+      threshold == priv->auto_split_max_threshold) {
+    priv->auto_split_shrinking = !priv->auto_split_shrinking;
+  }
+
+  GRL_DEBUG ("auto-split: %u items in %" G_GINT64_FORMAT " usec "
+             "(first after %" G_GINT64_FORMAT " usec), %.1f items/s; "
+             "threshold %u -> %u",
+             timing->items, now - timing->requested, latency, throughput,
+             priv->auto_split_threshold, threshold);
+
+  priv->auto_split_threshold = threshold;
+  g_mutex_unlock (&priv->lock);
+}
+
+/* Accounts a result of a chunk coming from the source */
+static void
+auto_split_timing_update (GrlSource *source,
+                          struct AutoSplitTiming *timing,
+                          GrlMedia *media,
+                          guint remaining)
+{
+  gint64 now = g_get_monotonic_time ();
+
+  if (!timing->first_item) {
+    timing->first_item = now;
+  }
+  if (media) {
+    timing->items++;
+  }
+  if (remaining == 0) {
+    auto_split_adapt (source, timing, now);
+    timing->requested = 0;
+  }
+}
+
+static struct AutoSplitCtl *
+auto_split_setup (GrlSource *source,
+                  GrlSupportedOps operation,
+                  GrlOperationOptions *options)
+{
+  struct AutoSplitCtl *as_ctl = NULL;
+  gint count = grl_operation_options_get_count (options);
+
+  if (source->priv->auto_split_threshold > 0 &&
+      count > source->priv->auto_split_threshold) {
+    GRL_DEBUG ("auto-split: enabled");
+
+    as_ctl = g_slice_new (struct AutoSplitCtl);
+    as_ctl->threshold = source->priv->auto_split_threshold;
+    as_ctl->total_remaining = count;
+    as_ctl->chunk_remaining = as_ctl->threshold;
+    as_ctl->chunk_deferred = FALSE;
+    as_ctl->next_skip = grl_operation_options_get_skip (options) + as_ctl->threshold;
+    as_ctl->use_continuation =
+      grl_caps_get_continuation_supported (grl_source_get_caps (source, operation));
+    as_ctl->continuation = NULL;
+    as_ctl->to_request = count - as_ctl->threshold;
+    as_ctl->prefetch_depth = source->priv->auto_split_prefetch;
+    as_ctl->prefetched = g_queue_new ();
+    auto_split_timing_start (&as_ctl->timing);
+    count = as_ctl->chunk_remaining;
+    grl_operation_options_set_count (options, count);
+    GRL_DEBUG ("auto-split: requesting chunk (skip=%u, count=%u)",
+               grl_operation_options_get_skip (options),
+               count);
+  }
+
+  return as_ctl;
+}
+
+static void
+auto_split_chunk_free (struct AutoSplitChunk *chunk)
+{
+  QueueElement *qelement;
+
+  while ((qelement = g_queue_pop_head (chunk->results))) {
+    g_clear_object (&qelement->media);
+    g_clear_error (&qelement->error);
+    g_slice_free (QueueElement, qelement);
+  }
+  g_queue_free (chunk->results);
+
+  if (chunk->replay_id) {
+    grl_operation_source_remove (chunk->replay_id);
+  }
+
+  switch (chunk->operation_type) {
+  case GRL_OP_BROWSE:
+    g_object_unref (chunk->spec.browse->source);
+    g_object_unref (chunk->spec.browse->container);
+    g_object_unref (chunk->spec.browse->options);
+    g_free (chunk->spec.browse);
+    break;
+  case GRL_OP_SEARCH:
+    g_object_unref (chunk->spec.search->source);
+    g_object_unref (chunk->spec.search->options);
+    g_free (chunk->spec.search->text);
+    g_free (chunk->spec.search);
+    break;
+  case GRL_OP_QUERY:
+    g_object_unref (chunk->spec.query->source);
+    g_object_unref (chunk->spec.query->options);
+    g_free (chunk->spec.query->query);
+    g_free (chunk->spec.query);
+    break;
+  default:
+    g_assert_not_reached ();
+    break;
+  }
+
+  g_slice_free (struct AutoSplitChunk, chunk);
+}
+
+/* Sends the results the chunk got before becoming the live one */
+static gboolean
+auto_split_chunk_replay (gpointer user_data)
+{
+  struct AutoSplitChunk *chunk = (struct AutoSplitChunk *) user_data;
+  struct BrowseRelayCb *brc = chunk->brc;
+  QueueElement *qelement;
+  GrlMedia *media;
+  GError *error;
+  gint remaining;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  chunk->replay_id = 0;
+  chunk->replaying = TRUE;
+
+  while ((qelement = g_queue_pop_head (chunk->results))) {
+    media = qelement->media;
+    remaining = qelement->remaining;
+    error = qelement->error;
+    g_slice_free (QueueElement, qelement);
+
+    browse_result_relay_cb (brc->source, brc->operation_id,
+                            media, remaining, brc, error);
+    g_clear_error (&error);
+
+    /* After the last result brc might be gone */
+    if (remaining == 0) {
+      auto_split_chunk_free (chunk);
+      return FALSE;
+    }
+  }
+
+  chunk->replaying = FALSE;
+
+  return FALSE;
+}
+
+static void
+auto_split_chunk_cb (GrlSource *source,
+                     guint operation_id,
+                     GrlMedia *media,
+                     guint remaining,
+                     gpointer user_data,
+                     const GError *error)
+{
+  struct AutoSplitChunk *chunk = (struct AutoSplitChunk *) user_data;
+  struct BrowseRelayCb *brc = chunk->brc;
+  QueueElement *qelement;
+  gboolean cancelled;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  grl_metrics_call_result (operation_id, media? 1: 0, remaining == 0, error);
+
+  cancelled = operation_is_cancelled (operation_id);
+  if (brc && !cancelled) {
+    auto_split_timing_update (brc->source, &chunk->timing, media, remaining);
+  }
+  if (remaining == 0) {
+    chunk->done = TRUE;
+    operation_set_finished (operation_id);
+  }
+
+  /* The operation the chunk belongs to has already finished */
+  if (!brc) {
+    g_clear_object (&media);
+    if (chunk->done) {
+      auto_split_chunk_free (chunk);
+    }
+    return;
+  }
+
+  /* Cancellation is handled by the main operation; just make sure it gets the
+     last result */
+  if (cancelled || operation_is_cancelled (brc->operation_id)) {
+    g_clear_object (&media);
+    if (remaining > 0) {
+      return;
+    }
+  }
+
+  if (chunk->live && !chunk->replaying && g_queue_is_empty (chunk->results)) {
+    browse_result_relay_cb (brc->source, brc->operation_id,
+                            media, remaining, brc, error);
+    if (remaining == 0) {
+      auto_split_chunk_free (chunk);
+    }
+    return;
+  }
+
+  qelement = g_slice_new (QueueElement);
+  qelement->media = media;
+  qelement->is_ready = TRUE;
+  qelement->remaining = remaining;
+  qelement->error = error? g_error_copy (error): NULL;
+  qelement->queued = 0;
+  g_queue_push_tail (chunk->results, qelement);
+}
+
+/* Requests in advance the following chunks, up to the prefetch depth */
+static void
+auto_split_prefetch (struct BrowseRelayCb *brc)
+{
+  struct AutoSplitCtl *as_ctl = brc->auto_split;
+  struct AutoSplitChunk *chunk;
+  GrlSourceBrowseSpec *bs;
+  GrlSourceSearchSpec *ss;
+  GrlSourceQuerySpec *qs;
+  GrlOperationOptions *options;
+  gint priority;
+
+  priority =
+    operation_relay_priority (brc->options);
+
+  while (as_ctl->to_request > 0 &&
+         g_queue_get_length (as_ctl->prefetched) < as_ctl->prefetch_depth &&
+         !operation_is_cancelled (brc->operation_id)) {
+    as_ctl->threshold = brc->source->priv->auto_split_threshold;
+    chunk = g_slice_new0 (struct AutoSplitChunk);
+    chunk->brc = brc;
+    chunk->operation_type = brc->operation_type;
+    chunk->operation_id = grl_operation_generate_id ();
+    chunk->count = MIN (as_ctl->threshold, as_ctl->to_request);
+    chunk->results = g_queue_new ();
+
+    GRL_DEBUG ("auto-split: prefetching chunk (skip=%u, count=%u)",
+               as_ctl->next_skip, chunk->count);
+
+    switch (brc->operation_type) {
+    case GRL_OP_BROWSE:
+      options = grl_operation_options_copy (brc->spec.browse->options);
+      bs = g_new (GrlSourceBrowseSpec, 1);
+      bs->source = g_object_ref (brc->source);
+      bs->operation_id = chunk->operation_id;
+      bs->container = g_object_ref (brc->spec.browse->container);
+      bs->keys = brc->keys;
+      bs->options = options;
+      bs->callback = auto_split_chunk_cb;
+      bs->user_data = chunk;
+      chunk->spec.browse = bs;
+      break;
+    case GRL_OP_SEARCH:
+      options = grl_operation_options_copy (brc->spec.search->options);
+      ss = g_new (GrlSourceSearchSpec, 1);
+      ss->source = g_object_ref (brc->source);
+      ss->operation_id = chunk->operation_id;
+      ss->text = g_strdup (brc->spec.search->text);
+      ss->keys = brc->keys;
+      ss->options = options;
+      ss->callback = auto_split_chunk_cb;
+      ss->user_data = chunk;
+      chunk->spec.search = ss;
+      break;
+    case GRL_OP_QUERY:
+      options = grl_operation_options_copy (brc->spec.query->options);
+      qs = g_new (GrlSourceQuerySpec, 1);
+      qs->source = g_object_ref (brc->source);
+      qs->operation_id = chunk->operation_id;
+      qs->query = g_strdup (brc->spec.query->query);
+      qs->keys = brc->keys;
+      qs->options = options;
+      qs->callback = auto_split_chunk_cb;
+      qs->user_data = chunk;
+      chunk->spec.query = qs;
+      break;
+    default:
+      g_assert_not_reached ();
+      break;
+    }
+
+    grl_operation_options_set_skip (options, as_ctl->next_skip);
+    grl_operation_options_set_count (options, chunk->count);
+    as_ctl->next_skip += chunk->count;
+    as_ctl->to_request -= chunk->count;
+
+    operation_set_ongoing (brc->source, chunk->operation_id, brc->operation_type);
+    operation_link (brc->operation_id, chunk->operation_id);
+    auto_split_timing_start (&chunk->timing);
+    g_queue_push_tail (as_ctl->prefetched, chunk);
+
+    switch (brc->operation_type) {
+    case GRL_OP_BROWSE:
+      grl_operation_idle_add (priority, browse_idle, chunk->spec.browse, NULL,
+                              "[grilo] browse_idle");
+      break;
+    case GRL_OP_SEARCH:
+      grl_operation_idle_add (priority, search_idle, chunk->spec.search, NULL,
+                              "[grilo] search_idle");
+      break;
+    default:
+      grl_operation_idle_add (priority, query_idle, chunk->spec.query, NULL,
+                              "[grilo] query_idle");
+      break;
+    }
+  }
+}
+
+static void
+auto_split_free (struct AutoSplitCtl *as_ctl)
+{
+  struct AutoSplitChunk *chunk;
+  QueueElement *qelement;
+
+  /* Chunks that were not needed in the end; those still running will be
+     freed when they send their last result */
+  while ((chunk = g_queue_pop_head (as_ctl->prefetched))) {
+    chunk->brc = NULL;
+    while ((qelement = g_queue_pop_head (chunk->results))) {
+      g_clear_object (&qelement->media);
+      g_clear_error (&qelement->error);
+      g_slice_free (QueueElement, qelement);
+    }
+    if (chunk->done) {
+      auto_split_chunk_free (chunk);
+    } else if (operation_is_ongoing (chunk->operation_id)) {
+      grl_operation_cancel (chunk->operation_id);
+    }
+  }
+  g_queue_free (as_ctl->prefetched);
+  g_free (as_ctl->continuation);
+
+  g_slice_free (struct AutoSplitCtl, as_ctl);
+}
+
+static void
+auto_split_run_next_chunk (struct BrowseRelayCb *brc)
+{
+  struct AutoSplitCtl *as_ctl = brc->auto_split;
+  struct AutoSplitChunk *chunk;
+  GrlOperationOptions *options;
+  GSourceFunc idle_func;
+  const gchar *idle_name;
+  gpointer spec;
+  guint skip;
+
+  /* If the chunk was already requested, just start sending its results */
+  chunk = g_queue_pop_head (as_ctl->prefetched);
+  if (chunk) {
+    GRL_DEBUG ("auto-split: using prefetched chunk (%u results received)",
+               g_queue_get_length (chunk->results));
+    /* Prefetched chunks are requested by skip */
+    g_clear_pointer (&as_ctl->continuation, g_free);
+    as_ctl->chunk_remaining = chunk->count;
+    /* The chunk keeps its own timing */
+    as_ctl->timing.requested = 0;
+    chunk->live = TRUE;
+    if (!g_queue_is_empty (chunk->results)) {
+      chunk->replay_id =
+        grl_operation_idle_add (operation_relay_priority (brc->options),
+                                auto_split_chunk_replay,
+                                chunk,
+                                NULL,
+                                "[grilo] auto_split_chunk_replay");
+    }
+    auto_split_prefetch (brc);
+    return;
+  }
+
+  switch (brc->operation_type) {
+  case GRL_OP_BROWSE:
+    options = brc->spec.browse->options;
+    idle_func = browse_idle;
+    idle_name = "[grilo] browse_idle";
+    spec = brc->spec.browse;
+    break;
+  case GRL_OP_SEARCH:
+    options = brc->spec.search->options;
+    idle_func = search_idle;
+    idle_name = "[grilo] search_idle";
+    spec = brc->spec.search;
+    break;
+  case GRL_OP_QUERY:
+    options = brc->spec.query->options;
+    idle_func = query_idle;
+    idle_name = "[grilo] query_idle";
+    spec = brc->spec.query;
+    break;
+  default:
+    g_assert_not_reached ();
+    return;
+  }
+
+  as_ctl->threshold = brc->source->priv->auto_split_threshold;
+  as_ctl->chunk_remaining = MIN (as_ctl->threshold, as_ctl->total_remaining);
+  auto_split_timing_start (&as_ctl->timing);
+
+  /* Resume after the last element if the source told how to; the skip of the
+     following chunks is then counted from there */
+  if (as_ctl->continuation) {
+    grl_operation_options_set_continuation (options, as_ctl->continuation);
+    g_clear_pointer (&as_ctl->continuation, g_free);
+    as_ctl->next_skip = 0;
+  }
+  skip = as_ctl->next_skip;
+  as_ctl->next_skip += as_ctl->chunk_remaining;
+  as_ctl->to_request -= MIN (as_ctl->to_request, as_ctl->chunk_remaining);
+
+  grl_operation_options_set_skip (options, skip);
+  grl_operation_options_set_count (options, as_ctl->chunk_remaining);
+  GRL_DEBUG ("auto-split: requesting chunk (skip=%u, count=%u%s)",
+             skip, as_ctl->chunk_remaining,
+             grl_operation_options_get_continuation (options) ?
+             ", continued" : "");
+  grl_operation_idle_add (operation_relay_priority (brc->options),
+                          idle_func,
+                          spec,
+                          NULL,
+                          idle_name);
+}
+
+static void
+warn_if_no_id (GrlMedia *media,
+               GrlSource *source)
+{
+  const char *id;
+
+  if (media == NULL || !grl_media_is_container (media))
+    return;
+
+  id = grl_media_get_id (media);
+  if (id == NULL || *id == '\0')
+    GRL_WARNING ("Media container is not browsable, has no ID: %s (source: %s)",
+                 grl_media_get_title (media),
+                 grl_source_get_id (source));
+}
+
+static void
+browse_result_relay_cb (GrlSource *source,
+                        guint operation_id,
+                        GrlMedia *media,
+                        guint remaining,
+                        gpointer user_data,
+                        const GError *error)
+{
+  struct BrowseRelayCb *brc = (struct BrowseRelayCb *) user_data;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  if (relay_redirect (source, operation_id, media, remaining, user_data, error,
+                      browse_result_relay_cb, NULL)) {
+    return;
+  }
+
+  grl_metrics_call_result (operation_id, media? 1: 0, remaining == 0, error);
+
+  /* Ignore elements after operation has completed */
+  if (operation_is_completed (operation_id)) {
+    GRL_WARNING ("Source '%s' emitted 'remaining=0' more than once "
+                 "for operation %d",
+                 grl_source_get_id (source), operation_id);
+    g_clear_object (&media);
+    return;
+  }
+
+  /* The user already got the elements collected before the deadline */
+  if (brc->deadline_closed) {
+    g_clear_object (&media);
+    if (remaining > 0) {
+      return;
+    }
+    browse_relay_spec_free (brc);
+    if (brc->user_done) {
+      operation_set_finished (operation_id);
+      browse_relay_free (brc);
+    } else {
+      operation_set_completed (operation_id);
+    }
+    return;
+  }
+
+  /* Check if cancelled */
+  if (operation_is_cancelled (operation_id)) {
+    GRL_DEBUG ("Operation is cancelled, skipping result until getting the last one");
+    g_clear_object (&media);
+    /* Wait for the last element */
+    if (remaining > 0) {
+      return;
+    } else {
+      browse_relay_send_cancelled (brc);
+      goto free_resources;
+    }
+  }
+
+  /* Auto-split management */
+  if (brc->auto_split) {
+    /* Results of prefetched chunks were already accounted when received */
+    if (brc->auto_split->timing.requested) {
+      auto_split_timing_update (source, &brc->auto_split->timing,
+                                media, remaining);
+    }
+    if (media && brc->auto_split->use_continuation) {
+      g_free (brc->auto_split->continuation);
+      brc->auto_split->continuation =
+        g_strdup (grl_media_get_continuation (media));
+    }
+    brc->auto_split->chunk_remaining--;
+    brc->auto_split->total_remaining--;
+    /* On last element, check if more elements should be asked: if source
+       satisfied all requested elements, but we need to get more */
+    if (remaining == 0) {
+      if (brc->auto_split->chunk_remaining == 0 &&
+          brc->auto_split->total_remaining > 0) {
+        if (auto_split_must_wait (brc)) {
+          GRL_DEBUG ("auto-split: deferring chunk, %u elements being completed",
+                     g_hash_table_size (brc->queue_pending));
+          brc->auto_split->chunk_deferred = TRUE;
+        } else {
+          auto_split_run_next_chunk (brc);
+        }
+        remaining = brc->auto_split->total_remaining;
+      }
+    } else {
+      remaining = brc->auto_split->total_remaining;
+    }
+  }
+
+  /* Set the source */
+  if (media && !grl_media_get_source (media)) {
+    grl_media_set_source (media, grl_source_get_id (source));
+  }
+
+  /* If we need further processing of media, or results are delivered in
+     batches, put it in a queue */
+  if (brc->batch_callback ||
+      grl_operation_options_get_resolution_flags (brc->options) &
+      (GRL_RESOLVE_FULL | GRL_RESOLVE_IDLE_RELAY)) {
+    queue_add_media (brc, media, remaining, error);
+  } else {
+    warn_if_no_id (media, source);
+    if (media) {
+      grl_operation_add_delivered (brc->operation_id, 1);
+    }
+    brc->user_callback (source, operation_id, media, remaining,
+                        brc->user_data, error);
+  }
+
+  if (remaining == 0) {
+  free_resources:
+    browse_relay_spec_free (brc);
+    if (!brc->queue || g_queue_is_empty (brc->queue)) {
+      operation_set_finished (operation_id);
+      browse_relay_free (brc);
+    } else {
+      /* There are elements pending to be processed; let's wait to free it in
+         the queue */
+      operation_set_completed (operation_id);
+    }
+  }
+}
+
+static void
+remove_result_relay_cb (GrlSource *source,
+                        GrlMedia *media,
+                        gpointer user_data,
+                        const GError *error)
+{
+  struct RemoveRelayCb *rrc = (struct RemoveRelayCb *) user_data;
+
+  grl_metrics_record (source, GRL_OP_REMOVE, GRL_METRICS_KIND_CALL,
+                      rrc->started, 0, error != NULL);
+
+  if (!error && grl_media_get_id (media)) {
+    grl_resolve_cache_invalidate (grl_media_get_source (media),
+                                  grl_media_get_id (media));
+  }
+
+  rrc->user_callback (source, media, rrc->user_data, error);
+  remove_relay_free (rrc);
+}
+
+/* ================ Threaded operations ================ */
+
+/* Operations that sources declare as thread-safe are run in a shared pool of
+   threads. The plugin gets a copy of the spec whose callback queues the
+   results in the main context of the thread that started the operation,
+   where they are relayed to the original callback. */
+
+#define THREADED_OPERATIONS (GRL_OP_RESOLVE | GRL_OP_BROWSE | GRL_OP_SEARCH | \
+                             GRL_OP_QUERY | GRL_OP_MEDIA_FROM_URI)
+
+struct ThreadedCall {
+  GrlSource *source;
+  GrlSupportedOps operation;
+  guint operation_id;
+  GMainContext *context;
+  GrlMedia *media;
+  gpointer callback;
+  gpointer user_data;
+  gint priority;
+  union {
+    GrlSourceResolveSpec resolve;
+    GrlSourceMediaFromUriSpec media_from_uri;
+    GrlSourceBrowseSpec browse;
+    GrlSourceSearchSpec search;
+    GrlSourceQuerySpec query;
+  } spec;
+};
+
+struct ThreadedResult {
+  struct ThreadedCall *tc;
+  guint operation_id;
+  GrlMedia *media;
+  guint remaining;
+  GError *error;
+};
+
+G_LOCK_DEFINE_STATIC (thread_pool);
+static GThreadPool *thread_pool = NULL;
+
+static void
+threaded_call_free (struct ThreadedCall *tc)
+{
+  g_object_unref (tc->source);
+  g_main_context_unref (tc->context);
+  if (tc->media) {
+    /* The copy given to the source */
+    g_object_unref (tc->spec.resolve.media);
+    g_object_unref (tc->media);
+  }
+  g_slice_free (struct ThreadedCall, tc);
+}
+
+/*
+ * Adds to @media the keys in @update it does not have yet. The values of the
+ * keys in @replace, those asked to the source, are replaced instead, as the
+ * source may have updated them.
+ */
+static void
+media_merge (GrlMedia *media,
+             GrlMedia *update,
+             const GList *replace)
+{
+  GrlKeySet *merged;
+  GList *keys, *each_key, *related, *each_related;
+  GrlRelatedKeys *relkeys;
+  GrlKeyID key;
+  guint i, length;
+
+  merged = grl_key_set_new ();
+  keys = grl_data_get_keys (GRL_DATA (update));
+  for (each_key = keys; each_key; each_key = g_list_next (each_key)) {
+    key = GRLPOINTER_TO_KEYID (each_key->data);
+    if (grl_key_set_contains (merged, key)) {
+      continue;
+    }
+
+    if (g_list_find ((GList *) replace, each_key->data)) {
+      /* Along with the keys related to them */
+      while (grl_data_length (GRL_DATA (media), key) > 0) {
+        grl_data_remove_nth (GRL_DATA (media), key, 0);
+      }
+    } else if (grl_data_has_key (GRL_DATA (media), key)) {
+      continue;
+    }
+
+    length = grl_data_length (GRL_DATA (update), key);
+    for (i = 0; i < length; i++) {
+      relkeys = grl_data_get_related_keys (GRL_DATA (update), key, i);
+      /* Related keys are copied together */
+      related = grl_related_keys_get_keys (relkeys);
+      for (each_related = related; each_related; each_related = g_list_next (each_related)) {
+        grl_key_set_add (merged, GRLPOINTER_TO_KEYID (each_related->data));
+      }
+      g_list_free (related);
+      grl_data_add_related_keys (GRL_DATA (media),
+                                 grl_related_keys_dup (relkeys));
+    }
+  }
+
+  g_list_free (keys);
+  grl_key_set_unref (merged);
+}
+
+/* Copies @media along with all its keys */
+static GrlMedia *
+media_copy (GrlMedia *media)
+{
+  GrlMedia *copy;
+
+  copy = g_object_new (G_OBJECT_TYPE (media),
+                       "media-type", grl_media_get_media_type (media),
+                       NULL);
+  media_merge (copy, media, NULL);
+
+  return copy;
+}
+
+static gboolean
+threaded_result_dispatch (gpointer user_data)
+{
+  struct ThreadedResult *tr = (struct ThreadedResult *) user_data;
+  struct ThreadedCall *tc = tr->tc;
+  gboolean last = TRUE;
+
+  switch (tc->operation) {
+  case GRL_OP_RESOLVE:
+    /* Bring the keys found by the source to the actual media */
+    if (tr->media) {
+      media_merge (tc->media, tr->media, tc->spec.resolve.keys);
+    }
+    ((GrlSourceResolveCb) tc->callback) (tc->source, tr->operation_id,
+                                         tc->media, tc->user_data,
+                                         tr->error);
+    break;
+  case GRL_OP_MEDIA_FROM_URI:
+    ((GrlSourceResolveCb) tc->callback) (tc->source, tr->operation_id,
+                                         tr->media, tc->user_data,
+                                         tr->error);
+    break;
+  default:
+    ((GrlSourceResultCb) tc->callback) (tc->source, tr->operation_id,
+                                        tr->media, tr->remaining,
+                                        tc->user_data, tr->error);
+    last = (tr->remaining == 0);
+    break;
+  }
+
+  if (last) {
+    threaded_call_free (tc);
+  }
+
+  g_clear_object (&tr->media);
+  g_clear_error (&tr->error);
+  g_slice_free (struct ThreadedResult, tr);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Runs in the plugin thread */
+static void
+threaded_result_queue (struct ThreadedCall *tc,
+                       guint operation_id,
+                       GrlMedia *media,
+                       guint remaining,
+                       const GError *error)
+{
+  struct ThreadedResult *tr;
+
+  tr = g_slice_new (struct ThreadedResult);
+  tr->tc = tc;
+  tr->operation_id = operation_id;
+  /* Keep the media alive until it is delivered, whoever owns it */
+  tr->media = media? g_object_ref (media): NULL;
+  tr->remaining = remaining;
+  tr->error = error? g_error_copy (error): NULL;
+
+  g_main_context_invoke_full (tc->context,
+                              tc->priority,
+                              threaded_result_dispatch,
+                              tr,
+                              NULL);
+}
+
+static void
+threaded_resolve_cb (GrlSource *source,
+                     guint operation_id,
+                     GrlMedia *media,
+                     gpointer user_data,
+                     const GError *error)
+{
+  threaded_result_queue (user_data, operation_id, media, 0, error);
+}
+
+static void
+threaded_result_cb (GrlSource *source,
+                    guint operation_id,
+                    GrlMedia *media,
+                    guint remaining,
+                    gpointer user_data,
+                    const GError *error)
+{
+  threaded_result_queue (user_data, operation_id, media, remaining, error);
+}
+
+/* Runs the calls of the most urgent operations first */
+static gint
+threaded_call_compare (gconstpointer a,
+                       gconstpointer b,
+                       gpointer user_data)
+{
+  const struct ThreadedCall *tc_a = a;
+  const struct ThreadedCall *tc_b = b;
+
+  return tc_a->priority - tc_b->priority;
+}
+
+static void
+threaded_call_run (gpointer data,
+                   gpointer pool_data)
+{
+  struct ThreadedCall *tc = (struct ThreadedCall *) data;
+  GrlSourceClass *klass = GRL_SOURCE_GET_CLASS (tc->source);
+
+  /* Abort if operation was cancelled while waiting for a thread */
+  if (operation_is_cancelled (tc->operation_id)) {
+    switch (tc->operation) {
+    case GRL_OP_RESOLVE:
+      threaded_resolve_cb (tc->source, tc->operation_id,
+                           tc->spec.resolve.media, tc, NULL);
+      break;
+    case GRL_OP_MEDIA_FROM_URI:
+      threaded_resolve_cb (tc->source, tc->operation_id, NULL, tc, NULL);
+      break;
+    default:
+      threaded_result_cb (tc->source, tc->operation_id, NULL, 0, tc, NULL);
+      break;
+    }
+    return;
+  }
+
+  switch (tc->operation) {
+  case GRL_OP_RESOLVE:
+    klass->resolve (tc->source, &tc->spec.resolve);
+    break;
+  case GRL_OP_MEDIA_FROM_URI:
+    klass->media_from_uri (tc->source, &tc->spec.media_from_uri);
+    break;
+  case GRL_OP_BROWSE:
+    klass->browse (tc->source, &tc->spec.browse);
+    break;
+  case GRL_OP_SEARCH:
+    klass->search (tc->source, &tc->spec.search);
+    break;
+  case GRL_OP_QUERY:
+    klass->query (tc->source, &tc->spec.query);
+    break;
+  default:
+    g_assert_not_reached ();
+  }
+}
+
+/*
+ * Runs @operation of @source with @spec, either directly or in the thread
+ * pool if @source declared it thread-safe.
+ */
+static void
+source_run_operation (GrlSource *source,
+                      GrlSupportedOps operation,
+                      gpointer spec)
+{
+  GrlSourceClass *klass = GRL_SOURCE_GET_CLASS (source);
+  GrlOperationOptions *options = NULL;
+  struct ThreadedCall *tc;
+  guint operation_id;
+
+  switch (operation) {
+  case GRL_OP_RESOLVE:
+    operation_id = ((GrlSourceResolveSpec *) spec)->operation_id;
+    break;
+  case GRL_OP_MEDIA_FROM_URI:
+    operation_id = ((GrlSourceMediaFromUriSpec *) spec)->operation_id;
+    break;
+  case GRL_OP_BROWSE:
+    operation_id = ((GrlSourceBrowseSpec *) spec)->operation_id;
+    break;
+  case GRL_OP_SEARCH:
+    operation_id = ((GrlSourceSearchSpec *) spec)->operation_id;
+    break;
+  case GRL_OP_QUERY:
+    operation_id = ((GrlSourceQuerySpec *) spec)->operation_id;
+    break;
+  default:
+    g_assert_not_reached ();
+  }
+
+  if (grl_metrics_get_enabled ()) {
+    grl_metrics_call_start (source, operation, operation_id);
+  }
+
+  if (!(source->priv->thread_safe_operations & operation)) {
+    switch (operation) {
+    case GRL_OP_RESOLVE:
+      klass->resolve (source, spec);
+      break;
+    case GRL_OP_MEDIA_FROM_URI:
+      klass->media_from_uri (source, spec);
+      break;
+    case GRL_OP_BROWSE:
+      klass->browse (source, spec);
+      break;
+    case GRL_OP_SEARCH:
+      klass->search (source, spec);
+      break;
+    case GRL_OP_QUERY:
+      klass->query (source, spec);
+      break;
+    default:
+      g_assert_not_reached ();
+    }
+    return;
+  }
+
+  tc = g_slice_new (struct ThreadedCall);
+  tc->source = g_object_ref (source);
+  tc->operation = operation;
+  tc->operation_id = operation_id;
+  tc->context = g_main_context_ref_thread_default ();
+  tc->media = NULL;
+
+  switch (operation) {
+  case GRL_OP_RESOLVE:
+    tc->spec.resolve = *(GrlSourceResolveSpec *) spec;
+    options = tc->spec.resolve.options;
+    /* Other sources might be completing the same media meanwhile in this
+       thread, so the source works on its own copy */
+    tc->media = g_object_ref (tc->spec.resolve.media);
+    tc->spec.resolve.media = media_copy (tc->media);
+    tc->callback = tc->spec.resolve.callback;
+    tc->user_data = tc->spec.resolve.user_data;
+    tc->spec.resolve.callback = threaded_resolve_cb;
+    tc->spec.resolve.user_data = tc;
+    break;
+  case GRL_OP_MEDIA_FROM_URI:
+    tc->spec.media_from_uri = *(GrlSourceMediaFromUriSpec *) spec;
+    options = tc->spec.media_from_uri.options;
+    tc->callback = tc->spec.media_from_uri.callback;
+    tc->user_data = tc->spec.media_from_uri.user_data;
+    tc->spec.media_from_uri.callback = threaded_resolve_cb;
+    tc->spec.media_from_uri.user_data = tc;
+    break;
+  case GRL_OP_BROWSE:
+    tc->spec.browse = *(GrlSourceBrowseSpec *) spec;
+    options = tc->spec.browse.options;
+    tc->callback = tc->spec.browse.callback;
+    tc->user_data = tc->spec.browse.user_data;
+    tc->spec.browse.callback = threaded_result_cb;
+    tc->spec.browse.user_data = tc;
+    break;
+  case GRL_OP_SEARCH:
+    tc->spec.search = *(GrlSourceSearchSpec *) spec;
+    options = tc->spec.search.options;
+    tc->callback = tc->spec.search.callback;
+    tc->user_data = tc->spec.search.user_data;
+    tc->spec.search.callback = threaded_result_cb;
+    tc->spec.search.user_data = tc;
+    break;
+  case GRL_OP_QUERY:
+    tc->spec.query = *(GrlSourceQuerySpec *) spec;
+    options = tc->spec.query.options;
+    tc->callback = tc->spec.query.callback;
+    tc->user_data = tc->spec.query.user_data;
+    tc->spec.query.callback = threaded_result_cb;
+    tc->spec.query.user_data = tc;
+    break;
+  default:
+    g_assert_not_reached ();
+  }
+
+  tc->priority = operation_priority (options, G_PRIORITY_HIGH_IDLE);
+
+  GRL_DEBUG ("%s: running operation in a thread", grl_source_get_id (source));
+
+  G_LOCK (thread_pool);
+  if (!thread_pool) {
+    thread_pool = g_thread_pool_new (threaded_call_run,
+                                     NULL,
+                                     g_get_num_processors (),
+                                     FALSE,
+                                     NULL);
+    g_thread_pool_set_sort_function (thread_pool, threaded_call_compare, NULL);
+  }
+  g_thread_pool_push (thread_pool, tc, NULL);
+  G_UNLOCK (thread_pool);
+}
+
+/*
+ * grl_source_threads_shutdown:
+ *
+ * Runs the calls still waiting for a thread and frees the pool, once all of
+ * them have returned. Their results are still sent to the main contexts
+ * that started them.
+ */
+void
+grl_source_threads_shutdown (void)
+{
+  GThreadPool *pool;
+
+  G_LOCK (thread_pool);
+  pool = g_steal_pointer (&thread_pool);
+  G_UNLOCK (thread_pool);
+
+  if (pool) {
+    g_thread_pool_free (pool, FALSE, TRUE);
+  }
+}
+
+/* Requests are only joined by others running in the same main context, so
+   only the table is shared between threads */
+G_LOCK_DEFINE_STATIC (resolve_flights);
+static GHashTable *resolve_flights = NULL;
+
+static gint
+compare_key_ids (gconstpointer a,
+                 gconstpointer b)
+{
+  GrlKeyID key_a = GRLPOINTER_TO_KEYID (a);
+  GrlKeyID key_b = GRLPOINTER_TO_KEYID (b);
+
+  return (key_a > key_b) - (key_a < key_b);
+}
+
+/* Identifies the requests from @context that would get the same answer from
+   the source, or returns NULL if the media can not be told apart from others */
+static gchar *
+resolve_flight_key_new (GrlSourceResolveSpec *rs,
+                        GMainContext *context)
+{
+  const gchar *media_id;
+  const gchar *media_source;
+  GString *key;
+  GList *keys, *each_key;
+
+  media_id = grl_media_get_id (rs->media);
+  if (!media_id) {
+    return NULL;
+  }
+  media_source = grl_media_get_source (rs->media);
+
+  key = g_string_new (grl_source_get_id (rs->source));
+  g_string_append_printf (key, "\x1f%p\x1f%s\x1f%s\x1f%u\x1f",
+                          context,
+                          media_source ? media_source : "",
+                          media_id,
+                          (guint) grl_operation_options_get_resolution_flags (rs->options));
+
+  keys = g_list_sort (g_list_copy (rs->keys), compare_key_ids);
+  for (each_key = keys; each_key; each_key = g_list_next (each_key)) {
+    g_string_append_printf (key, "%u,", GRLPOINTER_TO_KEYID (each_key->data));
+  }
+  g_list_free (keys);
+
+  return g_string_free (key, FALSE);
+}
+
+/* Makes the flight not to be joined by new requests */
+static void
+resolve_flight_unpublish (struct ResolveFlight *flight)
+{
+  if (flight->key) {
+    G_LOCK (resolve_flights);
+    g_hash_table_remove (resolve_flights, flight->key);
+    G_UNLOCK (resolve_flights);
+    g_clear_pointer (&flight->key, g_free);
+  }
+}
+
+static void
+resolve_flight_cb (GrlSource *source,
+                   guint operation_id,
+                   GrlMedia *media,
+                   gpointer user_data,
+                   const GError *error)
+{
+  struct ResolveFlight *flight = (struct ResolveFlight *) user_data;
+  struct OperationState *op_state;
+  GrlSourceResolveSpec *rs;
+  GList *waiters, *each_waiter;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  grl_metrics_call_result (flight->spec->operation_id, media? 1: 0, TRUE, error);
+
+  resolve_flight_unpublish (flight);
+  operation_set_finished (flight->spec->operation_id);
+
+  waiters = flight->waiters;
+  flight->waiters = NULL;
+  for (each_waiter = waiters; each_waiter; each_waiter = g_list_next (each_waiter)) {
+    rs = (GrlSourceResolveSpec *) each_waiter->data;
+    op_state = grl_operation_get_private_data (rs->operation_id);
+    if (op_state) {
+      op_state->flight = NULL;
+    }
+    /* The source worked on a media of its own */
+    if (media) {
+      media_merge (rs->media, media, flight->spec->keys);
+    }
+    rs->callback (rs->source, rs->operation_id, rs->media, rs->user_data, error);
+  }
+  g_list_free (waiters);
+
+  resolve_spec_free (flight->spec);
+  g_main_context_unref (flight->context);
+  g_slice_free (struct ResolveFlight, flight);
+}
+
+static gboolean
+resolve_flight_left_idle (gpointer user_data)
+{
+  GrlSourceResolveSpec *rs = (GrlSourceResolveSpec *) user_data;
+
+  rs->callback (rs->source, rs->operation_id, rs->media, rs->user_data, NULL);
+
+  return G_SOURCE_REMOVE;
+}
+
+/*
+ * Answers the cancelled request @operation_id, and cancels the request sent
+ * to the source if nobody else is waiting for it.
+ */
+static void
+resolve_flight_leave (struct ResolveFlight *flight,
+                      guint operation_id)
+{
+  GrlSourceResolveSpec *rs;
+  GList *each_waiter;
+
+  for (each_waiter = flight->waiters; each_waiter; each_waiter = g_list_next (each_waiter)) {
+    rs = (GrlSourceResolveSpec *) each_waiter->data;
+    if (rs->operation_id == operation_id) {
+      flight->waiters = g_list_delete_link (flight->waiters, each_waiter);
+      grl_operation_idle_add (operation_relay_priority (rs->options),
+                              resolve_flight_left_idle,
+                              rs,
+                              NULL,
+                              "[grilo] resolve_flight_left_idle");
+      break;
+    }
+  }
+
+  if (!flight->waiters) {
+    resolve_flight_unpublish (flight);
+    if (!flight->batch) {
+      grl_operation_cancel (flight->spec->operation_id);
+    } else if (--flight->batch->waited == 0) {
+      grl_operation_cancel (flight->batch->spec->operation_id);
+    }
+  }
+}
+
+/*
+ * Makes @rs wait for the identical request in @key if it is already running,
+ * or for a new one otherwise, in which case @start is set and the request
+ * must be sent to the source. Takes @key, which can be NULL if the request
+ * can not be shared, and @context.
+ */
+static struct ResolveFlight *
+resolve_flight_join (GrlSourceResolveSpec *rs,
+                     gchar *key,
+                     GMainContext *context,
+                     gboolean *start)
+{
+  struct ResolveFlight *flight = NULL;
+  struct OperationState *op_state;
+  GrlSourceResolveSpec *spec;
+
+  *start = FALSE;
+
+  G_LOCK (resolve_flights);
+  if (!resolve_flights) {
+    resolve_flights = g_hash_table_new (g_str_hash, g_str_equal);
+  }
+
+  if (key) {
+    flight = g_hash_table_lookup (resolve_flights, key);
+  }
+  if (flight) {
+    GRL_DEBUG ("resolve: joining running request to '%s'",
+               grl_source_get_id (rs->source));
+    g_main_context_unref (context);
+    g_free (key);
+  } else {
+    spec = g_new0 (GrlSourceResolveSpec, 1);
+    spec->source = g_object_ref (rs->source);
+    spec->operation_id = grl_operation_generate_id ();
+    /* Requests can leave before the source answers, so none of their medias
+       is given to it */
+    spec->media = media_copy (rs->media);
+    spec->keys = g_list_copy (rs->keys);
+    spec->options = g_object_ref (rs->options);
+    spec->callback = resolve_flight_cb;
+
+    flight = g_slice_new0 (struct ResolveFlight);
+    flight->key = key;
+    flight->context = context;
+    flight->spec = spec;
+    spec->user_data = flight;
+    if (key) {
+      g_hash_table_insert (resolve_flights, flight->key, flight);
+    }
+    *start = TRUE;
+  }
+  G_UNLOCK (resolve_flights);
+
+  flight->waiters = g_list_append (flight->waiters, rs);
+  op_state = grl_operation_get_private_data (rs->operation_id);
+  if (op_state) {
+    op_state->flight = flight;
+  }
+
+  if (*start) {
+    operation_set_ongoing (rs->source, flight->spec->operation_id, GRL_OP_RESOLVE);
+    operation_set_started (flight->spec->operation_id);
+  }
+
+  return flight;
+}
+
+/*
+ * Sends @rs to its source, unless an identical request is already running,
+ * in which case @rs will get the same answer.
+ */
+static void
+resolve_flight_run (GrlSourceResolveSpec *rs)
+{
+  struct ResolveFlight *flight;
+  GMainContext *context;
+  gchar *key;
+  gboolean start;
+
+  context = g_main_context_ref_thread_default ();
+  key = resolve_flight_key_new (rs, context);
+  if (!key) {
+    g_main_context_unref (context);
+    source_run_operation (rs->source, GRL_OP_RESOLVE, rs);
+    return;
+  }
+
+  flight = resolve_flight_join (rs, key, context, &start);
+  if (start) {
+    source_run_operation (rs->source, GRL_OP_RESOLVE, flight->spec);
+  }
+}
+
+static gboolean
+resolve_idle (gpointer user_data)
+{
+  struct ResolveRelayCb *rrc = (struct ResolveRelayCb *) user_data;
+  GrlSourceResolveSpec *rs;
+  GList *spec;
+  GList *key;
+  gboolean run_next;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  /* Abort if operation was cancelled or ran out of time */
+  if (operation_is_cancelled (rrc->operation_id) || rrc->deadline_exceeded) {
+    for (spec = rrc->specs_to_invoke;
+         spec;
+         spec = g_list_next (rs)) {
+      rs = (GrlSourceResolveSpec *) spec->data;
+      g_hash_table_remove (rrc->resolve_specs, rs->source);
+    }
+    g_list_free (rrc->specs_to_invoke);
+    rrc->specs_to_invoke = NULL;
+    run_next = FALSE;
+    resolve_result_relay_cb (rrc->source, rrc->operation_id, rrc->media, rrc, NULL);
+  } else {
+    rs = rrc->specs_to_invoke->data;
+    rrc->specs_to_invoke = g_list_delete_link (rrc->specs_to_invoke,
+                                               rrc->specs_to_invoke);
+    run_next = (rrc->specs_to_invoke != NULL);
+
+    /* Put the specific keys in rs also into rrc */
+    for (key = rs->keys; key; key = g_list_next (key)) {
+      if (!g_list_find (rrc->keys, key->data)) {
+        rrc->keys = g_list_prepend (rrc->keys, key->data);
+      }
+    }
+
+    operation_set_ongoing (rs->source, rs->operation_id, GRL_OP_RESOLVE);
+    operation_set_started (rs->operation_id);
+    operation_link (rrc->operation_id, rs->operation_id);
+
+    /* Skip the source if it answered the same recently */
+    if (grl_resolve_cache_lookup (grl_source_get_id (rs->source),
+                                  rs->media,
+                                  rs->keys,
+                                  grl_source_get_resolve_cache_ttl (rs->source))) {
+      GRL_DEBUG ("resolve: keys found in cache for '%s'",
+                 grl_source_get_id (rs->source));
+      rrc->cache_hit = TRUE;
+      rs->callback (rs->source, rs->operation_id, rs->media, rs->user_data, NULL);
+      rrc->cache_hit = FALSE;
+    } else {
+      resolve_flight_run (rs);
+    }
+  }
+
+  return run_next;
+}
+
+/* Stops asking sources, so the media is sent with the keys resolved so far */
+static gboolean
+resolve_deadline_cb (gpointer user_data)
+{
+  struct ResolveRelayCb *rrc = (struct ResolveRelayCb *) user_data;
+
+  rrc->deadline_id = 0;
+
+  if (operation_is_cancelled (rrc->operation_id)) {
+    return G_SOURCE_REMOVE;
+  }
+
+  GRL_DEBUG ("%s: deadline exceeded for operation %u",
+             grl_source_get_id (rrc->source), rrc->operation_id);
+
+  rrc->deadline_exceeded = TRUE;
+  if (rrc->resolve_specs) {
+    g_hash_table_foreach (rrc->resolve_specs, (GHFunc) cancel_resolve_spec, NULL);
+  }
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+resolve_all_done (gpointer user_data)
+{
+  struct ResolveRelayCb *rrc = (struct ResolveRelayCb *) user_data;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  if (operation_is_cancelled (rrc->operation_id)) {
+    g_clear_error (&rrc->error);
+    rrc->error = g_error_new (GRL_CORE_ERROR,
+                              GRL_CORE_ERROR_OPERATION_CANCELLED,
+                              _("Operation was cancelled"));
+  } else if (rrc->deadline_exceeded) {
+    g_clear_error (&rrc->error);
+    rrc->error = g_error_new (GRL_CORE_ERROR,
+                              GRL_CORE_ERROR_DEADLINE_EXCEEDED,
+                              _("Operation did not finish before its deadline"));
+  }
+
+  rrc->user_callback (rrc->source, rrc->operation_id, rrc->media, rrc->user_data, rrc->error);
+  operation_set_finished (rrc->operation_id);
+  resolve_relay_free (rrc);
+
+  return FALSE;
+}
+
+static void
+resolve_batch_relay_free (struct ResolveBatchRelayCb *rbrc)
+{
+  g_object_unref (rbrc->source);
+  g_ptr_array_unref (rbrc->medias);
+  g_list_free (rbrc->keys);
+  g_object_unref (rbrc->options);
+  g_list_free_full (rbrc->waiters, (GDestroyNotify) resolve_spec_free);
+  g_clear_pointer (&rbrc->pending, g_hash_table_unref);
+  g_clear_error (&rbrc->error);
+  g_slice_free (struct ResolveBatchRelayCb, rbrc);
+}
+
+/* Every element is resolved on its own, and the user is told when all of
+   them are done. Sources able to resolve several elements at once get the
+   ones they must be asked for in a single request, see resolve_batch_idle() */
+
+static gboolean
+resolve_batch_each_done (gpointer user_data)
+{
+  struct ResolveBatchRelayCb *rbrc = (struct ResolveBatchRelayCb *) user_data;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  if (rbrc->cancelled) {
+    g_clear_error (&rbrc->error);
+    rbrc->error = g_error_new (GRL_CORE_ERROR,
+                               GRL_CORE_ERROR_OPERATION_CANCELLED,
+                               _("Operation was cancelled"));
+  }
+
+  rbrc->user_callback (rbrc->source, rbrc->operation_id, rbrc->medias,
+                       rbrc->user_data, rbrc->error);
+  grl_operation_remove (rbrc->operation_id);
+  resolve_batch_relay_free (rbrc);
+
+  return FALSE;
+}
+
+static void
+resolve_batch_each_cb (GrlSource *source,
+                       guint operation_id,
+                       GrlMedia *media,
+                       gpointer user_data,
+                       const GError *error)
+{
+  struct ResolveBatchRelayCb *rbrc = (struct ResolveBatchRelayCb *) user_data;
+
+  g_hash_table_remove (rbrc->pending, GUINT_TO_POINTER (operation_id));
+
+  /* Keep the first error; cancellation is reported when all are done */
+  if (error && !rbrc->error &&
+      !g_error_matches (error,
+                        GRL_CORE_ERROR,
+                        GRL_CORE_ERROR_OPERATION_CANCELLED)) {
+    rbrc->error = g_error_copy (error);
+  }
+
+  if (g_hash_table_size (rbrc->pending) == 0) {
+    resolve_batch_each_done (rbrc);
+  }
+}
+
+static void
+resolve_batch_each_cancel_cb (struct ResolveBatchRelayCb *rbrc)
+{
+  GList *operations, *op;
+
+  if (rbrc->cancelled) {
+    return;
+  }
+
+  rbrc->cancelled = TRUE;
+  /* Sources might answer while being cancelled, so iterate over a copy */
+  operations = g_hash_table_get_keys (rbrc->pending);
+  for (op = operations; op; op = g_list_next (op)) {
+    grl_operation_cancel (GPOINTER_TO_UINT (op->data));
+  }
+  g_list_free (operations);
+}
+
+static void
+resolve_batch_waiter_cb (GrlSource *source,
+                         guint operation_id,
+                         GrlMedia *media,
+                         gpointer user_data,
+                         const GError *error)
+{
+  operation_set_finished (operation_id);
+  resolve_batch_each_cb (source, operation_id, media, user_data, error);
+}
+
+static void
+resolve_batch_flights_free (struct ResolveBatchFlights *rbf)
+{
+  g_object_unref (rbf->spec->source);
+  g_ptr_array_unref (rbf->spec->medias);
+  g_list_free (rbf->spec->keys);
+  g_object_unref (rbf->spec->options);
+  g_free (rbf->spec);
+  g_ptr_array_unref (rbf->flights);
+  g_slice_free (struct ResolveBatchFlights, rbf);
+}
+
+static void
+resolve_batch_flights_cb (GrlSource *source,
+                          guint operation_id,
+                          GPtrArray *medias,
+                          gpointer user_data,
+                          const GError *error)
+{
+  struct ResolveBatchFlights *rbf = (struct ResolveBatchFlights *) user_data;
+  struct ResolveFlight *flight;
+  GError *_error = (GError *) error;
+  guint i;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  grl_metrics_call_result (operation_id, medias? medias->len: 0, TRUE, error);
+
+  if (operation_is_cancelled (operation_id)) {
+    _error = g_error_new (GRL_CORE_ERROR,
+                          GRL_CORE_ERROR_OPERATION_CANCELLED,
+                          _("Operation was cancelled"));
+  } else if (!error && grl_source_get_resolve_cache_ttl (source) > 0) {
+    for (i = 0; i < rbf->flights->len; i++) {
+      flight = g_ptr_array_index (rbf->flights, i);
+      grl_resolve_cache_store (grl_source_get_id (source),
+                               flight->spec->media,
+                               rbf->spec->keys);
+    }
+  }
+
+  /* Every flight is freed once its waiters are answered */
+  for (i = 0; i < rbf->flights->len; i++) {
+    flight = g_ptr_array_index (rbf->flights, i);
+    resolve_flight_cb (source, flight->spec->operation_id, flight->spec->media,
+                       flight, _error);
+  }
+
+  if (_error != error) {
+    g_error_free (_error);
+  }
+
+  operation_set_finished (operation_id);
+  resolve_batch_flights_free (rbf);
+}
+
+/* Sends the new @flights of @rbrc asking for @keys in a single request */
+static void
+resolve_batch_flights_run (struct ResolveBatchRelayCb *rbrc,
+                           GPtrArray *flights,
+                           GList *keys)
+{
+  struct ResolveBatchFlights *rbf;
+  GrlSourceResolveBatchSpec *rbs;
+  struct ResolveFlight *flight;
+  guint i;
+
+  rbs = g_new0 (GrlSourceResolveBatchSpec, 1);
+  rbs->source = g_object_ref (rbrc->source);
+  rbs->operation_id = grl_operation_generate_id ();
+  rbs->medias = g_ptr_array_new_with_free_func (g_object_unref);
+  rbs->keys = g_list_copy (keys);
+  rbs->options = g_object_ref (rbrc->options);
+  rbs->callback = resolve_batch_flights_cb;
+
+  rbf = g_slice_new0 (struct ResolveBatchFlights);
+  rbf->spec = rbs;
+  rbf->flights = g_ptr_array_ref (flights);
+  rbf->waited = flights->len;
+  rbs->user_data = rbf;
+
+  for (i = 0; i < flights->len; i++) {
+    flight = g_ptr_array_index (flights, i);
+    flight->batch = rbf;
+    g_ptr_array_add (rbs->medias, g_object_ref (flight->spec->media));
+  }
+
+  operation_set_ongoing (rbrc->source, rbs->operation_id, GRL_OP_RESOLVE);
+  operation_set_started (rbs->operation_id);
+  grl_metrics_call_start (rbs->source, GRL_OP_RESOLVE, rbs->operation_id);
+  GRL_SOURCE_GET_CLASS (rbs->source)->resolve_batch (rbs->source, rbs);
+}
+
+/* Returns the keys of @media the source of @rbrc must be asked for, as
+   grl_source_resolve() would do */
+static GList *
+resolve_batch_media_keys (struct ResolveBatchRelayCb *rbrc,
+                          GrlMedia *media)
+{
+  GList *keys, *each_key, *next_key;
+  GrlKeyID key;
+  gboolean fast_only;
+
+  fast_only = grl_operation_options_get_resolution_flags (rbrc->options) &
+    GRL_RESOLVE_FAST_ONLY;
+
+  keys = filter_known_keys (media, rbrc->keys);
+  for (each_key = keys; each_key; each_key = next_key) {
+    next_key = g_list_next (each_key);
+    key = GRLPOINTER_TO_KEYID (each_key->data);
+    if ((fast_only && is_slow_key (rbrc->source, key)) ||
+        !grl_source_may_resolve (rbrc->source, media, key, NULL)) {
+      keys = g_list_delete_link (keys, each_key);
+    }
+  }
+
+  return keys;
+}
+
+/*
+ * Resolves the elements of @rbrc like grl_source_resolve() does: those whose
+ * keys are in the cache are completed from it, and those for which an
+ * identical request is already running wait for it. The rest are sent to
+ * resolve_batch(), together with the ones missing the same keys.
+ */
+static gboolean
+resolve_batch_idle (gpointer user_data)
+{
+  struct ResolveBatchRelayCb *rbrc = (struct ResolveBatchRelayCb *) user_data;
+  struct ResolveFlight *flight;
+  GrlSourceResolveSpec *rs;
+  GPtrArray *group_keys;
+  GPtrArray *group_flights;
+  GMainContext *context;
+  GrlMedia *media;
+  GList *keys;
+  gboolean start;
+  guint ttl;
+  guint i, g;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  if (rbrc->cancelled) {
+    resolve_batch_each_done (rbrc);
+    return FALSE;
+  }
+
+  grl_operation_set_state (rbrc->operation_id, GRL_OPERATION_STATE_RUNNING);
+
+  ttl = grl_source_get_resolve_cache_ttl (rbrc->source);
+  group_keys = g_ptr_array_new_with_free_func ((GDestroyNotify) g_list_free);
+  group_flights = g_ptr_array_new_with_free_func ((GDestroyNotify) g_ptr_array_unref);
+
+  for (i = 0; i < rbrc->medias->len; i++) {
+    media = g_ptr_array_index (rbrc->medias, i);
+    keys = resolve_batch_media_keys (rbrc, media);
+
+    if (!keys ||
+        grl_resolve_cache_lookup (grl_source_get_id (rbrc->source),
+                                  media, keys, ttl)) {
+      g_list_free (keys);
+      continue;
+    }
+
+    rs = g_new0 (GrlSourceResolveSpec, 1);
+    rs->source = g_object_ref (rbrc->source);
+    rs->operation_id = grl_operation_generate_id ();
+    rs->media = g_object_ref (media);
+    rs->keys = keys;
+    rs->options = g_object_ref (rbrc->options);
+    rs->callback = resolve_batch_waiter_cb;
+    rs->user_data = rbrc;
+    rbrc->waiters = g_list_prepend (rbrc->waiters, rs);
+
+    /* Cancelling the batch makes the element leave the request it waits for */
+    operation_set_ongoing (rbrc->source, rs->operation_id, GRL_OP_RESOLVE);
+    g_hash_table_add (rbrc->pending, GUINT_TO_POINTER (rs->operation_id));
+
+    context = g_main_context_ref_thread_default ();
+    flight = resolve_flight_join (rs,
+                                  resolve_flight_key_new (rs, context),
+                                  context,
+                                  &start);
+    if (!start) {
+      continue;
+    }
+
+    for (g = 0; g < group_keys->len; g++) {
+      if (key_lists_same_set (keys, g_ptr_array_index (group_keys, g))) {
+        break;
+      }
+    }
+    if (g == group_keys->len) {
+      g_ptr_array_add (group_keys, g_list_copy (keys));
+      g_ptr_array_add (group_flights, g_ptr_array_new ());
+    }
+    g_ptr_array_add (g_ptr_array_index (group_flights, g), flight);
+  }
+
+  for (g = 0; g < group_keys->len; g++) {
+    resolve_batch_flights_run (rbrc,
+                               g_ptr_array_index (group_flights, g),
+                               g_ptr_array_index (group_keys, g));
+  }
+  g_ptr_array_unref (group_keys);
+  g_ptr_array_unref (group_flights);
+
+  /* Everything was already known */
+  if (g_hash_table_size (rbrc->pending) == 0) {
+    resolve_batch_each_done (rbrc);
+  }
+
+  return FALSE;
+}
+
+static gboolean
+media_from_uri_idle (gpointer user_data)
+{
+  GrlSourceMediaFromUriSpec *mfus = (GrlSourceMediaFromUriSpec *) user_data;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  /* Abort if operation is cancelled */
+  if (operation_is_cancelled (mfus->operation_id)) {
+    mfus->callback (mfus->source, mfus->operation_id,
+                    NULL, mfus->user_data, NULL);
+  } else {
+    operation_set_started (mfus->operation_id);
+    source_run_operation (mfus->source, GRL_OP_MEDIA_FROM_URI, mfus);
+  }
+
+  return FALSE;
+}
+
+static gboolean
+browse_idle (gpointer user_data)
+{
+  GrlSourceBrowseSpec *bs = (GrlSourceBrowseSpec *) user_data;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  /* Abort if operation is cancelled */
+  if (operation_is_cancelled (bs->operation_id)) {
+    bs->callback (bs->source, bs->operation_id, NULL, 0, bs->user_data, NULL);
+  } else {
+    operation_set_started (bs->operation_id);
+    source_run_operation (bs->source, GRL_OP_BROWSE, bs);
+  }
+
+  return FALSE;
+}
+
+static gboolean
+search_idle (gpointer user_data)
+{
+  GrlSourceSearchSpec *ss = (GrlSourceSearchSpec *) user_data;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  /* Abort if operation is cancelled */
+  if (operation_is_cancelled (ss->operation_id)) {
+    ss->callback (ss->source, ss->operation_id, NULL, 0, ss->user_data, NULL);
+  } else {
+    operation_set_started (ss->operation_id);
+    source_run_operation (ss->source, GRL_OP_SEARCH, ss);
+  }
+
+  return FALSE;
+}
+
+static gboolean
+query_idle (gpointer user_data)
+{
+  GrlSourceQuerySpec *qs = (GrlSourceQuerySpec *) user_data;
+  GRL_DEBUG (__FUNCTION__);
+
+  /* Abort if operation is cancelled */
+  if (operation_is_cancelled (qs->operation_id)) {
+    qs->callback (qs->source, qs->operation_id, NULL, 0, qs->user_data, NULL);
+  } else {
+    operation_set_started (qs->operation_id);
+    source_run_operation (qs->source, GRL_OP_QUERY, qs);
+  }
+
+  return FALSE;
+}
+
+static gboolean
+remove_idle (gpointer user_data)
+{
+  struct RemoveRelayCb *rrc = (struct RemoveRelayCb *) user_data;
+  GRL_DEBUG (__FUNCTION__);
+
+  if (rrc->error) {
+    rrc->user_callback (rrc->source, rrc->media, rrc->user_data, rrc->error);
+    remove_relay_free (rrc);
+  } else {
+    rrc->started = grl_metrics_start ();
+    GRL_SOURCE_GET_CLASS (rrc->source)->remove (rrc->source, rrc->spec);
+  }
+
+  return FALSE;
+}
+
+/* Removes several medias: all at once if the source implements remove_batch,
+   or a few at a time otherwise */
+
+static void
+remove_batch_error_free (gpointer error)
+{
+  if (error) {
+    g_error_free (error);
+  }
+}
+
+static void
+remove_batch_relay_free (struct RemoveBatchRelayCb *rbrc)
+{
+  GList *item;
+
+  for (item = rbrc->items; item; item = g_list_next (item)) {
+    struct RemoveBatchItem *rbi = item->data;
+
+    g_object_unref (rbi->spec->source);
+    g_object_unref (rbi->spec->media);
+    g_free (rbi->spec->media_id);
+    g_free (rbi->spec);
+    g_slice_free (struct RemoveBatchItem, rbi);
+  }
+  g_list_free (rbrc->items);
+
+  if (rbrc->spec) {
+    g_object_unref (rbrc->spec->source);
+    g_ptr_array_unref (rbrc->spec->medias);
+    g_free (rbrc->spec);
+  }
+  g_clear_pointer (&rbrc->sent, g_array_unref);
+
+  g_object_unref (rbrc->source);
+  g_ptr_array_unref (rbrc->medias);
+  g_ptr_array_unref (rbrc->errors);
+
+  g_slice_free (struct RemoveBatchRelayCb, rbrc);
+}
+
+static void
+remove_batch_set_result (struct RemoveBatchRelayCb *rbrc,
+                         guint index,
+                         const GError *error)
+{
+  GrlMedia *media = g_ptr_array_index (rbrc->medias, index);
+
+  if (error) {
+    g_ptr_array_index (rbrc->errors, index) = g_error_copy (error);
+    rbrc->failed++;
+  } else if (grl_media_get_id (media)) {
+    grl_resolve_cache_invalidate (grl_media_get_source (media),
+                                  grl_media_get_id (media));
+  }
+}
+
+static void
+remove_batch_finish (struct RemoveBatchRelayCb *rbrc)
+{
+  GError *error = NULL;
+
+  GRL_DEBUG ("%s: %u of %u medias not removed",
+             __FUNCTION__, rbrc->failed, rbrc->medias->len);
+
+  grl_metrics_record (rbrc->source, GRL_OP_REMOVE, GRL_METRICS_KIND_CALL,
+                      rbrc->started, rbrc->medias->len, rbrc->failed > 0);
+
+  if (rbrc->failed > 0) {
+    error = g_error_new (GRL_CORE_ERROR,
+                         GRL_CORE_ERROR_REMOVE_FAILED,
+                         _("Some elements could not be removed"));
+  }
+
+  rbrc->user_callback (rbrc->source, rbrc->medias, rbrc->errors,
+                       rbrc->user_data, error);
+
+  g_clear_error (&error);
+  remove_batch_relay_free (rbrc);
+}
+
+static void
+remove_batch_result_relay_cb (GrlSource *source,
+                              GPtrArray *medias,
+                              GPtrArray *errors,
+                              gpointer user_data,
+                              const GError *error)
+{
+  struct RemoveBatchRelayCb *rbrc = (struct RemoveBatchRelayCb *) user_data;
+  const GError *item_error;
+  guint i;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  /* Elements in the request are the ones that had an id */
+  for (i = 0; i < rbrc->sent->len; i++) {
+    item_error = errors? g_ptr_array_index (errors, i): error;
+    remove_batch_set_result (rbrc, g_array_index (rbrc->sent, guint, i),
+                             item_error);
+  }
+
+  remove_batch_finish (rbrc);
+}
+
+static gboolean remove_batch_each_idle (gpointer user_data);
+
+static void
+remove_batch_each_cb (GrlSource *source,
+                      GrlMedia *media,
+                      gpointer user_data,
+                      const GError *error)
+{
+  struct RemoveBatchItem *rbi = (struct RemoveBatchItem *) user_data;
+  struct RemoveBatchRelayCb *rbrc = rbi->rbrc;
+
+  remove_batch_set_result (rbrc, rbi->index, error);
+  rbrc->running--;
+
+  /* Start the following ones from the main loop, as the source might have
+     answered right away */
+  if (!rbrc->scheduled) {
+    rbrc->scheduled = TRUE;
+    grl_operation_idle_add (G_PRIORITY_DEFAULT_IDLE,
+                            remove_batch_each_idle,
+                            rbrc,
+                            NULL,
+                            "[grilo] remove_batch_each_idle");
+  }
+}
+
+static gboolean
+remove_batch_each_idle (gpointer user_data)
+{
+  struct RemoveBatchRelayCb *rbrc = (struct RemoveBatchRelayCb *) user_data;
+  struct RemoveBatchItem *rbi;
+  GrlSourceRemoveSpec *rs;
+  GrlMedia *media;
+  GError *error;
+  guint limit;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  rbrc->scheduled = FALSE;
+
+  limit = rbrc->source->priv->remove_concurrency;
+  while ((limit == 0 || rbrc->running < limit) &&
+         rbrc->next < rbrc->medias->len) {
+    media = g_ptr_array_index (rbrc->medias, rbrc->next);
+
+    if (!grl_media_get_id (media)) {
+      error = g_error_new (GRL_CORE_ERROR,
+                           GRL_CORE_ERROR_REMOVE_FAILED,
+                           _("Media has no “id”, cannot remove"));
+      remove_batch_set_result (rbrc, rbrc->next++, error);
+      g_error_free (error);
+      continue;
+    }
+
+    rs = g_new0 (GrlSourceRemoveSpec, 1);
+    rs->source = g_object_ref (rbrc->source);
+    rs->media_id = g_strdup (grl_media_get_id (media));
+    rs->media = g_object_ref (media);
+    rs->callback = remove_batch_each_cb;
+
+    rbi = g_slice_new (struct RemoveBatchItem);
+    rbi->rbrc = rbrc;
+    rbi->index = rbrc->next++;
+    rbi->spec = rs;
+    rs->user_data = rbi;
+    rbrc->items = g_list_prepend (rbrc->items, rbi);
+
+    rbrc->running++;
+    GRL_SOURCE_GET_CLASS (rbrc->source)->remove (rbrc->source, rs);
+  }
+
+  if (rbrc->running == 0 && rbrc->next == rbrc->medias->len &&
+      !rbrc->scheduled) {
+    remove_batch_finish (rbrc);
+  }
+
+  return FALSE;
+}
+
+static gboolean
+remove_batch_idle (gpointer user_data)
+{
+  struct RemoveBatchRelayCb *rbrc = (struct RemoveBatchRelayCb *) user_data;
+  GrlSourceRemoveBatchSpec *rbs;
+  GrlMedia *media;
+  GError *error;
+  guint i;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  rbs = g_new0 (GrlSourceRemoveBatchSpec, 1);
+  rbs->source = g_object_ref (rbrc->source);
+  rbs->medias = g_ptr_array_new_with_free_func (g_object_unref);
+  rbs->callback = remove_batch_result_relay_cb;
+  rbs->user_data = rbrc;
+  rbrc->spec = rbs;
+  rbrc->sent = g_array_new (FALSE, FALSE, sizeof (guint));
+
+  error = g_error_new (GRL_CORE_ERROR,
+                       GRL_CORE_ERROR_REMOVE_FAILED,
+                       _("Media has no “id”, cannot remove"));
+  for (i = 0; i < rbrc->medias->len; i++) {
+    media = g_ptr_array_index (rbrc->medias, i);
+    if (grl_media_get_id (media)) {
+      g_ptr_array_add (rbs->medias, g_object_ref (media));
+      g_array_append_val (rbrc->sent, i);
+    } else {
+      remove_batch_set_result (rbrc, i, error);
+    }
+  }
+  g_error_free (error);
+
+  if (rbs->medias->len == 0) {
+    remove_batch_finish (rbrc);
+  } else {
+    GRL_SOURCE_GET_CLASS (rbrc->source)->remove_batch (rbrc->source, rbs);
+  }
+
+  return FALSE;
+}
+
+static void
+resolve_result_async_cb (GrlSource *source,
+                         guint operation_id,
+                         GrlMedia *media,
+                         gpointer user_data,
+                         const GError *error)
+{
+  GrlDataSync *ds = (GrlDataSync *) user_data;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  if (error) {
+    ds->error = g_error_copy (error);
+  }
+
+  ds->data = media;
+  ds->complete = TRUE;
+}
+
+static void
+multiple_result_async_cb (GrlSource *source,
+                          guint op_id,
+                          GrlMedia *media,
+                          guint remaining,
+                          gpointer user_data,
+                          const GError *error)
+{
+  GrlDataSync *ds = (GrlDataSync *) user_data;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  if (error) {
+    ds->error = g_error_copy (error);
+
+    /* Free previous results */
+    g_list_free_full (ds->data, g_object_unref);
+
+    ds->data = NULL;
+    ds->complete = TRUE;
+    return;
+  }
+
+  if (media) {
+    ds->data = g_list_prepend (ds->data, media);
+  }
+
+  if (remaining == 0) {
+    ds->data = g_list_reverse (ds->data);
+    ds->complete = TRUE;
+  }
+}
+
+static void
+remove_async_cb (GrlSource *source,
+                 GrlMedia *media,
+                 gpointer user_data,
+                 const GError *error)
+{
+  GrlDataSync *ds = (GrlDataSync *) user_data;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  if (error) {
+    ds->error = g_error_copy (error);
+  }
+
+  ds->complete = TRUE;
+}
+
+static void
+store_result_async_cb (GrlSource *source,
+                       GrlMedia *media,
+                       GList *failed_keys,
+                       gpointer user_data,
+                       const GError *error)
+{
+  GrlDataSync *ds = (GrlDataSync *) user_data;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  if (error) {
+    ds->error = g_error_copy (error);
+  }
+
+  ds->data = g_list_copy (failed_keys);
+  ds->complete = TRUE;
+}
+
+
+static void
+store_metadata_result_async_cb (GrlSource *source,
+                                GrlMedia *media,
+                                GList *failed_keys,
+                                gpointer user_data,
+                                const GError *error)
+{
+  GrlDataSync *ds = (GrlDataSync *) user_data;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  if (error) {
+    ds->error = g_error_copy (error);
+  }
+
+  ds->data = g_list_copy (failed_keys);
+  ds->complete = TRUE;
+}
+
+static GHashTable *
+map_writable_keys (GrlSource *source,
+                   GList *keys,
+                   GrlWriteFlags flags,
+                   GList **failed_keys)
+{
+  GHashTable *map;
+  GrlRegistry *registry;
+  GList *sources = NULL;
+  GList *sources_iter;
+  GList *unsupported_keys;
+  GrlSource *_source;
+
+  map = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                               g_object_unref,
+                               (GDestroyNotify) g_list_free);
+
+  /* 'key_list' holds keys that can be written by this source
+     'unsupportedy_keys' holds those that must be handled by other sources */
+  GList *key_list = g_list_copy (keys);
+  if (grl_source_supported_operations (source) & GRL_OP_STORE_METADATA) {
+    unsupported_keys = filter_writable (source, &key_list, TRUE);
+  } else {
+    unsupported_keys = key_list;
+    key_list = NULL;
+  }
+
+  if (key_list) {
+    g_hash_table_insert (map, g_object_ref (source), key_list);
+  }
+
+  if (!unsupported_keys || !(flags & GRL_WRITE_FULL)) {
+    /* We are done! */
+    goto done;
+  }
+
+  /* Check if other sources can write the missing keys */
+  registry = grl_registry_get_default ();
+  sources =
+    grl_registry_get_sources_by_operations (registry,
+                                            GRL_OP_STORE_METADATA,
+                                            TRUE);
+
+  for (sources_iter = sources; unsupported_keys && sources_iter;
+       sources_iter = g_list_next (sources_iter)) {
+    _source = GRL_SOURCE (sources_iter->data);
+
+    if (_source == source) {
+      continue;
+    }
+
+    key_list = unsupported_keys;
+    unsupported_keys = filter_writable (_source, &key_list, TRUE);
+
+    if (!key_list) {
+      continue;
+    }
+
+    g_hash_table_insert (map, g_object_ref (_source), key_list);
+
+    if (!unsupported_keys) {
+      break;
+    }
+  }
+
+  g_list_free (sources);
+
+ done:
+  *failed_keys = unsupported_keys;
+  return map;
+}
+
+static void
+store_relay_cb (GrlSource *source,
+                GrlMedia *media,
+                GList *failed_keys,
+                gpointer user_data,
+                const GError *error)
+{
+  struct StoreRelayCb *src = (struct StoreRelayCb *) user_data;
+  GrlSourceStoreSpec *ss  = src->spec;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  grl_metrics_record (source, GRL_OP_STORE, GRL_METRICS_KIND_CALL,
+                      src->started, 0, error != NULL);
+
+  if (error || !(src->flags & GRL_WRITE_FULL)) {
+    if (src->user_callback)
+      src->user_callback (source, media, failed_keys, src->user_data, error);
+  } else if (failed_keys != NULL) {
+    run_store_metadata (source, media, failed_keys, GRL_WRITE_FULL,
+                        src->user_callback, src->user_data);
+  }
+  store_relay_free (src);
+  store_spec_free (ss);
+}
+
+static void
+store_metadata_ctl_cb (GrlSource *source,
+                       GrlMedia *media,
+                       GList *failed_keys,
+                       gpointer user_data,
+                       const GError *error)
+{
+  struct StoreMetadataRelayCb *smrc;
+  GError *own_error = NULL;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  smrc = (struct StoreMetadataRelayCb *) user_data;
+
+  grl_metrics_record (source, GRL_OP_STORE_METADATA, GRL_METRICS_KIND_CALL,
+                      smrc->started, 0, error != NULL || failed_keys != NULL);
+
+  /* Cached values might not be valid any more */
+  if (grl_media_get_id (media)) {
+    grl_resolve_cache_invalidate (grl_media_get_source (media),
+                                  grl_media_get_id (media));
+  }
+
+  if (failed_keys) {
+    smrc->failed_keys = g_list_concat (smrc->failed_keys, failed_keys);
+  }
+
+  g_hash_table_remove (smrc->map, source);
+
+  /* If we all sources have answered */
+  if (g_hash_table_size (smrc->map) == 0) {
+    /* We ignore the plugin errors, instead we create an own error
+       if some keys were not written */
+    if (smrc->user_callback) {
+      if (smrc->failed_keys) {
+        own_error = g_error_new (GRL_CORE_ERROR,
+                                 GRL_CORE_ERROR_STORE_METADATA_FAILED,
+                                 _("Some keys could not be written"));
+      }
+      smrc->user_callback (smrc->source,
+                           media,
+                           smrc->failed_keys,
+                           smrc->user_data,
+                           own_error);
+      g_clear_error (&own_error);
+    }
+    store_metadata_relay_free (smrc);
+  }
+}
+
+static gboolean
+store_idle (gpointer user_data)
+{
+  GrlSourceStoreSpec *ss = (GrlSourceStoreSpec *) user_data;
+  struct StoreRelayCb *src = (struct StoreRelayCb *) ss->user_data;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  src->started = grl_metrics_start ();
+  GRL_SOURCE_GET_CLASS (ss->source)->store(ss->source, ss);
+
+  return FALSE;
+}
+
+static gboolean
+store_metadata_idle (gpointer user_data)
+{
+  GrlSourceStoreMetadataSpec *sms;
+  gboolean stop;
+  struct StoreMetadataRelayCb *smrc;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  smrc = (struct StoreMetadataRelayCb *) user_data;
+
+  sms = g_new (GrlSourceStoreMetadataSpec, 1);
+
+  sms->source = g_object_ref (g_list_first (smrc->use_sources)->data);
+  sms->keys = g_hash_table_lookup (smrc->map, sms->source);
+  sms->media = g_object_ref (smrc->media);
+  sms->callback = store_metadata_ctl_cb;
+  sms->user_data = smrc;
+
+  /* Remove list header */
+  smrc->use_sources = g_list_remove_link (smrc->use_sources, smrc->use_sources);
+  smrc->specs = g_list_prepend (smrc->specs, sms);
+
+  stop = smrc->use_sources == NULL;
+  GRL_SOURCE_GET_CLASS (sms->source)->store_metadata (sms->source, sms);
+
+  return !stop;
+}
+
+static void
+run_store_metadata (GrlSource *source,
+                    GrlMedia *media,
+                    GList *keys,
+                    GrlWriteFlags flags,
+                    GrlSourceStoreCb callback,
+                    gpointer user_data)
+{
+  GHashTable *map;
+  GList *failed_keys = NULL;
+  GError *error;
+  struct StoreMetadataRelayCb *smrc;
+
+  map = map_writable_keys (source, keys, flags, &failed_keys);
+
+  if (g_hash_table_size (map) == 0) {
+    error = g_error_new (GRL_CORE_ERROR,
+                         GRL_CORE_ERROR_STORE_METADATA_FAILED,
+                         _("None of the specified keys are writable"));
+    if (callback) {
+      callback (source, media, failed_keys, user_data, error);
+    }
+
+    g_error_free (error);
+    g_list_free (failed_keys);
+    g_hash_table_unref (map);
+
+    return;
+  }
+
+  smrc = g_slice_new (struct StoreMetadataRelayCb);
+  smrc->source = g_object_ref (source);
+  smrc->media = g_object_ref (media);
+  smrc->map = map;
+  smrc->use_sources = g_hash_table_get_keys (map);
+  smrc->failed_keys = failed_keys;
+  smrc->specs = NULL;
+  smrc->user_callback = callback;
+  smrc->user_data = user_data;
+  smrc->started = grl_metrics_start ();
+
+  grl_operation_idle_add (G_PRIORITY_DEFAULT_IDLE,
+                          store_metadata_idle,
+                          smrc,
+                          NULL,
+                          "[grilo] store_metadata_idle");
+}
+
+/* Stores the same keys of several medias, mapping the keys to the sources
+   that can write them only once */
+
+static void
+store_metadata_batch_relay_free (struct StoreMetadataBatchRelayCb *smbrc)
+{
+  GList *spec;
+
+  for (spec = smbrc->specs; spec; spec = g_list_next (spec)) {
+    GrlSourceStoreMetadataBatchSpec *smbs = spec->data;
+
+    g_object_unref (smbs->source);
+    g_ptr_array_unref (smbs->medias);
+    g_free (smbs);
+  }
+  g_list_free (smbrc->specs);
+
+  g_object_unref (smbrc->source);
+  g_ptr_array_unref (smbrc->medias);
+  g_hash_table_unref (smbrc->map);
+  g_list_free (smbrc->failed_keys);
+
+  g_slice_free (struct StoreMetadataBatchRelayCb, smbrc);
+}
+
+static void
+store_metadata_batch_add_failed (struct StoreMetadataBatchRelayCb *smbrc,
+                                 GList *failed_keys)
+{
+  for (; failed_keys; failed_keys = g_list_next (failed_keys)) {
+    if (!g_list_find (smbrc->failed_keys, failed_keys->data)) {
+      smbrc->failed_keys = g_list_append (smbrc->failed_keys,
+                                          failed_keys->data);
+    }
+  }
+}
+
+/* Called once per source; the last one tells the user */
+static void
+store_metadata_batch_source_done (struct StoreMetadataBatchRelayCb *smbrc)
+{
+  GError *error = NULL;
+  guint i;
+
+  if (--smbrc->pending > 0) {
+    return;
+  }
+
+  /* Cached values might not be valid any more */
+  for (i = 0; i < smbrc->medias->len; i++) {
+    GrlMedia *media = g_ptr_array_index (smbrc->medias, i);
+
+    if (grl_media_get_id (media)) {
+      grl_resolve_cache_invalidate (grl_media_get_source (media),
+                                    grl_media_get_id (media));
+    }
+  }
+
+  /* As in grl_source_store_metadata(), plugin errors are replaced by an own
+     error if some keys were not written */
+  if (smbrc->user_callback) {
+    if (smbrc->failed_keys) {
+      error = g_error_new (GRL_CORE_ERROR,
+                           GRL_CORE_ERROR_STORE_METADATA_FAILED,
+                           _("Some keys could not be written"));
+    }
+    smbrc->user_callback (smbrc->source,
+                          smbrc->medias,
+                          smbrc->failed_keys,
+                          smbrc->user_data,
+                          error);
+    g_clear_error (&error);
+  }
+  store_metadata_batch_relay_free (smbrc);
+}
+
+static void
+store_metadata_batch_ctl_cb (GrlSource *source,
+                             GPtrArray *medias,
+                             GList *failed_keys,
+                             gpointer user_data,
+                             const GError *error)
+{
+  struct StoreMetadataBatchRelayCb *smbrc;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  smbrc = (struct StoreMetadataBatchRelayCb *) user_data;
+
+  grl_metrics_record (source, GRL_OP_STORE_METADATA, GRL_METRICS_KIND_CALL,
+                      smbrc->started, medias->len,
+                      error != NULL || failed_keys != NULL);
+
+  store_metadata_batch_add_failed (smbrc, failed_keys);
+  store_metadata_batch_source_done (smbrc);
+}
+
+static gboolean store_metadata_batch_each_idle (gpointer user_data);
+
+static void
+store_metadata_batch_each_cb (GrlSource *source,
+                              GrlMedia *media,
+                              GList *failed_keys,
+                              gpointer user_data,
+                              const GError *error)
+{
+  struct StoreMetadataBatchEach *each;
+
+  each = (struct StoreMetadataBatchEach *) user_data;
+
+  if (error || failed_keys) {
+    each->failed = TRUE;
+  }
+  store_metadata_batch_add_failed (each->smbrc, failed_keys);
+  g_list_free (failed_keys);
+
+  /* Do not go deeper in the stack if the source answers right away */
+  grl_operation_idle_add (G_PRIORITY_DEFAULT_IDLE,
+                          store_metadata_batch_each_idle,
+                          each,
+                          NULL,
+                          "[grilo] store_metadata_batch_each_idle");
+}
+
+static gboolean
+store_metadata_batch_each_idle (gpointer user_data)
+{
+  struct StoreMetadataBatchEach *each;
+  struct StoreMetadataBatchRelayCb *smbrc;
+  GrlSourceStoreMetadataSpec *sms;
+
+  each = (struct StoreMetadataBatchEach *) user_data;
+  smbrc = each->smbrc;
+
+  g_clear_pointer (&each->spec, store_metadata_spec_free);
+
+  if (each->next == smbrc->medias->len) {
+    grl_metrics_record (each->source, GRL_OP_STORE_METADATA,
+                        GRL_METRICS_KIND_CALL, smbrc->started,
+                        smbrc->medias->len, each->failed);
+    g_slice_free (struct StoreMetadataBatchEach, each);
+    store_metadata_batch_source_done (smbrc);
+    return FALSE;
+  }
+
+  sms = g_new0 (GrlSourceStoreMetadataSpec, 1);
+  sms->source = g_object_ref (each->source);
+  sms->media = g_object_ref (g_ptr_array_index (smbrc->medias, each->next++));
+  sms->keys = each->keys;
+  sms->flags = GRL_WRITE_NORMAL;
+  sms->callback = store_metadata_batch_each_cb;
+  sms->user_data = each;
+  each->spec = sms;
+
+  GRL_SOURCE_GET_CLASS (sms->source)->store_metadata (sms->source, sms);
+
+  return FALSE;
+}
+
+static gboolean
+store_metadata_batch_idle (gpointer user_data)
+{
+  struct StoreMetadataBatchRelayCb *smbrc;
+  GrlSourceStoreMetadataBatchSpec *smbs;
+  struct StoreMetadataBatchEach *each;
+  GList *sources, *s;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  smbrc = (struct StoreMetadataBatchRelayCb *) user_data;
+
+  /* Sources might answer right away, so hold the operation until all of
+     them have been asked */
+  smbrc->pending = g_hash_table_size (smbrc->map) + 1;
+
+  sources = g_hash_table_get_keys (smbrc->map);
+  for (s = sources; s; s = g_list_next (s)) {
+    GrlSource *source = GRL_SOURCE (s->data);
+    GList *keys = g_hash_table_lookup (smbrc->map, source);
+
+    if (GRL_SOURCE_GET_CLASS (source)->store_metadata_batch) {
+      smbs = g_new0 (GrlSourceStoreMetadataBatchSpec, 1);
+      smbs->source = g_object_ref (source);
+      smbs->medias = g_ptr_array_ref (smbrc->medias);
+      smbs->keys = keys;
+      smbs->flags = GRL_WRITE_NORMAL;
+      smbs->callback = store_metadata_batch_ctl_cb;
+      smbs->user_data = smbrc;
+      smbrc->specs = g_list_prepend (smbrc->specs, smbs);
+
+      GRL_SOURCE_GET_CLASS (source)->store_metadata_batch (source, smbs);
+    } else {
+      each = g_slice_new0 (struct StoreMetadataBatchEach);
+      each->smbrc = smbrc;
+      each->source = source;
+      each->keys = keys;
+
+      store_metadata_batch_each_idle (each);
+    }
+  }
+  g_list_free (sources);
+
+  store_metadata_batch_source_done (smbrc);
+
+  return FALSE;
+}
+
+/* Write-behind: edits of the same media are merged while they wait, and
+   are stored with grl_source_store_metadata_batch() */
+
+static void
+write_behind_entry_free (WriteBehindEntry *entry)
+{
+  g_object_unref (entry->media);
+  g_list_free (entry->keys);
+  g_slice_free (WriteBehindEntry, entry);
+}
+
+static gboolean
+write_behind_waiter_done (gpointer user_data)
+{
+  WriteBehindWaiter *waiter = (WriteBehindWaiter *) user_data;
+
+  if (waiter->callback) {
+    waiter->callback (waiter->source, waiter->media, waiter->failed_keys,
+                      waiter->user_data, waiter->error);
+  }
+
+  g_object_unref (waiter->source);
+  g_object_unref (waiter->media);
+  g_list_free (waiter->keys);
+  g_main_context_unref (waiter->context);
+  g_list_free (waiter->failed_keys);
+  g_clear_error (&waiter->error);
+  g_slice_free (WriteBehindWaiter, waiter);
+
+  return FALSE;
+}
+
+/* Replaces the values of @keys in @dest by the ones in @media */
+static void
+write_behind_merge (WriteBehindEntry *entry,
+                    GrlMedia *media,
+                    GList *keys)
+{
+  GrlData *dest = GRL_DATA (entry->media);
+  GrlKeyID key;
+  guint i;
+
+  for (; keys; keys = g_list_next (keys)) {
+    key = GRLPOINTER_TO_KEYID (keys->data);
+
+    while (grl_data_length (dest, key) > 0) {
+      grl_data_remove_nth (dest, key, 0);
+    }
+    for (i = 0; i < grl_data_length (GRL_DATA (media), key); i++) {
+      GrlRelatedKeys *relkeys =
+        grl_data_get_related_keys (GRL_DATA (media), key, i);
+
+      grl_data_add_related_keys (dest, grl_related_keys_dup (relkeys));
+    }
+
+    if (!g_list_find (entry->keys, keys->data)) {
+      entry->keys = g_list_insert_sorted (entry->keys, keys->data,
+                                          compare_keys);
+    }
+  }
+}
+
+static void
+write_behind_batch_cb (GrlSource *source,
+                       GPtrArray *medias,
+                       GList *failed_keys,
+                       gpointer user_data,
+                       const GError *error)
+{
+  WriteBehindBatch *batch = (WriteBehindBatch *) user_data;
+  GList *e, *w, *k;
+
+  GRL_DEBUG ("write-behind: stored %u medias in '%s'",
+             medias->len, grl_source_get_id (source));
+
+  for (e = batch->entries; e; e = g_list_next (e)) {
+    WriteBehindEntry *entry = e->data;
+
+    for (w = entry->waiters; w; w = g_list_next (w)) {
+      WriteBehindWaiter *waiter = w->data;
+
+      /* Sources only tell which keys failed in the whole batch, so they are
+         reported as failed to every edit of them in the batch */
+      for (k = waiter->keys; k; k = g_list_next (k)) {
+        if (g_list_find (failed_keys, k->data)) {
+          waiter->failed_keys = g_list_append (waiter->failed_keys, k->data);
+        }
+      }
+      /* Other keys failing are not this edit's problem */
+      if (error &&
+          (waiter->failed_keys ||
+           !g_error_matches (error,
+                             GRL_CORE_ERROR,
+                             GRL_CORE_ERROR_STORE_METADATA_FAILED))) {
+        waiter->error = g_error_copy (error);
+      }
+
+      /* Answer in the context the edit was requested from */
+      g_main_context_invoke_full (waiter->context,
+                                  G_PRIORITY_DEFAULT,
+                                  write_behind_waiter_done,
+                                  waiter,
+                                  NULL);
+    }
+    g_list_free (entry->waiters);
+    write_behind_entry_free (entry);
+  }
+
+  g_list_free (batch->entries);
+  g_list_free (batch->keys);
+  g_slice_free (WriteBehindBatch, batch);
+}
+
+static gboolean
+write_behind_same_keys (GList *a,
+                        GList *b)
+{
+  for (; a && b; a = g_list_next (a), b = g_list_next (b)) {
+    if (a->data != b->data) {
+      return FALSE;
+    }
+  }
+
+  return a == NULL && b == NULL;
+}
+
+static void
+write_behind_flush (GrlSource *source)
+{
+  GrlSourcePrivate *priv = source->priv;
+  WriteBehindEntry *entry;
+  WriteBehindBatch *batch;
+  GList *batches = NULL;
+  GList *b, *e;
+  GQueue *queue;
+  GPtrArray *medias;
+
+  g_mutex_lock (&priv->lock);
+  queue = priv->write_behind_queue;
+  priv->write_behind_queue = g_queue_new ();
+  g_hash_table_remove_all (priv->write_behind_entries);
+  priv->write_behind_generation++;
+  g_mutex_unlock (&priv->lock);
+
+  /* Medias with the same edited keys are stored together */
+  while ((entry = g_queue_pop_head (queue))) {
+    for (b = batches; b; b = g_list_next (b)) {
+      batch = b->data;
+      if (batch->flags == entry->flags &&
+          write_behind_same_keys (batch->keys, entry->keys)) {
+        break;
+      }
+    }
+
+    if (!b) {
+      batch = g_slice_new0 (WriteBehindBatch);
+      batch->keys = g_list_copy (entry->keys);
+      batch->flags = entry->flags;
+      batches = g_list_append (batches, batch);
+    }
+    batch->entries = g_list_append (batch->entries, entry);
+  }
+  g_queue_free (queue);
+
+  for (b = batches; b; b = g_list_next (b)) {
+    batch = b->data;
+
+    medias = g_ptr_array_new ();
+    for (e = batch->entries; e; e = g_list_next (e)) {
+      entry = e->data;
+      g_ptr_array_add (medias, entry->media);
+    }
+
+    GRL_DEBUG ("write-behind: storing %u medias in '%s'",
+               medias->len, grl_source_get_id (source));
+
+    grl_source_store_metadata_batch (source, medias, batch->keys, batch->flags,
+                                     write_behind_batch_cb, batch);
+    g_ptr_array_unref (medias);
+  }
+  g_list_free (batches);
+}
+
+static gboolean
+write_behind_timeout (gpointer user_data)
+{
+  WriteBehindTimer *timer = (WriteBehindTimer *) user_data;
+  gboolean flush;
+
+  /* Nothing to do if the edits were already flushed */
+  g_mutex_lock (&timer->source->priv->lock);
+  flush = timer->generation == timer->source->priv->write_behind_generation;
+  g_mutex_unlock (&timer->source->priv->lock);
+
+  if (flush) {
+    write_behind_flush (timer->source);
+  }
+
+  g_object_unref (timer->source);
+  g_slice_free (WriteBehindTimer, timer);
+
+  return FALSE;
+}
+
+/* Keeps the edit to be stored later; returns FALSE if write-behind is not
+   enabled for @source */
+static gboolean
+write_behind_add (GrlSource *source,
+                  GrlMedia *media,
+                  GList *keys,
+                  GrlWriteFlags flags,
+                  GrlSourceStoreCb callback,
+                  gpointer user_data)
+{
+  GrlSourcePrivate *priv = source->priv;
+  WriteBehindEntry *entry;
+  WriteBehindWaiter *waiter;
+  WriteBehindTimer *timer = NULL;
+  const gchar *id;
+  gboolean flush;
+
+  id = grl_media_get_id (media);
+  if (!id) {
+    return FALSE;
+  }
+
+  g_mutex_lock (&priv->lock);
+
+  if (priv->write_behind_max_pending == 0) {
+    g_mutex_unlock (&priv->lock);
+    return FALSE;
+  }
+
+  entry = g_hash_table_lookup (priv->write_behind_entries, id);
+  if (!entry) {
+    entry = g_slice_new0 (WriteBehindEntry);
+    /* Sources get the media as it was when first edited, along with the
+       edits, as when storing it right away */
+    entry->media = media_copy (media);
+    g_hash_table_insert (priv->write_behind_entries, g_strdup (id), entry);
+    g_queue_push_tail (priv->write_behind_queue, entry);
+
+    /* The first edit sets the deadline of all of them */
+    if (priv->write_behind_delay > 0 &&
+        g_queue_get_length (priv->write_behind_queue) == 1) {
+      timer = g_slice_new (WriteBehindTimer);
+      timer->source = g_object_ref (source);
+      timer->generation = priv->write_behind_generation;
+    }
+  }
+
+  write_behind_merge (entry, media, keys);
+  entry->flags |= flags;
+
+  /* Waiters keep the source alive until the edits are stored */
+  waiter = g_slice_new0 (WriteBehindWaiter);
+  waiter->source = g_object_ref (source);
+  waiter->media = g_object_ref (media);
+  waiter->keys = g_list_copy (keys);
+  waiter->callback = callback;
+  waiter->user_data = user_data;
+  waiter->context = g_main_context_ref_thread_default ();
+  entry->waiters = g_list_append (entry->waiters, waiter);
+
+  flush = g_queue_get_length (priv->write_behind_queue) >=
+    priv->write_behind_max_pending;
+
+  g_mutex_unlock (&priv->lock);
+
+  if (timer) {
+    grl_operation_timeout_add (priv->write_behind_delay,
+                               write_behind_timeout,
+                               timer,
+                               "[grilo] write_behind_timeout");
+  }
+
+  if (flush) {
+    write_behind_flush (source);
+  }
+
+  return TRUE;
+}
+
+static gboolean
+check_options (GrlSource *source,
+               GrlSupportedOps operation,
+               GrlOperationOptions *options)
+{
+  GrlCaps *caps;
+
+  /* FIXME: that check should be in somewhere in GrlOperationOptions */
+  if (grl_operation_options_get_count (options) == 0)
+    return FALSE;
+
+  /* Check only if the source supports the operation */
+  if (grl_source_supported_operations (source) & operation) {
+    caps = grl_source_get_caps (source, operation);
+
+    return grl_operation_options_obey_caps (options, caps, NULL, NULL);
+  } else {
+    return TRUE;
+  }
+}
+
+/* ============= API ============= */
+
+/**
+ * grl_source_supported_keys:
+ * @source: a source
+ *
+ * Get a list of #GrlKeyID, which describe a metadata types that this
+ * source can fetch and store.
+ *
+ * Returns: (element-type GrlKeyID) (transfer none): a #GList with the keys
+ *
+ * Since: 0.2.0
+ */
+const GList *
+grl_source_supported_keys (GrlSource *source)
+{
+  g_return_val_if_fail (GRL_IS_SOURCE (source), NULL);
+
+  if (GRL_SOURCE_GET_CLASS (source)->supported_keys) {
+    return GRL_SOURCE_GET_CLASS (source)->supported_keys (source);
+  } else {
+    return NULL;
+  }
+}
+
+/**
+ * grl_source_slow_keys:
+ * @source: a source
+ *
+ * Similar to grl_source_supported_keys(), but these keys
+ * are marked as slow because of the amount of traffic/processing needed
+ * to fetch them.
+ *
+ * Returns: (element-type GrlKeyID) (transfer none): a #GList with the keys
+ *
+ * Since: 0.2.0
+ */
+const GList *
+grl_source_slow_keys (GrlSource *source)
+{
+  g_return_val_if_fail (GRL_IS_SOURCE (source), NULL);
+
+  if (GRL_SOURCE_GET_CLASS (source)->slow_keys) {
     return GRL_SOURCE_GET_CLASS (source)->slow_keys (source);
   } else {
-    return NULL;
+    return NULL;
+  }
+}
+
+/**
+ * grl_source_writable_keys:
+ * @source: a source
+ *
+ * Similar to grl_source_supported_keys(), but these keys
+ * are marked as writable, meaning the source allows the client
+ * to provide new values for these keys that will be stored permanently.
+ *
+ * Returns: (element-type GrlKeyID) (transfer none):
+ * a #GList with the keys
+ *
+ * Since: 0.2.0
+ */
+const GList *
+grl_source_writable_keys (GrlSource *source)
+{
+  g_return_val_if_fail (GRL_IS_SOURCE (source), NULL);
+
+  if (GRL_SOURCE_GET_CLASS (source)->writable_keys) {
+    return GRL_SOURCE_GET_CLASS (source)->writable_keys (source);
+  } else {
+    return NULL;
+  }
+}
+
+/**
+ * grl_source_get_id:
+ * @source: a source
+ *
+ * Returns: the ID of the @source
+ *
+ * Since: 0.2.0
+ */
+const gchar *
+grl_source_get_id (GrlSource *source)
+{
+  g_return_val_if_fail (GRL_IS_SOURCE (source), NULL);
+
+  return source->priv->id;
+}
+
+/**
+ * grl_source_get_name:
+ * @source: a source
+ *
+ * Returns: the name of the @source
+ *
+ * Since: 0.2.0
+ */
+const gchar *
+grl_source_get_name (GrlSource *source)
+{
+  g_return_val_if_fail (GRL_IS_SOURCE (source), NULL);
+
+  return source->priv->name;
+}
+
+/**
+ * grl_source_get_icon:
+ * @source: a source
+ *
+ * Returns: (transfer none): a #GIcon
+ *
+ * Since: 0.2.8
+ */
+GIcon *
+grl_source_get_icon (GrlSource *source)
+{
+  g_return_val_if_fail (GRL_IS_SOURCE (source), NULL);
+
+  return source->priv->icon;
+}
+
+/**
+ * grl_source_get_description:
+ * @source: a source
+ *
+ * Returns: the description of the @source
+ *
+ * Since: 0.2.0
+ */
+const gchar *
+grl_source_get_description (GrlSource *source)
+{
+  g_return_val_if_fail (GRL_IS_SOURCE (source), NULL);
+
+  return source->priv->desc;
+}
+
+/**
+ * grl_source_get_tags:
+ * @source: a source
+ *
+ * Returns: (element-type utf8) (transfer none): a %NULL-terminated list of tags
+ *
+ * Since: 0.2.10
+ */
+const char **
+grl_source_get_tags (GrlSource *source)
+{
+  g_return_val_if_fail (GRL_IS_SOURCE (source), NULL);
+
+  return (const char **) source->priv->tags->pdata;
+}
+
+/**
+ * grl_source_get_uri_prefixes:
+ * @source: a source
+ *
+ * Returns: (element-type utf8) (transfer none) (nullable): a
+ * %NULL-terminated list of the URI prefixes declared by @source, or %NULL
+ * if it declares none. See #GrlSource:uri-prefixes
+ *
+ * Since: 0.3.20
+ */
+const gchar **
+grl_source_get_uri_prefixes (GrlSource *source)
+{
+  g_return_val_if_fail (GRL_IS_SOURCE (source), NULL);
+
+  return (const gchar **) source->priv->uri_prefixes;
+}
+
+/**
+ * grl_source_get_plugin:
+ * @source: a source
+ *
+ * Returns: (transfer none): the plugin this source belongs to
+ *
+ * Since: 0.2.0
+ **/
+GrlPlugin *
+grl_source_get_plugin (GrlSource *source)
+{
+  g_return_val_if_fail (GRL_IS_SOURCE (source), NULL);
+
+  return source->priv->plugin;
+}
+
+/**
+ * grl_source_get_rank:
+ * @source: a source
+ *
+ * Gets the source rank
+ *
+ * Returns: rank value
+ *
+ * Since: 0.2.0
+ **/
+gint
+grl_source_get_rank (GrlSource *source)
+{
+  g_return_val_if_fail (GRL_IS_SOURCE (source), 0);
+
+  return source->priv->rank;
+}
+
+/**
+ * grl_source_get_supported_media:
+ * @source: a source
+ *
+ * Gets the supported type of medias @source can deal with.
+ *
+ * Returns: a #GrlSupportedMedia value
+ *
+ * Since: 0.3.0
+ **/
+GrlSupportedMedia
+grl_source_get_supported_media (GrlSource *source)
+{
+  g_return_val_if_fail (GRL_IS_SOURCE (source), 0);
+
+  return source->priv->supported_media;
+}
+
+/**
+ * grl_source_supported_operations:
+ * @source: a source
+ *
+ * By default the derived objects of #GrlSource can only resolve.
+ *
+ * Returns: (type uint): a bitwise mangle with the supported operations by
+ * the source
+ *
+ * Since: 0.2.0
+ */
+GrlSupportedOps
+grl_source_supported_operations (GrlSource *source)
+{
+  GrlSupportedOps ops = GRL_OP_NONE;
+  GrlSourceClass *source_class;
+
+  g_return_val_if_fail (GRL_IS_SOURCE (source), GRL_OP_NONE);
+
+  source_class = GRL_SOURCE_GET_CLASS (source);
+
+  if (source_class->supported_operations) {
+    return  source_class->supported_operations (source);
+  }
+
+  if (source_class->resolve) {
+    ops |= GRL_OP_RESOLVE;
+  }
+  if ((source_class->test_media_from_uri || source->priv->uri_prefixes) &&
+      source_class->media_from_uri) {
+    ops |= GRL_OP_MEDIA_FROM_URI;
+  }
+  if (source_class->browse) {
+    ops |= GRL_OP_BROWSE;
+  }
+  if (source_class->search) {
+    ops |= GRL_OP_SEARCH;
+  }
+  if (source_class->query) {
+    ops |= GRL_OP_QUERY;
+  }
+  if (source_class->remove) {
+    ops |= GRL_OP_REMOVE;
+  }
+  if (source_class->store_metadata) {
+    ops |= GRL_OP_STORE_METADATA;
+  }
+  if (source_class->store) {
+    ops |= GRL_OP_STORE;
+  }
+
+  if (source_class->notify_change_start &&
+      source_class->notify_change_stop) {
+    ops |= GRL_OP_NOTIFY_CHANGE;
+  }
+
+  return ops;
+}
+
+/**
+ * grl_source_get_auto_split_threshold:
+ * @source: a source
+ *
+ * Gets how much elements the source is able to handle in a single request.
+ *
+ * See #grl_source_set_auto_split_threshold()
+ *
+ * If the threshold is adapted to the performance of the source (see
+ * grl_source_set_auto_split_limits()), this is its current value.
+ *
+ * Returns: the assigned threshold, or 0 if there is no threshold
+ *
+ * Since: 0.2.0
+ */
+guint
+grl_source_get_auto_split_threshold (GrlSource *source)
+{
+  g_return_val_if_fail (GRL_IS_SOURCE (source), 0);
+
+  return source->priv->auto_split_threshold;
+}
+
+/**
+ * grl_source_set_auto_split_threshold:
+ * @source: a source
+ * @threshold: the threshold to set
+ *
+ * Sets how much elements the source is able to handle in a single request.
+ *
+ * If user, during a search or browsing operation, asks for more elements than
+ * the threshold, the request will be automatically splitted in chunks, so up to
+ * @threshold elements will be asked in each request.
+ *
+ * Source will act as if user were asking just a chunk, and user won't notice
+ * that the request was chunked.
+ *
+ * <note>
+ *  <para>
+ *    This function is intended to be used only by plugins.
+ *  </para>
+ * </note>
+ *
+ * Since: 0.2.0
+ */
+void
+grl_source_set_auto_split_threshold (GrlSource *source,
+                                     guint threshold)
+{
+  g_return_if_fail (GRL_IS_SOURCE (source));
+
+  source->priv->auto_split_threshold = threshold;
+}
+
+/**
+ * grl_source_get_auto_split_limits:
+ * @source: a source
+ * @min_threshold: (out) (optional): the lower bound of the threshold
+ * @max_threshold: (out) (optional): the upper bound of the threshold
+ *
+ * Gets the bounds the auto-split threshold is adapted within.
+ *
+ * See #grl_source_set_auto_split_limits()
+ *
+ * Since: 0.3.20
+ */
+void
+grl_source_get_auto_split_limits (GrlSource *source,
+                                  guint *min_threshold,
+                                  guint *max_threshold)
+{
+  g_return_if_fail (GRL_IS_SOURCE (source));
+
+  if (min_threshold) {
+    *min_threshold = source->priv->auto_split_min_threshold;
+  }
+  if (max_threshold) {
+    *max_threshold = source->priv->auto_split_max_threshold;
+  }
+}
+
+/**
+ * grl_source_set_auto_split_limits:
+ * @source: a source
+ * @min_threshold: the lower bound of the threshold
+ * @max_threshold: the upper bound of the threshold, or 0 to keep the
+ * threshold fixed
+ *
+ * Makes the auto-split threshold adapt to the performance of the source.
+ *
+ * The time until the first element and the number of elements per second
+ * are measured for each chunk, and the threshold is made bigger or smaller,
+ * between @min_threshold and @max_threshold, to get the elements as fast as
+ * possible. The current value can be obtained with
+ * grl_source_get_auto_split_threshold().
+ *
+ * <note>
+ *  <para>
+ *    This function is intended to be used only by plugins.
+ *  </para>
+ * </note>
+ *
+ * Since: 0.3.20
+ */
+void
+grl_source_set_auto_split_limits (GrlSource *source,
+                                  guint min_threshold,
+                                  guint max_threshold)
+{
+  GrlSourcePrivate *priv;
+
+  g_return_if_fail (GRL_IS_SOURCE (source));
+  g_return_if_fail (max_threshold == 0 || min_threshold <= max_threshold);
+
+  priv = source->priv;
+  g_mutex_lock (&priv->lock);
+  priv->auto_split_min_threshold = min_threshold;
+  priv->auto_split_max_threshold = max_threshold;
+  priv->auto_split_throughput = 0;
+
+  if (max_threshold > 0) {
+    priv->auto_split_threshold = CLAMP (priv->auto_split_threshold,
+                                        MAX (min_threshold, 1),
+                                        max_threshold);
+  }
+  g_mutex_unlock (&priv->lock);
+}
+
+/**
+ * grl_source_get_auto_split_prefetch:
+ * @source: a source
+ *
+ * Gets how many chunks of an auto-split request are asked in advance.
+ *
+ * See #grl_source_set_auto_split_prefetch()
+ *
+ * Returns: the number of chunks requested in advance
+ *
+ * Since: 0.3.20
+ */
+guint
+grl_source_get_auto_split_prefetch (GrlSource *source)
+{
+  g_return_val_if_fail (GRL_IS_SOURCE (source), 0);
+
+  return source->priv->auto_split_prefetch;
+}
+
+/**
+ * grl_source_set_auto_split_prefetch:
+ * @source: a source
+ * @depth: the number of chunks to request in advance
+ *
+ * Sets how many chunks of an auto-split request are asked in advance.
+ *
+ * By default, when a request is split because of the auto-split threshold,
+ * each chunk is asked once the previous one has been fully received. With a
+ * @depth bigger than 0, up to @depth following chunks are requested while
+ * the current one is still being received, so the latency of each request is
+ * hidden. Results of those chunks are kept until it is their turn, so user
+ * still gets them in order.
+ *
+ * <note>
+ *  <para>
+ *    This function is intended to be used only by plugins.
+ *  </para>
+ * </note>
+ *
+ * Since: 0.3.20
+ */
+void
+grl_source_set_auto_split_prefetch (GrlSource *source,
+                                    guint depth)
+{
+  g_return_if_fail (GRL_IS_SOURCE (source));
+
+  source->priv->auto_split_prefetch = depth;
+}
+
+/**
+ * grl_source_get_resolve_concurrency:
+ * @source: a source
+ *
+ * Gets how many resolve operations can run at the same time in @source to
+ * complete results of other sources.
+ *
+ * See #grl_source_set_resolve_concurrency()
+ *
+ * Returns: the maximum number of concurrent resolves, or 0 if there is no limit
+ *
+ * Since: 0.3.20
+ */
+guint
+grl_source_get_resolve_concurrency (GrlSource *source)
+{
+  g_return_val_if_fail (GRL_IS_SOURCE (source), 0);
+
+  return source->priv->resolve_concurrency;
+}
+
+/**
+ * grl_source_set_resolve_concurrency:
+ * @source: a source
+ * @concurrency: the maximum number of concurrent resolves, or 0 for no limit
+ *
+ * Sets how many resolve operations can run at the same time in @source to
+ * complete results of other sources, when they are requested with
+ * %GRL_RESOLVE_FULL.
+ *
+ * When the limit is reached, further requests wait until one of the running
+ * ones finishes. Browse, search and query operations whose results are
+ * waiting to be completed defer asking for more elements to the source
+ * meanwhile. This is useful for sources relying on remote services that
+ * throttle clients sending too many requests.
+ *
+ * Since: 0.3.20
+ */
+void
+grl_source_set_resolve_concurrency (GrlSource *source,
+                                    guint concurrency)
+{
+  g_return_if_fail (GRL_IS_SOURCE (source));
+
+  source->priv->resolve_concurrency = concurrency;
+  decorate_resolve_run_waiting (source);
+}
+
+/**
+ * grl_source_get_remove_concurrency:
+ * @source: a source
+ *
+ * Gets how many remove operations can run at the same time in @source when
+ * removing several elements at once.
+ *
+ * See #grl_source_set_remove_concurrency()
+ *
+ * Returns: the maximum number of concurrent removes, or 0 if there is no limit
+ *
+ * Since: 0.3.20
+ */
+guint
+grl_source_get_remove_concurrency (GrlSource *source)
+{
+  g_return_val_if_fail (GRL_IS_SOURCE (source), 0);
+
+  return source->priv->remove_concurrency;
+}
+
+/**
+ * grl_source_set_remove_concurrency:
+ * @source: a source
+ * @concurrency: the maximum number of concurrent removes, or 0 for no limit
+ *
+ * Sets how many remove operations can run at the same time in @source when
+ * grl_source_remove_batch() asks it to remove the elements one by one,
+ * because it does not implement remove_batch. It is 4 by default.
+ *
+ * Batches already running apply the new limit when starting their next
+ * removes.
+ *
+ * Since: 0.3.20
+ */
+void
+grl_source_set_remove_concurrency (GrlSource *source,
+                                   guint concurrency)
+{
+  g_return_if_fail (GRL_IS_SOURCE (source));
+
+  source->priv->remove_concurrency = concurrency;
+}
+
+/**
+ * grl_source_get_resolve_cache_ttl:
+ * @source: a source
+ *
+ * Gets for how long the metadata resolved by @source is cached.
+ *
+ * See #grl_source_set_resolve_cache_ttl()
+ *
+ * Returns: the time-to-live in seconds, or 0 if metadata is not cached
+ *
+ * Since: 0.3.20
+ */
+guint
+grl_source_get_resolve_cache_ttl (GrlSource *source)
+{
+  g_return_val_if_fail (GRL_IS_SOURCE (source), 0);
+
+  if (!source->priv->resolve_cache_ttl_set) {
+    return grl_resolve_cache_get_default_ttl ();
+  }
+
+  return source->priv->resolve_cache_ttl;
+}
+
+/**
+ * grl_source_set_resolve_cache_ttl:
+ * @source: a source
+ * @ttl: the time-to-live in seconds, or 0 to not cache metadata
+ *
+ * Sets for how long the metadata resolved by @source is cached.
+ *
+ * When it is not 0, the keys @source provides, or fails to provide, when
+ * resolving a media with an id are kept in a cache shared by all sources.
+ * Further resolutions of the same media asking for keys that are all in the
+ * cache and are not older than @ttl seconds do not reach @source.
+ *
+ * Cached metadata of a media is dropped when its source notifies it changed,
+ * or when it is stored or removed through Grilo. The size of the cache is
+ * bounded; the least recently used medias are dropped first. The bound can
+ * be changed with the <literal>GRL_RESOLVE_CACHE_SIZE</literal> environment
+ * variable or the <literal>--grl-resolve-cache-size</literal> option, in
+ * bytes.
+ *
+ * If it is not set, metadata is not cached unless a metadata store is
+ * configured, with the <literal>GRL_METADATA_STORE</literal> environment
+ * variable or the <literal>--grl-metadata-store</literal> option. Metadata
+ * is then cached, and kept on disk, for one day.
+ *
+ * Since: 0.3.20
+ */
+void
+grl_source_set_resolve_cache_ttl (GrlSource *source,
+                                  guint ttl)
+{
+  g_return_if_fail (GRL_IS_SOURCE (source));
+
+  if (ttl == 0 && grl_source_get_resolve_cache_ttl (source) > 0 &&
+      source->priv->id) {
+    grl_resolve_cache_invalidate (source->priv->id, NULL);
+  }
+  source->priv->resolve_cache_ttl = ttl;
+  source->priv->resolve_cache_ttl_set = TRUE;
+}
+
+/**
+ * grl_source_get_thread_safe_operations:
+ * @source: a source
+ *
+ * Gets the operations of @source that can run in a thread.
+ *
+ * See #grl_source_set_thread_safe_operations()
+ *
+ * Returns: the thread-safe operations
+ *
+ * Since: 0.3.20
+ */
+GrlSupportedOps
+grl_source_get_thread_safe_operations (GrlSource *source)
+{
+  g_return_val_if_fail (GRL_IS_SOURCE (source), GRL_OP_NONE);
+
+  return source->priv->thread_safe_operations;
+}
+
+/**
+ * grl_source_set_thread_safe_operations:
+ * @source: a source
+ * @operations: the operations that can run in a thread
+ *
+ * Declares which operations of @source can run in a thread other than the
+ * one that requested them, so CPU-heavy sources do not block the
+ * application's main loop. Only %GRL_OP_RESOLVE, %GRL_OP_BROWSE,
+ * %GRL_OP_SEARCH, %GRL_OP_QUERY and %GRL_OP_MEDIA_FROM_URI can run in a
+ * thread; other flags are ignored.
+ *
+ * Those operations are run in a pool of threads shared by all sources, so
+ * several of them can run at the same time, even for the same source.
+ * Results are sent back to the thread-default main context of the thread
+ * that requested the operation, in the same order the source sent them.
+ * Note that the cancel vmethod is still invoked in the requesting thread.
+ *
+ * This is intended to be called by sources when they are created.
+ *
+ * Since: 0.3.20
+ */
+void
+grl_source_set_thread_safe_operations (GrlSource *source,
+                                       GrlSupportedOps operations)
+{
+  g_return_if_fail (GRL_IS_SOURCE (source));
+
+  source->priv->thread_safe_operations = operations & THREADED_OPERATIONS;
+}
+
+/**
+ * grl_source_get_write_behind:
+ * @source: a source
+ * @max_pending: (out) (optional): the number of edited medias kept
+ * @delay: (out) (optional): the milliseconds edits are kept
+ *
+ * Gets how edits are kept before being stored in @source.
+ *
+ * See #grl_source_set_write_behind()
+ *
+ * Since: 0.3.20
+ */
+void
+grl_source_get_write_behind (GrlSource *source,
+                             guint *max_pending,
+                             guint *delay)
+{
+  g_return_if_fail (GRL_IS_SOURCE (source));
+
+  if (max_pending) {
+    *max_pending = source->priv->write_behind_max_pending;
+  }
+  if (delay) {
+    *delay = source->priv->write_behind_delay;
+  }
+}
+
+/**
+ * grl_source_set_write_behind:
+ * @source: a source
+ * @max_pending: the number of edited medias kept, or 0 to store edits as
+ * soon as they are requested
+ * @delay: the milliseconds edits are kept, or 0 to keep them until there
+ * are @max_pending edited medias
+ *
+ * Makes grl_source_store_metadata() and grl_source_store_metadata_async()
+ * keep the edits of medias with an id instead of storing them right away.
+ * Edits of the same media are merged, and the kept edits are stored together
+ * with grl_source_store_metadata_batch() when there are @max_pending edited
+ * medias, or @delay milliseconds after the first of them.
+ * grl_source_flush_metadata() stores them at any moment.
+ *
+ * The callback of each edit is invoked once it has been stored. Edits not
+ * stored yet keep @source alive.
+ *
+ * As the failed keys of grl_source_store_metadata_batch() are those of the
+ * whole batch, a key that could not be stored in one media is reported as
+ * failed to all the edits of that key stored along with it.
+ *
+ * Disabling write-behind stores the edits that were kept.
+ *
+ * Since: 0.3.20
+ */
+void
+grl_source_set_write_behind (GrlSource *source,
+                             guint max_pending,
+                             guint delay)
+{
+  g_return_if_fail (GRL_IS_SOURCE (source));
+
+  g_mutex_lock (&source->priv->lock);
+  source->priv->write_behind_max_pending = max_pending;
+  source->priv->write_behind_delay = delay;
+  g_mutex_unlock (&source->priv->lock);
+
+  if (max_pending == 0) {
+    grl_source_flush_metadata (source);
+  }
+}
+
+/**
+ * grl_source_resolve:
+ * @source: a source
+ * @media: (allow-none) (transfer full): a data transfer object
+ * @keys: (element-type GrlKeyID): the #GList of
+ * #GrlKeyID<!-- -->s to request
+ * @options: options to pass to this operation
+ * @callback: (scope notified): the user defined callback
+ * @user_data: the user data to pass in the callback
+ *
+ * This method is intended to fetch the requested keys of metadata of
+ * a given @media to the media source.
+ *
+ * This method is asynchronous.
+ *
+ * Returns: the operation identifie
+ *
+ * Since: 0.2.0
+ */
+guint
+grl_source_resolve (GrlSource *source,
+                    GrlMedia *media,
+                    const GList *keys,
+                    GrlOperationOptions *options,
+                    GrlSourceResolveCb callback,
+                    gpointer user_data)
+{
+  GList *_keys;
+  GList *each_key;
+  GList *delete_key;
+  struct ResolveRelayCb *rrc;
+  guint operation_id;
+  GList *sources = NULL;
+  GrlResolutionFlags flags;
+  GrlOperationOptions *resolve_options;
+  ResolutionPlan *plan;
+  GList *checks = NULL;
+  gchar *plan_key;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  g_return_val_if_fail (GRL_IS_SOURCE (source), 0);
+  g_return_val_if_fail (GRL_IS_OPERATION_OPTIONS (options), 0);
+  g_return_val_if_fail (keys != NULL, 0);
+  g_return_val_if_fail (callback != NULL, 0);
+  g_return_val_if_fail (check_options (source, GRL_OP_RESOLVE, options), 0);
+
+  if (!media) {
+    /* Special case, NULL media ==> root container */
+    media = grl_media_container_new ();
+    grl_media_set_id (media, NULL);
+    grl_media_set_source (media, grl_source_get_id (source));
+  } else if (!grl_media_get_source (media)) {
+    grl_media_set_source (media, grl_source_get_id (source));
+  }
+
+  flags = grl_operation_options_get_resolution_flags (options);
+
+  /* Check if the same plan was already computed for a similar element */
+  plan_key = plan_key_new ("resolve", source, media, (GList *) keys, flags);
+  plan = plan_cache_lookup (plan_key, media);
+  if (plan) {
+    g_clear_pointer (&plan_key, g_free);
+    _keys = NULL;
+  } else {
+    /* By default assume we will use the parameters specified by the user */
+    _keys = filter_known_keys (media, (GList *) keys);
+  }
+
+  if (flags & GRL_RESOLVE_FULL) {
+    GRL_DEBUG ("requested full metadata");
+    if (!plan) {
+      sources = grl_registry_get_sources_by_operations (grl_registry_get_default (),
+                                                        GRL_OP_RESOLVE,
+                                                        TRUE);
+      /* Put current source on top, if it supports resolve() */
+      if (grl_source_supported_operations (source) & GRL_OP_RESOLVE) {
+        sources = g_list_remove (sources, source);
+        sources = g_list_prepend (sources, source);
+      }
+    }
+    flags &= ~GRL_RESOLVE_FULL;
+    resolve_options = grl_operation_options_copy (options);
+    grl_operation_options_set_resolution_flags (resolve_options, flags);
+  } else {
+    /* Consider only this source, if it supports resolve() */
+    if (!plan &&
+        grl_source_supported_operations (source) & GRL_OP_RESOLVE) {
+      sources = g_list_prepend (NULL, source);
+    }
+    resolve_options = g_object_ref (options);
+  }
+
+  if (flags & GRL_RESOLVE_FAST_ONLY) {
+    GRL_DEBUG ("requested fast keys");
+  }
+
+  operation_id = grl_operation_generate_id ();
+
+  operation_set_ongoing (source, operation_id, GRL_OP_RESOLVE);
+
+  /* Always hook an own relay callback so we can do some
+     post-processing before handing out the results
+     to the user */
+  rrc = g_slice_new0 (struct ResolveRelayCb);
+  rrc->source = g_object_ref (source);
+  rrc->operation_type = GRL_OP_RESOLVE;
+  rrc->operation_id = operation_id;
+  rrc->media = g_object_ref (media);
+  rrc->user_callback = callback;
+  rrc->user_data = user_data;
+  rrc->options = resolve_options;
+  rrc->deadline_id = operation_deadline_start (options,
+                                               resolve_deadline_cb,
+                                               rrc);
+
+  if (plan) {
+    resolution_plan_apply (plan, rrc, media);
+    resolution_plan_unref (plan);
+    goto run_specs;
+  }
+
+  /* If there are no sources able to solve just send the media */
+  if (g_list_length (sources) == 0) {
+    g_free (plan_key);
+    g_list_free (_keys);
+    grl_operation_idle_add (operation_relay_priority (options),
+                            resolve_all_done,
+                            rrc,
+                            NULL,
+                            "[grilo] resolve_all_done");
+    return operation_id;
+  }
+
+  _keys = filter_unresolvable_keys (sources, &_keys);
+
+  rrc->keys = _keys;
+  rrc->map = map_keys_new ();
+  rrc->resolve_specs = map_sources_new ();
+
+  map_keys_to_sources (rrc->map, _keys, sources, media,
+                       flags & GRL_RESOLVE_FAST_ONLY, &checks);
+  g_list_free (sources);
+
+  each_key = rrc->keys;
+  while (each_key) {
+    if (map_sources_to_specs (rrc->resolve_specs, rrc->map, media,
+                              GRLPOINTER_TO_KEYID (each_key->data),
+                              resolve_options, rrc)) {
+      each_key = g_list_next (each_key);
+    } else {
+      delete_key = each_key;
+      each_key = g_list_next (each_key);
+      rrc->keys = g_list_delete_link (rrc->keys, delete_key);
+    }
+  }
+
+  resolution_plan_store (plan_key, rrc, checks);
+
+ run_specs:
+  rrc->specs_to_invoke = g_hash_table_get_values (rrc->resolve_specs);
+  if (rrc->specs_to_invoke) {
+    grl_operation_idle_add (operation_relay_priority (options),
+                            resolve_idle,
+                            rrc,
+                            NULL,
+                            "[grilo] resolve_idle");
+  } else {
+    grl_operation_idle_add (operation_relay_priority (options),
+                            resolve_all_done,
+                            rrc,
+                            NULL,
+                            "[grilo] resolve_all_done");
+  }
+
+  return operation_id;
+}
+
+/**
+ * grl_source_resolve_sync:
+ * @source: a source
+ * @media: (allow-none) (transfer full): a data transfer object
+ * @keys: (element-type GrlKeyID): the #GList of
+ * #GrlKeyID<!-- -->s to request
+ * @options: options to pass to this operation
+ * @error: a #GError, or @NULL
+ *
+ * This method is intended to fetch the requested keys of metadata of
+ * a given @media to the media source.
+ *
+ * This method is synchronous.
+ *
+ * Returns: (transfer full): a filled #GrlMedia
+ *
+ * Since: 0.2.0
+ */
+GrlMedia *
+grl_source_resolve_sync (GrlSource *source,
+                         GrlMedia *media,
+                         const GList *keys,
+                         GrlOperationOptions *options,
+                         GError **error)
+{
+  GrlDataSync *ds;
+
+  ds = g_slice_new0 (GrlDataSync);
+
+  if (grl_source_resolve (source,
+                          media,
+                          keys,
+                          options,
+                          resolve_result_async_cb,
+                          ds))
+    grl_wait_for_async_operation_complete (ds);
+
+  if (ds->error) {
+    if (error) {
+      *error = ds->error;
+    } else {
+      g_error_free (ds->error);
+    }
+  }
+
+  g_slice_free (GrlDataSync, ds);
+
+  return media;
+}
+
+/**
+ * grl_source_resolve_batch:
+ * @source: a source
+ * @medias: (element-type GrlMedia) (transfer none): the #GPtrArray of
+ * #GrlMedia to complete
+ * @keys: (element-type GrlKeyID): the #GList of
+ * #GrlKeyID<!-- -->s to request
+ * @options: options to pass to this operation
+ * @callback: (scope notified): the user defined callback
+ * @user_data: the user data to pass in the callback
+ *
+ * This method is intended to fetch the requested keys of metadata of
+ * all the elements in @medias with a single operation.
+ *
+ * Sources implementing the resolve_batch vmethod get a single request
+ * with the elements they must be asked for, which allows them to ask a
+ * remote service for them at once. As in grl_source_resolve(), elements
+ * whose keys are in the resolve cache, or for which an identical request is
+ * already running, are not sent to the source. For the rest of sources, or
+ * if @options request %GRL_RESOLVE_FULL, each element is resolved as in
+ * grl_source_resolve().
+ *
+ * @callback is invoked once, when all elements have been resolved.
+ *
+ * This method is asynchronous.
+ *
+ * Returns: the operation identifier
+ *
+ * Since: 0.3.20
+ */
+guint
+grl_source_resolve_batch (GrlSource *source,
+                          GPtrArray *medias,
+                          const GList *keys,
+                          GrlOperationOptions *options,
+                          GrlSourceResolveBatchCb callback,
+                          gpointer user_data)
+{
+  struct ResolveBatchRelayCb *rbrc;
+  GrlResolutionFlags flags;
+  guint operation_id;
+  guint i;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  g_return_val_if_fail (GRL_IS_SOURCE (source), 0);
+  g_return_val_if_fail (medias != NULL, 0);
+  g_return_val_if_fail (GRL_IS_OPERATION_OPTIONS (options), 0);
+  g_return_val_if_fail (keys != NULL, 0);
+  g_return_val_if_fail (callback != NULL, 0);
+  g_return_val_if_fail (check_options (source, GRL_OP_RESOLVE, options), 0);
+
+  for (i = 0; i < medias->len; i++) {
+    GrlMedia *media = g_ptr_array_index (medias, i);
+    if (!grl_media_get_source (media)) {
+      grl_media_set_source (media, grl_source_get_id (source));
+    }
+  }
+
+  flags = grl_operation_options_get_resolution_flags (options);
+  operation_id = grl_operation_generate_id ();
+  grl_operation_set_info (operation_id, GRL_OP_RESOLVE, source);
+
+  rbrc = g_slice_new0 (struct ResolveBatchRelayCb);
+  rbrc->source = g_object_ref (source);
+  rbrc->operation_id = operation_id;
+  rbrc->medias = g_ptr_array_ref (medias);
+  rbrc->options = grl_operation_options_copy (options);
+  rbrc->user_callback = callback;
+  rbrc->user_data = user_data;
+  rbrc->pending = g_hash_table_new (g_direct_hash, g_direct_equal);
+  grl_operation_set_private_data (operation_id,
+                                  rbrc,
+                                  (GrlOperationCancelCb) resolve_batch_each_cancel_cb,
+                                  NULL);
+
+  if (GRL_SOURCE_GET_CLASS (source)->resolve_batch &&
+      !(flags & GRL_RESOLVE_FULL)) {
+    /* Only ask the source for the keys it knows about */
+    rbrc->keys = g_list_copy ((GList *) keys);
+    filter_supported (source, &rbrc->keys, FALSE);
+
+    grl_operation_idle_add (operation_relay_priority (options),
+                            resolve_batch_idle,
+                            rbrc,
+                            NULL,
+                            "[grilo] resolve_batch_idle");
+
+    return operation_id;
+  }
+
+  /* Resolve each element on its own */
+  for (i = 0; i < medias->len; i++) {
+    guint resolve_id = grl_source_resolve (source,
+                                           g_ptr_array_index (medias, i),
+                                           keys,
+                                           options,
+                                           resolve_batch_each_cb,
+                                           rbrc);
+    if (resolve_id > 0) {
+      g_hash_table_add (rbrc->pending, GUINT_TO_POINTER (resolve_id));
+    }
+  }
+
+  if (g_hash_table_size (rbrc->pending) == 0) {
+    grl_operation_idle_add (operation_relay_priority (options),
+                            resolve_batch_each_done,
+                            rbrc,
+                            NULL,
+                            "[grilo] resolve_batch_each_done");
+  }
+
+  return operation_id;
+}
+
+/**
+ * grl_source_may_resolve:
+ * @source: a source
+ * @media: a media on which we want more metadata
+ * @key_id: the key corresponding to a metadata we might want
+ * @missing_keys: (element-type GrlKeyID): an optional originally empty list
+ *
+ * Checks whether @key_id may be resolved with @source for @media, so that the
+ * caller can avoid calling grl_source_resolve() if it can be known in
+ * advance it will fail.
+ *
+ * If the resolution is known to be impossible because more keys are needed in
+ * @media, and @missing_keys is not @NULL, it is populated with the list of
+ * GrlKeyID that would be needed.
+ *
+ * This function is synchronous and should not block.
+ *
+ * Returns: @TRUE if there's a possibility that @source resolves @key_id for
+ * @media, @FALSE otherwise.
+ *
+ * Since: 0.2.0
+ */
+gboolean
+grl_source_may_resolve (GrlSource *source,
+                        GrlMedia *media,
+                        GrlKeyID key_id,
+                        GList **missing_keys)
+{
+  GrlSourceClass *klass;
+  const gchar *media_source;
+  GrlKeySet *supported;
+  gboolean may_resolve;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  g_return_val_if_fail (GRL_IS_SOURCE (source), FALSE);
+  g_return_val_if_fail (!missing_keys || !*missing_keys, FALSE);
+
+  klass = GRL_SOURCE_GET_CLASS (source);
+
+  if (klass->may_resolve) {
+    return klass->may_resolve (source, media, key_id, missing_keys);
+  }
+
+  /* Default behaviour is to assume that if source implements resolve, then any
+     supported key for its own content is resolved */
+  if (klass->resolve) {
+    GRL_DEBUG ("Using default may_resolve()");
+    /* We need to know the media source */
+    if (media == NULL ||
+        (media_source = grl_media_get_source (media)) == NULL) {
+      if (missing_keys) {
+        *missing_keys = NULL;
+        *missing_keys =
+          g_list_prepend (*missing_keys,
+                          GRLKEYID_TO_POINTER (GRL_METADATA_KEY_SOURCE));
+      }
+      return FALSE;
+    }
+    /* Content is from different source */
+    if (g_strcmp0 (grl_source_get_id (source), media_source) != 0) {
+      return FALSE;
+    }
+    /* Check if the key is supported */
+    supported = supported_key_set (source);
+    may_resolve = grl_key_set_contains (supported, key_id);
+    grl_key_set_unref (supported);
+    return may_resolve;
+  } else {
+    GRL_WARNING ("Source %s does not implement may_resolve()",
+                 grl_source_get_id (source));
+    return FALSE;
+  }
+}
+
+/**
+ * grl_source_test_media_from_uri:
+ * @source: a source
+ * @uri: A URI that can be used to identify a media resource
+ *
+ * Tests whether @source can instantiate a #GrlMedia object representing
+ * the media resource exposed at @uri.
+ *
+ * Sources declaring #GrlSource:uri-prefixes can do it for the URIs starting
+ * with any of them. Other URIs are tested with the test_media_from_uri
+ * implementation of the source, if it has one.
+ *
+ * Returns: %TRUE if it can, %FALSE otherwise.
+ *
+ * This method is synchronous.
+ *
+ * Since: 0.2.0
+ */
+gboolean
+grl_source_test_media_from_uri (GrlSource *source,
+                                const gchar *uri)
+{
+  GRL_DEBUG (__FUNCTION__);
+
+  g_return_val_if_fail (GRL_IS_SOURCE (source), FALSE);
+  g_return_val_if_fail (uri != NULL, FALSE);
+
+  if (source->priv->uri_prefixes) {
+    gchar **prefix;
+
+    for (prefix = source->priv->uri_prefixes; *prefix; prefix++) {
+      if (grl_uri_index_has_prefix (uri, *prefix)) {
+        return TRUE;
+      }
+    }
+  }
+
+  if (GRL_SOURCE_GET_CLASS (source)->test_media_from_uri) {
+    return GRL_SOURCE_GET_CLASS (source)->test_media_from_uri (source, uri);
+  } else {
+    return FALSE;
+  }
+}
+
+/**
+ * grl_source_get_media_from_uri:
+ * @source: a source
+ * @uri: A URI that can be used to identify a media resource
+ * @keys: (element-type GrlKeyID): A list of keys to resolve
+ * @options: options wanted for that operation
+ * @callback: (scope notified): the user defined callback
+ * @user_data: the user data to pass in the callback
+ *
+ * Creates an instance of #GrlMedia representing the media resource
+ * exposed at @uri.
+ *
+ * It is recommended to call grl_source_test_media_from_uri() before invoking
+ * this to check whether the target source can theoretically do the resolution.
+ *
+ * This method is asynchronous.
+ *
+ * Returns: the operation identifier
+ *
+ * Since: 0.2.0
+ */
+guint
+grl_source_get_media_from_uri (GrlSource *source,
+                               const gchar *uri,
+                               const GList *keys,
+                               GrlOperationOptions *options,
+                               GrlSourceResolveCb callback,
+                               gpointer user_data)
+{
+  GList *_keys;
+  GrlSourceMediaFromUriSpec *mfus;
+  struct ResolveRelayCb *rrc;
+  guint operation_id;
+  GrlResolutionFlags flags;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  g_return_val_if_fail (GRL_IS_SOURCE (source), 0);
+  g_return_val_if_fail (GRL_IS_OPERATION_OPTIONS (options), 0);
+  g_return_val_if_fail (uri != NULL, 0);
+  g_return_val_if_fail (keys != NULL, 0);
+  g_return_val_if_fail (callback != NULL, 0);
+  g_return_val_if_fail (grl_source_supported_operations (source) &
+                        GRL_OP_MEDIA_FROM_URI, 0);
+  g_return_val_if_fail (check_options (source, GRL_OP_MEDIA_FROM_URI, options), 0);
+
+  _keys = g_list_copy ((GList *) keys);
+  flags = grl_operation_options_get_resolution_flags (options);
+
+  if (flags & GRL_RESOLVE_FAST_ONLY) {
+    filter_slow (source, &_keys, FALSE);
+  }
+
+  if (flags & GRL_RESOLVE_FULL) {
+    _keys = expand_operation_keys (source, NULL, _keys);
+  }
+
+  operation_id = grl_operation_generate_id ();
+
+  /* We cannot prepare for full resolution yet because we don't
+     have a GrlMedia t operate with.
+     TODO: full resolution could be added in the relay calback
+     when we get the GrlMedia object */
+
+  /* Always hook an own relay callback so we can do some
+     post-processing before handing out the results
+     to the user */
+  rrc = g_slice_new0 (struct ResolveRelayCb);
+  rrc->source = g_object_ref (source);
+  rrc->operation_type = GRL_OP_MEDIA_FROM_URI;
+  rrc->operation_id = operation_id;
+  rrc->keys = _keys;
+  rrc->options = g_object_ref (options);
+  rrc->user_callback = callback;
+  rrc->user_data = user_data;
+
+  mfus = g_new0 (GrlSourceMediaFromUriSpec, 1);
+  mfus->source = g_object_ref (source);
+  mfus->operation_id = operation_id;
+  mfus->uri = g_strdup (uri);
+  mfus->keys = _keys;
+  mfus->options = grl_operation_options_copy (options);
+  mfus->callback = media_from_uri_result_relay_cb;
+  mfus->user_data = rrc;
+
+  /* Save a reference to the operaton spec in the relay-cb's
+     user_data so that we can free the spec there */
+  rrc->spec.mfu = mfus;
+
+  operation_set_ongoing (source, operation_id, GRL_OP_MEDIA_FROM_URI);
+
+  grl_operation_idle_add (operation_relay_priority (options),
+                          media_from_uri_idle,
+                          mfus,
+                          NULL,
+                          "[grilo] media_from_uri_idle");
+
+  return operation_id;
+}
+
+/**
+ * grl_source_get_media_from_uri_sync:
+ * @source: a source
+ * @uri: A URI that can be used to identify a media resource
+ * @keys: (element-type GrlKeyID): a list of keys to resolve
+ * @options: options wanted for that operation
+ * @error: a #GError, or @NULL
+ *
+ * Creates an instance of #GrlMedia representing the media resource
+ * exposed at @uri.
+ *
+ * It is recommended to call grl_source_test_media_from_uri() before
+ * invoking this to check whether the target source can theoretically do the
+ * resolution.
+ *
+ * This method is synchronous.
+ *
+ * Returns: (transfer full): a filled #GrlMedia
+ *
+ * Since: 0.2.0
+ */
+GrlMedia *
+grl_source_get_media_from_uri_sync (GrlSource *source,
+                                    const gchar *uri,
+                                    const GList *keys,
+                                    GrlOperationOptions *options,
+                                    GError **error)
+{
+  GrlDataSync *ds;
+  GrlMedia *result;
+
+  ds = g_slice_new0 (GrlDataSync);
+
+  if (grl_source_get_media_from_uri (source,
+                                     uri,
+                                     keys,
+                                     options,
+                                     resolve_result_async_cb,
+                                     ds))
+    grl_wait_for_async_operation_complete (ds);
+
+  if (ds->error) {
+    if (error) {
+      *error = ds->error;
+    } else {
+      g_error_free (ds->error);
+    }
+  }
+
+  result = (GrlMedia *) ds->data;
+  g_slice_free (GrlDataSync, ds);
+
+  return result;
+}
+
+static guint
+run_browse (GrlSource *source,
+            GrlMedia *container,
+            const GList *keys,
+            GrlOperationOptions *options,
+            GrlSourceResultCb callback,
+            GrlSourceBatchResultCb batch_callback,
+            gpointer user_data)
+{
+  GList *_keys;
+  GrlSourceBrowseSpec *bs;
+  guint operation_id;
+  struct BrowseRelayCb *brc;
+  GrlResolutionFlags flags;
+
+  g_return_val_if_fail (GRL_IS_SOURCE (source), 0);
+  g_return_val_if_fail (GRL_IS_OPERATION_OPTIONS (options), 0);
+  g_return_val_if_fail (callback != NULL || batch_callback != NULL, 0);
+  g_return_val_if_fail (grl_source_supported_operations (source) &
+                        GRL_OP_BROWSE, 0);
+  g_return_val_if_fail (check_options (source, GRL_OP_BROWSE, options), 0);
+
+  /* By default assume we will use the parameters specified by the user */
+  _keys = g_list_copy ((GList *) keys);
+
+  flags = grl_operation_options_get_resolution_flags (options);
+
+  if (flags & GRL_RESOLVE_FAST_ONLY) {
+    GRL_DEBUG ("requested fast keys");
+    filter_slow (source, &_keys, FALSE);
+  }
+
+  /* Setup full resolution mode if requested */
+  if (flags & GRL_RESOLVE_FULL) {
+    GRL_DEBUG ("requested full metadata");
+    _keys = expand_operation_keys (source, NULL, _keys);
+  }
+
+  operation_id = grl_operation_generate_id ();
+
+  /* Always hook an own relay callback so we can do some
+     post-processing before handing out the results
+     to the user */
+  brc = g_slice_new (struct BrowseRelayCb);
+  brc->source = g_object_ref (source);
+  brc->operation_type = GRL_OP_BROWSE;
+  brc->operation_id = operation_id;
+  brc->keys = _keys;
+  brc->options = g_object_ref (options);
+  brc->user_callback = callback;
+  brc->batch_callback = batch_callback;
+  brc->user_data = user_data;
+  brc->queue = NULL;
+  brc->queue_pending = NULL;
+  brc->decorate_pending = NULL;
+  brc->decorate_id = 0;
+  brc->dispatcher_running = FALSE;
+  brc->progressive = NULL;
+  brc->deadline_id = 0;
+  brc->deadline_closed = FALSE;
+  brc->user_done = FALSE;
+
+  bs = g_new (GrlSourceBrowseSpec, 1);
+  bs->source = g_object_ref (source);
+  bs->operation_id = operation_id;
+  /* _keys is already a copy */
+  bs->keys = _keys;
+  bs->options = grl_operation_options_copy (options);
+  bs->callback = browse_result_relay_cb;
+  bs->user_data = brc;
+
+  if (!container) {
+    /* Special case: NULL container ==> NULL id */
+    bs->container = grl_media_container_new ();
+    grl_media_set_source (bs->container,
+                          grl_source_get_id (source));
+  } else {
+    bs->container = g_object_ref (container);
+  }
+
+  /* Save a reference to the operaton spec in the relay-cb's
+     user_data so that we can free the spec there when we get
+     the last result */
+  brc->spec.browse = bs;
+
+  /* Setup auto-split management if requested */
+  brc->auto_split = auto_split_setup (source, GRL_OP_BROWSE, bs->options);
+
+  operation_set_ongoing (source, operation_id, GRL_OP_BROWSE);
+  brc->deadline_id = operation_deadline_start (options,
+                                              browse_deadline_cb,
+                                              brc);
+
+  grl_operation_idle_add (operation_relay_priority (options),
+                          browse_idle,
+                          bs,
+                          NULL,
+                          "[grilo] browse_idle");
+
+  /* Ask in advance for the next chunks, if configured */
+  if (brc->auto_split) {
+    auto_split_prefetch (brc);
+  }
+
+  return operation_id;
+}
+
+/**
+ * grl_source_browse:
+ * @source: a source
+ * @container: (allow-none): a container of data transfer objects
+ * @keys: (element-type GrlKeyID): the #GList of
+ * #GrlKeyID<!-- -->s to request
+ * @options: options wanted for that operation
+ * @callback: (scope notified): the user defined callback
+ * @user_data: the user data to pass in the callback
+ *
+ * Browse from media elements through an available list.
+ *
+ * This method is asynchronous.
+ *
+ * Returns: the operation identifier
+ *
+ * Since: 0.2.0
+ */
+guint
+grl_source_browse (GrlSource *source,
+                   GrlMedia *container,
+                   const GList *keys,
+                   GrlOperationOptions *options,
+                   GrlSourceResultCb callback,
+                   gpointer user_data)
+{
+  g_return_val_if_fail (callback != NULL, 0);
+
+  return run_browse (source, container, keys, options, callback, NULL, user_data);
+}
+
+/**
+ * grl_source_browse_batch:
+ * @source: a source
+ * @container: (allow-none): a container of data transfer objects
+ * @keys: (element-type GrlKeyID): the #GList of
+ * #GrlKeyID<!-- -->s to request
+ * @options: options wanted for that operation
+ * @callback: (scope notified): the user defined callback
+ * @user_data: the user data to pass in the callback
+ *
+ * Browse from media elements through an available list, delivering
+ * the results in batches.
+ *
+ * Works like grl_source_browse(), but @callback receives a #GPtrArray with
+ * all the elements that are ready to be sent in the same main loop
+ * iteration, instead of being invoked once per element. The last
+ * invocation of @callback has @remaining set to 0.
+ *
+ * This method is asynchronous.
+ *
+ * Returns: the operation identifier
+ *
+ * Since: 0.3.20
+ */
+guint
+grl_source_browse_batch (GrlSource *source,
+                         GrlMedia *container,
+                         const GList *keys,
+                         GrlOperationOptions *options,
+                         GrlSourceBatchResultCb callback,
+                         gpointer user_data)
+{
+  g_return_val_if_fail (callback != NULL, 0);
+
+  return run_browse (source, container, keys, options, NULL, callback, user_data);
+}
+
+/**
+ * grl_source_browse_sync:
+ * @source: a source
+ * @container: (allow-none): a container of data transfer objects
+ * @keys: (element-type GrlKeyID): the #GList of
+ * #GrlKeyID<!-- -->s to request
+ * @options: options wanted for that operation
+ * @error: a #GError, or @NULL
+ *
+ * Browse media elements through an available
+ * list.
+ *
+ * This method is synchronous.
+ *
+ * Returns: (element-type GrlMedia) (transfer full): a #GList with #GrlMedia
+ * elements. After use g_object_unref() every element and g_list_free() the
+ * list.
+ *
+ * Since: 0.2.0
+ */
+GList *
+grl_source_browse_sync (GrlSource *source,
+                        GrlMedia *container,
+                        const GList *keys,
+                        GrlOperationOptions *options,
+                        GError **error)
+{
+  GrlDataSync *ds;
+  GList *result;
+
+  ds = g_slice_new0 (GrlDataSync);
+
+  if (grl_source_browse (source,
+                         container,
+                         keys,
+                         options,
+                         multiple_result_async_cb,
+                         ds))
+    grl_wait_for_async_operation_complete (ds);
+
+  if (ds->error) {
+    if (error) {
+      *error = ds->error;
+    } else {
+      g_error_free (ds->error);
+    }
+  }
+
+  result = (GList *) ds->data;
+  g_slice_free (GrlDataSync, ds);
+
+  return result;
+}
+
+static guint
+run_search (GrlSource *source,
+            const gchar *text,
+            const GList *keys,
+            GrlOperationOptions *options,
+            GrlSourceResultCb callback,
+            GrlSourceBatchResultCb batch_callback,
+            gpointer user_data)
+{
+  GList *_keys;
+  GrlSourceSearchSpec *ss;
+  guint operation_id;
+  struct BrowseRelayCb *brc;
+  GrlResolutionFlags flags;
+
+  g_return_val_if_fail (GRL_IS_SOURCE (source), 0);
+  g_return_val_if_fail (GRL_IS_OPERATION_OPTIONS (options), 0);
+  g_return_val_if_fail (callback != NULL || batch_callback != NULL, 0);
+  g_return_val_if_fail (grl_source_supported_operations (source) &
+                        GRL_OP_SEARCH, 0);
+  g_return_val_if_fail (check_options (source, GRL_OP_SEARCH, options), 0);
+
+  /* By default assume we will use the parameters specified by the user */
+  _keys = g_list_copy ((GList *) keys);
+
+  flags = grl_operation_options_get_resolution_flags (options);
+
+  if (flags & GRL_RESOLVE_FAST_ONLY) {
+    GRL_DEBUG ("requested fast keys");
+    filter_slow (source, &_keys, FALSE);
+  }
+
+  /* Setup full resolution mode if requested */
+  if (flags & GRL_RESOLVE_FULL) {
+    GRL_DEBUG ("requested full metadata");
+    _keys = expand_operation_keys (source, NULL, _keys);
+  }
+
+  operation_id = grl_operation_generate_id ();
+
+  /* Always hook an own relay callback so we can do some
+     post-processing before handing out the results
+     to the user */
+  brc = g_slice_new (struct BrowseRelayCb);
+  brc->source = g_object_ref (source);
+  brc->operation_type = GRL_OP_SEARCH;
+  brc->operation_id = operation_id;
+  brc->keys = _keys;
+  brc->options = g_object_ref (options);
+  brc->user_callback = callback;
+  brc->batch_callback = batch_callback;
+  brc->user_data = user_data;
+  brc->queue = NULL;
+  brc->queue_pending = NULL;
+  brc->decorate_pending = NULL;
+  brc->decorate_id = 0;
+  brc->dispatcher_running = FALSE;
+  brc->progressive = NULL;
+  brc->deadline_id = 0;
+  brc->deadline_closed = FALSE;
+  brc->user_done = FALSE;
+
+  ss = g_new (GrlSourceSearchSpec, 1);
+  ss->source = g_object_ref (source);
+  ss->operation_id = operation_id;
+  ss->text = g_strdup (text);
+  ss->keys = _keys;
+  ss->options = grl_operation_options_copy (options);
+  ss->callback = browse_result_relay_cb;
+  ss->user_data = brc;
+
+  /* Save a reference to the operaton spec in the relay-cb's
+     user_data so that we can free the spec there when we get
+     the last result */
+  brc->spec.search = ss;
+
+  /* Setup auto-split management if requested */
+  brc->auto_split = auto_split_setup (source, GRL_OP_SEARCH, ss->options);
+
+  operation_set_ongoing (source, operation_id, GRL_OP_SEARCH);
+  brc->deadline_id = operation_deadline_start (options,
+                                              browse_deadline_cb,
+                                              brc);
+
+  grl_operation_idle_add (operation_relay_priority (options),
+                          search_idle,
+                          ss,
+                          NULL,
+                          "[grilo] search_idle");
+
+  /* Ask in advance for the next chunks, if configured */
+  if (brc->auto_split) {
+    auto_split_prefetch (brc);
   }
+
+  return operation_id;
 }
 
 /**
- * grl_source_writable_keys:
+ * grl_source_search:
  * @source: a source
+ * @text: the text to search
+ * @keys: (element-type GrlKeyID): the #GList of
+ * #GrlKeyID<!-- -->s to request
+ * @options: options wanted for that operation
+ * @callback: (scope notified): the user defined callback
+ * @user_data: the user data to pass in the callback
  *
- * Similar to grl_source_supported_keys(), but these keys
- * are marked as writable, meaning the source allows the client
- * to provide new values for these keys that will be stored permanently.
+ * Search for the @text string in a source for data identified with that string.
  *
- * Returns: (element-type GrlKeyID) (transfer none):
- * a #GList with the keys
+ * If @text is @NULL then no text filter will be applied, and thus, no media
+ * items from @source will be filtered. If @source does not support NULL-text
+ * search operations it should notiy the client by setting
+ * @GRL_CORE_ERROR_SEARCH_NULL_UNSUPPORTED in @callback's error parameter.
  *
- * Since: 0.2.0
- */
-const GList *
-grl_source_writable_keys (GrlSource *source)
-{
-  g_return_val_if_fail (GRL_IS_SOURCE (source), NULL);
-
-  if (GRL_SOURCE_GET_CLASS (source)->writable_keys) {
-    return GRL_SOURCE_GET_CLASS (source)->writable_keys (source);
-  } else {
-    return NULL;
-  }
-}
-
-/**
- * grl_source_get_id:
- * @source: a source
+ * This method is asynchronous.
  *
- * Returns: the ID of the @source
+ * Returns: the operation identifier
  *
  * Since: 0.2.0
  */
-const gchar *
-grl_source_get_id (GrlSource *source)
+guint
+grl_source_search (GrlSource *source,
+                   const gchar *text,
+                   const GList *keys,
+                   GrlOperationOptions *options,
+                   GrlSourceResultCb callback,
+                   gpointer user_data)
 {
-  g_return_val_if_fail (GRL_IS_SOURCE (source), NULL);
+  g_return_val_if_fail (callback != NULL, 0);
 
-  return source->priv->id;
+  return run_search (source, text, keys, options, callback, NULL, user_data);
 }
 
 /**
- * grl_source_get_name:
+ * grl_source_search_batch:
  * @source: a source
+ * @text: (allow-none): the text to search
+ * @keys: (element-type GrlKeyID): the #GList of
+ * #GrlKeyID<!-- -->s to request
+ * @options: options wanted for that operation
+ * @callback: (scope notified): the user defined callback
+ * @user_data: the user data to pass in the callback
  *
- * Returns: the name of the @source
+ * Search for the @text string in a source for data identified with that
+ * string, delivering the results in batches.
  *
- * Since: 0.2.0
- */
-const gchar *
-grl_source_get_name (GrlSource *source)
-{
-  g_return_val_if_fail (GRL_IS_SOURCE (source), NULL);
-
-  return source->priv->name;
-}
-
-/**
- * grl_source_get_icon:
- * @source: a source
+ * Works like grl_source_search(), but @callback receives a #GPtrArray with
+ * all the elements that are ready to be sent in the same main loop
+ * iteration, instead of being invoked once per element. The last
+ * invocation of @callback has @remaining set to 0.
  *
- * Returns: (transfer none): a #GIcon
+ * This method is asynchronous.
  *
- * Since: 0.2.8
+ * Returns: the operation identifier
+ *
+ * Since: 0.3.20
  */
-GIcon *
-grl_source_get_icon (GrlSource *source)
+guint
+grl_source_search_batch (GrlSource *source,
+                         const gchar *text,
+                         const GList *keys,
+                         GrlOperationOptions *options,
+                         GrlSourceBatchResultCb callback,
+                         gpointer user_data)
 {
-  g_return_val_if_fail (GRL_IS_SOURCE (source), NULL);
+  g_return_val_if_fail (callback != NULL, 0);
 
-  return source->priv->icon;
+  return run_search (source, text, keys, options, NULL, callback, user_data);
 }
 
 /**
- * grl_source_get_description:
+ * grl_source_search_sync:
  * @source: a source
+ * @text: the text to search
+ * @keys: (element-type GrlKeyID): the #GList of
+ * #GrlKeyID<!-- -->s to request
+ * @options: options wanted for that operation
+ * @error: a #GError, or @NULL
  *
- * Returns: the description of the @source
+ * Search for the @text string in a source for data identified with that string.
+ *
+ * If @text is @NULL then no text filter will be applied, and thus, no media
+ * items from @source will be filtered. If @source does not support NULL-text
+ * search operations it should notiy the client by setting
+ * @GRL_CORE_ERROR_SEARCH_NULL_UNSUPPORTED in the error parameter.
+ *
+ * This method is synchronous.
+ *
+ * Returns: (element-type GrlMedia) (transfer full): a #GList with #GrlMedia
+ * elements. After use g_object_unref() every element and g_list_free() the
+ * list.
  *
  * Since: 0.2.0
  */
-const gchar *
-grl_source_get_description (GrlSource *source)
+GList *
+grl_source_search_sync (GrlSource *source,
+                        const gchar *text,
+                        const GList *keys,
+                        GrlOperationOptions *options,
+                        GError **error)
 {
-  g_return_val_if_fail (GRL_IS_SOURCE (source), NULL);
+  GrlDataSync *ds;
+  GList *result;
 
-  return source->priv->desc;
-}
+  ds = g_slice_new0 (GrlDataSync);
 
-/**
- * grl_source_get_tags:
- * @source: a source
- *
- * Returns: (element-type utf8) (transfer none): a %NULL-terminated list of tags
- *
- * Since: 0.2.10
- */
-const char **
-grl_source_get_tags (GrlSource *source)
-{
-  g_return_val_if_fail (GRL_IS_SOURCE (source), NULL);
+  if (grl_source_search (source,
+                         text,
+                         keys,
+                         options,
+                         multiple_result_async_cb,
+                         ds))
+    grl_wait_for_async_operation_complete (ds);
 
-  return (const char **) source->priv->tags->pdata;
-}
+  if (ds->error) {
+    if (error) {
+      *error = ds->error;
+    } else {
+      g_error_free (ds->error);
+    }
+  }
 
-/**
- * grl_source_get_plugin:
- * @source: a source
- *
- * Returns: (transfer none): the plugin this source belongs to
- *
- * Since: 0.2.0
- **/
-GrlPlugin *
-grl_source_get_plugin (GrlSource *source)
-{
-  g_return_val_if_fail (GRL_IS_SOURCE (source), NULL);
+  result = (GList *) ds->data;
+  g_slice_free (GrlDataSync, ds);
 
-  return source->priv->plugin;
+  return result;
 }
 
-/**
- * grl_source_get_rank:
- * @source: a source
- *
- * Gets the source rank
- *
- * Returns: rank value
- *
- * Since: 0.2.0
- **/
-gint
-grl_source_get_rank (GrlSource *source)
+static guint
+run_query (GrlSource *source,
+           const gchar *query,
+           const GList *keys,
+           GrlOperationOptions *options,
+           GrlSourceResultCb callback,
+           GrlSourceBatchResultCb batch_callback,
+           gpointer user_data)
 {
+  GList *_keys;
+  GrlSourceQuerySpec *qs;
+  guint operation_id;
+  struct BrowseRelayCb *brc;
+  GrlResolutionFlags flags;
+
   g_return_val_if_fail (GRL_IS_SOURCE (source), 0);
+  g_return_val_if_fail (GRL_IS_OPERATION_OPTIONS (options), 0);
+  g_return_val_if_fail (query != NULL, 0);
+  g_return_val_if_fail (callback != NULL || batch_callback != NULL, 0);
+  g_return_val_if_fail (grl_source_supported_operations (source) &
+                        GRL_OP_QUERY, 0);
+  g_return_val_if_fail (check_options (source, GRL_OP_QUERY, options), 0);
 
-  return source->priv->rank;
-}
+  /* By default assume we will use the parameters specified by the user */
+  _keys = g_list_copy ((GList *) keys);
 
-/**
- * grl_source_get_supported_media:
- * @source: a source
- *
- * Gets the supported type of medias @source can deal with.
- *
- * Returns: a #GrlSupportedMedia value
- *
- * Since: 0.3.0
- **/
-GrlSupportedMedia
-grl_source_get_supported_media (GrlSource *source)
-{
-  g_return_val_if_fail (GRL_IS_SOURCE (source), 0);
+  flags = grl_operation_options_get_resolution_flags (options);
 
-  return source->priv->supported_media;
-}
+  if (flags & GRL_RESOLVE_FAST_ONLY) {
+    GRL_DEBUG ("requested fast keys");
+    filter_slow (source, &_keys, FALSE);
+  }
 
-/**
- * grl_source_supported_operations:
- * @source: a source
- *
- * By default the derived objects of #GrlSource can only resolve.
- *
- * Returns: (type uint): a bitwise mangle with the supported operations by
- * the source
- *
- * Since: 0.2.0
- */
-GrlSupportedOps
-grl_source_supported_operations (GrlSource *source)
-{
-  GrlSupportedOps ops = GRL_OP_NONE;
-  GrlSourceClass *source_class;
+  if (flags & GRL_RESOLVE_FULL) {
+    GRL_DEBUG ("requested full metadata");
+    _keys = expand_operation_keys (source, NULL, _keys);
+  }
 
-  g_return_val_if_fail (GRL_IS_SOURCE (source), GRL_OP_NONE);
+  operation_id = grl_operation_generate_id ();
+
+  /* Always hook an own relay callback so we can do some
+     post-processing before handing out the results
+     to the user */
+  brc = g_slice_new (struct BrowseRelayCb);
+  brc->source = g_object_ref (source);
+  brc->operation_type = GRL_OP_QUERY;
+  brc->operation_id = operation_id;
+  brc->keys = _keys;
+  brc->options = g_object_ref (options);
+  brc->user_callback = callback;
+  brc->batch_callback = batch_callback;
+  brc->user_data = user_data;
+  brc->queue = NULL;
+  brc->queue_pending = NULL;
+  brc->decorate_pending = NULL;
+  brc->decorate_id = 0;
+  brc->dispatcher_running = FALSE;
+  brc->progressive = NULL;
+  brc->deadline_id = 0;
+  brc->deadline_closed = FALSE;
+  brc->user_done = FALSE;
+
+  qs = g_new (GrlSourceQuerySpec, 1);
+  qs->source = g_object_ref (source);
+  qs->operation_id = operation_id;
+  qs->query = g_strdup (query);
+  qs->keys = _keys;
+  qs->options = grl_operation_options_copy (options);
+  qs->callback = browse_result_relay_cb;
+  qs->user_data = brc;
+
+  /* Save a reference to the operaton spec in the relay-cb's
+     user_data so that we can free the spec there when we get
+     the last result */
+  brc->spec.query = qs;
 
-  source_class = GRL_SOURCE_GET_CLASS (source);
+  /* Setup auto-split management if requested */
+  brc->auto_split = auto_split_setup (source, GRL_OP_QUERY, qs->options);
 
-  if (source_class->supported_operations) {
-    return  source_class->supported_operations (source);
-  }
+  operation_set_ongoing (source, operation_id, GRL_OP_QUERY);
+  brc->deadline_id = operation_deadline_start (options,
+                                              browse_deadline_cb,
+                                              brc);
 
-  if (source_class->resolve) {
-    ops |= GRL_OP_RESOLVE;
-  }
-  if (source_class->test_media_from_uri &&
-      source_class->media_from_uri) {
-    ops |= GRL_OP_MEDIA_FROM_URI;
-  }
-  if (source_class->browse) {
-    ops |= GRL_OP_BROWSE;
-  }
-  if (source_class->search) {
-    ops |= GRL_OP_SEARCH;
-  }
-  if (source_class->query) {
-    ops |= GRL_OP_QUERY;
-  }
-  if (source_class->remove) {
-    ops |= GRL_OP_REMOVE;
-  }
-  if (source_class->store_metadata) {
-    ops |= GRL_OP_STORE_METADATA;
-  }
-  if (source_class->store) {
-    ops |= GRL_OP_STORE;
-  }
+  grl_operation_idle_add (operation_relay_priority (options),
+                          query_idle,
+                          qs,
+                          NULL,
+                          "[grilo] query_idle");
 
-  if (source_class->notify_change_start &&
-      source_class->notify_change_stop) {
-    ops |= GRL_OP_NOTIFY_CHANGE;
+  /* Ask in advance for the next chunks, if configured */
+  if (brc->auto_split) {
+    auto_split_prefetch (brc);
   }
 
-  return ops;
+  return operation_id;
 }
 
 /**
- * grl_source_get_auto_split_threshold:
+ * grl_source_query:
  * @source: a source
+ * @query: the query to process
+ * @keys: (element-type GrlKeyID): the #GList of
+ * #GrlKeyID<!-- -->s to request
+ * @options: options wanted for that operation
+ * @callback: (scope notified): the user defined callback
+ * @user_data: the user data to pass in the callback
  *
- * Gets how much elements the source is able to handle in a single request.
+ * Execute a specialized query (specific for each provider) on a media
+ * repository.
  *
- * See #grl_source_set_auto_split_threshold()
+ * It is different from grl_source_search() semantically, because the query
+ * implies a carefully crafted string, rather than a simple string to search.
  *
- * Returns: the assigned threshold, or 0 if there is no threshold
+ * This method is asynchronous.
+ *
+ * Returns: the operation identifier
  *
  * Since: 0.2.0
  */
 guint
-grl_source_get_auto_split_threshold (GrlSource *source)
+grl_source_query (GrlSource *source,
+                  const gchar *query,
+                  const GList *keys,
+                  GrlOperationOptions *options,
+                  GrlSourceResultCb callback,
+                  gpointer user_data)
 {
-  g_return_val_if_fail (GRL_IS_SOURCE (source), 0);
+  g_return_val_if_fail (callback != NULL, 0);
 
-  return source->priv->auto_split_threshold;
+  return run_query (source, query, keys, options, callback, NULL, user_data);
 }
 
 /**
- * grl_source_set_auto_split_threshold:
+ * grl_source_query_batch:
  * @source: a source
- * @threshold: the threshold to set
+ * @query: the query to process
+ * @keys: (element-type GrlKeyID): the #GList of
+ * #GrlKeyID<!-- -->s to request
+ * @options: options wanted for that operation
+ * @callback: (scope notified): the user defined callback
+ * @user_data: the user data to pass in the callback
  *
- * Sets how much elements the source is able to handle in a single request.
+ * Execute a specialized query (specific for each provider) on a media
+ * repository, delivering the results in batches.
  *
- * If user, during a search or browsing operation, asks for more elements than
- * the threshold, the request will be automatically splitted in chunks, so up to
- * @threshold elements will be asked in each request.
+ * Works like grl_source_query(), but @callback receives a #GPtrArray with
+ * all the elements that are ready to be sent in the same main loop
+ * iteration, instead of being invoked once per element. The last
+ * invocation of @callback has @remaining set to 0.
  *
- * Source will act as if user were asking just a chunk, and user won't notice
- * that the request was chunked.
+ * This method is asynchronous.
  *
- * <note>
- *  <para>
- *    This function is intended to be used only by plugins.
- *  </para>
- * </note>
+ * Returns: the operation identifier
  *
- * Since: 0.2.0
+ * Since: 0.3.20
  */
-void
-grl_source_set_auto_split_threshold (GrlSource *source,
-                                     guint threshold)
+guint
+grl_source_query_batch (GrlSource *source,
+                        const gchar *query,
+                        const GList *keys,
+                        GrlOperationOptions *options,
+                        GrlSourceBatchResultCb callback,
+                        gpointer user_data)
 {
-  g_return_if_fail (GRL_IS_SOURCE (source));
+  g_return_val_if_fail (callback != NULL, 0);
 
-  source->priv->auto_split_threshold = threshold;
+  return run_query (source, query, keys, options, NULL, callback, user_data);
 }
 
 /**
- * grl_source_resolve:
+ * grl_source_query_sync:
  * @source: a source
- * @media: (allow-none) (transfer full): a data transfer object
+ * @query: the query to process
  * @keys: (element-type GrlKeyID): the #GList of
  * #GrlKeyID<!-- -->s to request
- * @options: options to pass to this operation
- * @callback: (scope notified): the user defined callback
- * @user_data: the user data to pass in the callback
+ * @options: options wanted for that operation
+ * @error: a #GError, or @NULL
  *
- * This method is intended to fetch the requested keys of metadata of
- * a given @media to the media source.
+ * Execute a specialized query (specific for each provider) on a media
+ * repository.
  *
- * This method is asynchronous.
+ * This method is synchronous.
  *
- * Returns: the operation identifie
+ * Returns: (element-type GrlMedia) (transfer full): a #GList with #GrlMedia
+ * elements. After use g_object_unref() every element and g_list_free() the
+ * list.
  *
  * Since: 0.2.0
  */
-guint
-grl_source_resolve (GrlSource *source,
-                    GrlMedia *media,
-                    const GList *keys,
-                    GrlOperationOptions *options,
-                    GrlSourceResolveCb callback,
-                    gpointer user_data)
+GList *
+grl_source_query_sync (GrlSource *source,
+                       const gchar *query,
+                       const GList *keys,
+                       GrlOperationOptions *options,
+                       GError **error)
 {
-  GList *_keys;
-  GList *each_key;
-  GList *delete_key;
-  struct ResolveRelayCb *rrc;
-  guint operation_id;
-  GList *sources = NULL;
-  GrlResolutionFlags flags;
-  GrlOperationOptions *resolve_options;
+  GrlDataSync *ds;
+  GList *result;
 
-  GRL_DEBUG (__FUNCTION__);
+  ds = g_slice_new0 (GrlDataSync);
 
-  g_return_val_if_fail (GRL_IS_SOURCE (source), 0);
-  g_return_val_if_fail (GRL_IS_OPERATION_OPTIONS (options), 0);
-  g_return_val_if_fail (keys != NULL, 0);
-  g_return_val_if_fail (callback != NULL, 0);
-  g_return_val_if_fail (check_options (source, GRL_OP_RESOLVE, options), 0);
+  if (grl_source_query (source,
+                        query,
+                        keys,
+                        options,
+                        multiple_result_async_cb,
+                        ds))
+    grl_wait_for_async_operation_complete (ds);
 
-  if (!media) {
-    /* Special case, NULL media ==> root container */
-    media = grl_media_container_new ();
-    grl_media_set_id (media, NULL);
-    grl_media_set_source (media, grl_source_get_id (source));
-  } else if (!grl_media_get_source (media)) {
-    grl_media_set_source (media, grl_source_get_id (source));
+  if (ds->error) {
+    if (error) {
+      *error = ds->error;
+    } else {
+      g_error_free (ds->error);
+    }
   }
 
-  /* By default assume we will use the parameters specified by the user */
-  _keys = filter_known_keys (media, (GList *) keys);
-
-  flags = grl_operation_options_get_resolution_flags (options);
+  result = (GList *) ds->data;
+  g_slice_free (GrlDataSync, ds);
 
-  if (flags & GRL_RESOLVE_FULL) {
-    GRL_DEBUG ("requested full metadata");
-    sources = grl_registry_get_sources_by_operations (grl_registry_get_default (),
-                                                      GRL_OP_RESOLVE,
-                                                      TRUE);
-    /* Put current source on top, if it supports resolve() */
-    if (grl_source_supported_operations (source) & GRL_OP_RESOLVE) {
-      sources = g_list_remove (sources, source);
-      sources = g_list_prepend (sources, source);
-    }
-    flags &= ~GRL_RESOLVE_FULL;
-    resolve_options = grl_operation_options_copy (options);
-    grl_operation_options_set_resolution_flags (resolve_options, flags);
-  } else {
-    /* Consider only this source, if it supports resolve() */
-    if (grl_source_supported_operations (source) & GRL_OP_RESOLVE) {
-      sources = g_list_prepend (NULL, source);
-    }
-    resolve_options = g_object_ref (options);
-  }
+  return result;
+}
 
-  if (flags & GRL_RESOLVE_FAST_ONLY) {
-    GRL_DEBUG ("requested fast keys");
-  }
+static gboolean
+grl_source_store_remove_impl (GrlSource *source,
+                              GrlMedia *media,
+                              GrlSourceRemoveCb callback,
+                              gpointer user_data)
+{
+  const gchar *id;
+  struct RemoveRelayCb *rrc;
+  GrlSourceRemoveSpec *rs;
 
-  operation_id = grl_operation_generate_id ();
+  GRL_DEBUG (__FUNCTION__);
 
-  operation_set_ongoing (source, operation_id);
+  g_return_val_if_fail (GRL_IS_SOURCE (source), FALSE);
+  g_return_val_if_fail (GRL_IS_MEDIA (media), FALSE);
+  g_return_val_if_fail (callback != NULL, FALSE);
+  g_return_val_if_fail (grl_source_supported_operations (source) &
+                        GRL_OP_REMOVE, FALSE);
 
-  /* Always hook an own relay callback so we can do some
-     post-processing before handing out the results
-     to the user */
-  rrc = g_slice_new0 (struct ResolveRelayCb);
+  rrc = g_slice_new (struct RemoveRelayCb);
   rrc->source = g_object_ref (source);
-  rrc->operation_type = GRL_OP_RESOLVE;
-  rrc->operation_id = operation_id;
   rrc->media = g_object_ref (media);
   rrc->user_callback = callback;
   rrc->user_data = user_data;
-  rrc->options = resolve_options;
-
-  /* If there are no sources able to solve just send the media */
-  if (g_list_length (sources) == 0) {
-    guint id;
-    g_list_free (_keys);
-    id = g_idle_add_full (flags & GRL_RESOLVE_IDLE_RELAY?
-                          G_PRIORITY_DEFAULT_IDLE: G_PRIORITY_HIGH_IDLE,
-                          resolve_all_done,
-                          rrc,
-                          NULL);
-    g_source_set_name_by_id (id, "[grilo] resolve_all_done");
-    return operation_id;
-  }
-
-  _keys = filter_unresolvable_keys (sources, &_keys);
-
-  rrc->keys = _keys;
-  rrc->map = map_keys_new ();
-  rrc->resolve_specs = map_sources_new ();
-
-  map_keys_to_sources (rrc->map, _keys, sources, media, flags & GRL_RESOLVE_FAST_ONLY);
-  g_list_free (sources);
+  rrc->started = 0;
 
-  each_key = rrc->keys;
-  while (each_key) {
-    if (map_sources_to_specs (rrc->resolve_specs, rrc->map, media,
-                              GRLPOINTER_TO_KEYID (each_key->data),
-                              resolve_options, rrc)) {
-      each_key = g_list_next (each_key);
-    } else {
-      delete_key = each_key;
-      each_key = g_list_next (each_key);
-      rrc->keys = g_list_delete_link (rrc->keys, delete_key);
-    }
+  /* Check that we have the minimum information we need */
+  id = grl_media_get_id (media);
+  if (!id) {
+    rrc->error = g_error_new (GRL_CORE_ERROR,
+                              GRL_CORE_ERROR_REMOVE_FAILED,
+                              _("Media has no “id”, cannot remove"));
+    rrc->spec = NULL;
+  } else {
+    rrc->error = NULL;
+    rs = g_new0 (GrlSourceRemoveSpec, 1);
+    rs->source = g_object_ref (source);
+    rs->media_id = g_strdup (id);
+    rs->media = g_object_ref (media);
+    rs->callback = remove_result_relay_cb;
+    rs->user_data = rrc;
+    rrc->spec = rs;
   }
 
-  rrc->specs_to_invoke = g_hash_table_get_values (rrc->resolve_specs);
-  if (rrc->specs_to_invoke) {
-    guint id;
-    id = g_idle_add_full (flags & GRL_RESOLVE_IDLE_RELAY?
-                          G_PRIORITY_DEFAULT_IDLE: G_PRIORITY_HIGH_IDLE,
-                          resolve_idle,
-                          rrc,
-                          NULL);
-    g_source_set_name_by_id (id, "[grilo] resolve_idle");
-  } else {
-    guint id;
-    id = g_idle_add_full (flags & GRL_RESOLVE_IDLE_RELAY?
-                          G_PRIORITY_DEFAULT_IDLE: G_PRIORITY_HIGH_IDLE,
-                          resolve_all_done,
+  grl_operation_idle_add (G_PRIORITY_DEFAULT_IDLE,
+                          remove_idle,
                           rrc,
-                          NULL);
-    g_source_set_name_by_id (id, "[grilo] resolve_all_done");
-  }
+                          NULL,
+                          "[grilo] remove_idle");
 
-  return operation_id;
+  return TRUE;
 }
 
 /**
- * grl_source_resolve_sync:
+ * grl_source_remove:
  * @source: a source
- * @media: (allow-none) (transfer full): a data transfer object
- * @keys: (element-type GrlKeyID): the #GList of
- * #GrlKeyID<!-- -->s to request
- * @options: options to pass to this operation
+ * @media: a data transfer object
+ * @callback: (scope notified): the user defined callback
+ * @user_data: the user data to pass in the callback
+ *
+ * Remove a @media from the @source repository.
+ *
+ * This method is asynchronous.
+ *
+ * Since: 0.2.0
+ */
+void
+grl_source_remove (GrlSource *source,
+                   GrlMedia *media,
+                   GrlSourceRemoveCb callback,
+                   gpointer user_data)
+{
+  grl_source_store_remove_impl (source, media, callback, user_data);
+}
+
+/**
+ * grl_source_remove_sync:
+ * @source: a source
+ * @media: a data transfer object
  * @error: a #GError, or @NULL
  *
- * This method is intended to fetch the requested keys of metadata of
- * a given @media to the media source.
+ * Remove a @media from the @source repository.
  *
  * This method is synchronous.
  *
- * Returns: (transfer full): a filled #GrlMedia
- *
  * Since: 0.2.0
  */
-GrlMedia *
-grl_source_resolve_sync (GrlSource *source,
-                         GrlMedia *media,
-                         const GList *keys,
-                         GrlOperationOptions *options,
-                         GError **error)
+void
+grl_source_remove_sync (GrlSource *source,
+                        GrlMedia *media,
+                        GError **error)
 {
   GrlDataSync *ds;
 
   ds = g_slice_new0 (GrlDataSync);
 
-  if (grl_source_resolve (source,
-                          media,
-                          keys,
-                          options,
-                          resolve_result_async_cb,
-                          ds))
+  if (grl_source_store_remove_impl (source,
+                                    media,
+                                    remove_async_cb,
+                                    ds))
     grl_wait_for_async_operation_complete (ds);
 
   if (ds->error) {
@@ -3410,254 +9259,289 @@ grl_source_resolve_sync (GrlSource *source,
   }
 
   g_slice_free (GrlDataSync, ds);
-
-  return media;
 }
 
 /**
- * grl_source_may_resolve:
+ * grl_source_remove_batch:
  * @source: a source
- * @media: a media on which we want more metadata
- * @key_id: the key corresponding to a metadata we might want
- * @missing_keys: (element-type GrlKeyID): an optional originally empty list
+ * @medias: (element-type GrlMedia) (transfer none): the #GPtrArray of
+ * #GrlMedia to remove
+ * @callback: (scope notified): the user defined callback
+ * @user_data: the user data to pass in the callback
  *
- * Checks whether @key_id may be resolved with @source for @media, so that the
- * caller can avoid calling grl_source_resolve() if it can be known in
- * advance it will fail.
+ * Removes all the elements in @medias from the @source repository.
  *
- * If the resolution is known to be impossible because more keys are needed in
- * @media, and @missing_keys is not @NULL, it is populated with the list of
- * GrlKeyID that would be needed.
+ * Sources implementing the remove_batch vmethod get a single request with
+ * all the elements. The rest of sources are asked to remove them one by one,
+ * with up to #GrlSource:remove-concurrency removals running at the same
+ * time.
  *
- * This function is synchronous and should not block.
+ * @callback is invoked once, when all elements have been processed, with the
+ * error of each element that could not be removed.
  *
- * Returns: @TRUE if there's a possibility that @source resolves @key_id for
- * @media, @FALSE otherwise.
+ * This method is asynchronous.
  *
- * Since: 0.2.0
+ * Since: 0.3.20
  */
-gboolean
-grl_source_may_resolve (GrlSource *source,
-                        GrlMedia *media,
-                        GrlKeyID key_id,
-                        GList **missing_keys)
+void
+grl_source_remove_batch (GrlSource *source,
+                         GPtrArray *medias,
+                         GrlSourceRemoveBatchCb callback,
+                         gpointer user_data)
 {
-  GrlSourceClass *klass;
-  const GList *supported_keys;
-  const gchar *media_source;
+  struct RemoveBatchRelayCb *rbrc;
 
   GRL_DEBUG (__FUNCTION__);
 
-  g_return_val_if_fail (GRL_IS_SOURCE (source), FALSE);
-  g_return_val_if_fail (!missing_keys || !*missing_keys, FALSE);
-
-  klass = GRL_SOURCE_GET_CLASS (source);
-
-  if (klass->may_resolve) {
-    return klass->may_resolve (source, media, key_id, missing_keys);
-  }
-
-  /* Default behaviour is to assume that if source implements resolve, then any
-     supported key for its own content is resolved */
-  if (klass->resolve) {
-    GRL_DEBUG ("Using default may_resolve()");
-    /* We need to know the media source */
-    if (media == NULL ||
-        (media_source = grl_media_get_source (media)) == NULL) {
-      if (missing_keys) {
-        *missing_keys = NULL;
-        *missing_keys =
-          g_list_prepend (*missing_keys,
-                          GRLKEYID_TO_POINTER (GRL_METADATA_KEY_SOURCE));
-      }
-      return FALSE;
-    }
-    /* Content is from different source */
-    if (g_strcmp0 (grl_source_get_id (source), media_source) != 0) {
-      return FALSE;
-    }
-    /* Check if the key is supported */
-    supported_keys = grl_source_supported_keys (source);
-    return (g_list_find ((GList *) supported_keys,
-                         GRLKEYID_TO_POINTER (key_id)) != NULL);
+  g_return_if_fail (GRL_IS_SOURCE (source));
+  g_return_if_fail (medias != NULL);
+  g_return_if_fail (callback != NULL);
+  g_return_if_fail (grl_source_supported_operations (source) & GRL_OP_REMOVE);
+
+  rbrc = g_slice_new0 (struct RemoveBatchRelayCb);
+  rbrc->source = g_object_ref (source);
+  rbrc->medias = g_ptr_array_ref (medias);
+  rbrc->errors = g_ptr_array_new_full (medias->len, remove_batch_error_free);
+  g_ptr_array_set_size (rbrc->errors, medias->len);
+  rbrc->user_callback = callback;
+  rbrc->user_data = user_data;
+  rbrc->started = grl_metrics_start ();
+
+  if (GRL_SOURCE_GET_CLASS (source)->remove_batch) {
+    grl_operation_idle_add (G_PRIORITY_DEFAULT_IDLE,
+                            remove_batch_idle,
+                            rbrc,
+                            NULL,
+                            "[grilo] remove_batch_idle");
   } else {
-    GRL_WARNING ("Source %s does not implement may_resolve()",
-                 grl_source_get_id (source));
-    return FALSE;
+    rbrc->scheduled = TRUE;
+    grl_operation_idle_add (G_PRIORITY_DEFAULT_IDLE,
+                            remove_batch_each_idle,
+                            rbrc,
+                            NULL,
+                            "[grilo] remove_batch_each_idle");
   }
 }
 
-/**
- * grl_source_test_media_from_uri:
- * @source: a source
- * @uri: A URI that can be used to identify a media resource
- *
- * Tests whether @source can instantiate a #GrlMedia object representing
- * the media resource exposed at @uri.
- *
- * Returns: %TRUE if it can, %FALSE otherwise.
- *
- * This method is synchronous.
- *
- * Since: 0.2.0
- */
-gboolean
-grl_source_test_media_from_uri (GrlSource *source,
-                                const gchar *uri)
+static gboolean
+grl_source_store_impl (GrlSource *source,
+                       GrlMedia *parent,
+                       GrlMedia *media,
+                       GrlWriteFlags flags,
+                       GrlSourceStoreCb callback,
+                       gpointer user_data)
 {
+  struct StoreRelayCb *src;
+  GrlSourceStoreSpec *ss;
+
   GRL_DEBUG (__FUNCTION__);
 
   g_return_val_if_fail (GRL_IS_SOURCE (source), FALSE);
-  g_return_val_if_fail (uri != NULL, FALSE);
+  g_return_val_if_fail (!parent || grl_media_is_container (parent), FALSE);
+  g_return_val_if_fail (GRL_IS_MEDIA (media), FALSE);
 
-  if (GRL_SOURCE_GET_CLASS (source)->test_media_from_uri) {
-    return GRL_SOURCE_GET_CLASS (source)->test_media_from_uri (source, uri);
-  } else {
-    return FALSE;
-  }
+  g_return_val_if_fail ((!parent &&
+                         grl_source_supported_operations (source) & GRL_OP_STORE) ||
+                        (parent &&
+                         grl_source_supported_operations (source) & GRL_OP_STORE_PARENT),
+                        FALSE);
+
+  src = g_slice_new (struct StoreRelayCb);
+  src->flags = flags;
+  src->user_callback = callback;
+  src->user_data = user_data;
+  src->started = 0;
+
+  ss = g_new (GrlSourceStoreSpec, 1);
+  ss->source = g_object_ref (source);
+  ss->parent = parent? g_object_ref (parent): NULL;
+  ss->media = g_object_ref (media);
+  ss->callback = store_relay_cb;
+  ss->user_data = src;
+
+  src->spec = ss;
+
+  grl_operation_idle_add (G_PRIORITY_DEFAULT_IDLE,
+                          store_idle,
+                          ss,
+                          NULL,
+                          "[grilo] store_idle");
+
+  return TRUE;
 }
 
 /**
- * grl_source_get_media_from_uri:
+ * grl_source_store:
  * @source: a source
- * @uri: A URI that can be used to identify a media resource
- * @keys: (element-type GrlKeyID): A list of keys to resolve
- * @options: options wanted for that operation
+ * @parent: (allow-none): a parent to store the data transfer objects
+ * @media: a data transfer object
+ * @flags: flags to configure specific behaviour of the operation
  * @callback: (scope notified): the user defined callback
  * @user_data: the user data to pass in the callback
  *
- * Creates an instance of #GrlMedia representing the media resource
- * exposed at @uri.
- *
- * It is recommended to call grl_source_test_media_from_uri() before invoking
- * this to check whether the target source can theoretically do the resolution.
+ * Store the @media into the @parent container
  *
  * This method is asynchronous.
  *
- * Returns: the operation identifier
- *
- * Since: 0.2.0
+ * Since: 0.3.0
  */
-guint
-grl_source_get_media_from_uri (GrlSource *source,
-                               const gchar *uri,
-                               const GList *keys,
-                               GrlOperationOptions *options,
-                               GrlSourceResolveCb callback,
-                               gpointer user_data)
+void
+grl_source_store (GrlSource *source,
+                  GrlMedia *parent,
+                  GrlMedia *media,
+                  GrlWriteFlags flags,
+                  GrlSourceStoreCb callback,
+                  gpointer user_data)
 {
-  GList *_keys;
-  GrlSourceMediaFromUriSpec *mfus;
-  struct ResolveRelayCb *rrc;
-  guint operation_id;
-  GrlResolutionFlags flags;
-  guint id;
-
-  GRL_DEBUG (__FUNCTION__);
+  grl_source_store_impl (source, parent, media, flags, callback, user_data);
+}
 
-  g_return_val_if_fail (GRL_IS_SOURCE (source), 0);
-  g_return_val_if_fail (GRL_IS_OPERATION_OPTIONS (options), 0);
-  g_return_val_if_fail (uri != NULL, 0);
-  g_return_val_if_fail (keys != NULL, 0);
-  g_return_val_if_fail (callback != NULL, 0);
-  g_return_val_if_fail (grl_source_supported_operations (source) &
-                        GRL_OP_MEDIA_FROM_URI, 0);
-  g_return_val_if_fail (check_options (source, GRL_OP_MEDIA_FROM_URI, options), 0);
+/**
+ * grl_source_store_sync:
+ * @source: a source
+ * @parent: (allow-none): a #GrlMedia container to store the data transfer objects
+ * @media: a #GrlMedia data transfer object
+ * @flags: flags to configure specific behaviour of the operation
+ * @error: a #GError, or @NULL
+ *
+ * Store the @media into the @parent container.
+ *
+ * This method is synchronous.
+ *
+ * Since: 0.3.0
+ */
+void
+grl_source_store_sync (GrlSource *source,
+                       GrlMedia *parent,
+                       GrlMedia *media,
+                       GrlWriteFlags flags,
+                       GError **error)
+{
+  GrlDataSync *ds;
 
-  _keys = g_list_copy ((GList *) keys);
-  flags = grl_operation_options_get_resolution_flags (options);
+  ds = g_slice_new0 (GrlDataSync);
 
-  if (flags & GRL_RESOLVE_FAST_ONLY) {
-    filter_slow (source, &_keys, FALSE);
-  }
+  if (grl_source_store_impl (source,
+                             parent,
+                             media,
+                             flags,
+                             store_result_async_cb,
+                             ds))
+    grl_wait_for_async_operation_complete (ds);
 
-  if (flags & GRL_RESOLVE_FULL) {
-    _keys = expand_operation_keys (source, NULL, _keys);
+  if (ds->error) {
+    if (error) {
+      *error = ds->error;
+    } else {
+      g_error_free (ds->error);
+    }
   }
 
-  operation_id = grl_operation_generate_id ();
+  g_slice_free (GrlDataSync, ds);
+}
 
-  /* We cannot prepare for full resolution yet because we don't
-     have a GrlMedia t operate with.
-     TODO: full resolution could be added in the relay calback
-     when we get the GrlMedia object */
+static gboolean
+grl_source_store_metadata_impl (GrlSource *source,
+                                GrlMedia *media,
+                                GList *keys,
+                                GrlWriteFlags flags,
+                                GrlSourceStoreCb callback,
+                                gpointer user_data)
+{
+  GRL_DEBUG (__FUNCTION__);
 
-  /* Always hook an own relay callback so we can do some
-     post-processing before handing out the results
-     to the user */
-  rrc = g_slice_new0 (struct ResolveRelayCb);
-  rrc->source = g_object_ref (source);
-  rrc->operation_type = GRL_OP_MEDIA_FROM_URI;
-  rrc->operation_id = operation_id;
-  rrc->keys = _keys;
-  rrc->options = g_object_ref (options);
-  rrc->user_callback = callback;
-  rrc->user_data = user_data;
+  g_return_val_if_fail (GRL_IS_SOURCE (source), FALSE);
+  g_return_val_if_fail (GRL_IS_MEDIA (media), FALSE);
+  g_return_val_if_fail (keys != NULL, FALSE);
 
-  mfus = g_new0 (GrlSourceMediaFromUriSpec, 1);
-  mfus->source = g_object_ref (source);
-  mfus->operation_id = operation_id;
-  mfus->uri = g_strdup (uri);
-  mfus->keys = _keys;
-  mfus->options = grl_operation_options_copy (options);
-  mfus->callback = media_from_uri_result_relay_cb;
-  mfus->user_data = rrc;
+  run_store_metadata (source, media, keys, flags, callback, user_data);
 
-  /* Save a reference to the operaton spec in the relay-cb's
-     user_data so that we can free the spec there */
-  rrc->spec.mfu = mfus;
+  return TRUE;
+}
 
-  operation_set_ongoing (source, operation_id);
+/**
+ * grl_source_store_metadata:
+ * @source: a metadata source
+ * @media: the #GrlMedia object that we want to operate on.
+ * @keys: (element-type GrlKeyID) (allow-none): a list
+ * of #GrlKeyID whose values we want to change.
+ * @flags: Flags to configure specific behaviors of the operation.
+ * @callback: (scope notified): the callback to execute when the operation is finished.
+ * @user_data: user data set for the @callback
+ *
+ * Get the values for @keys from @media and store it permanently. After
+ * calling this method, future queries that return this media object
+ * shall return this new values for the selected keys.
+ *
+ * If write-behind is enabled in @source, the values are stored later,
+ * along with other edits. See grl_source_set_write_behind().
+ *
+ * This function is asynchronous and uses the Glib's main loop.
+ *
+ * Since: 0.2.0
+ */
+void
+grl_source_store_metadata (GrlSource *source,
+                           GrlMedia *media,
+                           GList *keys,
+                           GrlWriteFlags flags,
+                           GrlSourceStoreCb callback,
+                           gpointer user_data)
+{
+  g_return_if_fail (GRL_IS_SOURCE (source));
+  g_return_if_fail (GRL_IS_MEDIA (media));
+  g_return_if_fail (keys != NULL);
 
-  id = g_idle_add_full (flags & GRL_RESOLVE_IDLE_RELAY?
-                        G_PRIORITY_DEFAULT_IDLE: G_PRIORITY_HIGH_IDLE,
-                        media_from_uri_idle,
-                        mfus,
-                        NULL);
-  g_source_set_name_by_id (id, "[grilo] media_from_uri_idle");
+  if (write_behind_add (source, media, keys, flags, callback, user_data)) {
+    return;
+  }
 
-  return operation_id;
+  grl_source_store_metadata_impl (source,
+                                  media,
+                                  keys,
+                                  flags,
+                                  callback,
+                                  user_data);
 }
 
 /**
- * grl_source_get_media_from_uri_sync:
+ * grl_source_store_metadata_sync:
  * @source: a source
- * @uri: A URI that can be used to identify a media resource
- * @keys: (element-type GrlKeyID): a list of keys to resolve
- * @options: options wanted for that operation
+ * @media: the #GrlMedia object that we want to operate on
+ * @keys: (element-type GrlKeyID) (allow-none): a list of
+ * #GrlKeyID whose values we want to change
+ * @flags: Flags to configure specific behaviors of the operation.
  * @error: a #GError, or @NULL
  *
- * Creates an instance of #GrlMedia representing the media resource
- * exposed at @uri.
- *
- * It is recommended to call grl_source_test_media_from_uri() before
- * invoking this to check whether the target source can theoretically do the
- * resolution.
+ * Update @keys values from @media in the @source. After calling this method,
+ * future queries that return this media object shall return this new value for
+ * the selected key.
  *
- * This method is synchronous.
+ * This function is synchronous.
  *
- * Returns: (transfer full): a filled #GrlMedia
+ * Returns: (element-type GrlKeyID) (transfer container):
+ * a #GList of keys that could not be updated, or @NULL
  *
  * Since: 0.2.0
  */
-GrlMedia *
-grl_source_get_media_from_uri_sync (GrlSource *source,
-                                    const gchar *uri,
-                                    const GList *keys,
-                                    GrlOperationOptions *options,
-                                    GError **error)
+GList *
+grl_source_store_metadata_sync (GrlSource *source,
+                                GrlMedia *media,
+                                GList *keys,
+                                GrlWriteFlags flags,
+                                GError **error)
 {
   GrlDataSync *ds;
-  GrlMedia *result;
+  GList *failed;
 
   ds = g_slice_new0 (GrlDataSync);
 
-  if (grl_source_get_media_from_uri (source,
-                                     uri,
-                                     keys,
-                                     options,
-                                     resolve_result_async_cb,
-                                     ds))
+  if (grl_source_store_metadata_impl (source,
+                                      media,
+                                      keys,
+                                      flags,
+                                      store_metadata_result_async_cb,
+                                      ds))
     grl_wait_for_async_operation_complete (ds);
 
   if (ds->error) {
@@ -3668,825 +9552,900 @@ grl_source_get_media_from_uri_sync (GrlSource *source,
     }
   }
 
-  result = (GrlMedia *) ds->data;
+  failed = ds->data;
+
   g_slice_free (GrlDataSync, ds);
 
-  return result;
+  return failed;
 }
 
 /**
- * grl_source_browse:
+ * grl_source_store_metadata_batch:
  * @source: a source
- * @container: (allow-none): a container of data transfer objects
- * @keys: (element-type GrlKeyID): the #GList of
- * #GrlKeyID<!-- -->s to request
- * @options: options wanted for that operation
- * @callback: (scope notified): the user defined callback
- * @user_data: the user data to pass in the callback
+ * @medias: (element-type GrlMedia) (transfer none): the #GPtrArray of
+ * #GrlMedia to store
+ * @keys: (element-type GrlKeyID): the #GList of #GrlKeyID whose values we
+ * want to change in every element of @medias
+ * @flags: Flags to configure specific behaviors of the operation.
+ * @callback: (scope notified) (allow-none): the callback to execute when
+ * the operation is finished
+ * @user_data: user data set for the @callback
  *
- * Browse from media elements through an available list.
+ * Stores permanently the values for @keys of all the elements in @medias,
+ * as grl_source_store_metadata() does for a single one.
  *
- * This method is asynchronous.
+ * Which source writes each key is only worked out once for all the elements.
+ * Sources implementing the store_metadata_batch vmethod get a single request
+ * with all of them; the rest are given them one after the other.
  *
- * Returns: the operation identifier
+ * @callback is invoked once, when all elements have been stored.
  *
- * Since: 0.2.0
+ * This function is asynchronous and uses the Glib's main loop.
+ *
+ * Since: 0.3.20
  */
-guint
-grl_source_browse (GrlSource *source,
-                   GrlMedia *container,
-                   const GList *keys,
-                   GrlOperationOptions *options,
-                   GrlSourceResultCb callback,
-                   gpointer user_data)
+void
+grl_source_store_metadata_batch (GrlSource *source,
+                                 GPtrArray *medias,
+                                 GList *keys,
+                                 GrlWriteFlags flags,
+                                 GrlSourceStoreMetadataBatchCb callback,
+                                 gpointer user_data)
+{
+  struct StoreMetadataBatchRelayCb *smbrc;
+  GHashTable *map;
+  GList *failed_keys = NULL;
+  GError *error;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  g_return_if_fail (GRL_IS_SOURCE (source));
+  g_return_if_fail (medias != NULL);
+  g_return_if_fail (keys != NULL);
+
+  map = map_writable_keys (source, keys, flags, &failed_keys);
+
+  if (g_hash_table_size (map) == 0) {
+    error = g_error_new (GRL_CORE_ERROR,
+                         GRL_CORE_ERROR_STORE_METADATA_FAILED,
+                         _("None of the specified keys are writable"));
+    if (callback) {
+      callback (source, medias, failed_keys, user_data, error);
+    }
+
+    g_error_free (error);
+    g_list_free (failed_keys);
+    g_hash_table_unref (map);
+
+    return;
+  }
+
+  smbrc = g_slice_new0 (struct StoreMetadataBatchRelayCb);
+  smbrc->source = g_object_ref (source);
+  smbrc->medias = g_ptr_array_ref (medias);
+  smbrc->map = map;
+  smbrc->failed_keys = failed_keys;
+  smbrc->user_callback = callback;
+  smbrc->user_data = user_data;
+  smbrc->started = grl_metrics_start ();
+
+  grl_operation_idle_add (G_PRIORITY_DEFAULT_IDLE,
+                          store_metadata_batch_idle,
+                          smbrc,
+                          NULL,
+                          "[grilo] store_metadata_batch_idle");
+}
+
+/**
+ * grl_source_flush_metadata:
+ * @source: a source
+ *
+ * Stores right away the edits kept by write-behind in @source. See
+ * grl_source_set_write_behind().
+ *
+ * Since: 0.3.20
+ */
+void
+grl_source_flush_metadata (GrlSource *source)
+{
+  g_return_if_fail (GRL_IS_SOURCE (source));
+
+  write_behind_flush (source);
+}
+
+/* ================ GTask API ================ */
+
+/* Operations started from the *_async () functions run in the thread-default
+   main context of the caller, like the callback based ones, so GTask returns
+   their results in the same context they were produced in. */
+
+struct AsyncCall {
+  GrlSupportedOps operation;
+  GrlMedia *media;
+  GrlMedia *container;
+  gchar *text;
+  GList *keys;
+  GrlOperationOptions *options;
+  GrlWriteFlags flags;
+  guint operation_id;
+  gulong cancelled_id;
+  gboolean finished;
+  GList *medias;
+  GList *failed_keys;
+};
+
+static void
+async_call_free (struct AsyncCall *ac)
+{
+  g_clear_object (&ac->media);
+  g_clear_object (&ac->container);
+  g_free (ac->text);
+  g_list_free (ac->keys);
+  g_clear_object (&ac->options);
+  g_list_free_full (ac->medias, g_object_unref);
+  g_list_free (ac->failed_keys);
+  g_slice_free (struct AsyncCall, ac);
+}
+
+static void
+async_call_media_list_free (GList *medias)
+{
+  g_list_free_full (medias, g_object_unref);
+}
+
+static gboolean
+async_call_cancel_idle (gpointer user_data)
+{
+  struct AsyncCall *ac = g_task_get_task_data (G_TASK (user_data));
+
+  GRL_DEBUG (__FUNCTION__);
+
+  if (!ac->finished) {
+    grl_operation_cancel (ac->operation_id);
+  }
+
+  return FALSE;
+}
+
+static void
+async_call_cancelled_cb (GCancellable *cancellable,
+                         gpointer user_data)
+{
+  GSource *idle;
+
+  /* This can be run in any thread */
+  idle = g_idle_source_new ();
+  g_source_set_priority (idle, G_PRIORITY_DEFAULT);
+  g_source_set_callback (idle, async_call_cancel_idle,
+                         g_object_ref (user_data), g_object_unref);
+  g_source_set_name (idle, "[grilo] async_call_cancel_idle");
+  g_source_attach (idle, g_task_get_context (G_TASK (user_data)));
+  g_source_unref (idle);
+}
+
+/* Detaches the call from its cancellable once the source has answered */
+static struct AsyncCall *
+async_call_finished (GTask *task)
+{
+  struct AsyncCall *ac = g_task_get_task_data (task);
+
+  ac->finished = TRUE;
+  if (ac->cancelled_id) {
+    g_cancellable_disconnect (g_task_get_cancellable (task), ac->cancelled_id);
+    ac->cancelled_id = 0;
+  }
+
+  return ac;
+}
+
+static void
+async_call_resolve_cb (GrlSource *source,
+                       guint operation_id,
+                       GrlMedia *media,
+                       gpointer user_data,
+                       const GError *error)
+{
+  GTask *task = G_TASK (user_data);
+
+  GRL_DEBUG (__FUNCTION__);
+
+  async_call_finished (task);
+
+  if (error) {
+    g_clear_object (&media);
+    g_task_return_error (task, g_error_copy (error));
+  } else {
+    g_task_return_pointer (task, media, g_object_unref);
+  }
+  g_object_unref (task);
+}
+
+static void
+async_call_result_cb (GrlSource *source,
+                      guint operation_id,
+                      GPtrArray *medias,
+                      guint remaining,
+                      gpointer user_data,
+                      const GError *error)
 {
-  GList *_keys;
-  GrlSourceBrowseSpec *bs;
-  guint operation_id;
-  struct BrowseRelayCb *brc;
-  GrlResolutionFlags flags;
-  guint id;
+  GTask *task = G_TASK (user_data);
+  struct AsyncCall *ac = g_task_get_task_data (task);
+  guint i;
 
-  g_return_val_if_fail (GRL_IS_SOURCE (source), 0);
-  g_return_val_if_fail (GRL_IS_OPERATION_OPTIONS (options), 0);
-  g_return_val_if_fail (callback != NULL, 0);
-  g_return_val_if_fail (grl_source_supported_operations (source) &
-                        GRL_OP_BROWSE, 0);
-  g_return_val_if_fail (check_options (source, GRL_OP_BROWSE, options), 0);
+  GRL_DEBUG (__FUNCTION__);
 
-  /* By default assume we will use the parameters specified by the user */
-  _keys = g_list_copy ((GList *) keys);
+  for (i = 0; i < medias->len; i++) {
+    ac->medias = g_list_prepend (ac->medias,
+                                 g_object_ref (g_ptr_array_index (medias, i)));
+  }
+  g_ptr_array_unref (medias);
 
-  flags = grl_operation_options_get_resolution_flags (options);
+  if (!error && remaining > 0) {
+    return;
+  }
 
-  if (flags & GRL_RESOLVE_FAST_ONLY) {
-    GRL_DEBUG ("requested fast keys");
-    filter_slow (source, &_keys, FALSE);
+  async_call_finished (task);
+
+  if (error) {
+    g_task_return_error (task, g_error_copy (error));
+  } else {
+    g_task_return_pointer (task,
+                           g_list_reverse (g_steal_pointer (&ac->medias)),
+                           (GDestroyNotify) async_call_media_list_free);
   }
+  g_object_unref (task);
+}
 
-  /* Setup full resolution mode if requested */
-  if (flags & GRL_RESOLVE_FULL) {
-    GRL_DEBUG ("requested full metadata");
-    _keys = expand_operation_keys (source, NULL, _keys);
+static void
+async_call_remove_cb (GrlSource *source,
+                      GrlMedia *media,
+                      gpointer user_data,
+                      const GError *error)
+{
+  GTask *task = G_TASK (user_data);
+
+  GRL_DEBUG (__FUNCTION__);
+
+  async_call_finished (task);
+
+  if (error) {
+    g_task_return_error (task, g_error_copy (error));
+  } else {
+    g_task_return_boolean (task, TRUE);
   }
+  g_object_unref (task);
+}
 
-  operation_id = grl_operation_generate_id ();
+static void
+async_call_store_cb (GrlSource *source,
+                     GrlMedia *media,
+                     GList *failed_keys,
+                     gpointer user_data,
+                     const GError *error)
+{
+  GTask *task = G_TASK (user_data);
+  struct AsyncCall *ac;
 
-  /* Always hook an own relay callback so we can do some
-     post-processing before handing out the results
-     to the user */
-  brc = g_slice_new (struct BrowseRelayCb);
-  brc->source = g_object_ref (source);
-  brc->operation_type = GRL_OP_BROWSE;
-  brc->operation_id = operation_id;
-  brc->keys = _keys;
-  brc->options = g_object_ref (options);
-  brc->user_callback = callback;
-  brc->user_data = user_data;
-  brc->queue = NULL;
-  brc->dispatcher_running = FALSE;
+  GRL_DEBUG (__FUNCTION__);
 
-  bs = g_new (GrlSourceBrowseSpec, 1);
-  bs->source = g_object_ref (source);
-  bs->operation_id = operation_id;
-  /* _keys is already a copy */
-  bs->keys = _keys;
-  bs->options = grl_operation_options_copy (options);
-  bs->callback = browse_result_relay_cb;
-  bs->user_data = brc;
+  ac = async_call_finished (task);
+  ac->failed_keys = g_list_copy (failed_keys);
 
-  if (!container) {
-    /* Special case: NULL container ==> NULL id */
-    bs->container = grl_media_container_new ();
-    grl_media_set_source (bs->container,
-                          grl_source_get_id (source));
+  if (error) {
+    g_task_return_error (task, g_error_copy (error));
   } else {
-    bs->container = g_object_ref (container);
+    g_task_return_boolean (task, TRUE);
   }
+  g_object_unref (task);
+}
 
-  /* Save a reference to the operaton spec in the relay-cb's
-     user_data so that we can free the spec there when we get
-     the last result */
-  brc->spec.browse = bs;
+static void
+async_call_run (GTask *task)
+{
+  GrlSource *source = g_task_get_source_object (task);
+  struct AsyncCall *ac = g_task_get_task_data (task);
+  GCancellable *cancellable = g_task_get_cancellable (task);
 
-  /* Setup auto-split management if requested */
-  brc->auto_split = auto_split_setup (source, bs->options);
+  GRL_DEBUG (__FUNCTION__);
 
-  operation_set_ongoing (source, operation_id);
+  if (g_task_return_error_if_cancelled (task)) {
+    return;
+  }
 
-  id = g_idle_add_full (flags & GRL_RESOLVE_IDLE_RELAY? G_PRIORITY_DEFAULT_IDLE: G_PRIORITY_HIGH_IDLE,
-                        browse_idle,
-                        bs,
-                        NULL);
-  g_source_set_name_by_id (id, "[grilo] browse_idle");
+  /* Reference released when the source answers */
+  g_object_ref (task);
 
-  return operation_id;
+  switch (ac->operation) {
+  case GRL_OP_RESOLVE:
+    ac->operation_id = grl_source_resolve (source,
+                                           g_steal_pointer (&ac->media),
+                                           ac->keys, ac->options,
+                                           async_call_resolve_cb, task);
+    break;
+  case GRL_OP_MEDIA_FROM_URI:
+    ac->operation_id = grl_source_get_media_from_uri (source,
+                                                      ac->text,
+                                                      ac->keys, ac->options,
+                                                      async_call_resolve_cb,
+                                                      task);
+    break;
+  case GRL_OP_BROWSE:
+    ac->operation_id = grl_source_browse_batch (source, ac->container,
+                                                ac->keys, ac->options,
+                                                async_call_result_cb, task);
+    break;
+  case GRL_OP_SEARCH:
+    ac->operation_id = grl_source_search_batch (source, ac->text,
+                                                ac->keys, ac->options,
+                                                async_call_result_cb, task);
+    break;
+  case GRL_OP_QUERY:
+    ac->operation_id = grl_source_query_batch (source, ac->text,
+                                               ac->keys, ac->options,
+                                               async_call_result_cb, task);
+    break;
+  case GRL_OP_REMOVE:
+    grl_source_remove (source, ac->media, async_call_remove_cb, task);
+    break;
+  case GRL_OP_STORE:
+    grl_source_store (source, ac->container, ac->media, ac->flags,
+                      async_call_store_cb, task);
+    break;
+  case GRL_OP_STORE_METADATA:
+    grl_source_store_metadata (source, ac->media, ac->keys, ac->flags,
+                               async_call_store_cb, task);
+    break;
+  default:
+    g_assert_not_reached ();
+  }
+
+  /* Only operations with an identifier can be stopped midway; the others
+     are reported as cancelled once the source answers */
+  if (ac->operation_id && !ac->finished && cancellable) {
+    ac->cancelled_id = g_cancellable_connect (cancellable,
+                                              G_CALLBACK (async_call_cancelled_cb),
+                                              task, NULL);
+  }
 }
 
-/**
- * grl_source_browse_sync:
- * @source: a source
- * @container: (allow-none): a container of data transfer objects
- * @keys: (element-type GrlKeyID): the #GList of
- * #GrlKeyID<!-- -->s to request
- * @options: options wanted for that operation
- * @error: a #GError, or @NULL
- *
- * Browse media elements through an available
- * list.
- *
- * This method is synchronous.
- *
- * Returns: (element-type GrlMedia) (transfer full): a #GList with #GrlMedia
- * elements. After use g_object_unref() every element and g_list_free() the
- * list.
- *
- * Since: 0.2.0
- */
-GList *
-grl_source_browse_sync (GrlSource *source,
-                        GrlMedia *container,
-                        const GList *keys,
-                        GrlOperationOptions *options,
-                        GError **error)
+static void
+async_call_start (GrlSource *source,
+                  struct AsyncCall *ac,
+                  gpointer source_tag,
+                  GCancellable *cancellable,
+                  GAsyncReadyCallback callback,
+                  gpointer user_data)
 {
-  GrlDataSync *ds;
-  GList *result;
+  GTask *task;
 
-  ds = g_slice_new0 (GrlDataSync);
+  task = g_task_new (source, cancellable, callback, user_data);
+  g_task_set_source_tag (task, source_tag);
+  g_task_set_task_data (task, ac, (GDestroyNotify) async_call_free);
 
-  if (grl_source_browse (source,
-                         container,
-                         keys,
-                         options,
-                         multiple_result_async_cb,
-                         ds))
-    grl_wait_for_async_operation_complete (ds);
+  async_call_run (task);
+  g_object_unref (task);
+}
 
-  if (ds->error) {
-    if (error) {
-      *error = ds->error;
-    } else {
-      g_error_free (ds->error);
-    }
-  }
+static struct AsyncCall *
+async_call_new (GrlSupportedOps operation,
+                const GList *keys,
+                GrlOperationOptions *options)
+{
+  struct AsyncCall *ac;
 
-  result = (GList *) ds->data;
-  g_slice_free (GrlDataSync, ds);
+  ac = g_slice_new0 (struct AsyncCall);
+  ac->operation = operation;
+  ac->keys = g_list_copy ((GList *) keys);
+  ac->options = options? g_object_ref (options): NULL;
 
-  return result;
+  return ac;
 }
 
 /**
- * grl_source_search:
+ * grl_source_resolve_async:
  * @source: a source
- * @text: the text to search
+ * @media: (allow-none) (transfer full): a data transfer object
  * @keys: (element-type GrlKeyID): the #GList of
  * #GrlKeyID<!-- -->s to request
- * @options: options wanted for that operation
- * @callback: (scope notified): the user defined callback
+ * @options: options to pass to this operation
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @callback: (scope async): the callback to call when the operation finishes
  * @user_data: the user data to pass in the callback
  *
- * Search for the @text string in a source for data identified with that string.
- *
- * If @text is @NULL then no text filter will be applied, and thus, no media
- * items from @source will be filtered. If @source does not support NULL-text
- * search operations it should notiy the client by setting
- * @GRL_CORE_ERROR_SEARCH_NULL_UNSUPPORTED in @callback's error parameter.
- *
- * This method is asynchronous.
- *
- * Returns: the operation identifier
+ * Asynchronous variant of grl_source_resolve_sync(). It can be called from
+ * any thread: the operation is run in the global default main context, and
+ * @callback is invoked in the thread-default main context of the caller.
  *
- * Since: 0.2.0
+ * Since: 0.3.20
  */
-guint
-grl_source_search (GrlSource *source,
-                   const gchar *text,
-                   const GList *keys,
-                   GrlOperationOptions *options,
-                   GrlSourceResultCb callback,
-                   gpointer user_data)
+void
+grl_source_resolve_async (GrlSource *source,
+                          GrlMedia *media,
+                          const GList *keys,
+                          GrlOperationOptions *options,
+                          GCancellable *cancellable,
+                          GAsyncReadyCallback callback,
+                          gpointer user_data)
 {
-  GList *_keys;
-  GrlSourceSearchSpec *ss;
-  guint operation_id;
-  struct BrowseRelayCb *brc;
-  GrlResolutionFlags flags;
-  guint id;
-
-  g_return_val_if_fail (GRL_IS_SOURCE (source), 0);
-  g_return_val_if_fail (GRL_IS_OPERATION_OPTIONS (options), 0);
-  g_return_val_if_fail (callback != NULL, 0);
-  g_return_val_if_fail (grl_source_supported_operations (source) &
-                        GRL_OP_SEARCH, 0);
-  g_return_val_if_fail (check_options (source, GRL_OP_SEARCH, options), 0);
+  struct AsyncCall *ac;
 
-  /* By default assume we will use the parameters specified by the user */
-  _keys = g_list_copy ((GList *) keys);
-
-  flags = grl_operation_options_get_resolution_flags (options);
+  g_return_if_fail (GRL_IS_SOURCE (source));
+  g_return_if_fail (GRL_IS_OPERATION_OPTIONS (options));
 
-  if (flags & GRL_RESOLVE_FAST_ONLY) {
-    GRL_DEBUG ("requested fast keys");
-    filter_slow (source, &_keys, FALSE);
-  }
+  ac = async_call_new (GRL_OP_RESOLVE, keys, options);
+  ac->media = media;
 
-  /* Setup full resolution mode if requested */
-  if (flags & GRL_RESOLVE_FULL) {
-    GRL_DEBUG ("requested full metadata");
-    _keys = expand_operation_keys (source, NULL, _keys);
-  }
+  async_call_start (source, ac, grl_source_resolve_async,
+                    cancellable, callback, user_data);
+}
 
-  operation_id = grl_operation_generate_id ();
+/**
+ * grl_source_resolve_finish:
+ * @source: a source
+ * @result: the #GAsyncResult passed to the callback
+ * @error: a #GError, or @NULL
+ *
+ * Finishes an operation started with grl_source_resolve_async().
+ *
+ * Returns: (transfer full): a filled #GrlMedia, or %NULL on error
+ *
+ * Since: 0.3.20
+ */
+GrlMedia *
+grl_source_resolve_finish (GrlSource *source,
+                           GAsyncResult *result,
+                           GError **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, source), NULL);
+  g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) ==
+                        grl_source_resolve_async, NULL);
 
-  /* Always hook an own relay callback so we can do some
-     post-processing before handing out the results
-     to the user */
-  brc = g_slice_new (struct BrowseRelayCb);
-  brc->source = g_object_ref (source);
-  brc->operation_type = GRL_OP_SEARCH;
-  brc->operation_id = operation_id;
-  brc->keys = _keys;
-  brc->options = g_object_ref (options);
-  brc->user_callback = callback;
-  brc->user_data = user_data;
-  brc->queue = NULL;
-  brc->dispatcher_running = FALSE;
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
 
-  ss = g_new (GrlSourceSearchSpec, 1);
-  ss->source = g_object_ref (source);
-  ss->operation_id = operation_id;
-  ss->text = g_strdup (text);
-  ss->keys = _keys;
-  ss->options = grl_operation_options_copy (options);
-  ss->callback = browse_result_relay_cb;
-  ss->user_data = brc;
+/**
+ * grl_source_get_media_from_uri_async:
+ * @source: a source
+ * @uri: A URI that can be used to identify a media resource
+ * @keys: (element-type GrlKeyID): A list of keys to resolve
+ * @options: options wanted for that operation
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @callback: (scope async): the callback to call when the operation finishes
+ * @user_data: the user data to pass in the callback
+ *
+ * Asynchronous variant of grl_source_get_media_from_uri_sync(). See
+ * grl_source_resolve_async() for the contexts involved.
+ *
+ * Since: 0.3.20
+ */
+void
+grl_source_get_media_from_uri_async (GrlSource *source,
+                                     const gchar *uri,
+                                     const GList *keys,
+                                     GrlOperationOptions *options,
+                                     GCancellable *cancellable,
+                                     GAsyncReadyCallback callback,
+                                     gpointer user_data)
+{
+  struct AsyncCall *ac;
 
-  /* Save a reference to the operaton spec in the relay-cb's
-     user_data so that we can free the spec there when we get
-     the last result */
-  brc->spec.search = ss;
+  g_return_if_fail (GRL_IS_SOURCE (source));
+  g_return_if_fail (uri != NULL);
+  g_return_if_fail (GRL_IS_OPERATION_OPTIONS (options));
 
-  /* Setup auto-split management if requested */
-  brc->auto_split = auto_split_setup (source, ss->options);
+  ac = async_call_new (GRL_OP_MEDIA_FROM_URI, keys, options);
+  ac->text = g_strdup (uri);
 
-  operation_set_ongoing (source, operation_id);
+  async_call_start (source, ac, grl_source_get_media_from_uri_async,
+                    cancellable, callback, user_data);
+}
 
-  id = g_idle_add_full (flags & GRL_RESOLVE_IDLE_RELAY? G_PRIORITY_DEFAULT_IDLE: G_PRIORITY_HIGH_IDLE,
-                        search_idle,
-                        ss,
-                        NULL);
-  g_source_set_name_by_id (id, "[grilo] search_idle");
+/**
+ * grl_source_get_media_from_uri_finish:
+ * @source: a source
+ * @result: the #GAsyncResult passed to the callback
+ * @error: a #GError, or @NULL
+ *
+ * Finishes an operation started with grl_source_get_media_from_uri_async().
+ *
+ * Returns: (transfer full): a filled #GrlMedia, or %NULL
+ *
+ * Since: 0.3.20
+ */
+GrlMedia *
+grl_source_get_media_from_uri_finish (GrlSource *source,
+                                      GAsyncResult *result,
+                                      GError **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, source), NULL);
+  g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) ==
+                        grl_source_get_media_from_uri_async, NULL);
 
-  return operation_id;
+  return g_task_propagate_pointer (G_TASK (result), error);
 }
 
 /**
- * grl_source_search_sync:
+ * grl_source_browse_async:
  * @source: a source
- * @text: the text to search
+ * @container: (allow-none): a container of data transfer objects
  * @keys: (element-type GrlKeyID): the #GList of
  * #GrlKeyID<!-- -->s to request
  * @options: options wanted for that operation
- * @error: a #GError, or @NULL
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @callback: (scope async): the callback to call when the operation finishes
+ * @user_data: the user data to pass in the callback
  *
- * Search for the @text string in a source for data identified with that string.
+ * Asynchronous variant of grl_source_browse_sync(). See
+ * grl_source_resolve_async() for the contexts involved.
  *
- * If @text is @NULL then no text filter will be applied, and thus, no media
- * items from @source will be filtered. If @source does not support NULL-text
- * search operations it should notiy the client by setting
- * @GRL_CORE_ERROR_SEARCH_NULL_UNSUPPORTED in the error parameter.
+ * Since: 0.3.20
+ */
+void
+grl_source_browse_async (GrlSource *source,
+                         GrlMedia *container,
+                         const GList *keys,
+                         GrlOperationOptions *options,
+                         GCancellable *cancellable,
+                         GAsyncReadyCallback callback,
+                         gpointer user_data)
+{
+  struct AsyncCall *ac;
+
+  g_return_if_fail (GRL_IS_SOURCE (source));
+  g_return_if_fail (GRL_IS_OPERATION_OPTIONS (options));
+
+  ac = async_call_new (GRL_OP_BROWSE, keys, options);
+  ac->container = container? g_object_ref (container): NULL;
+
+  async_call_start (source, ac, grl_source_browse_async,
+                    cancellable, callback, user_data);
+}
+
+/**
+ * grl_source_browse_finish:
+ * @source: a source
+ * @result: the #GAsyncResult passed to the callback
+ * @error: a #GError, or @NULL
  *
- * This method is synchronous.
+ * Finishes an operation started with grl_source_browse_async().
  *
  * Returns: (element-type GrlMedia) (transfer full): a #GList with #GrlMedia
  * elements. After use g_object_unref() every element and g_list_free() the
  * list.
  *
- * Since: 0.2.0
+ * Since: 0.3.20
  */
 GList *
-grl_source_search_sync (GrlSource *source,
-                        const gchar *text,
-                        const GList *keys,
-                        GrlOperationOptions *options,
-                        GError **error)
+grl_source_browse_finish (GrlSource *source,
+                          GAsyncResult *result,
+                          GError **error)
 {
-  GrlDataSync *ds;
-  GList *result;
-
-  ds = g_slice_new0 (GrlDataSync);
-
-  if (grl_source_search (source,
-                         text,
-                         keys,
-                         options,
-                         multiple_result_async_cb,
-                         ds))
-    grl_wait_for_async_operation_complete (ds);
-
-  if (ds->error) {
-    if (error) {
-      *error = ds->error;
-    } else {
-      g_error_free (ds->error);
-    }
-  }
-
-  result = (GList *) ds->data;
-  g_slice_free (GrlDataSync, ds);
+  g_return_val_if_fail (g_task_is_valid (result, source), NULL);
+  g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) ==
+                        grl_source_browse_async, NULL);
 
-  return result;
+  return g_task_propagate_pointer (G_TASK (result), error);
 }
 
 /**
- * grl_source_query:
+ * grl_source_search_async:
  * @source: a source
- * @query: the query to process
+ * @text: the text to search
  * @keys: (element-type GrlKeyID): the #GList of
  * #GrlKeyID<!-- -->s to request
  * @options: options wanted for that operation
- * @callback: (scope notified): the user defined callback
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @callback: (scope async): the callback to call when the operation finishes
  * @user_data: the user data to pass in the callback
  *
- * Execute a specialized query (specific for each provider) on a media
- * repository.
- *
- * It is different from grl_source_search() semantically, because the query
- * implies a carefully crafted string, rather than a simple string to search.
- *
- * This method is asynchronous.
- *
- * Returns: the operation identifier
+ * Asynchronous variant of grl_source_search_sync(). See
+ * grl_source_resolve_async() for the contexts involved.
  *
- * Since: 0.2.0
+ * Since: 0.3.20
  */
-guint
-grl_source_query (GrlSource *source,
-                  const gchar *query,
-                  const GList *keys,
-                  GrlOperationOptions *options,
-                  GrlSourceResultCb callback,
-                  gpointer user_data)
+void
+grl_source_search_async (GrlSource *source,
+                         const gchar *text,
+                         const GList *keys,
+                         GrlOperationOptions *options,
+                         GCancellable *cancellable,
+                         GAsyncReadyCallback callback,
+                         gpointer user_data)
 {
-  GList *_keys;
-  GrlSourceQuerySpec *qs;
-  guint operation_id;
-  struct BrowseRelayCb *brc;
-  GrlResolutionFlags flags;
-  guint id;
-
-  g_return_val_if_fail (GRL_IS_SOURCE (source), 0);
-  g_return_val_if_fail (GRL_IS_OPERATION_OPTIONS (options), 0);
-  g_return_val_if_fail (query != NULL, 0);
-  g_return_val_if_fail (callback != NULL, 0);
-  g_return_val_if_fail (grl_source_supported_operations (source) &
-                        GRL_OP_QUERY, 0);
-  g_return_val_if_fail (check_options (source, GRL_OP_QUERY, options), 0);
-
-  /* By default assume we will use the parameters specified by the user */
-  _keys = g_list_copy ((GList *) keys);
-
-  flags = grl_operation_options_get_resolution_flags (options);
-
-  if (flags & GRL_RESOLVE_FAST_ONLY) {
-    GRL_DEBUG ("requested fast keys");
-    filter_slow (source, &_keys, FALSE);
-  }
-
-  if (flags & GRL_RESOLVE_FULL) {
-    GRL_DEBUG ("requested full metadata");
-    _keys = expand_operation_keys (source, NULL, _keys);
-  }
-
-  operation_id = grl_operation_generate_id ();
-
-  /* Always hook an own relay callback so we can do some
-     post-processing before handing out the results
-     to the user */
-  brc = g_slice_new (struct BrowseRelayCb);
-  brc->source = g_object_ref (source);
-  brc->operation_type = GRL_OP_QUERY;
-  brc->operation_id = operation_id;
-  brc->keys = _keys;
-  brc->options = g_object_ref (options);
-  brc->user_callback = callback;
-  brc->user_data = user_data;
-  brc->queue = NULL;
-  brc->dispatcher_running = FALSE;
-
-  qs = g_new (GrlSourceQuerySpec, 1);
-  qs->source = g_object_ref (source);
-  qs->operation_id = operation_id;
-  qs->query = g_strdup (query);
-  qs->keys = _keys;
-  qs->options = grl_operation_options_copy (options);
-  qs->callback = browse_result_relay_cb;
-  qs->user_data = brc;
-
-  /* Save a reference to the operaton spec in the relay-cb's
-     user_data so that we can free the spec there when we get
-     the last result */
-  brc->spec.query = qs;
-
-  /* Setup auto-split management if requested */
-  brc->auto_split = auto_split_setup (source, qs->options);
+  struct AsyncCall *ac;
 
-  operation_set_ongoing (source, operation_id);
+  g_return_if_fail (GRL_IS_SOURCE (source));
+  g_return_if_fail (GRL_IS_OPERATION_OPTIONS (options));
 
-  id = g_idle_add_full (flags & GRL_RESOLVE_IDLE_RELAY? G_PRIORITY_DEFAULT_IDLE: G_PRIORITY_HIGH_IDLE,
-                        query_idle,
-                        qs,
-                        NULL);
-  g_source_set_name_by_id (id, "[grilo] query_idle");
+  ac = async_call_new (GRL_OP_SEARCH, keys, options);
+  ac->text = g_strdup (text);
 
-  return operation_id;
+  async_call_start (source, ac, grl_source_search_async,
+                    cancellable, callback, user_data);
 }
 
 /**
- * grl_source_query_sync:
+ * grl_source_search_finish:
  * @source: a source
- * @query: the query to process
- * @keys: (element-type GrlKeyID): the #GList of
- * #GrlKeyID<!-- -->s to request
- * @options: options wanted for that operation
+ * @result: the #GAsyncResult passed to the callback
  * @error: a #GError, or @NULL
  *
- * Execute a specialized query (specific for each provider) on a media
- * repository.
- *
- * This method is synchronous.
+ * Finishes an operation started with grl_source_search_async().
  *
  * Returns: (element-type GrlMedia) (transfer full): a #GList with #GrlMedia
  * elements. After use g_object_unref() every element and g_list_free() the
  * list.
  *
- * Since: 0.2.0
+ * Since: 0.3.20
  */
 GList *
-grl_source_query_sync (GrlSource *source,
-                       const gchar *query,
-                       const GList *keys,
-                       GrlOperationOptions *options,
-                       GError **error)
+grl_source_search_finish (GrlSource *source,
+                          GAsyncResult *result,
+                          GError **error)
 {
-  GrlDataSync *ds;
-  GList *result;
-
-  ds = g_slice_new0 (GrlDataSync);
-
-  if (grl_source_query (source,
-                        query,
-                        keys,
-                        options,
-                        multiple_result_async_cb,
-                        ds))
-    grl_wait_for_async_operation_complete (ds);
+  g_return_val_if_fail (g_task_is_valid (result, source), NULL);
+  g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) ==
+                        grl_source_search_async, NULL);
 
-  if (ds->error) {
-    if (error) {
-      *error = ds->error;
-    } else {
-      g_error_free (ds->error);
-    }
-  }
-
-  result = (GList *) ds->data;
-  g_slice_free (GrlDataSync, ds);
-
-  return result;
+  return g_task_propagate_pointer (G_TASK (result), error);
 }
 
-static gboolean
-grl_source_store_remove_impl (GrlSource *source,
-                              GrlMedia *media,
-                              GrlSourceRemoveCb callback,
-                              gpointer user_data)
-{
-  const gchar *id;
-  struct RemoveRelayCb *rrc;
-  GrlSourceRemoveSpec *rs;
-  guint tag_id;
-
-  GRL_DEBUG (__FUNCTION__);
-
-  g_return_val_if_fail (GRL_IS_SOURCE (source), FALSE);
-  g_return_val_if_fail (GRL_IS_MEDIA (media), FALSE);
-  g_return_val_if_fail (callback != NULL, FALSE);
-  g_return_val_if_fail (grl_source_supported_operations (source) &
-                        GRL_OP_REMOVE, FALSE);
-
-  rrc = g_slice_new (struct RemoveRelayCb);
-  rrc->source = g_object_ref (source);
-  rrc->media = g_object_ref (media);
-  rrc->user_callback = callback;
-  rrc->user_data = user_data;
-
-  /* Check that we have the minimum information we need */
-  id = grl_media_get_id (media);
-  if (!id) {
-    rrc->error = g_error_new (GRL_CORE_ERROR,
-                              GRL_CORE_ERROR_REMOVE_FAILED,
-                              _("Media has no “id”, cannot remove"));
-    rrc->spec = NULL;
-  } else {
-    rrc->error = NULL;
-    rs = g_new0 (GrlSourceRemoveSpec, 1);
-    rs->source = g_object_ref (source);
-    rs->media_id = g_strdup (id);
-    rs->media = g_object_ref (media);
-    rs->callback = remove_result_relay_cb;
-    rs->user_data = rrc;
-    rrc->spec = rs;
-  }
+/**
+ * grl_source_query_async:
+ * @source: a source
+ * @query: the query to process
+ * @keys: (element-type GrlKeyID): the #GList of
+ * #GrlKeyID<!-- -->s to request
+ * @options: options wanted for that operation
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @callback: (scope async): the callback to call when the operation finishes
+ * @user_data: the user data to pass in the callback
+ *
+ * Asynchronous variant of grl_source_query_sync(). See
+ * grl_source_resolve_async() for the contexts involved.
+ *
+ * Since: 0.3.20
+ */
+void
+grl_source_query_async (GrlSource *source,
+                        const gchar *query,
+                        const GList *keys,
+                        GrlOperationOptions *options,
+                        GCancellable *cancellable,
+                        GAsyncReadyCallback callback,
+                        gpointer user_data)
+{
+  struct AsyncCall *ac;
+
+  g_return_if_fail (GRL_IS_SOURCE (source));
+  g_return_if_fail (query != NULL);
+  g_return_if_fail (GRL_IS_OPERATION_OPTIONS (options));
 
-  tag_id = g_idle_add (remove_idle, rrc);
-  g_source_set_name_by_id (tag_id, "[grilo] remove_idle");
+  ac = async_call_new (GRL_OP_QUERY, keys, options);
+  ac->text = g_strdup (query);
 
-  return TRUE;
+  async_call_start (source, ac, grl_source_query_async,
+                    cancellable, callback, user_data);
 }
 
 /**
- * grl_source_remove:
+ * grl_source_query_finish:
  * @source: a source
- * @media: a data transfer object
- * @callback: (scope notified): the user defined callback
- * @user_data: the user data to pass in the callback
+ * @result: the #GAsyncResult passed to the callback
+ * @error: a #GError, or @NULL
  *
- * Remove a @media from the @source repository.
+ * Finishes an operation started with grl_source_query_async().
  *
- * This method is asynchronous.
+ * Returns: (element-type GrlMedia) (transfer full): a #GList with #GrlMedia
+ * elements. After use g_object_unref() every element and g_list_free() the
+ * list.
  *
- * Since: 0.2.0
+ * Since: 0.3.20
  */
-void
-grl_source_remove (GrlSource *source,
-                   GrlMedia *media,
-                   GrlSourceRemoveCb callback,
-                   gpointer user_data)
+GList *
+grl_source_query_finish (GrlSource *source,
+                         GAsyncResult *result,
+                         GError **error)
 {
-  grl_source_store_remove_impl (source, media, callback, user_data);
+  g_return_val_if_fail (g_task_is_valid (result, source), NULL);
+  g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) ==
+                        grl_source_query_async, NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
 }
 
 /**
- * grl_source_remove_sync:
+ * grl_source_remove_async:
  * @source: a source
  * @media: a data transfer object
- * @error: a #GError, or @NULL
- *
- * Remove a @media from the @source repository.
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @callback: (scope async): the callback to call when the operation finishes
+ * @user_data: the user data to pass in the callback
  *
- * This method is synchronous.
+ * Asynchronous variant of grl_source_remove_sync(). See
+ * grl_source_resolve_async() for the contexts involved. Once the source has
+ * been asked to remove @media, cancelling @cancellable only changes the
+ * result reported.
  *
- * Since: 0.2.0
+ * Since: 0.3.20
  */
 void
-grl_source_remove_sync (GrlSource *source,
-                        GrlMedia *media,
-                        GError **error)
-{
-  GrlDataSync *ds;
-
-  ds = g_slice_new0 (GrlDataSync);
-
-  if (grl_source_store_remove_impl (source,
-                                    media,
-                                    remove_async_cb,
-                                    ds))
-    grl_wait_for_async_operation_complete (ds);
-
-  if (ds->error) {
-    if (error) {
-      *error = ds->error;
-    } else {
-      g_error_free (ds->error);
-    }
-  }
-
-  g_slice_free (GrlDataSync, ds);
-}
-
-static gboolean
-grl_source_store_impl (GrlSource *source,
-                       GrlMedia *parent,
-                       GrlMedia *media,
-                       GrlWriteFlags flags,
-                       GrlSourceStoreCb callback,
-                       gpointer user_data)
+grl_source_remove_async (GrlSource *source,
+                         GrlMedia *media,
+                         GCancellable *cancellable,
+                         GAsyncReadyCallback callback,
+                         gpointer user_data)
 {
-  struct StoreRelayCb *src;
-  GrlSourceStoreSpec *ss;
-  guint id;
-
-  GRL_DEBUG (__FUNCTION__);
-
-  g_return_val_if_fail (GRL_IS_SOURCE (source), FALSE);
-  g_return_val_if_fail (!parent || grl_media_is_container (parent), FALSE);
-  g_return_val_if_fail (GRL_IS_MEDIA (media), FALSE);
-
-  g_return_val_if_fail ((!parent &&
-                         grl_source_supported_operations (source) & GRL_OP_STORE) ||
-                        (parent &&
-                         grl_source_supported_operations (source) & GRL_OP_STORE_PARENT),
-                        FALSE);
-
-  src = g_slice_new (struct StoreRelayCb);
-  src->flags = flags;
-  src->user_callback = callback;
-  src->user_data = user_data;
-
-  ss = g_new (GrlSourceStoreSpec, 1);
-  ss->source = g_object_ref (source);
-  ss->parent = parent? g_object_ref (parent): NULL;
-  ss->media = g_object_ref (media);
-  ss->callback = store_relay_cb;
-  ss->user_data = src;
+  struct AsyncCall *ac;
 
-  src->spec = ss;
+  g_return_if_fail (GRL_IS_SOURCE (source));
+  g_return_if_fail (GRL_IS_MEDIA (media));
 
-  id = g_idle_add (store_idle, ss);
-  g_source_set_name_by_id (id, "[grilo] store_idle");
+  ac = async_call_new (GRL_OP_REMOVE, NULL, NULL);
+  ac->media = g_object_ref (media);
 
-  return TRUE;
+  async_call_start (source, ac, grl_source_remove_async,
+                    cancellable, callback, user_data);
 }
 
 /**
- * grl_source_store:
+ * grl_source_remove_finish:
  * @source: a source
- * @parent: (allow-none): a parent to store the data transfer objects
- * @media: a data transfer object
- * @flags: flags to configure specific behaviour of the operation
- * @callback: (scope notified): the user defined callback
- * @user_data: the user data to pass in the callback
+ * @result: the #GAsyncResult passed to the callback
+ * @error: a #GError, or @NULL
  *
- * Store the @media into the @parent container
+ * Finishes an operation started with grl_source_remove_async().
  *
- * This method is asynchronous.
+ * Returns: %TRUE if the element was removed
  *
- * Since: 0.3.0
+ * Since: 0.3.20
  */
-void
-grl_source_store (GrlSource *source,
-                  GrlMedia *parent,
-                  GrlMedia *media,
-                  GrlWriteFlags flags,
-                  GrlSourceStoreCb callback,
-                  gpointer user_data)
+gboolean
+grl_source_remove_finish (GrlSource *source,
+                          GAsyncResult *result,
+                          GError **error)
 {
-  grl_source_store_impl (source, parent, media, flags, callback, user_data);
+  g_return_val_if_fail (g_task_is_valid (result, source), FALSE);
+  g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) ==
+                        grl_source_remove_async, FALSE);
+
+  return g_task_propagate_boolean (G_TASK (result), error);
 }
 
 /**
- * grl_source_store_sync:
+ * grl_source_store_async:
  * @source: a source
- * @parent: (allow-none): a #GrlMedia container to store the data transfer objects
+ * @parent: (allow-none): a #GrlMedia container to store the data transfer
+ * objects
  * @media: a #GrlMedia data transfer object
  * @flags: flags to configure specific behaviour of the operation
- * @error: a #GError, or @NULL
- *
- * Store the @media into the @parent container.
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @callback: (scope async): the callback to call when the operation finishes
+ * @user_data: the user data to pass in the callback
  *
- * This method is synchronous.
+ * Asynchronous variant of grl_source_store_sync(). See
+ * grl_source_remove_async() for the handling of @cancellable.
  *
- * Since: 0.3.0
+ * Since: 0.3.20
  */
 void
-grl_source_store_sync (GrlSource *source,
-                       GrlMedia *parent,
-                       GrlMedia *media,
-                       GrlWriteFlags flags,
-                       GError **error)
+grl_source_store_async (GrlSource *source,
+                        GrlMedia *parent,
+                        GrlMedia *media,
+                        GrlWriteFlags flags,
+                        GCancellable *cancellable,
+                        GAsyncReadyCallback callback,
+                        gpointer user_data)
 {
-  GrlDataSync *ds;
-
-  ds = g_slice_new0 (GrlDataSync);
+  struct AsyncCall *ac;
 
-  if (grl_source_store_impl (source,
-                             parent,
-                             media,
-                             flags,
-                             store_result_async_cb,
-                             ds))
-    grl_wait_for_async_operation_complete (ds);
+  g_return_if_fail (GRL_IS_SOURCE (source));
+  g_return_if_fail (GRL_IS_MEDIA (media));
 
-  if (ds->error) {
-    if (error) {
-      *error = ds->error;
-    } else {
-      g_error_free (ds->error);
-    }
-  }
+  ac = async_call_new (GRL_OP_STORE, NULL, NULL);
+  ac->container = parent? g_object_ref (parent): NULL;
+  ac->media = g_object_ref (media);
+  ac->flags = flags;
 
-  g_slice_free (GrlDataSync, ds);
+  async_call_start (source, ac, grl_source_store_async,
+                    cancellable, callback, user_data);
 }
 
-static gboolean
-grl_source_store_metadata_impl (GrlSource *source,
-                                GrlMedia *media,
-                                GList *keys,
-                                GrlWriteFlags flags,
-                                GrlSourceStoreCb callback,
-                                gpointer user_data)
+/**
+ * grl_source_store_finish:
+ * @source: a source
+ * @result: the #GAsyncResult passed to the callback
+ * @error: a #GError, or @NULL
+ *
+ * Finishes an operation started with grl_source_store_async().
+ *
+ * Returns: %TRUE if the element was stored
+ *
+ * Since: 0.3.20
+ */
+gboolean
+grl_source_store_finish (GrlSource *source,
+                         GAsyncResult *result,
+                         GError **error)
 {
-  GRL_DEBUG (__FUNCTION__);
-
-  g_return_val_if_fail (GRL_IS_SOURCE (source), FALSE);
-  g_return_val_if_fail (GRL_IS_MEDIA (media), FALSE);
-  g_return_val_if_fail (keys != NULL, FALSE);
-
-  run_store_metadata (source, media, keys, flags, callback, user_data);
+  g_return_val_if_fail (g_task_is_valid (result, source), FALSE);
+  g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) ==
+                        grl_source_store_async, FALSE);
 
-  return TRUE;
+  return g_task_propagate_boolean (G_TASK (result), error);
 }
 
 /**
- * grl_source_store_metadata:
- * @source: a metadata source
- * @media: the #GrlMedia object that we want to operate on.
- * @keys: (element-type GrlKeyID) (allow-none): a list
- * of #GrlKeyID whose values we want to change.
+ * grl_source_store_metadata_async:
+ * @source: a source
+ * @media: the #GrlMedia object that we want to operate on
+ * @keys: (element-type GrlKeyID) (allow-none): a list of
+ * #GrlKeyID whose values we want to change
  * @flags: Flags to configure specific behaviors of the operation.
- * @callback: (scope notified): the callback to execute when the operation is finished.
- * @user_data: user data set for the @callback
- *
- * Get the values for @keys from @media and store it permanently. After
- * calling this method, future queries that return this media object
- * shall return this new values for the selected keys.
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @callback: (scope async): the callback to call when the operation finishes
+ * @user_data: the user data to pass in the callback
  *
- * This function is asynchronous and uses the Glib's main loop.
+ * Asynchronous variant of grl_source_store_metadata_sync(). See
+ * grl_source_remove_async() for the handling of @cancellable.
  *
- * Since: 0.2.0
+ * Since: 0.3.20
  */
 void
-grl_source_store_metadata (GrlSource *source,
-                           GrlMedia *media,
-                           GList *keys,
-                           GrlWriteFlags flags,
-                           GrlSourceStoreCb callback,
-                           gpointer user_data)
+grl_source_store_metadata_async (GrlSource *source,
+                                 GrlMedia *media,
+                                 GList *keys,
+                                 GrlWriteFlags flags,
+                                 GCancellable *cancellable,
+                                 GAsyncReadyCallback callback,
+                                 gpointer user_data)
 {
-  grl_source_store_metadata_impl (source,
-                                  media,
-                                  keys,
-                                  flags,
-                                  callback,
-                                  user_data);
+  struct AsyncCall *ac;
+
+  g_return_if_fail (GRL_IS_SOURCE (source));
+  g_return_if_fail (GRL_IS_MEDIA (media));
+
+  ac = async_call_new (GRL_OP_STORE_METADATA, keys, NULL);
+  ac->media = g_object_ref (media);
+  ac->flags = flags;
+
+  async_call_start (source, ac, grl_source_store_metadata_async,
+                    cancellable, callback, user_data);
 }
 
 /**
- * grl_source_store_metadata_sync:
+ * grl_source_store_metadata_finish:
  * @source: a source
- * @media: the #GrlMedia object that we want to operate on
- * @keys: (element-type GrlKeyID) (allow-none): a list of
- * #GrlKeyID whose values we want to change
- * @flags: Flags to configure specific behaviors of the operation.
+ * @result: the #GAsyncResult passed to the callback
+ * @failed_keys: (out) (optional) (element-type GrlKeyID) (transfer container):
+ * return location for the #GList of keys that could not be updated
  * @error: a #GError, or @NULL
  *
- * Update @keys values from @media in the @source. After calling this method,
- * future queries that return this media object shall return this new value for
- * the selected key.
- *
- * This function is synchronous.
+ * Finishes an operation started with grl_source_store_metadata_async().
+ * @failed_keys is filled in even if the operation failed.
  *
- * Returns: (element-type GrlKeyID) (transfer container):
- * a #GList of keys that could not be updated, or @NULL
+ * Returns: %TRUE if all the keys were updated
  *
- * Since: 0.2.0
+ * Since: 0.3.20
  */
-GList *
-grl_source_store_metadata_sync (GrlSource *source,
-                                GrlMedia *media,
-                                GList *keys,
-                                GrlWriteFlags flags,
-                                GError **error)
+gboolean
+grl_source_store_metadata_finish (GrlSource *source,
+                                  GAsyncResult *result,
+                                  GList **failed_keys,
+                                  GError **error)
 {
-  GrlDataSync *ds;
-  GList *failed;
-
-  ds = g_slice_new0 (GrlDataSync);
+  struct AsyncCall *ac;
 
-  if (grl_source_store_metadata_impl (source,
-                                      media,
-                                      keys,
-                                      flags,
-                                      store_metadata_result_async_cb,
-                                      ds))
-    grl_wait_for_async_operation_complete (ds);
+  g_return_val_if_fail (g_task_is_valid (result, source), FALSE);
+  g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) ==
+                        grl_source_store_metadata_async, FALSE);
 
-  if (ds->error) {
-    if (error) {
-      *error = ds->error;
-    } else {
-      g_error_free (ds->error);
-    }
+  if (failed_keys) {
+    ac = g_task_get_task_data (G_TASK (result));
+    *failed_keys = g_steal_pointer (&ac->failed_keys);
   }
 
-  failed = ds->data;
-
-  g_slice_free (GrlDataSync, ds);
-
-  return failed;
+  return g_task_propagate_boolean (G_TASK (result), error);
 }
 
 /**
@@ -4581,6 +10540,8 @@ void grl_source_notify_change_list (GrlSource *source,
                                     gboolean location_unknown)
 {
   const gchar *source_id;
+  GrlMedia *media;
+  guint i;
 
   g_return_if_fail (GRL_IS_SOURCE (source));
   g_return_if_fail (changed_medias);
@@ -4591,6 +10552,17 @@ void grl_source_notify_change_list (GrlSource *source,
                        (GFunc) grl_media_set_source_if_unset,
                        (gpointer) source_id);
 
+  /* Drop the cached metadata of what changed */
+  for (i = 0; i < changed_medias->len; i++) {
+    media = g_ptr_array_index (changed_medias, i);
+    if (location_unknown || !grl_media_get_id (media)) {
+      grl_resolve_cache_invalidate (source_id, NULL);
+      break;
+    }
+    grl_resolve_cache_invalidate (grl_media_get_source (media),
+                                  grl_media_get_id (media));
+  }
+
   /* Add hook to free content when freeing the array */
   g_ptr_array_set_free_func (changed_medias, (GDestroyNotify) g_object_unref);
 
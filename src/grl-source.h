@@ -163,6 +163,26 @@ typedef void (*GrlSourceResolveCb) (GrlSource *source,
                                     gpointer user_data,
                                     const GError *error);
 
+/**
+ * GrlSourceResolveBatchCb:
+ * @source: a source
+ * @operation_id: operation identifier
+ * @medias: (element-type GrlMedia) (transfer none): the #GPtrArray of
+ * #GrlMedia passed to grl_source_resolve_batch()
+ * @user_data: user data passed to grl_source_resolve_batch()
+ * @error: (nullable): possible #GError generated at processing
+ *
+ * Prototype for the callback passed to grl_source_resolve_batch(). It is
+ * invoked once, when all the elements in @medias have been resolved.
+ *
+ * Since: 0.3.20
+ */
+typedef void (*GrlSourceResolveBatchCb) (GrlSource *source,
+                                         guint operation_id,
+                                         GPtrArray *medias,
+                                         gpointer user_data,
+                                         const GError *error);
+
 /**
  * GrlSourceResultCb:
  * @source: a source
@@ -182,6 +202,32 @@ typedef void (*GrlSourceResultCb) (GrlSource *source,
                                    gpointer user_data,
                                    const GError *error);
 
+/**
+ * GrlSourceBatchResultCb:
+ * @source: a source
+ * @operation_id: operation identifier
+ * @medias: (element-type GrlMedia) (transfer full): a #GPtrArray with the
+ * data transfer objects delivered in this batch; it can be empty
+ * @remaining: the number of remaining #GrlMedia to process after this batch,
+ * or GRL_SOURCE_REMAINING_UNKNOWN if it is unknown
+ * @user_data: user data passed to the used method
+ * @error: (nullable): possible #GError generated at processing
+ *
+ * Prototype for the callback passed to the batched variants of the media
+ * sources' methods. Instead of being invoked once per element, it is invoked
+ * with all the elements that became ready during the same main loop
+ * iteration. Use g_ptr_array_unref() to free @medias once done; the elements
+ * are released with it, so take a reference to those that must be kept.
+ *
+ * Since: 0.3.20
+ */
+typedef void (*GrlSourceBatchResultCb) (GrlSource *source,
+                                        guint operation_id,
+                                        GPtrArray *medias,
+                                        guint remaining,
+                                        gpointer user_data,
+                                        const GError *error);
+
 /**
  * GrlSourceRemoveCb:
  * @source: a source
@@ -196,6 +242,31 @@ typedef void (*GrlSourceRemoveCb) (GrlSource *source,
                                    gpointer user_data,
                                    const GError *error);
 
+/**
+ * GrlSourceRemoveBatchCb:
+ * @source: a source
+ * @medias: (element-type GrlMedia) (transfer none): the #GPtrArray of
+ * #GrlMedia passed to grl_source_remove_batch()
+ * @errors: (element-type GError) (transfer none) (nullable): a #GPtrArray
+ * with the #GError of each element of @medias that could not be removed,
+ * or %NULL for the ones that were removed
+ * @user_data: user data passed to grl_source_remove_batch()
+ * @error: (nullable): possible #GError generated at processing
+ *
+ * Prototype for the callback passed to grl_source_remove_batch(). It is
+ * invoked once, when all the elements in @medias have been processed.
+ *
+ * Sources answering a remove_batch request can pass %NULL @errors, in which
+ * case @error applies to every element.
+ *
+ * Since: 0.3.20
+ */
+typedef void (*GrlSourceRemoveBatchCb) (GrlSource *source,
+                                        GPtrArray *medias,
+                                        GPtrArray *errors,
+                                        gpointer user_data,
+                                        const GError *error);
+
 /**
  * GrlSourceStoreCb:
  * @source: a source
@@ -213,6 +284,27 @@ typedef void (*GrlSourceStoreCb) (GrlSource *source,
                                   gpointer user_data,
                                   const GError *error);
 
+/**
+ * GrlSourceStoreMetadataBatchCb:
+ * @source: a source
+ * @medias: (element-type GrlMedia) (transfer none): the #GPtrArray of
+ * #GrlMedia passed to grl_source_store_metadata_batch()
+ * @failed_keys: (element-type GrlKeyID) (transfer none): #GList of
+ * keys that could not be updated in some of the elements, if any
+ * @user_data: user data passed to grl_source_store_metadata_batch()
+ * @error: (nullable): possible #GError generated
+ *
+ * Prototype for the callback passed to grl_source_store_metadata_batch(). It
+ * is invoked once, when all the elements in @medias have been stored.
+ *
+ * Since: 0.3.20
+ */
+typedef void (*GrlSourceStoreMetadataBatchCb) (GrlSource *source,
+                                               GPtrArray *medias,
+                                               GList *failed_keys,
+                                               gpointer user_data,
+                                               const GError *error);
+
 /**
  * GrlSourceResolveSpec:
  * @source: a source
@@ -239,6 +331,34 @@ typedef struct {
   gpointer _grl_reserved[GRL_PADDING];
 } GrlSourceResolveSpec;
 
+/**
+ * GrlSourceResolveBatchSpec:
+ * @source: a source
+ * @operation_id: operation identifier
+ * @medias: (element-type GrlMedia): the data transfer objects to resolve
+ * @keys: the #GList of #GrlKeyID<!-- -->s to request
+ * @options: options wanted for that operation
+ * @callback: the user defined callback
+ * @user_data: the user data to pass in the callback
+ *
+ * Data transport structure used internally by the plugins which support
+ * resolve_batch vmethod.
+ *
+ * Since: 0.3.20
+ */
+typedef struct {
+  GrlSource *source;
+  guint operation_id;
+  GPtrArray *medias;
+  GList *keys;
+  GrlOperationOptions *options;
+  GrlSourceResolveBatchCb callback;
+  gpointer user_data;
+
+  /*< private >*/
+  gpointer _grl_reserved[GRL_PADDING];
+} GrlSourceResolveBatchSpec;
+
 /**
  * GrlSourceMediaFromUriSpec:
  * @source: a source
@@ -365,6 +485,29 @@ typedef struct {
   gpointer _grl_reserved[GRL_PADDING];
 } GrlSourceRemoveSpec;
 
+/**
+ * GrlSourceRemoveBatchSpec:
+ * @source: a source
+ * @medias: (element-type GrlMedia): the data transfer objects to remove,
+ * all of them with an id
+ * @callback: the callback to call when all the elements have been processed
+ * @user_data: the user data to pass in the callback
+ *
+ * Data transport structure used internally by the plugins which support
+ * remove_batch vmethod.
+ *
+ * Since: 0.3.20
+ */
+typedef struct {
+  GrlSource *source;
+  GPtrArray *medias;
+  GrlSourceRemoveBatchCb callback;
+  gpointer user_data;
+
+  /*< private >*/
+  gpointer _grl_reserved[GRL_PADDING];
+} GrlSourceRemoveBatchSpec;
+
 /**
  * GrlSourceStoreSpec:
  * @source: a media source
@@ -413,6 +556,32 @@ typedef struct {
   gpointer _grl_reserved[GRL_PADDING];
 } GrlSourceStoreMetadataSpec;
 
+/**
+ * GrlSourceStoreMetadataBatchSpec:
+ * @source: a source
+ * @medias: (element-type GrlMedia): the data transfer objects to store
+ * @keys: List of keys to be stored/updated in every element.
+ * @flags: Flags to control specific behaviors of the set metadata operation.
+ * @callback: the callback to call when all the elements have been stored
+ * @user_data: the user data to pass in the callback
+ *
+ * Data transport structure used internally by the plugins which support
+ * store_metadata_batch vmethod.
+ *
+ * Since: 0.3.20
+ */
+typedef struct {
+  GrlSource *source;
+  GPtrArray *medias;
+  GList *keys;
+  GrlWriteFlags flags;
+  GrlSourceStoreMetadataBatchCb callback;
+  gpointer user_data;
+
+  /*< private >*/
+  gpointer _grl_reserved[GRL_PADDING];
+} GrlSourceStoreMetadataBatchSpec;
+
 /* GrlSource class */
 
 typedef struct _GrlSourceClass GrlSourceClass;
@@ -438,9 +607,17 @@ typedef struct _GrlSourceClass GrlSourceClass;
  * @store: store a media in a container
  * @store_metadata: update metadata values for a given object in a
  * permanent fashion
- * @cancel: cancel the current operation
+ * @cancel: cancel the current operation. It is called in the main context,
+ * so for operations in #GrlSource:thread-safe-operations it may run while
+ * the call is still running in its thread
  * @notify_change_start: start emitting signals about changes in content
  * @notify_change_stop: stop emitting signals about changes in content
+ * @resolve_batch: resolve the metadata of several transfer objects at once.
+ * Sources implementing it must also implement @resolve. Since: 0.3.20
+ * @store_metadata_batch: update metadata values for several objects at once.
+ * Sources implementing it must also implement @store_metadata. Since: 0.3.20
+ * @remove_batch: remove several medias at once. Sources implementing it must
+ * also implement @remove. Since: 0.3.20
  *
  * Grilo Source class. Override the vmethods to implement the
  * element functionality.
@@ -490,8 +667,15 @@ struct _GrlSourceClass {
   gboolean (*notify_change_stop) (GrlSource *source,
                                   GError **error);
 
+  void (*resolve_batch) (GrlSource *source, GrlSourceResolveBatchSpec *rbs);
+
+  void (*store_metadata_batch) (GrlSource *source,
+                                GrlSourceStoreMetadataBatchSpec *smbs);
+
+  void (*remove_batch) (GrlSource *source, GrlSourceRemoveBatchSpec *rbs);
+
   /*< private >*/
-  gpointer _grl_reserved[GRL_PADDING];
+  gpointer _grl_reserved[GRL_PADDING - 3];
 };
 
 G_BEGIN_DECLS
@@ -514,6 +698,47 @@ void grl_source_set_auto_split_threshold (GrlSource *source,
 
 guint grl_source_get_auto_split_threshold (GrlSource *source);
 
+void grl_source_set_auto_split_limits (GrlSource *source,
+                                       guint min_threshold,
+                                       guint max_threshold);
+
+void grl_source_get_auto_split_limits (GrlSource *source,
+                                       guint *min_threshold,
+                                       guint *max_threshold);
+
+void grl_source_set_auto_split_prefetch (GrlSource *source,
+                                         guint depth);
+
+guint grl_source_get_auto_split_prefetch (GrlSource *source);
+
+void grl_source_set_resolve_concurrency (GrlSource *source,
+                                         guint concurrency);
+
+guint grl_source_get_resolve_concurrency (GrlSource *source);
+
+void grl_source_set_remove_concurrency (GrlSource *source,
+                                        guint concurrency);
+
+guint grl_source_get_remove_concurrency (GrlSource *source);
+
+void grl_source_set_resolve_cache_ttl (GrlSource *source,
+                                       guint ttl);
+
+guint grl_source_get_resolve_cache_ttl (GrlSource *source);
+
+void grl_source_set_write_behind (GrlSource *source,
+                                  guint max_pending,
+                                  guint delay);
+
+void grl_source_get_write_behind (GrlSource *source,
+                                  guint *max_pending,
+                                  guint *delay);
+
+void grl_source_set_thread_safe_operations (GrlSource *source,
+                                            GrlSupportedOps operations);
+
+GrlSupportedOps grl_source_get_thread_safe_operations (GrlSource *source);
+
 
 guint grl_source_resolve (GrlSource *source,
                           GrlMedia *media,
@@ -528,6 +753,13 @@ GrlMedia *grl_source_resolve_sync (GrlSource *source,
                                    GrlOperationOptions *options,
                                    GError **error);
 
+guint grl_source_resolve_batch (GrlSource *source,
+                                GPtrArray *medias,
+                                const GList *keys,
+                                GrlOperationOptions *options,
+                                GrlSourceResolveBatchCb callback,
+                                gpointer user_data);
+
 gboolean grl_source_may_resolve (GrlSource *source,
                                  GrlMedia *media,
                                  GrlKeyID key_id,
@@ -556,6 +788,13 @@ guint grl_source_browse (GrlSource *source,
                          GrlSourceResultCb callback,
                          gpointer user_data);
 
+guint grl_source_browse_batch (GrlSource *source,
+                               GrlMedia *container,
+                               const GList *keys,
+                               GrlOperationOptions *options,
+                               GrlSourceBatchResultCb callback,
+                               gpointer user_data);
+
 GList *grl_source_browse_sync (GrlSource *source,
                                GrlMedia *container,
                                const GList *keys,
@@ -569,6 +808,13 @@ guint grl_source_search (GrlSource *source,
                          GrlSourceResultCb callback,
                          gpointer user_data);
 
+guint grl_source_search_batch (GrlSource *source,
+                               const gchar *text,
+                               const GList *keys,
+                               GrlOperationOptions *options,
+                               GrlSourceBatchResultCb callback,
+                               gpointer user_data);
+
 GList *grl_source_search_sync (GrlSource *source,
                                const gchar *text,
                                const GList *keys,
@@ -582,6 +828,13 @@ guint grl_source_query (GrlSource *source,
                         GrlSourceResultCb callback,
                         gpointer user_data);
 
+guint grl_source_query_batch (GrlSource *source,
+                              const gchar *query,
+                              const GList *keys,
+                              GrlOperationOptions *options,
+                              GrlSourceBatchResultCb callback,
+                              gpointer user_data);
+
 GList *grl_source_query_sync (GrlSource *source,
                               const gchar *query,
                               const GList *keys,
@@ -597,6 +850,11 @@ void grl_source_remove_sync (GrlSource *source,
                              GrlMedia *media,
                              GError **error);
 
+void grl_source_remove_batch (GrlSource *source,
+                              GPtrArray *medias,
+                              GrlSourceRemoveBatchCb callback,
+                              gpointer user_data);
+
 void grl_source_store (GrlSource *source,
                        GrlMedia *parent,
                        GrlMedia *media,
@@ -623,6 +881,110 @@ GList *grl_source_store_metadata_sync (GrlSource *source,
                                        GrlWriteFlags flags,
                                        GError **error);
 
+void grl_source_store_metadata_batch (GrlSource *source,
+                                      GPtrArray *medias,
+                                      GList *keys,
+                                      GrlWriteFlags flags,
+                                      GrlSourceStoreMetadataBatchCb callback,
+                                      gpointer user_data);
+
+void grl_source_flush_metadata (GrlSource *source);
+
+void grl_source_resolve_async (GrlSource *source,
+                               GrlMedia *media,
+                               const GList *keys,
+                               GrlOperationOptions *options,
+                               GCancellable *cancellable,
+                               GAsyncReadyCallback callback,
+                               gpointer user_data);
+
+GrlMedia *grl_source_resolve_finish (GrlSource *source,
+                                     GAsyncResult *result,
+                                     GError **error);
+
+void grl_source_get_media_from_uri_async (GrlSource *source,
+                                          const gchar *uri,
+                                          const GList *keys,
+                                          GrlOperationOptions *options,
+                                          GCancellable *cancellable,
+                                          GAsyncReadyCallback callback,
+                                          gpointer user_data);
+
+GrlMedia *grl_source_get_media_from_uri_finish (GrlSource *source,
+                                                GAsyncResult *result,
+                                                GError **error);
+
+void grl_source_browse_async (GrlSource *source,
+                              GrlMedia *container,
+                              const GList *keys,
+                              GrlOperationOptions *options,
+                              GCancellable *cancellable,
+                              GAsyncReadyCallback callback,
+                              gpointer user_data);
+
+GList *grl_source_browse_finish (GrlSource *source,
+                                 GAsyncResult *result,
+                                 GError **error);
+
+void grl_source_search_async (GrlSource *source,
+                              const gchar *text,
+                              const GList *keys,
+                              GrlOperationOptions *options,
+                              GCancellable *cancellable,
+                              GAsyncReadyCallback callback,
+                              gpointer user_data);
+
+GList *grl_source_search_finish (GrlSource *source,
+                                 GAsyncResult *result,
+                                 GError **error);
+
+void grl_source_query_async (GrlSource *source,
+                             const gchar *query,
+                             const GList *keys,
+                             GrlOperationOptions *options,
+                             GCancellable *cancellable,
+                             GAsyncReadyCallback callback,
+                             gpointer user_data);
+
+GList *grl_source_query_finish (GrlSource *source,
+                                GAsyncResult *result,
+                                GError **error);
+
+void grl_source_remove_async (GrlSource *source,
+                              GrlMedia *media,
+                              GCancellable *cancellable,
+                              GAsyncReadyCallback callback,
+                              gpointer user_data);
+
+gboolean grl_source_remove_finish (GrlSource *source,
+                                   GAsyncResult *result,
+                                   GError **error);
+
+void grl_source_store_async (GrlSource *source,
+                             GrlMedia *parent,
+                             GrlMedia *media,
+                             GrlWriteFlags flags,
+                             GCancellable *cancellable,
+                             GAsyncReadyCallback callback,
+                             gpointer user_data);
+
+gboolean grl_source_store_finish (GrlSource *source,
+                                  GAsyncResult *result,
+                                  GError **error);
+
+void grl_source_store_metadata_async (GrlSource *source,
+                                      GrlMedia *media,
+                                      GList *keys,
+                                      GrlWriteFlags flags,
+                                      GCancellable *cancellable,
+                                      GAsyncReadyCallback callback,
+                                      gpointer user_data);
+
+gboolean grl_source_store_metadata_finish (GrlSource *source,
+                                          GAsyncResult *result,
+                                          GList **failed_keys,
+                                          GError **error);
+
 gboolean grl_source_notify_change_start (GrlSource *source,
                                          GError **error);
 
@@ -655,6 +1017,8 @@ GrlSupportedMedia grl_source_get_supported_media (GrlSource *source);
 
 const char ** grl_source_get_tags (GrlSource *source);
 
+const gchar ** grl_source_get_uri_prefixes (GrlSource *source);
+
 G_END_DECLS
 
 #endif /* _GRL_SOURCE_H_ */
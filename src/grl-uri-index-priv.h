@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2026 Grilo Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifndef _GRL_URI_INDEX_PRIV_H_
+#define _GRL_URI_INDEX_PRIV_H_
+
+#include <glib.h>
+
+/* Trie of URI prefixes, each one with the values registered for it. The
+   scheme of prefixes and URIs is compared without regard to case */
+typedef struct _GrlUriIndex GrlUriIndex;
+
+GrlUriIndex *grl_uri_index_new (void);
+
+void grl_uri_index_free (GrlUriIndex *index);
+
+void grl_uri_index_add (GrlUriIndex *index,
+                        const gchar *prefix,
+                        gpointer value);
+
+void grl_uri_index_remove (GrlUriIndex *index,
+                           gpointer value);
+
+GList *grl_uri_index_lookup (const GrlUriIndex *index,
+                             const gchar *uri,
+                             GCompareFunc compare);
+
+gboolean grl_uri_index_has_prefix (const gchar *uri,
+                                   const gchar *prefix);
+
+#endif /* _GRL_URI_INDEX_PRIV_H_ */
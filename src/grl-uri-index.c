@@ -0,0 +1,224 @@
+/*
+ * Copyright (C) 2026 Grilo Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+
+/*
+ * Sources can declare the URI prefixes they create medias for. Finding the
+ * sources for a URI walks a trie of those prefixes, one character at a time,
+ * instead of asking every source whether it knows the URI.
+ */
+
+#include "grl-uri-index-priv.h"
+
+typedef struct _UriIndexNode UriIndexNode;
+
+struct _UriIndexNode {
+  gchar c;
+  UriIndexNode *children;
+  UriIndexNode *next;
+  GPtrArray *values;
+};
+
+struct _GrlUriIndex {
+  UriIndexNode root;
+};
+
+/* Characters before the first ':' belong to the scheme */
+static gchar
+uri_index_char (gchar c,
+                gboolean *in_scheme)
+{
+  if (*in_scheme) {
+    if (c == ':') {
+      *in_scheme = FALSE;
+    }
+    return g_ascii_tolower (c);
+  }
+
+  return c;
+}
+
+static UriIndexNode *
+uri_index_node_child (UriIndexNode *node,
+                      gchar c)
+{
+  UriIndexNode *child;
+
+  for (child = node->children; child; child = child->next) {
+    if (child->c == c) {
+      return child;
+    }
+  }
+
+  return NULL;
+}
+
+static void
+uri_index_node_free (UriIndexNode *node)
+{
+  UriIndexNode *child, *next;
+
+  for (child = node->children; child; child = next) {
+    next = child->next;
+    uri_index_node_free (child);
+  }
+  g_clear_pointer (&node->values, g_ptr_array_unref);
+  g_slice_free (UriIndexNode, node);
+}
+
+GrlUriIndex *
+grl_uri_index_new (void)
+{
+  return g_slice_new0 (GrlUriIndex);
+}
+
+void
+grl_uri_index_free (GrlUriIndex *index)
+{
+  UriIndexNode *child, *next;
+
+  for (child = index->root.children; child; child = next) {
+    next = child->next;
+    uri_index_node_free (child);
+  }
+  g_clear_pointer (&index->root.values, g_ptr_array_unref);
+  g_slice_free (GrlUriIndex, index);
+}
+
+void
+grl_uri_index_add (GrlUriIndex *index,
+                   const gchar *prefix,
+                   gpointer value)
+{
+  UriIndexNode *node = &index->root;
+  UriIndexNode *child;
+  gboolean in_scheme = TRUE;
+  gchar c;
+
+  for (; *prefix; prefix++) {
+    c = uri_index_char (*prefix, &in_scheme);
+    child = uri_index_node_child (node, c);
+    if (!child) {
+      child = g_slice_new0 (UriIndexNode);
+      child->c = c;
+      child->next = node->children;
+      node->children = child;
+    }
+    node = child;
+  }
+
+  if (!node->values) {
+    node->values = g_ptr_array_new ();
+  }
+  if (!g_ptr_array_find (node->values, value, NULL)) {
+    g_ptr_array_add (node->values, value);
+  }
+}
+
+/* Returns TRUE if @node is left without values nor children */
+static gboolean
+uri_index_node_remove (UriIndexNode *node,
+                       gpointer value)
+{
+  UriIndexNode **link = &node->children;
+  UriIndexNode *child;
+
+  while ((child = *link)) {
+    if (uri_index_node_remove (child, value)) {
+      *link = child->next;
+      child->next = NULL;
+      uri_index_node_free (child);
+    } else {
+      link = &child->next;
+    }
+  }
+
+  if (node->values) {
+    g_ptr_array_remove (node->values, value);
+    if (node->values->len == 0) {
+      g_clear_pointer (&node->values, g_ptr_array_unref);
+    }
+  }
+
+  return !node->values && !node->children;
+}
+
+void
+grl_uri_index_remove (GrlUriIndex *index,
+                      gpointer value)
+{
+  uri_index_node_remove (&index->root, value);
+}
+
+/* Values of all the prefixes of @uri, the ones for the longest prefix first.
+   Values of the same prefix are sorted with @compare, if given */
+GList *
+grl_uri_index_lookup (const GrlUriIndex *index,
+                      const gchar *uri,
+                      GCompareFunc compare)
+{
+  const UriIndexNode *node = &index->root;
+  GList *result = NULL;
+  GList *group;
+  gboolean in_scheme = TRUE;
+  guint i;
+
+  for (; node && *uri; uri++) {
+    node = uri_index_node_child ((UriIndexNode *) node,
+                                 uri_index_char (*uri, &in_scheme));
+    if (!node || !node->values) {
+      continue;
+    }
+
+    group = NULL;
+    for (i = 0; i < node->values->len; i++) {
+      gpointer value = g_ptr_array_index (node->values, i);
+
+      /* Keep only the longest prefix of each value */
+      result = g_list_remove (result, value);
+      group = g_list_prepend (group, value);
+    }
+    group = g_list_reverse (group);
+    if (compare) {
+      group = g_list_sort (group, compare);
+    }
+    result = g_list_concat (group, result);
+  }
+
+  return result;
+}
+
+gboolean
+grl_uri_index_has_prefix (const gchar *uri,
+                          const gchar *prefix)
+{
+  gboolean in_scheme_uri = TRUE;
+  gboolean in_scheme_prefix = TRUE;
+
+  for (; *prefix; prefix++, uri++) {
+    if (!*uri ||
+        uri_index_char (*uri, &in_scheme_uri) !=
+        uri_index_char (*prefix, &in_scheme_prefix)) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
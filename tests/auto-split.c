@@ -0,0 +1,322 @@
+/*
+ * Copyright (C) 2026 Grilo Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#undef G_DISABLE_ASSERT
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+#include <glib.h>
+#include <glib-object.h>
+
+#include <grilo.h>
+
+/* ================ Timed source ================ */
+
+/* Sends "count" audio items with id and title, starting at "skip". The
+   first item is sent after "latency" milliseconds, and the following ones
+   one each "interval" milliseconds, or all at once if it is not set. Browses
+   are counted */
+
+typedef struct {
+  GrlSourceBrowseSpec *bs;
+  guint next;
+  guint end;
+  guint interval;
+} TestTimedPending;
+
+typedef struct {
+  GrlSource parent;
+  guint latency;
+  guint interval;
+  guint browses;
+} TestTimedSource;
+
+typedef struct {
+  GrlSourceClass parent_class;
+} TestTimedSourceClass;
+
+GType test_timed_source_get_type (void);
+
+G_DEFINE_TYPE (TestTimedSource, test_timed_source, GRL_TYPE_SOURCE)
+
+static const GList *
+test_timed_source_supported_keys (GrlSource *source)
+{
+  static GList *keys = NULL;
+
+  if (!keys) {
+    keys = grl_metadata_key_list_new (GRL_METADATA_KEY_ID,
+                                      GRL_METADATA_KEY_TITLE,
+                                      NULL);
+  }
+
+  return keys;
+}
+
+static gboolean
+test_timed_source_send (gpointer user_data)
+{
+  TestTimedPending *pending = user_data;
+  GrlSourceBrowseSpec *bs = pending->bs;
+  guint last;
+
+  last = pending->interval > 0? pending->next + 1: pending->end;
+
+  for (; pending->next < last; pending->next++) {
+    GrlMedia *media = grl_media_audio_new ();
+    gchar *id = g_strdup_printf ("media-%u", pending->next);
+
+    grl_media_set_id (media, id);
+    grl_media_set_title (media, id);
+    g_free (id);
+
+    bs->callback (bs->source, bs->operation_id, media,
+                  pending->end - pending->next - 1, bs->user_data, NULL);
+  }
+
+  if (pending->next < pending->end) {
+    g_timeout_add (pending->interval, test_timed_source_send, pending);
+  } else {
+    g_slice_free (TestTimedPending, pending);
+  }
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+test_timed_source_browse (GrlSource *source,
+                          GrlSourceBrowseSpec *bs)
+{
+  TestTimedSource *timed_source = (TestTimedSource *) source;
+  gint count = grl_operation_options_get_count (bs->options);
+  guint skip = grl_operation_options_get_skip (bs->options);
+  TestTimedPending *pending;
+
+  timed_source->browses++;
+
+  if (count <= 0) {
+    bs->callback (source, bs->operation_id, NULL, 0, bs->user_data, NULL);
+    return;
+  }
+
+  pending = g_slice_new (TestTimedPending);
+  pending->bs = bs;
+  pending->next = skip;
+  pending->end = skip + count;
+  pending->interval = timed_source->interval;
+
+  g_timeout_add (timed_source->latency, test_timed_source_send, pending);
+}
+
+static void
+test_timed_source_class_init (TestTimedSourceClass *klass)
+{
+  GrlSourceClass *source_class = GRL_SOURCE_CLASS (klass);
+
+  source_class->supported_keys = test_timed_source_supported_keys;
+  source_class->browse = test_timed_source_browse;
+}
+
+static void
+test_timed_source_init (TestTimedSource *source)
+{
+}
+
+/* ================ Tests ================ */
+
+typedef struct {
+  GMainLoop *loop;
+  GrlSource *source;
+} AutoSplitFixture;
+
+static void
+auto_split_fixture_setup (AutoSplitFixture *fixture, gconstpointer data)
+{
+  fixture->loop = g_main_loop_new (NULL, TRUE);
+  fixture->source = g_object_new (test_timed_source_get_type (),
+                                  "source-id", "test-timed",
+                                  NULL);
+}
+
+static void
+auto_split_fixture_teardown (AutoSplitFixture *fixture, gconstpointer data)
+{
+  g_object_unref (fixture->source);
+  g_main_loop_unref (fixture->loop);
+}
+
+typedef struct {
+  GMainLoop *loop;
+  guint received;
+  gboolean in_order;
+  guint threshold;
+} AdaptiveResult;
+
+static void
+adaptive_cb (GrlSource *source,
+             guint operation_id,
+             GrlMedia *media,
+             guint remaining,
+             gpointer user_data,
+             const GError *error)
+{
+  AdaptiveResult *result = user_data;
+  gchar *id;
+
+  g_assert_no_error (error);
+
+  if (media) {
+    id = g_strdup_printf ("media-%u", result->received);
+    if (g_strcmp0 (grl_media_get_id (media), id) != 0) {
+      result->in_order = FALSE;
+    }
+    result->received++;
+    g_free (id);
+    g_object_unref (media);
+  }
+
+  /* The threshold was just adapted to the first chunk */
+  if (result->received == 10 && result->threshold == 0) {
+    result->threshold = grl_source_get_auto_split_threshold (source);
+  }
+
+  if (remaining == 0) {
+    g_main_loop_quit (result->loop);
+  }
+}
+
+/* Browses 30 items in chunks starting at 10, returning the threshold after
+   the first chunk */
+static guint
+adaptive_browse (AutoSplitFixture *fixture)
+{
+  AdaptiveResult result = { fixture->loop, 0, TRUE, 0 };
+  GrlOperationOptions *options;
+  guint threshold;
+  GList *keys;
+
+  grl_source_set_auto_split_threshold (fixture->source, 10);
+  grl_source_set_auto_split_limits (fixture->source, 5, 40);
+
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE, NULL);
+  options = grl_operation_options_new (NULL);
+  grl_operation_options_set_count (options, 30);
+
+  grl_source_browse (fixture->source, NULL, keys, options,
+                     adaptive_cb, &result);
+  g_main_loop_run (fixture->loop);
+
+  /* Chunk size changes, but results are the same */
+  g_assert_cmpuint (result.received, ==, 30);
+  g_assert_true (result.in_order);
+
+  threshold = grl_source_get_auto_split_threshold (fixture->source);
+  g_assert_cmpuint (threshold, >=, 5);
+  g_assert_cmpuint (threshold, <=, 40);
+
+  g_object_unref (options);
+  g_list_free (keys);
+
+  return result.threshold;
+}
+
+static void
+auto_split_adaptive_latency (AutoSplitFixture *fixture, gconstpointer data)
+{
+  TestTimedSource *timed_source = (TestTimedSource *) fixture->source;
+
+  /* Waiting for the first item dominates, so bigger chunks pay off */
+  timed_source->latency = 50;
+  timed_source->interval = 0;
+  g_assert_cmpuint (adaptive_browse (fixture), >, 10);
+}
+
+static void
+auto_split_adaptive_transfer (AutoSplitFixture *fixture, gconstpointer data)
+{
+  TestTimedSource *timed_source = (TestTimedSource *) fixture->source;
+
+  /* Transferring the items dominates, so smaller chunks start sooner */
+  timed_source->latency = 0;
+  timed_source->interval = 5;
+  g_assert_cmpuint (adaptive_browse (fixture), <, 10);
+}
+
+static void
+auto_split_prefetch (AutoSplitFixture *fixture, gconstpointer data)
+{
+  AdaptiveResult result = { fixture->loop, 0, TRUE, 0 };
+  TestTimedSource *timed_source = (TestTimedSource *) fixture->source;
+  GrlOperationOptions *options;
+  GList *keys;
+
+  grl_source_set_auto_split_threshold (fixture->source, 10);
+  grl_source_set_auto_split_prefetch (fixture->source, 2);
+
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE, NULL);
+  options = grl_operation_options_new (NULL);
+  grl_operation_options_set_count (options, 95);
+
+  grl_source_browse (fixture->source, NULL, keys, options,
+                     adaptive_cb, &result);
+  g_main_loop_run (fixture->loop);
+
+  /* Chunks are received in advance, but sent in order */
+  g_assert_cmpuint (timed_source->browses, ==, 10);
+  g_assert_cmpuint (result.received, ==, 95);
+  g_assert_true (result.in_order);
+
+  g_object_unref (options);
+  g_list_free (keys);
+}
+
+int
+main (int argc, char **argv)
+{
+  setlocale (LC_ALL, "");
+
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_bug_base ("http://gitlab.gnome.org/GNOME/grilo/issues/%s");
+
+  grl_init (&argc, &argv);
+
+  g_test_add ("/auto-split/adaptive/latency",
+              AutoSplitFixture, NULL,
+              auto_split_fixture_setup,
+              auto_split_adaptive_latency,
+              auto_split_fixture_teardown);
+
+  g_test_add ("/auto-split/adaptive/transfer",
+              AutoSplitFixture, NULL,
+              auto_split_fixture_setup,
+              auto_split_adaptive_transfer,
+              auto_split_fixture_teardown);
+
+  g_test_add ("/auto-split/prefetch",
+              AutoSplitFixture, NULL,
+              auto_split_fixture_setup,
+              auto_split_prefetch,
+              auto_split_fixture_teardown);
+
+  return g_test_run ();
+}
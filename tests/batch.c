@@ -0,0 +1,517 @@
+/*
+ * Copyright (C) 2026 Grilo Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#undef G_DISABLE_ASSERT
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+#include <glib.h>
+#include <glib-object.h>
+
+#include <grilo.h>
+
+/* ================ Paged source ================ */
+
+/* Sends "count" audio items with id and title, starting at "skip", to
+   browses, searches and queries alike. If "limit" is set, there are no more
+   items than that. If "page" is set, only that many items are sent at once,
+   and test_paged_source_resume() sends the next ones */
+
+typedef struct {
+  GrlSource *source;
+  guint operation_id;
+  guint next;
+  guint end;
+  GrlSourceResultCb callback;
+  gpointer user_data;
+} TestPagedPending;
+
+typedef struct {
+  GrlSource parent;
+  guint limit;
+  guint page;
+  TestPagedPending *pending;
+} TestPagedSource;
+
+typedef struct {
+  GrlSourceClass parent_class;
+} TestPagedSourceClass;
+
+GType test_paged_source_get_type (void);
+
+G_DEFINE_TYPE (TestPagedSource, test_paged_source, GRL_TYPE_SOURCE)
+
+static const GList *
+test_paged_source_supported_keys (GrlSource *source)
+{
+  static GList *keys = NULL;
+
+  if (!keys) {
+    keys = grl_metadata_key_list_new (GRL_METADATA_KEY_ID,
+                                      GRL_METADATA_KEY_TITLE,
+                                      NULL);
+  }
+
+  return keys;
+}
+
+/* Sends the items of @pending up to the end of the page, returning TRUE if
+   there are more left */
+static gboolean
+test_paged_source_send (TestPagedSource *paged_source,
+                        TestPagedPending *pending)
+{
+  guint page_end = pending->end;
+
+  if (paged_source->page > 0) {
+    page_end = MIN (page_end, pending->next + paged_source->page);
+  }
+
+  for (; pending->next < page_end; pending->next++) {
+    GrlMedia *media = grl_media_audio_new ();
+    gchar *id = g_strdup_printf ("media-%u", pending->next);
+
+    grl_media_set_id (media, id);
+    grl_media_set_title (media, id);
+    g_free (id);
+
+    pending->callback (pending->source, pending->operation_id, media,
+                       pending->end - pending->next - 1,
+                       pending->user_data, NULL);
+  }
+
+  return pending->next < pending->end;
+}
+
+static void
+test_paged_source_run (GrlSource *source,
+                       guint operation_id,
+                       GrlOperationOptions *options,
+                       GrlSourceResultCb callback,
+                       gpointer user_data)
+{
+  TestPagedSource *paged_source = (TestPagedSource *) source;
+  gint count = grl_operation_options_get_count (options);
+  guint skip = grl_operation_options_get_skip (options);
+  TestPagedPending *pending;
+
+  if (paged_source->limit > 0) {
+    count = MIN (count, (gint) paged_source->limit - (gint) skip);
+  }
+
+  if (count <= 0) {
+    callback (source, operation_id, NULL, 0, user_data, NULL);
+    return;
+  }
+
+  pending = g_slice_new (TestPagedPending);
+  pending->source = source;
+  pending->operation_id = operation_id;
+  pending->next = skip;
+  pending->end = skip + count;
+  pending->callback = callback;
+  pending->user_data = user_data;
+
+  if (test_paged_source_send (paged_source, pending)) {
+    g_assert_null (paged_source->pending);
+    paged_source->pending = pending;
+  } else {
+    g_slice_free (TestPagedPending, pending);
+  }
+}
+
+/* Sends the next page of the operation in progress */
+static void
+test_paged_source_resume (TestPagedSource *paged_source)
+{
+  TestPagedPending *pending = paged_source->pending;
+
+  g_assert_nonnull (pending);
+  paged_source->pending = NULL;
+
+  if (test_paged_source_send (paged_source, pending)) {
+    paged_source->pending = pending;
+  } else {
+    g_slice_free (TestPagedPending, pending);
+  }
+}
+
+static void
+test_paged_source_browse (GrlSource *source,
+                          GrlSourceBrowseSpec *bs)
+{
+  test_paged_source_run (source, bs->operation_id, bs->options,
+                         bs->callback, bs->user_data);
+}
+
+static void
+test_paged_source_search (GrlSource *source,
+                          GrlSourceSearchSpec *ss)
+{
+  test_paged_source_run (source, ss->operation_id, ss->options,
+                         ss->callback, ss->user_data);
+}
+
+static void
+test_paged_source_query (GrlSource *source,
+                         GrlSourceQuerySpec *qs)
+{
+  test_paged_source_run (source, qs->operation_id, qs->options,
+                         qs->callback, qs->user_data);
+}
+
+static void
+test_paged_source_class_init (TestPagedSourceClass *klass)
+{
+  GrlSourceClass *source_class = GRL_SOURCE_CLASS (klass);
+
+  source_class->supported_keys = test_paged_source_supported_keys;
+  source_class->browse = test_paged_source_browse;
+  source_class->search = test_paged_source_search;
+  source_class->query = test_paged_source_query;
+}
+
+static void
+test_paged_source_init (TestPagedSource *source)
+{
+}
+
+/* ================ Tests ================ */
+
+typedef struct {
+  GMainLoop *loop;
+  GrlSource *source;
+} BatchFixture;
+
+static void
+batch_fixture_setup (BatchFixture *fixture, gconstpointer data)
+{
+  fixture->loop = g_main_loop_new (NULL, TRUE);
+  fixture->source = g_object_new (test_paged_source_get_type (),
+                                  "source-id", "test-paged",
+                                  NULL);
+}
+
+static void
+batch_fixture_teardown (BatchFixture *fixture, gconstpointer data)
+{
+  g_object_unref (fixture->source);
+  g_main_loop_unref (fixture->loop);
+}
+
+typedef struct {
+  GMainLoop *loop;
+  TestPagedSource *source;
+  GArray *sizes;
+  GArray *remaining;
+  guint received;
+  gboolean in_order;
+  gboolean done;
+} BatchResult;
+
+static void
+batch_cb (GrlSource *source,
+          guint operation_id,
+          GPtrArray *medias,
+          guint remaining,
+          gpointer user_data,
+          const GError *error)
+{
+  BatchResult *result = user_data;
+  guint i;
+
+  g_assert_no_error (error);
+  /* Nothing is sent after the last batch */
+  g_assert_false (result->done);
+
+  for (i = 0; i < medias->len; i++) {
+    gchar *id = g_strdup_printf ("media-%u", result->received);
+
+    if (g_strcmp0 (grl_media_get_id (g_ptr_array_index (medias, i)), id) != 0) {
+      result->in_order = FALSE;
+    }
+    result->received++;
+    g_free (id);
+  }
+  g_array_append_val (result->sizes, medias->len);
+  g_array_append_val (result->remaining, remaining);
+  g_ptr_array_unref (medias);
+
+  if (remaining == 0) {
+    result->done = TRUE;
+    g_main_loop_quit (result->loop);
+  } else if (result->source->pending) {
+    /* The next page is ready only after this batch was sent */
+    test_paged_source_resume (result->source);
+  }
+}
+
+/* Runs a batched @operation on the paged source, checking the size and
+   remaining count of each batch received */
+static void
+batch_run (BatchFixture *fixture,
+           GrlSupportedOps operation,
+           guint skip,
+           guint count,
+           const guint *sizes,
+           const guint *remaining,
+           guint n_batches)
+{
+  BatchResult result = { fixture->loop,
+                         (TestPagedSource *) fixture->source,
+                         NULL, NULL, skip, TRUE, FALSE };
+  GrlOperationOptions *options;
+  GList *keys;
+  guint i;
+
+  result.sizes = g_array_new (FALSE, FALSE, sizeof (guint));
+  result.remaining = g_array_new (FALSE, FALSE, sizeof (guint));
+
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE, NULL);
+  options = grl_operation_options_new (NULL);
+  grl_operation_options_set_skip (options, skip);
+  grl_operation_options_set_count (options, count);
+
+  switch (operation) {
+  case GRL_OP_BROWSE:
+    grl_source_browse_batch (fixture->source, NULL, keys, options,
+                             batch_cb, &result);
+    break;
+  case GRL_OP_SEARCH:
+    grl_source_search_batch (fixture->source, "text", keys, options,
+                             batch_cb, &result);
+    break;
+  case GRL_OP_QUERY:
+    grl_source_query_batch (fixture->source, "query", keys, options,
+                            batch_cb, &result);
+    break;
+  default:
+    g_assert_not_reached ();
+  }
+  g_main_loop_run (fixture->loop);
+
+  /* Let anything sent late show up */
+  while (g_main_context_pending (NULL)) {
+    g_main_context_iteration (NULL, FALSE);
+  }
+
+  g_assert_true (result.in_order);
+  g_assert_cmpuint (result.sizes->len, ==, n_batches);
+  for (i = 0; i < n_batches; i++) {
+    g_assert_cmpuint (g_array_index (result.sizes, guint, i), ==, sizes[i]);
+    g_assert_cmpuint (g_array_index (result.remaining, guint, i), ==,
+                      remaining[i]);
+  }
+  g_assert_null (result.source->pending);
+
+  g_array_unref (result.sizes);
+  g_array_unref (result.remaining);
+  g_object_unref (options);
+  g_list_free (keys);
+}
+
+static const GrlSupportedOps batch_operations[] = {
+  GRL_OP_BROWSE, GRL_OP_SEARCH, GRL_OP_QUERY
+};
+
+static void
+batch_whole (BatchFixture *fixture, gconstpointer data)
+{
+  static const guint sizes[] = { 10 };
+  static const guint remaining[] = { 0 };
+  guint i;
+
+  ((TestPagedSource *) fixture->source)->limit = 10;
+
+  /* Elements ready at once are sent together */
+  for (i = 0; i < G_N_ELEMENTS (batch_operations); i++) {
+    batch_run (fixture, batch_operations[i], 0, 10,
+               sizes, remaining, G_N_ELEMENTS (sizes));
+  }
+}
+
+static void
+batch_empty (BatchFixture *fixture, gconstpointer data)
+{
+  static const guint sizes[] = { 0 };
+  static const guint remaining[] = { 0 };
+  guint i;
+
+  ((TestPagedSource *) fixture->source)->limit = 10;
+
+  /* Operations without results still get a last, empty, batch */
+  for (i = 0; i < G_N_ELEMENTS (batch_operations); i++) {
+    batch_run (fixture, batch_operations[i], 10, 10,
+               sizes, remaining, G_N_ELEMENTS (sizes));
+  }
+}
+
+static void
+batch_paged (BatchFixture *fixture, gconstpointer data)
+{
+  static const guint sizes[] = { 4, 4, 2 };
+  static const guint remaining[] = { 6, 2, 0 };
+  guint i;
+
+  ((TestPagedSource *) fixture->source)->limit = 10;
+  ((TestPagedSource *) fixture->source)->page = 4;
+
+  /* Elements that become ready later are sent in the following batches */
+  for (i = 0; i < G_N_ELEMENTS (batch_operations); i++) {
+    batch_run (fixture, batch_operations[i], 0, 10,
+               sizes, remaining, G_N_ELEMENTS (sizes));
+  }
+}
+
+typedef struct {
+  GMainLoop *loop;
+  GrlSource *sources[2];
+  guint received[2];
+  guint total;
+  guint batches;
+  guint last_size;
+  gboolean in_order;
+  gboolean done;
+} MultipleBatchResult;
+
+static void
+multiple_batch_cb (GrlSource *source,
+                   guint operation_id,
+                   GPtrArray *medias,
+                   guint remaining,
+                   gpointer user_data,
+                   const GError *error)
+{
+  MultipleBatchResult *result = user_data;
+  GrlMedia *media;
+  gchar *id;
+  guint i, s;
+
+  g_assert_no_error (error);
+  g_assert_false (result->done);
+
+  for (i = 0; i < medias->len; i++) {
+    media = g_ptr_array_index (medias, i);
+    s = g_strcmp0 (grl_media_get_source (media),
+                   grl_source_get_id (result->sources[0])) == 0? 0: 1;
+    id = g_strdup_printf ("media-%u", result->received[s]);
+    if (g_strcmp0 (grl_media_get_id (media), id) != 0) {
+      result->in_order = FALSE;
+    }
+    result->received[s]++;
+    result->total++;
+    g_free (id);
+  }
+  result->batches++;
+  result->last_size = medias->len;
+  g_ptr_array_unref (medias);
+
+  if (remaining == 0) {
+    result->done = TRUE;
+    g_main_loop_quit (result->loop);
+  } else {
+    g_assert_cmpuint (remaining, ==, 10 - result->total);
+  }
+}
+
+static void
+batch_multiple_search (BatchFixture *fixture, gconstpointer data)
+{
+  MultipleBatchResult result = { fixture->loop, { NULL, NULL }, { 0, 0 },
+                                 0, 0, 0, TRUE, FALSE };
+  GrlSource *more_source;
+  GrlOperationOptions *options;
+  GList *sources, *keys;
+
+  /* The first source has fewer results than asked for, so the second one is
+     asked for the missing ones in a chained search */
+  ((TestPagedSource *) fixture->source)->limit = 3;
+  more_source = g_object_new (test_paged_source_get_type (),
+                              "source-id", "test-paged-more",
+                              NULL);
+  result.sources[0] = fixture->source;
+  result.sources[1] = more_source;
+
+  sources = g_list_append (NULL, fixture->source);
+  sources = g_list_append (sources, more_source);
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE, NULL);
+  options = grl_operation_options_new (NULL);
+  grl_operation_options_set_count (options, 10);
+
+  grl_multiple_search_batch (sources, "text", keys, options,
+                             multiple_batch_cb, &result);
+  g_main_loop_run (fixture->loop);
+
+  while (g_main_context_pending (NULL)) {
+    g_main_context_iteration (NULL, FALSE);
+  }
+
+  /* One batch per source, and the last one with the chained results */
+  g_assert_true (result.in_order);
+  g_assert_cmpuint (result.received[0], ==, 3);
+  g_assert_cmpuint (result.received[1], ==, 7);
+  g_assert_cmpuint (result.batches, ==, 3);
+  g_assert_cmpuint (result.last_size, ==, 2);
+
+  g_object_unref (options);
+  g_list_free (keys);
+  g_list_free (sources);
+  g_object_unref (more_source);
+}
+
+int
+main (int argc, char **argv)
+{
+  setlocale (LC_ALL, "");
+
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_bug_base ("http://gitlab.gnome.org/GNOME/grilo/issues/%s");
+
+  grl_init (&argc, &argv);
+
+  g_test_add ("/batch/whole",
+              BatchFixture, NULL,
+              batch_fixture_setup,
+              batch_whole,
+              batch_fixture_teardown);
+
+  g_test_add ("/batch/empty",
+              BatchFixture, NULL,
+              batch_fixture_setup,
+              batch_empty,
+              batch_fixture_teardown);
+
+  g_test_add ("/batch/paged",
+              BatchFixture, NULL,
+              batch_fixture_setup,
+              batch_paged,
+              batch_fixture_teardown);
+
+  g_test_add ("/batch/multiple-search",
+              BatchFixture, NULL,
+              batch_fixture_setup,
+              batch_multiple_search,
+              batch_fixture_teardown);
+
+  return g_test_run ();
+}
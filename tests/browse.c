@@ -0,0 +1,430 @@
+/*
+ * Copyright (C) 2026 Grilo Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#undef G_DISABLE_ASSERT
+
+#undef G_DISABLE_ASSERT
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+#include <glib.h>
+#include <glib-object.h>
+
+#include <grilo.h>
+
+/* ================ Browse source ================ */
+
+/* Sends "count" audio items with id and title, starting at "skip", counting
+   the browses. If "continuation" is set, the last item of each page carries
+   a token to get the following ones, and the caps declare them unless
+   "hide_continuation" is set */
+
+typedef struct {
+  GrlSource parent;
+  guint browses;
+  gboolean continuation;
+  gboolean hide_continuation;
+  guint continued;
+} TestBrowseSource;
+
+typedef struct {
+  GrlSourceClass parent_class;
+} TestBrowseSourceClass;
+
+GType test_browse_source_get_type (void);
+
+G_DEFINE_TYPE (TestBrowseSource, test_browse_source, GRL_TYPE_SOURCE)
+
+static const GList *
+test_browse_source_supported_keys (GrlSource *source)
+{
+  static GList *keys = NULL;
+
+  if (!keys) {
+    keys = grl_metadata_key_list_new (GRL_METADATA_KEY_ID,
+                                      GRL_METADATA_KEY_TITLE,
+                                      NULL);
+  }
+
+  return keys;
+}
+
+static void
+test_browse_source_browse (GrlSource *source,
+                           GrlSourceBrowseSpec *bs)
+{
+  TestBrowseSource *browse_source = (TestBrowseSource *) source;
+  gint count = grl_operation_options_get_count (bs->options);
+  guint skip = grl_operation_options_get_skip (bs->options);
+  const gchar *continuation;
+  gint i;
+
+  browse_source->browses++;
+
+  continuation = grl_operation_options_get_continuation (bs->options);
+  if (continuation) {
+    g_assert_true (g_str_has_prefix (continuation, "after-"));
+    skip += atoi (continuation + strlen ("after-")) + 1;
+    browse_source->continued++;
+  }
+
+  if (count <= 0) {
+    bs->callback (source, bs->operation_id, NULL, 0, bs->user_data, NULL);
+    return;
+  }
+
+  for (i = 0; i < count; i++) {
+    GrlMedia *media = grl_media_audio_new ();
+    gchar *id = g_strdup_printf ("media-%u", skip + i);
+
+    grl_media_set_id (media, id);
+    grl_media_set_title (media, id);
+    g_free (id);
+
+    if (browse_source->continuation && i == count - 1) {
+      gchar *token = g_strdup_printf ("after-%u", skip + i);
+
+      grl_media_set_continuation (media, token);
+      g_free (token);
+    }
+
+    bs->callback (source, bs->operation_id, media, count - i - 1,
+                  bs->user_data, NULL);
+  }
+}
+
+static GrlCaps *
+test_browse_source_get_caps (GrlSource *source,
+                             GrlSupportedOps operation)
+{
+  TestBrowseSource *browse_source = (TestBrowseSource *) source;
+  static GrlCaps *caps = NULL;
+  static GrlCaps *continuation_caps = NULL;
+
+  if (!caps) {
+    caps = grl_caps_new ();
+    continuation_caps = grl_caps_new ();
+    grl_caps_set_continuation_supported (continuation_caps, TRUE);
+  }
+
+  if (browse_source->continuation && !browse_source->hide_continuation) {
+    return continuation_caps;
+  }
+
+  return caps;
+}
+
+static void
+test_browse_source_class_init (TestBrowseSourceClass *klass)
+{
+  GrlSourceClass *source_class = GRL_SOURCE_CLASS (klass);
+
+  source_class->supported_keys = test_browse_source_supported_keys;
+  source_class->get_caps = test_browse_source_get_caps;
+  source_class->browse = test_browse_source_browse;
+}
+
+static void
+test_browse_source_init (TestBrowseSource *source)
+{
+}
+
+/* ================ Tests ================ */
+
+typedef struct {
+  GrlSource *browse_source;
+  GMainLoop *loop;
+} BrowseFixture;
+
+static void
+browse_fixture_setup (BrowseFixture *fixture, gconstpointer data)
+{
+  fixture->loop = g_main_loop_new (NULL, TRUE);
+  fixture->browse_source = g_object_new (test_browse_source_get_type (),
+                                         "source-id", "test-browse",
+                                         "source-name", "Test browse",
+                                         NULL);
+}
+
+static void
+browse_fixture_teardown (BrowseFixture *fixture, gconstpointer data)
+{
+  g_object_unref (fixture->browse_source);
+  g_main_loop_unref (fixture->loop);
+}
+
+typedef struct {
+  GMainLoop *loop;
+  guint received;
+  gboolean in_order;
+} BrowseResult;
+
+static void
+browse_cb (GrlSource *source,
+                guint operation_id,
+                GrlMedia *media,
+                guint remaining,
+                gpointer user_data,
+                const GError *error)
+{
+  BrowseResult *result = user_data;
+
+  g_assert_no_error (error);
+  /* Results are always received in the thread that requested them */
+  g_assert_true (g_main_context_is_owner (g_main_context_default ()));
+
+  if (media) {
+    gchar *id = g_strdup_printf ("media-%u", result->received);
+
+    if (g_strcmp0 (grl_media_get_id (media), id) != 0) {
+      result->in_order = FALSE;
+    }
+    result->received++;
+    g_free (id);
+    g_object_unref (media);
+  }
+
+  if (remaining == 0) {
+    g_main_loop_quit (result->loop);
+  }
+}
+
+static void
+browse_continuation (BrowseFixture *fixture, gconstpointer data)
+{
+  BrowseResult result = { fixture->loop, 0, TRUE };
+  TestBrowseSource *browse_source;
+  GrlOperationOptions *options;
+  GList *keys;
+
+  browse_source = (TestBrowseSource *) fixture->browse_source;
+  browse_source->continuation = TRUE;
+  grl_source_set_auto_split_threshold (fixture->browse_source, 10);
+
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE, NULL);
+  options = grl_operation_options_new (NULL);
+  grl_operation_options_set_skip (options, 5);
+  grl_operation_options_set_count (options, 30);
+  grl_operation_options_set_continuation (options, "after-9");
+
+  /* The first chunk starts after the given token, and the following ones
+     after the token of the previous chunk */
+  result.received = 15;
+  grl_source_browse (fixture->browse_source, NULL, keys, options,
+                     browse_cb, &result);
+  g_main_loop_run (fixture->loop);
+
+  g_assert_cmpuint (browse_source->browses, ==, 3);
+  g_assert_cmpuint (browse_source->continued, ==, 3);
+  g_assert_cmpuint (result.received, ==, 45);
+  g_assert_true (result.in_order);
+
+  /* Tokens are not used with sources not declaring them in their caps */
+  browse_source->hide_continuation = TRUE;
+  browse_source->browses = 0;
+  browse_source->continued = 0;
+  g_assert_false (grl_operation_options_obey_caps (options,
+                                                   grl_source_get_caps (fixture->browse_source,
+                                                                        GRL_OP_BROWSE),
+                                                   NULL, NULL));
+  grl_operation_options_set_continuation (options, NULL);
+
+  result.received = 5;
+  grl_source_browse (fixture->browse_source, NULL, keys, options,
+                     browse_cb, &result);
+  g_main_loop_run (fixture->loop);
+
+  g_assert_cmpuint (browse_source->browses, ==, 3);
+  g_assert_cmpuint (browse_source->continued, ==, 0);
+  g_assert_cmpuint (result.received, ==, 35);
+  g_assert_true (result.in_order);
+
+  g_object_unref (options);
+  g_list_free (keys);
+}
+
+static void
+iterator_next_cb (GObject *object,
+                  GAsyncResult *result,
+                  gpointer user_data)
+{
+  GList **medias = user_data;
+  GError *error = NULL;
+
+  *medias = grl_media_iterator_next_finish (GRL_MEDIA_ITERATOR (object),
+                                            result, &error);
+  g_assert_no_error (error);
+}
+
+static void
+browse_iterator (BrowseFixture *fixture, gconstpointer data)
+{
+  TestBrowseSource *browse_source;
+  GrlOperationOptions *options;
+  GrlMediaIterator *iterator;
+  GList *keys;
+  GList *medias;
+  GList *m;
+  guint received = 0;
+  guint i;
+  static const guint expected_pages[] = { 5, 5, 2 };
+
+  browse_source = (TestBrowseSource *) fixture->browse_source;
+  browse_source->continuation = TRUE;
+
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE, NULL);
+  options = grl_operation_options_new (NULL);
+  grl_operation_options_set_count (options, 12);
+
+  iterator = grl_media_iterator_new_browse (fixture->browse_source, NULL,
+                                            keys, options);
+
+  /* Every page is asked only when the previous one was received */
+  for (i = 0; i < G_N_ELEMENTS (expected_pages); i++) {
+    g_assert_false (grl_media_iterator_is_done (iterator));
+    g_assert_cmpuint (browse_source->browses, ==, i);
+
+    medias = NULL;
+    grl_media_iterator_next_async (iterator, 5, NULL,
+                                   iterator_next_cb, &medias);
+    while (!medias) {
+      g_main_context_iteration (NULL, TRUE);
+    }
+
+    g_assert_cmpuint (g_list_length (medias), ==, expected_pages[i]);
+    for (m = medias; m; m = g_list_next (m)) {
+      gchar *id = g_strdup_printf ("media-%u", received++);
+
+      g_assert_cmpstr (grl_media_get_id (m->data), ==, id);
+      g_free (id);
+    }
+    g_list_free_full (medias, g_object_unref);
+  }
+
+  g_assert_true (grl_media_iterator_is_done (iterator));
+  g_assert_cmpuint (browse_source->continued, ==, 2);
+
+  g_object_unref (iterator);
+  g_object_unref (options);
+  g_list_free (keys);
+}
+
+typedef struct {
+  GMainLoop *loop;
+  GrlOperationPriority finished[2];
+  guint n_finished;
+} PriorityResult;
+
+typedef struct {
+  PriorityResult *result;
+  GrlOperationPriority priority;
+} PriorityBrowse;
+
+static void
+browse_priority_cb (GrlSource *source,
+                    guint operation_id,
+                    GrlMedia *media,
+                    guint remaining,
+                    gpointer user_data,
+                    const GError *error)
+{
+  PriorityBrowse *browse = user_data;
+  PriorityResult *result = browse->result;
+
+  g_assert_no_error (error);
+  g_clear_object (&media);
+
+  if (remaining == 0) {
+    result->finished[result->n_finished++] = browse->priority;
+    if (result->n_finished == 2) {
+      g_main_loop_quit (result->loop);
+    }
+  }
+}
+
+static void
+browse_priority (BrowseFixture *fixture, gconstpointer data)
+{
+  PriorityResult result = { fixture->loop, { 0, }, 0 };
+  PriorityBrowse background = { &result, GRL_OPERATION_PRIORITY_BACKGROUND };
+  PriorityBrowse interactive = { &result, GRL_OPERATION_PRIORITY_INTERACTIVE };
+  GrlOperationOptions *background_options;
+  GrlOperationOptions *interactive_options;
+  GList *keys;
+
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE, NULL);
+  background_options = grl_operation_options_new (NULL);
+  grl_operation_options_set_count (background_options, 5);
+  grl_operation_options_set_priority (background_options,
+                                      GRL_OPERATION_PRIORITY_BACKGROUND);
+  interactive_options = grl_operation_options_copy (background_options);
+  g_assert_cmpint (grl_operation_options_get_priority (interactive_options), ==,
+                   GRL_OPERATION_PRIORITY_BACKGROUND);
+  grl_operation_options_set_priority (interactive_options,
+                                      GRL_OPERATION_PRIORITY_INTERACTIVE);
+
+  /* The interactive browse overtakes the one started before it */
+  grl_source_browse (fixture->browse_source, NULL, keys, background_options,
+                     browse_priority_cb, &background);
+  grl_source_browse (fixture->browse_source, NULL, keys, interactive_options,
+                     browse_priority_cb, &interactive);
+  g_main_loop_run (fixture->loop);
+
+  g_assert_cmpint (result.finished[0], ==, GRL_OPERATION_PRIORITY_INTERACTIVE);
+  g_assert_cmpint (result.finished[1], ==, GRL_OPERATION_PRIORITY_BACKGROUND);
+
+  g_object_unref (interactive_options);
+  g_object_unref (background_options);
+  g_list_free (keys);
+}
+
+int
+main (int argc, char **argv)
+{
+  setlocale (LC_ALL, "");
+
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_bug_base ("http://gitlab.gnome.org/GNOME/grilo/issues/%s");
+
+  grl_init (&argc, &argv);
+
+  g_test_add ("/browse/continuation",
+              BrowseFixture, NULL,
+              browse_fixture_setup,
+              browse_continuation,
+              browse_fixture_teardown);
+
+  g_test_add ("/browse/iterator",
+              BrowseFixture, NULL,
+              browse_fixture_setup,
+              browse_iterator,
+              browse_fixture_teardown);
+
+  g_test_add ("/browse/priority",
+              BrowseFixture, NULL,
+              browse_fixture_setup,
+              browse_priority,
+              browse_fixture_teardown);
+
+  return g_test_run ();
+}
@@ -0,0 +1,469 @@
+/*
+ * Copyright (C) 2026 Grilo Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#undef G_DISABLE_ASSERT
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+#include <glib.h>
+#include <glib-object.h>
+
+#include <grilo.h>
+
+#define TEST_URI "ftp://example.com/song.ogg"
+#define N_SOURCES 3
+
+/* ================ URI source ================ */
+
+/* Creates a media for any URI. It answers after "latency" ms if set, and
+   fails if "fail" is set. If "hang" is set, it only answers once cancelled,
+   from an idle. The times it was asked whether it can create the media are
+   counted, and it says it cannot if "refuse" is set */
+
+typedef struct {
+  GrlSource parent;
+  guint latency;
+  gboolean fail;
+  gboolean hang;
+  GrlSourceMediaFromUriSpec *pending;
+  guint answered;
+  guint cancelled;
+  guint tests;
+  gboolean refuse;
+} TestUriSource;
+
+typedef struct {
+  GrlSourceClass parent_class;
+} TestUriSourceClass;
+
+GType test_uri_source_get_type (void);
+
+G_DEFINE_TYPE (TestUriSource, test_uri_source, GRL_TYPE_SOURCE)
+
+static const GList *
+test_uri_source_supported_keys (GrlSource *source)
+{
+  static GList *keys = NULL;
+
+  if (!keys) {
+    keys = grl_metadata_key_list_new (GRL_METADATA_KEY_URL,
+                                      NULL);
+  }
+
+  return keys;
+}
+
+static gboolean
+test_uri_source_test_media_from_uri (GrlSource *source,
+                                     const gchar *uri)
+{
+  TestUriSource *uri_source = (TestUriSource *) source;
+
+  uri_source->tests++;
+
+  return !uri_source->refuse;
+}
+
+static void
+test_uri_source_answer (GrlSourceMediaFromUriSpec *mfus,
+                        gboolean cancelled)
+{
+  TestUriSource *uri_source = (TestUriSource *) mfus->source;
+  GrlMedia *media = NULL;
+  GError *error = NULL;
+
+  uri_source->answered++;
+
+  if (cancelled) {
+    error = g_error_new (GRL_CORE_ERROR, GRL_CORE_ERROR_OPERATION_CANCELLED,
+                         "Cancelled");
+  } else if (uri_source->fail) {
+    error = g_error_new (GRL_CORE_ERROR, GRL_CORE_ERROR_MEDIA_FROM_URI_FAILED,
+                         "Unknown URI");
+  } else {
+    media = grl_media_new ();
+    grl_media_set_url (media, mfus->uri);
+  }
+
+  mfus->callback (mfus->source, mfus->operation_id, media, mfus->user_data,
+                  error);
+  g_clear_error (&error);
+}
+
+static gboolean
+test_uri_source_answer_later (gpointer user_data)
+{
+  test_uri_source_answer (user_data, FALSE);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+test_uri_source_answer_cancelled (gpointer user_data)
+{
+  test_uri_source_answer (user_data, TRUE);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+test_uri_source_media_from_uri (GrlSource *source,
+                                GrlSourceMediaFromUriSpec *mfus)
+{
+  TestUriSource *uri_source = (TestUriSource *) source;
+
+  if (uri_source->hang) {
+    uri_source->pending = mfus;
+  } else if (uri_source->latency > 0) {
+    g_timeout_add (uri_source->latency, test_uri_source_answer_later, mfus);
+  } else {
+    test_uri_source_answer (mfus, FALSE);
+  }
+}
+
+static void
+test_uri_source_cancel (GrlSource *source,
+                        guint operation_id)
+{
+  TestUriSource *uri_source = (TestUriSource *) source;
+
+  if (uri_source->pending &&
+      uri_source->pending->operation_id == operation_id) {
+    uri_source->cancelled++;
+    g_idle_add (test_uri_source_answer_cancelled, uri_source->pending);
+    uri_source->pending = NULL;
+  }
+}
+
+static void
+test_uri_source_class_init (TestUriSourceClass *klass)
+{
+  GrlSourceClass *source_class = GRL_SOURCE_CLASS (klass);
+
+  source_class->supported_keys = test_uri_source_supported_keys;
+  source_class->test_media_from_uri = test_uri_source_test_media_from_uri;
+  source_class->media_from_uri = test_uri_source_media_from_uri;
+  source_class->cancel = test_uri_source_cancel;
+}
+
+static void
+test_uri_source_init (TestUriSource *source)
+{
+}
+
+/* ================ Tests ================ */
+
+/* The sources do not declare prefixes, so they are tried by rank, the first
+   one being the preferred one */
+typedef struct {
+  GrlRegistry *registry;
+  GrlPlugin *plugin;
+  TestUriSource *sources[N_SOURCES];
+  GList *keys;
+  GrlOperationOptions *options;
+} UriFixture;
+
+static void
+uri_fixture_setup (UriFixture *fixture, gconstpointer data)
+{
+  GError *error = NULL;
+  guint i;
+
+  fixture->registry = grl_registry_get_default ();
+  fixture->plugin = g_object_new (GRL_TYPE_PLUGIN, NULL);
+
+  for (i = 0; i < N_SOURCES; i++) {
+    gchar *id = g_strdup_printf ("test-uri-%u", i);
+
+    fixture->sources[i] = g_object_new (test_uri_source_get_type (),
+                                        "source-id", id,
+                                        NULL);
+    g_object_ref (fixture->sources[i]);
+    g_assert_true (grl_registry_register_source (fixture->registry,
+                                                 fixture->plugin,
+                                                 GRL_SOURCE (fixture->sources[i]),
+                                                 &error));
+    g_assert_no_error (error);
+    /* Registering sets the configured rank */
+    g_object_set (fixture->sources[i], "rank", 10 - (gint) i, NULL);
+    g_free (id);
+  }
+
+  fixture->keys = grl_metadata_key_list_new (GRL_METADATA_KEY_URL, NULL);
+  fixture->options = grl_operation_options_new (NULL);
+}
+
+static void
+uri_fixture_teardown (UriFixture *fixture, gconstpointer data)
+{
+  guint i;
+
+  for (i = 0; i < N_SOURCES; i++) {
+    grl_registry_unregister_source (fixture->registry,
+                                    GRL_SOURCE (fixture->sources[i]), NULL);
+    g_object_unref (fixture->sources[i]);
+  }
+  g_object_unref (fixture->options);
+  g_list_free (fixture->keys);
+  g_object_unref (fixture->plugin);
+}
+
+typedef struct {
+  GrlSource *source;
+  guint answers;
+  GError *error;
+} ParallelResult;
+
+static void
+parallel_cb (GrlSource *source,
+             guint operation_id,
+             GrlMedia *media,
+             gpointer user_data,
+             const GError *error)
+{
+  ParallelResult *result = user_data;
+
+  result->answers++;
+  result->source = source;
+  g_clear_error (&result->error);
+  result->error = error ? g_error_copy (error) : NULL;
+  g_clear_object (&media);
+}
+
+/* Waits for the answer of a parallel request for TEST_URI */
+static void
+parallel_run (UriFixture *fixture,
+              ParallelResult *result)
+{
+  memset (result, 0, sizeof (ParallelResult));
+  grl_multiple_get_media_from_uri_parallel (TEST_URI,
+                                            fixture->keys,
+                                            fixture->options,
+                                            parallel_cb,
+                                            result);
+  while (result->answers == 0) {
+    g_main_context_iteration (NULL, TRUE);
+  }
+}
+
+static void
+parallel_rank_order (UriFixture *fixture, gconstpointer data)
+{
+  ParallelResult result;
+  guint i;
+
+  /* The best ranked source wins even if the others answer before */
+  fixture->sources[0]->latency = 50;
+  parallel_run (fixture, &result);
+
+  g_assert_no_error (result.error);
+  g_assert_true (result.source == GRL_SOURCE (fixture->sources[0]));
+  for (i = 0; i < N_SOURCES; i++) {
+    g_assert_cmpuint (fixture->sources[i]->answered, ==, 1);
+    g_assert_cmpuint (fixture->sources[i]->cancelled, ==, 0);
+  }
+
+  /* Once it fails, the next one in rank order wins */
+  fixture->sources[0]->fail = TRUE;
+  parallel_run (fixture, &result);
+
+  g_assert_no_error (result.error);
+  g_assert_true (result.source == GRL_SOURCE (fixture->sources[1]));
+}
+
+static void
+parallel_all_fail (UriFixture *fixture, gconstpointer data)
+{
+  ParallelResult result;
+  guint i;
+
+  for (i = 0; i < N_SOURCES; i++) {
+    fixture->sources[i]->fail = TRUE;
+  }
+  fixture->sources[1]->latency = 20;
+
+  /* The error is only reported once all of them have failed */
+  parallel_run (fixture, &result);
+
+  g_assert_error (result.error, GRL_CORE_ERROR,
+                  GRL_CORE_ERROR_MEDIA_FROM_URI_FAILED);
+  g_assert_null (result.source);
+  for (i = 0; i < N_SOURCES; i++) {
+    g_assert_cmpuint (fixture->sources[i]->answered, ==, 1);
+  }
+  g_clear_error (&result.error);
+
+  while (g_main_context_iteration (NULL, FALSE));
+  g_assert_cmpuint (result.answers, ==, 1);
+}
+
+static void
+parallel_cancel (UriFixture *fixture, gconstpointer data)
+{
+  ParallelResult result;
+  guint i;
+
+  /* The best source answers once the others are waiting */
+  fixture->sources[0]->latency = 10;
+  for (i = 1; i < N_SOURCES; i++) {
+    fixture->sources[i]->hang = TRUE;
+  }
+  parallel_run (fixture, &result);
+
+  /* The outstanding requests are cancelled */
+  g_assert_no_error (result.error);
+  g_assert_true (result.source == GRL_SOURCE (fixture->sources[0]));
+  for (i = 1; i < N_SOURCES; i++) {
+    g_assert_cmpuint (fixture->sources[i]->cancelled, ==, 1);
+    g_assert_cmpuint (fixture->sources[i]->answered, ==, 0);
+  }
+
+  /* They still answer later, using the request data, which is kept until
+     then; their answers are not delivered */
+  while (fixture->sources[1]->answered == 0 ||
+         fixture->sources[2]->answered == 0) {
+    g_main_context_iteration (NULL, TRUE);
+  }
+  while (g_main_context_iteration (NULL, FALSE));
+  g_assert_cmpuint (result.answers, ==, 1);
+}
+
+static void
+media_from_uri_cb (GrlSource *source,
+                   guint operation_id,
+                   GrlMedia *media,
+                   gpointer user_data,
+                   const GError *error)
+{
+  GrlSource **result = user_data;
+
+  g_assert_no_error (error);
+  g_assert_nonnull (media);
+  *result = source;
+  g_object_unref (media);
+}
+
+static void
+media_from_uri_prefixes (void)
+{
+  GrlRegistry *registry = grl_registry_get_default ();
+  GrlPlugin *plugin = g_object_new (GRL_TYPE_PLUGIN, NULL);
+  GrlSource *sources[3];
+  GrlOperationOptions *options;
+  GList *keys;
+  guint i;
+  const gchar *file_prefixes[] = { "file:", "http:", NULL };
+  const gchar *site_prefixes[] = { "http://example.com/", NULL };
+  static const struct {
+    const gchar *uri;
+    guint source;
+  } expected[] = {
+    { "FILE:///music/song.ogg", 0 },
+    { "http://example.com/song.ogg", 1 },
+    { "http://example.org/song.ogg", 0 },
+    { "ftp://example.com/song.ogg", 1 },
+  };
+
+  sources[0] = g_object_new (test_uri_source_get_type (),
+                             "source-id", "test-uri-file",
+                             "uri-prefixes", file_prefixes,
+                             NULL);
+  sources[1] = g_object_new (test_uri_source_get_type (),
+                             "source-id", "test-uri-site",
+                             "uri-prefixes", site_prefixes,
+                             NULL);
+  sources[2] = g_object_new (test_uri_source_get_type (),
+                             "source-id", "test-uri-any",
+                             NULL);
+  for (i = 0; i < G_N_ELEMENTS (sources); i++) {
+    g_object_ref (sources[i]);
+    g_assert_true (grl_registry_register_source (registry,
+                                                 plugin,
+                                                 sources[i],
+                                                 NULL));
+    /* Tested in order */
+    g_object_set (sources[i], "rank", (gint) (G_N_ELEMENTS (sources) - i), NULL);
+  }
+  ((TestUriSource *) sources[0])->refuse = TRUE;
+
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_URL, NULL);
+  options = grl_operation_options_new (NULL);
+
+  /* Sources declaring prefixes are chosen by the longest one without testing
+     them. They are still tested for the URIs outside their prefixes */
+  for (i = 0; i < G_N_ELEMENTS (expected); i++) {
+    GrlSource *result = NULL;
+
+    grl_multiple_get_media_from_uri (expected[i].uri, keys, options,
+                                     media_from_uri_cb, &result);
+    while (!result) {
+      g_main_context_iteration (NULL, TRUE);
+    }
+    g_assert_true (result == sources[expected[i].source]);
+  }
+
+  g_assert_cmpuint (((TestUriSource *) sources[0])->tests, ==, 1);
+  g_assert_cmpuint (((TestUriSource *) sources[1])->tests, ==, 1);
+  g_assert_cmpuint (((TestUriSource *) sources[2])->tests, ==, 0);
+
+  for (i = 0; i < G_N_ELEMENTS (sources); i++) {
+    grl_registry_unregister_source (registry, sources[i], NULL);
+    g_object_unref (sources[i]);
+  }
+  g_object_unref (options);
+  g_list_free (keys);
+  g_object_unref (plugin);
+}
+
+int
+main (int argc, char **argv)
+{
+  setlocale (LC_ALL, "");
+
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_bug_base ("http://gitlab.gnome.org/GNOME/grilo/issues/%s");
+
+  grl_init (&argc, &argv);
+
+  g_test_add ("/media-from-uri/parallel/rank-order",
+              UriFixture, NULL,
+              uri_fixture_setup,
+              parallel_rank_order,
+              uri_fixture_teardown);
+
+  g_test_add ("/media-from-uri/parallel/all-fail",
+              UriFixture, NULL,
+              uri_fixture_setup,
+              parallel_all_fail,
+              uri_fixture_teardown);
+
+  g_test_add ("/media-from-uri/parallel/cancel",
+              UriFixture, NULL,
+              uri_fixture_setup,
+              parallel_cancel,
+              uri_fixture_teardown);
+
+  g_test_add_func ("/media-from-uri/prefixes", media_from_uri_prefixes);
+
+  return g_test_run ();
+}
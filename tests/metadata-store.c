@@ -0,0 +1,587 @@
+/*
+ * Copyright (C) 2026 Grilo Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#undef G_DISABLE_ASSERT
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#ifdef G_OS_UNIX
+#include <signal.h>
+#include <sys/resource.h>
+#endif
+
+#include <grilo.h>
+
+/* The store is private to the library */
+#define _GRILO_H_INSIDE_
+#include "grl-metadata-store-priv.h"
+#undef _GRILO_H_INSIDE_
+
+#define STORE_MAGIC_SIZE 8
+#define RECORD_HEADER_SIZE 8
+
+typedef struct {
+  gchar *dir;
+  gchar *path;
+  /* Media ids replayed, invalidations prefixed with "-" */
+  GPtrArray *replayed;
+  /* Titles of the values replayed */
+  GPtrArray *titles;
+} StoreFixture;
+
+static void
+store_fixture_setup (StoreFixture *fixture, gconstpointer data)
+{
+  GError *error = NULL;
+
+  fixture->dir = g_dir_make_tmp ("grilo-store-XXXXXX", &error);
+  g_assert_no_error (error);
+  fixture->path = g_build_filename (fixture->dir, "store", NULL);
+  fixture->replayed = g_ptr_array_new_with_free_func (g_free);
+  fixture->titles = g_ptr_array_new_with_free_func (g_free);
+}
+
+static void
+store_fixture_teardown (StoreFixture *fixture, gconstpointer data)
+{
+  g_unlink (fixture->path);
+  g_assert_cmpint (g_rmdir (fixture->dir), ==, 0);
+  g_ptr_array_unref (fixture->replayed);
+  g_ptr_array_unref (fixture->titles);
+  g_free (fixture->path);
+  g_free (fixture->dir);
+}
+
+static void
+store_value_cb (gint64 stored,
+                const gchar *resolver,
+                const gchar *media_source,
+                const gchar *media_id,
+                GrlKeyID key,
+                GList *relkeys,
+                gpointer user_data)
+{
+  StoreFixture *fixture = user_data;
+
+  g_assert_cmpint (stored, ==, 1000);
+  g_assert_cmpstr (resolver, ==, "resolver");
+  g_assert_cmpstr (media_source, ==, "source");
+  g_assert_cmpuint (key, ==, GRL_METADATA_KEY_TITLE);
+  g_assert_cmpuint (g_list_length (relkeys), ==, 1);
+  g_assert_cmpint (grl_related_keys_get_int (relkeys->data,
+                                             GRL_METADATA_KEY_DURATION),
+                   ==, 60);
+
+  g_ptr_array_add (fixture->replayed, g_strdup (media_id));
+  g_ptr_array_add (fixture->titles,
+                   g_strdup (grl_related_keys_get_string (relkeys->data,
+                                                          GRL_METADATA_KEY_TITLE)));
+  g_list_free_full (relkeys, g_object_unref);
+}
+
+static void
+store_invalidate_cb (const gchar *source_id,
+                     const gchar *media_id,
+                     gpointer user_data)
+{
+  StoreFixture *fixture = user_data;
+
+  g_assert_cmpstr (source_id, ==, "source");
+  g_ptr_array_add (fixture->replayed, g_strconcat ("-", media_id, NULL));
+}
+
+/* Opens the store, replaying it into @fixture */
+static GrlMetadataStore *
+store_open (StoreFixture *fixture)
+{
+  GrlMetadataStore *store;
+  GError *error = NULL;
+
+  g_ptr_array_set_size (fixture->replayed, 0);
+  g_ptr_array_set_size (fixture->titles, 0);
+
+  store = grl_metadata_store_open (fixture->path,
+                                   store_value_cb,
+                                   store_invalidate_cb,
+                                   fixture,
+                                   &error);
+  g_assert_no_error (error);
+  g_assert_nonnull (store);
+
+  return store;
+}
+
+/* Stores the title of @media_id, along with its duration */
+static void
+store_add (GrlMetadataStore *store,
+           const gchar *media_id,
+           GrlKeyID key)
+{
+  GrlRelatedKeys *relkeys;
+  GList *list;
+  gchar *title;
+
+  title = g_strconcat ("title of ", media_id, NULL);
+  relkeys = grl_related_keys_new ();
+  grl_related_keys_set_string (relkeys, key, title);
+  grl_related_keys_set_int (relkeys, GRL_METADATA_KEY_DURATION, 60);
+  list = g_list_append (NULL, relkeys);
+
+  grl_metadata_store_add_value (store, 1000, "resolver", "source",
+                                media_id, key, list);
+
+  g_list_free_full (list, g_object_unref);
+  g_free (title);
+}
+
+static void
+assert_replayed (StoreFixture *fixture,
+                 const gchar * const *expected)
+{
+  guint i;
+
+  g_assert_cmpuint (fixture->replayed->len, ==, g_strv_length ((gchar **) expected));
+  for (i = 0; expected[i]; i++) {
+    g_assert_cmpstr (g_ptr_array_index (fixture->replayed, i), ==, expected[i]);
+  }
+}
+
+static GBytes *
+store_contents (StoreFixture *fixture)
+{
+  GError *error = NULL;
+  gchar *contents;
+  gsize length;
+
+  g_file_get_contents (fixture->path, &contents, &length, &error);
+  g_assert_no_error (error);
+
+  return g_bytes_new_take (contents, length);
+}
+
+static void
+store_set_contents (StoreFixture *fixture,
+                    const guint8 *contents,
+                    gsize length)
+{
+  GError *error = NULL;
+
+  g_file_set_contents (fixture->path, (const gchar *) contents, length, &error);
+  g_assert_no_error (error);
+}
+
+/* Returns the offset of the record number @n in @contents */
+static gsize
+record_offset (GBytes *contents,
+               guint n)
+{
+  const guint8 *data;
+  gsize offset = STORE_MAGIC_SIZE;
+  guint32 length;
+
+  data = g_bytes_get_data (contents, NULL);
+  while (n-- > 0) {
+    memcpy (&length, data + offset, sizeof (length));
+    offset += RECORD_HEADER_SIZE + GUINT32_FROM_LE (length);
+  }
+
+  return offset;
+}
+
+static guint32
+checksum (const guint8 *data,
+          gsize size)
+{
+  guint32 hash = 2166136261U;
+  gsize i;
+
+  for (i = 0; i < size; i++) {
+    hash ^= data[i];
+    hash *= 16777619U;
+  }
+
+  return hash;
+}
+
+/* Writes three values and an invalidation */
+static void
+store_fill (StoreFixture *fixture)
+{
+  GrlMetadataStore *store;
+
+  store = store_open (fixture);
+  g_assert_cmpuint (fixture->replayed->len, ==, 0);
+  store_add (store, "media-1", GRL_METADATA_KEY_TITLE);
+  store_add (store, "media-2", GRL_METADATA_KEY_TITLE);
+  grl_metadata_store_add_invalidation (store, "source", "media-1");
+  store_add (store, "media-3", GRL_METADATA_KEY_TITLE);
+  grl_metadata_store_close (store);
+}
+
+static void
+store_replay (StoreFixture *fixture, gconstpointer data)
+{
+  static const gchar *expected[] = {
+    "media-1", "media-2", "-media-1", "media-3", NULL
+  };
+  GrlMetadataStore *store;
+
+  store_fill (fixture);
+
+  /* Records are replayed in order */
+  store = store_open (fixture);
+  assert_replayed (fixture, expected);
+  g_assert_cmpstr (g_ptr_array_index (fixture->titles, 2), ==, "title of media-3");
+
+  /* Values keep being appended */
+  store_add (store, "media-4", GRL_METADATA_KEY_TITLE);
+  grl_metadata_store_close (store);
+
+  store = store_open (fixture);
+  g_assert_cmpuint (fixture->replayed->len, ==, 5);
+  g_assert_cmpstr (g_ptr_array_index (fixture->replayed, 4), ==, "media-4");
+  grl_metadata_store_close (store);
+}
+
+/* Checks that the damaged store only replays @expected, and that it is
+   truncated after them so values are appended again */
+static void
+store_check_damaged (StoreFixture *fixture,
+                     const gchar * const *expected)
+{
+  GrlMetadataStore *store;
+  GBytes *damaged, *contents;
+  gsize good;
+  guint n_expected;
+
+  n_expected = g_strv_length ((gchar **) expected);
+  damaged = store_contents (fixture);
+  good = record_offset (damaged, n_expected);
+
+  store = store_open (fixture);
+  assert_replayed (fixture, expected);
+
+  /* Appending after the damaged record would make it be lost too */
+  contents = store_contents (fixture);
+  g_assert_cmpuint (g_bytes_get_size (contents), ==, good);
+  g_assert_cmpmem (g_bytes_get_data (contents, NULL), good,
+                   g_bytes_get_data (damaged, NULL), good);
+  g_bytes_unref (contents);
+
+  store_add (store, "media-5", GRL_METADATA_KEY_TITLE);
+  grl_metadata_store_close (store);
+
+  store = store_open (fixture);
+  g_assert_cmpuint (fixture->replayed->len, ==, n_expected + 1);
+  g_assert_cmpstr (g_ptr_array_index (fixture->replayed, n_expected), ==, "media-5");
+  grl_metadata_store_close (store);
+
+  g_bytes_unref (damaged);
+}
+
+static void
+store_truncated (StoreFixture *fixture, gconstpointer data)
+{
+  static const gchar *expected[] = { "media-1", "media-2", "-media-1", NULL };
+  GBytes *contents;
+  gsize length, last;
+
+  store_fill (fixture);
+  contents = store_contents (fixture);
+  length = g_bytes_get_size (contents);
+  last = record_offset (contents, 3);
+
+  /* The payload of the last record was not completely written */
+  store_set_contents (fixture, g_bytes_get_data (contents, NULL), length - 3);
+  store_check_damaged (fixture, expected);
+
+  /* Nor its header */
+  store_set_contents (fixture, g_bytes_get_data (contents, NULL), last + 5);
+  store_check_damaged (fixture, expected);
+
+  g_bytes_unref (contents);
+}
+
+static void
+store_corrupted (StoreFixture *fixture, gconstpointer data)
+{
+  static const gchar *expected[] = { "media-1", NULL };
+  GBytes *contents;
+  GByteArray *array;
+  gsize offset;
+
+  store_fill (fixture);
+  contents = store_contents (fixture);
+  offset = record_offset (contents, 2);
+  array = g_bytes_unref_to_array (contents);
+
+  /* A record not matching its checksum ends the replay, even if the
+     following ones are right */
+  array->data[offset - 1] ^= 0xff;
+  store_set_contents (fixture, array->data, array->len);
+  store_check_damaged (fixture, expected);
+
+  g_byte_array_unref (array);
+}
+
+static void
+store_unknown_keys (StoreFixture *fixture, gconstpointer data)
+{
+  static const gchar *expected[] = { "media-1", "-media-1", "media-3", NULL };
+  GrlMetadataStore *store;
+  GBytes *contents;
+  GByteArray *array;
+  guint8 *record;
+  gsize offset, end, i;
+  guint32 sum;
+  guint renamed = 0;
+
+  store = store_open (fixture);
+  store_add (store, "media-1", GRL_METADATA_KEY_TITLE);
+  store_add (store, "media-2", GRL_METADATA_KEY_ALBUM);
+  grl_metadata_store_add_invalidation (store, "source", "media-1");
+  store_add (store, "media-3", GRL_METADATA_KEY_TITLE);
+  grl_metadata_store_close (store);
+
+  /* Rename the key of the second record to one not registered, as if it was
+     registered by a plugin not loaded any more */
+  contents = store_contents (fixture);
+  offset = record_offset (contents, 1);
+  end = record_offset (contents, 2);
+  array = g_bytes_unref_to_array (contents);
+  record = array->data + offset + RECORD_HEADER_SIZE;
+  for (i = 0; record + i + strlen ("album") <= array->data + end; i++) {
+    if (memcmp (record + i, "album", strlen ("album")) == 0) {
+      record[i] = 'x';
+      renamed++;
+    }
+  }
+  g_assert_cmpuint (renamed, >, 0);
+  sum = GUINT32_TO_LE (checksum (record, end - offset - RECORD_HEADER_SIZE));
+  memcpy (array->data + offset + sizeof (guint32), &sum, sizeof (sum));
+  store_set_contents (fixture, array->data, array->len);
+  g_byte_array_unref (array);
+
+  /* Values of unknown keys are dropped, without stopping the replay */
+  store = store_open (fixture);
+  assert_replayed (fixture, expected);
+  grl_metadata_store_close (store);
+}
+
+/* Checks that no temporary file is left behind */
+static void
+assert_only_store (StoreFixture *fixture)
+{
+  GError *error = NULL;
+  const gchar *name;
+  GDir *dir;
+
+  dir = g_dir_open (fixture->dir, 0, &error);
+  g_assert_no_error (error);
+  name = g_dir_read_name (dir);
+  g_assert_cmpstr (name, ==, "store");
+  g_assert_null (g_dir_read_name (dir));
+  g_dir_close (dir);
+}
+
+static void
+store_compaction (StoreFixture *fixture, gconstpointer data)
+{
+  static const gchar *expected[] = { "media-3", NULL };
+  GrlMetadataStore *store;
+  GBytes *contents;
+  guint i;
+
+  /* Once the file has grown enough, superseded values are dropped on their
+     own, without waiting for the writes */
+  store = store_open (fixture);
+  for (i = 0; i < 600; i++) {
+    store_add (store, "media-3", GRL_METADATA_KEY_TITLE);
+  }
+  grl_metadata_store_flush (store);
+
+  contents = store_contents (fixture);
+  g_assert_cmpuint (g_bytes_get_size (contents), ==, record_offset (contents, 1));
+  g_bytes_unref (contents);
+
+  /* But not while it is small */
+  for (i = 0; i < 10; i++) {
+    store_add (store, "media-3", GRL_METADATA_KEY_TITLE);
+  }
+  grl_metadata_store_close (store);
+
+  contents = store_contents (fixture);
+  g_assert_cmpuint (g_bytes_get_size (contents), ==, record_offset (contents, 11));
+  g_bytes_unref (contents);
+  assert_only_store (fixture);
+
+  store = store_open (fixture);
+  g_assert_cmpuint (fixture->replayed->len, ==, 11);
+  g_assert_true (grl_metadata_store_compact (store, NULL));
+  grl_metadata_store_close (store);
+
+  store = store_open (fixture);
+  assert_replayed (fixture, expected);
+  grl_metadata_store_close (store);
+}
+
+static void
+store_compaction_invalidated (StoreFixture *fixture, gconstpointer data)
+{
+  static const gchar *expected[] = { "media-2", "media-3", NULL };
+  GrlMetadataStore *store;
+  GError *error = NULL;
+
+  /* Compaction works on the records in the file, whatever is kept in
+     memory; invalidations drop the records before them */
+  store_fill (fixture);
+  store = store_open (fixture);
+  g_assert_true (grl_metadata_store_compact (store, &error));
+  g_assert_no_error (error);
+  grl_metadata_store_close (store);
+
+  store = store_open (fixture);
+  assert_replayed (fixture, expected);
+  g_assert_cmpstr (g_ptr_array_index (fixture->titles, 0), ==, "title of media-2");
+
+  /* Invalidating a whole source drops its medias */
+  grl_metadata_store_add_invalidation (store, "source", NULL);
+  store_add (store, "media-4", GRL_METADATA_KEY_TITLE);
+  g_assert_true (grl_metadata_store_compact (store, &error));
+  g_assert_no_error (error);
+  grl_metadata_store_close (store);
+  assert_only_store (fixture);
+
+  store = store_open (fixture);
+  g_assert_cmpuint (fixture->replayed->len, ==, 1);
+  g_assert_cmpstr (g_ptr_array_index (fixture->replayed, 0), ==, "media-4");
+  grl_metadata_store_close (store);
+}
+
+#ifdef G_OS_UNIX
+static void
+store_write_failure (StoreFixture *fixture, gconstpointer data)
+{
+  static const gchar *expected[] = {
+    "media-1", "media-2", "-media-1", "media-3", "media-5", NULL
+  };
+  GrlMetadataStore *store;
+  GBytes *before, *after;
+  struct rlimit limit, old_limit;
+  gchar *long_id;
+
+  store_fill (fixture);
+  store = store_open (fixture);
+  before = store_contents (fixture);
+
+  /* The file can only grow a bit, so the record is partially written */
+  signal (SIGXFSZ, SIG_IGN);
+  g_assert_cmpint (getrlimit (RLIMIT_FSIZE, &old_limit), ==, 0);
+  limit = old_limit;
+  limit.rlim_cur = g_bytes_get_size (before) + 16;
+  g_assert_cmpint (setrlimit (RLIMIT_FSIZE, &limit), ==, 0);
+
+  long_id = g_strnfill (1024, 'x');
+  g_test_expect_message ("Grilo", G_LOG_LEVEL_WARNING,
+                         "*Could not write to metadata store*");
+  store_add (store, long_id, GRL_METADATA_KEY_TITLE);
+  grl_metadata_store_flush (store);
+  g_test_assert_expected_messages ();
+
+  g_assert_cmpint (setrlimit (RLIMIT_FSIZE, &old_limit), ==, 0);
+  signal (SIGXFSZ, SIG_DFL);
+
+  /* The incomplete record is dropped, so the following ones are kept */
+  after = store_contents (fixture);
+  g_assert_true (g_bytes_equal (before, after));
+  g_bytes_unref (after);
+
+  store_add (store, "media-5", GRL_METADATA_KEY_TITLE);
+  grl_metadata_store_close (store);
+
+  store = store_open (fixture);
+  assert_replayed (fixture, expected);
+  grl_metadata_store_close (store);
+
+  g_bytes_unref (before);
+  g_free (long_id);
+}
+#endif
+
+int
+main (int argc, char **argv)
+{
+  setlocale (LC_ALL, "");
+
+  g_test_init (&argc, &argv, NULL);
+
+  grl_init (&argc, &argv);
+
+  g_test_add ("/metadata-store/replay",
+              StoreFixture, NULL,
+              store_fixture_setup,
+              store_replay,
+              store_fixture_teardown);
+
+  g_test_add ("/metadata-store/truncated",
+              StoreFixture, NULL,
+              store_fixture_setup,
+              store_truncated,
+              store_fixture_teardown);
+
+  g_test_add ("/metadata-store/corrupted",
+              StoreFixture, NULL,
+              store_fixture_setup,
+              store_corrupted,
+              store_fixture_teardown);
+
+  g_test_add ("/metadata-store/unknown-keys",
+              StoreFixture, NULL,
+              store_fixture_setup,
+              store_unknown_keys,
+              store_fixture_teardown);
+
+  g_test_add ("/metadata-store/compaction",
+              StoreFixture, NULL,
+              store_fixture_setup,
+              store_compaction,
+              store_fixture_teardown);
+
+  g_test_add ("/metadata-store/compaction/invalidated",
+              StoreFixture, NULL,
+              store_fixture_setup,
+              store_compaction_invalidated,
+              store_fixture_teardown);
+
+#ifdef G_OS_UNIX
+  g_test_add ("/metadata-store/write-failure",
+              StoreFixture, NULL,
+              store_fixture_setup,
+              store_write_failure,
+              store_fixture_teardown);
+#endif
+
+  return g_test_run ();
+}
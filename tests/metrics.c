@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2026 Grilo Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#undef G_DISABLE_ASSERT
+
+#undef G_DISABLE_ASSERT
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+#include <glib.h>
+#include <glib-object.h>
+
+#include <grilo.h>
+
+/* ================ Browse source ================ */
+
+/* Sends "count" audio items with id and title, starting at "skip" */
+
+typedef struct {
+  GrlSource parent;
+} TestBrowseSource;
+
+typedef struct {
+  GrlSourceClass parent_class;
+} TestBrowseSourceClass;
+
+GType test_browse_source_get_type (void);
+
+G_DEFINE_TYPE (TestBrowseSource, test_browse_source, GRL_TYPE_SOURCE)
+
+static const GList *
+test_browse_source_supported_keys (GrlSource *source)
+{
+  static GList *keys = NULL;
+
+  if (!keys) {
+    keys = grl_metadata_key_list_new (GRL_METADATA_KEY_ID,
+                                      GRL_METADATA_KEY_TITLE,
+                                      NULL);
+  }
+
+  return keys;
+}
+
+static void
+test_browse_source_browse (GrlSource *source,
+                           GrlSourceBrowseSpec *bs)
+{
+  gint count = grl_operation_options_get_count (bs->options);
+  guint skip = grl_operation_options_get_skip (bs->options);
+  gint i;
+
+  if (count <= 0) {
+    bs->callback (source, bs->operation_id, NULL, 0, bs->user_data, NULL);
+    return;
+  }
+
+  for (i = 0; i < count; i++) {
+    GrlMedia *media = grl_media_audio_new ();
+    gchar *id = g_strdup_printf ("media-%u", skip + i);
+
+    grl_media_set_id (media, id);
+    grl_media_set_title (media, id);
+    g_free (id);
+
+    bs->callback (source, bs->operation_id, media, count - i - 1,
+                  bs->user_data, NULL);
+  }
+}
+
+static void
+test_browse_source_class_init (TestBrowseSourceClass *klass)
+{
+  GrlSourceClass *source_class = GRL_SOURCE_CLASS (klass);
+
+  source_class->supported_keys = test_browse_source_supported_keys;
+  source_class->browse = test_browse_source_browse;
+}
+
+static void
+test_browse_source_init (TestBrowseSource *source)
+{
+}
+
+/* ================ Tests ================ */
+
+typedef struct {
+  GrlSource *browse_source;
+  GMainLoop *loop;
+} MetricsFixture;
+
+static void
+metrics_fixture_setup (MetricsFixture *fixture, gconstpointer data)
+{
+  fixture->loop = g_main_loop_new (NULL, TRUE);
+  fixture->browse_source = g_object_new (test_browse_source_get_type (),
+                                         "source-id", "test-browse",
+                                         "source-name", "Test browse",
+                                         NULL);
+}
+
+static void
+metrics_fixture_teardown (MetricsFixture *fixture, gconstpointer data)
+{
+  g_object_unref (fixture->browse_source);
+  g_main_loop_unref (fixture->loop);
+}
+
+static void
+browse_metrics_cb (GrlSource *source,
+                   guint operation_id,
+                   GrlMedia *media,
+                   guint remaining,
+                   gpointer user_data,
+                   const GError *error)
+{
+  GMainLoop *loop = user_data;
+
+  g_assert_no_error (error);
+  g_clear_object (&media);
+
+  if (remaining == 0) {
+    g_main_loop_quit (loop);
+  }
+}
+
+static void
+metrics_browse (MetricsFixture *fixture, gconstpointer data)
+{
+  GrlOperationOptions *options;
+  GrlMetricsEntry *call = NULL;
+  GList *entries, *entry;
+  GList *keys;
+  guint64 samples = 0;
+  guint i;
+
+  grl_metrics_reset ();
+  grl_metrics_set_enabled (TRUE);
+
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE, NULL);
+  options = grl_operation_options_new (NULL);
+  grl_operation_options_set_count (options, 5);
+
+  grl_source_browse (fixture->browse_source, NULL, keys, options,
+                     browse_metrics_cb, fixture->loop);
+  g_main_loop_run (fixture->loop);
+
+  grl_metrics_set_enabled (FALSE);
+
+  entries = grl_metrics_get_entries ();
+  for (entry = entries; entry; entry = g_list_next (entry)) {
+    GrlMetricsEntry *e = entry->data;
+    if (g_strcmp0 (e->source_id, "test-browse") == 0 &&
+        e->operation == GRL_OP_BROWSE &&
+        e->kind == GRL_METRICS_KIND_CALL) {
+      call = e;
+    }
+  }
+
+  g_assert_nonnull (call);
+  g_assert_cmpuint (call->count, ==, 1);
+  g_assert_cmpuint (call->errors, ==, 0);
+  g_assert_cmpuint (call->results, ==, 5);
+  g_assert_cmpint (call->min_time, <=, call->max_time);
+  for (i = 0; i < GRL_METRICS_N_BUCKETS; i++) {
+    samples += call->buckets[i];
+  }
+  g_assert_cmpuint (samples, ==, call->count);
+
+  g_list_free_full (entries, (GDestroyNotify) grl_metrics_entry_free);
+  grl_metrics_reset ();
+
+  g_object_unref (options);
+  g_list_free (keys);
+}
+
+int
+main (int argc, char **argv)
+{
+  setlocale (LC_ALL, "");
+
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_bug_base ("http://gitlab.gnome.org/GNOME/grilo/issues/%s");
+
+  grl_init (&argc, &argv);
+
+  g_test_add ("/metrics/browse",
+              MetricsFixture, NULL,
+              metrics_fixture_setup,
+              metrics_browse,
+              metrics_fixture_teardown);
+
+  return g_test_run ();
+}
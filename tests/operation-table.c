@@ -0,0 +1,260 @@
+/*
+ * Copyright (C) 2026 Grilo Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#undef G_DISABLE_ASSERT
+
+#undef G_DISABLE_ASSERT
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+#include <glib.h>
+#include <glib-object.h>
+
+#include <grilo.h>
+
+/* ================ Browse source ================ */
+
+/* Sends "count" audio items with id and title, starting at "skip" */
+
+typedef struct {
+  GrlSource parent;
+} TestBrowseSource;
+
+typedef struct {
+  GrlSourceClass parent_class;
+} TestBrowseSourceClass;
+
+GType test_browse_source_get_type (void);
+
+G_DEFINE_TYPE (TestBrowseSource, test_browse_source, GRL_TYPE_SOURCE)
+
+static const GList *
+test_browse_source_supported_keys (GrlSource *source)
+{
+  static GList *keys = NULL;
+
+  if (!keys) {
+    keys = grl_metadata_key_list_new (GRL_METADATA_KEY_ID,
+                                      GRL_METADATA_KEY_TITLE,
+                                      NULL);
+  }
+
+  return keys;
+}
+
+static void
+test_browse_source_browse (GrlSource *source,
+                           GrlSourceBrowseSpec *bs)
+{
+  gint count = grl_operation_options_get_count (bs->options);
+  guint skip = grl_operation_options_get_skip (bs->options);
+  gint i;
+
+  if (count <= 0) {
+    bs->callback (source, bs->operation_id, NULL, 0, bs->user_data, NULL);
+    return;
+  }
+
+  for (i = 0; i < count; i++) {
+    GrlMedia *media = grl_media_audio_new ();
+    gchar *id = g_strdup_printf ("media-%u", skip + i);
+
+    grl_media_set_id (media, id);
+    grl_media_set_title (media, id);
+    g_free (id);
+
+    bs->callback (source, bs->operation_id, media, count - i - 1,
+                  bs->user_data, NULL);
+  }
+}
+
+static void
+test_browse_source_class_init (TestBrowseSourceClass *klass)
+{
+  GrlSourceClass *source_class = GRL_SOURCE_CLASS (klass);
+
+  source_class->supported_keys = test_browse_source_supported_keys;
+  source_class->browse = test_browse_source_browse;
+}
+
+static void
+test_browse_source_init (TestBrowseSource *source)
+{
+}
+
+/* ================ Tests ================ */
+
+typedef struct {
+  GrlSource *browse_source;
+  GMainLoop *loop;
+} OperationTableFixture;
+
+static void
+operation_table_fixture_setup (OperationTableFixture *fixture, gconstpointer data)
+{
+  fixture->loop = g_main_loop_new (NULL, TRUE);
+  fixture->browse_source = g_object_new (test_browse_source_get_type (),
+                                         "source-id", "test-browse",
+                                         "source-name", "Test browse",
+                                         NULL);
+}
+
+static void
+operation_table_fixture_teardown (OperationTableFixture *fixture, gconstpointer data)
+{
+  g_object_unref (fixture->browse_source);
+  g_main_loop_unref (fixture->loop);
+}
+
+static GrlOperationInfo *
+find_operation (GList *operations,
+                guint operation_id)
+{
+  for (; operations; operations = g_list_next (operations)) {
+    GrlOperationInfo *info = operations->data;
+    if (info->operation_id == operation_id) {
+      return info;
+    }
+  }
+
+  return NULL;
+}
+
+static void
+browse_list_active_cb (GrlSource *source,
+                       guint operation_id,
+                       GrlMedia *media,
+                       guint remaining,
+                       gpointer user_data,
+                       const GError *error)
+{
+  GMainLoop *loop = user_data;
+  GrlOperationInfo *info;
+  GList *operations;
+
+  g_assert_no_error (error);
+  g_clear_object (&media);
+
+  if (remaining == 0) {
+    operations = grl_operation_list_active ();
+    info = find_operation (operations, operation_id);
+    g_assert_nonnull (info);
+    g_assert_cmpuint (info->delivered, ==, 5);
+    g_list_free_full (operations, (GDestroyNotify) grl_operation_info_free);
+    g_main_loop_quit (loop);
+  }
+}
+
+static void
+operation_table_list_active (OperationTableFixture *fixture, gconstpointer data)
+{
+  GrlOperationOptions *options;
+  GrlOperationInfo *info;
+  GList *operations;
+  GList *keys;
+  guint operation_id;
+
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE, NULL);
+  options = grl_operation_options_new (NULL);
+  grl_operation_options_set_count (options, 5);
+
+  operation_id = grl_source_browse (fixture->browse_source, NULL, keys, options,
+                                    browse_list_active_cb, fixture->loop);
+
+  operations = grl_operation_list_active ();
+  info = find_operation (operations, operation_id);
+  g_assert_nonnull (info);
+  g_assert_cmpuint (info->operation, ==, GRL_OP_BROWSE);
+  g_assert_true (info->source == fixture->browse_source);
+  g_assert_cmpint (info->state, ==, GRL_OPERATION_STATE_QUEUED);
+  g_assert_cmpuint (info->delivered, ==, 0);
+  g_list_free_full (operations, (GDestroyNotify) grl_operation_info_free);
+
+  g_main_loop_run (fixture->loop);
+
+  /* Once finished, the operation is gone */
+  operations = grl_operation_list_active ();
+  g_assert_null (find_operation (operations, operation_id));
+  g_list_free_full (operations, (GDestroyNotify) grl_operation_info_free);
+
+  g_object_unref (options);
+  g_list_free (keys);
+}
+
+static void
+operation_table_ids (OperationTableFixture *fixture, gconstpointer data)
+{
+  GrlOperationOptions *options;
+  GHashTable *used;
+  GList *keys;
+  guint operation_id;
+  guint i;
+
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE, NULL);
+  options = grl_operation_options_new (NULL);
+  grl_operation_options_set_count (options, 5);
+  used = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  /* Identifiers of finished operations are not given to new ones, even when
+     running one operation at a time, until their slot has gone through its
+     4096 generations */
+  for (i = 0; i < 4000; i++) {
+    operation_id = grl_source_browse (fixture->browse_source, NULL, keys,
+                                      options, browse_list_active_cb,
+                                      fixture->loop);
+    g_assert_cmpuint (operation_id, !=, 0);
+    g_assert_false (g_hash_table_contains (used,
+                                           GUINT_TO_POINTER (operation_id)));
+    g_hash_table_add (used, GUINT_TO_POINTER (operation_id));
+    g_main_loop_run (fixture->loop);
+  }
+
+  g_hash_table_unref (used);
+  g_object_unref (options);
+  g_list_free (keys);
+}
+
+int
+main (int argc, char **argv)
+{
+  setlocale (LC_ALL, "");
+
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_bug_base ("http://gitlab.gnome.org/GNOME/grilo/issues/%s");
+
+  grl_init (&argc, &argv);
+
+  g_test_add ("/operation-table/list-active",
+              OperationTableFixture, NULL,
+              operation_table_fixture_setup,
+              operation_table_list_active,
+              operation_table_fixture_teardown);
+
+  g_test_add ("/operation-table/ids",
+              OperationTableFixture, NULL,
+              operation_table_fixture_setup,
+              operation_table_ids,
+              operation_table_fixture_teardown);
+
+  return g_test_run ();
+}
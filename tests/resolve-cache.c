@@ -0,0 +1,575 @@
+/*
+ * Copyright (C) 2026 Grilo Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#undef G_DISABLE_ASSERT
+
+#undef G_DISABLE_ASSERT
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+#include <glib.h>
+#include <glib-object.h>
+
+#include <grilo.h>
+
+/* ================ Browse source ================ */
+
+/* Sends "count" audio items with id and title, starting at "skip" */
+
+typedef struct {
+  GrlSource parent;
+} TestBrowseSource;
+
+typedef struct {
+  GrlSourceClass parent_class;
+} TestBrowseSourceClass;
+
+GType test_browse_source_get_type (void);
+
+G_DEFINE_TYPE (TestBrowseSource, test_browse_source, GRL_TYPE_SOURCE)
+
+static const GList *
+test_browse_source_supported_keys (GrlSource *source)
+{
+  static GList *keys = NULL;
+
+  if (!keys) {
+    keys = grl_metadata_key_list_new (GRL_METADATA_KEY_ID,
+                                      GRL_METADATA_KEY_TITLE,
+                                      NULL);
+  }
+
+  return keys;
+}
+
+static void
+test_browse_source_browse (GrlSource *source,
+                           GrlSourceBrowseSpec *bs)
+{
+  gint count = grl_operation_options_get_count (bs->options);
+  guint skip = grl_operation_options_get_skip (bs->options);
+  gint i;
+
+  if (count <= 0) {
+    bs->callback (source, bs->operation_id, NULL, 0, bs->user_data, NULL);
+    return;
+  }
+
+  for (i = 0; i < count; i++) {
+    GrlMedia *media = grl_media_audio_new ();
+    gchar *id = g_strdup_printf ("media-%u", skip + i);
+
+    grl_media_set_id (media, id);
+    grl_media_set_title (media, id);
+    g_free (id);
+
+    bs->callback (source, bs->operation_id, media, count - i - 1,
+                  bs->user_data, NULL);
+  }
+}
+
+static void
+test_browse_source_class_init (TestBrowseSourceClass *klass)
+{
+  GrlSourceClass *source_class = GRL_SOURCE_CLASS (klass);
+
+  source_class->supported_keys = test_browse_source_supported_keys;
+  source_class->browse = test_browse_source_browse;
+}
+
+static void
+test_browse_source_init (TestBrowseSource *source)
+{
+}
+
+/* ================ Decorator source ================ */
+
+/* Resolves the artist of any media, which is a slow key. Requests are answered
+   together once the default main context is idle, whatever the thread they
+   come from, in the reverse order they were received */
+
+typedef struct {
+  GrlSource parent;
+  GMutex lock;
+  GList *pending;
+  guint complete_id;
+  guint resolves;
+} TestDecoratorSource;
+
+typedef struct {
+  GrlSourceClass parent_class;
+} TestDecoratorSourceClass;
+
+GType test_decorator_source_get_type (void);
+
+G_DEFINE_TYPE (TestDecoratorSource, test_decorator_source, GRL_TYPE_SOURCE)
+
+static const GList *
+test_decorator_source_supported_keys (GrlSource *source)
+{
+  static GList *keys = NULL;
+
+  if (!keys) {
+    keys = grl_metadata_key_list_new (GRL_METADATA_KEY_ARTIST,
+                                      NULL);
+  }
+
+  return keys;
+}
+
+static gboolean
+test_decorator_source_may_resolve (GrlSource *source,
+                                   GrlMedia *media,
+                                   GrlKeyID key_id,
+                                   GList **missing_keys)
+{
+  return key_id == GRL_METADATA_KEY_ARTIST;
+}
+
+static gboolean
+test_decorator_source_complete (gpointer user_data)
+{
+  TestDecoratorSource *decorator = user_data;
+  GList *pending, *l;
+
+  g_mutex_lock (&decorator->lock);
+  pending = decorator->pending;
+  decorator->pending = NULL;
+  decorator->complete_id = 0;
+  g_mutex_unlock (&decorator->lock);
+
+  /* The list is in reverse order of arrival */
+  for (l = pending; l; l = g_list_next (l)) {
+    GrlSourceResolveSpec *rs = l->data;
+
+    grl_media_set_artist (rs->media, "artist");
+    rs->callback (rs->source, rs->operation_id, rs->media, rs->user_data, NULL);
+  }
+  g_list_free (pending);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+test_decorator_source_resolve (GrlSource *source,
+                               GrlSourceResolveSpec *rs)
+{
+  TestDecoratorSource *decorator = (TestDecoratorSource *) source;
+
+  g_mutex_lock (&decorator->lock);
+  decorator->resolves++;
+  decorator->pending = g_list_prepend (decorator->pending, rs);
+  if (!decorator->complete_id) {
+    decorator->complete_id = g_idle_add_full (G_PRIORITY_LOW,
+                                              test_decorator_source_complete,
+                                              decorator,
+                                              NULL);
+  }
+  g_mutex_unlock (&decorator->lock);
+}
+
+static void
+test_decorator_source_finalize (GObject *object)
+{
+  TestDecoratorSource *decorator = (TestDecoratorSource *) object;
+
+  g_mutex_clear (&decorator->lock);
+
+  G_OBJECT_CLASS (test_decorator_source_parent_class)->finalize (object);
+}
+
+static void
+test_decorator_source_class_init (TestDecoratorSourceClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  GrlSourceClass *source_class = GRL_SOURCE_CLASS (klass);
+
+  object_class->finalize = test_decorator_source_finalize;
+
+  source_class->supported_keys = test_decorator_source_supported_keys;
+  source_class->slow_keys = test_decorator_source_supported_keys;
+  source_class->may_resolve = test_decorator_source_may_resolve;
+  source_class->resolve = test_decorator_source_resolve;
+}
+
+static void
+test_decorator_source_init (TestDecoratorSource *source)
+{
+  g_mutex_init (&source->lock);
+}
+
+/* ================ Plan source ================ */
+
+/* Resolves the artist of any media at once, or only of those with an URL
+   starting with "prefix" if it is set, counting how many times it is asked
+   whether it can */
+
+typedef struct {
+  GrlSource parent;
+  guint may_resolves;
+  const gchar *prefix;
+} TestPlanSource;
+
+typedef struct {
+  GrlSourceClass parent_class;
+} TestPlanSourceClass;
+
+GType test_plan_source_get_type (void);
+
+G_DEFINE_TYPE (TestPlanSource, test_plan_source, GRL_TYPE_SOURCE)
+
+static gboolean
+test_plan_source_may_resolve (GrlSource *source,
+                              GrlMedia *media,
+                              GrlKeyID key_id,
+                              GList **missing_keys)
+{
+  TestPlanSource *plan_source = (TestPlanSource *) source;
+
+  plan_source->may_resolves++;
+
+  if (plan_source->prefix &&
+      !g_str_has_prefix (grl_media_get_url (media), plan_source->prefix)) {
+    return FALSE;
+  }
+
+  return key_id == GRL_METADATA_KEY_ARTIST;
+}
+
+static void
+test_plan_source_resolve (GrlSource *source,
+                          GrlSourceResolveSpec *rs)
+{
+  grl_media_set_artist (rs->media, "artist");
+  rs->callback (rs->source, rs->operation_id, rs->media, rs->user_data, NULL);
+}
+
+static void
+test_plan_source_class_init (TestPlanSourceClass *klass)
+{
+  GrlSourceClass *source_class = GRL_SOURCE_CLASS (klass);
+
+  source_class->supported_keys = test_decorator_source_supported_keys;
+  source_class->may_resolve = test_plan_source_may_resolve;
+  source_class->resolve = test_plan_source_resolve;
+}
+
+static void
+test_plan_source_init (TestPlanSource *source)
+{
+}
+
+/* ================ Tests ================ */
+
+typedef struct {
+  GrlRegistry *registry;
+  GrlPlugin *plugin;
+  GrlSource *browse_source;
+  GrlSource *decorator_source;
+  GMainLoop *loop;
+} ResolveCacheFixture;
+
+static void
+resolve_cache_fixture_setup (ResolveCacheFixture *fixture, gconstpointer data)
+{
+  GError *error = NULL;
+
+  fixture->registry = grl_registry_get_default ();
+  fixture->loop = g_main_loop_new (NULL, TRUE);
+  fixture->plugin = g_object_new (GRL_TYPE_PLUGIN, NULL);
+
+  fixture->browse_source = g_object_new (test_browse_source_get_type (),
+                                         "source-id", "test-browse",
+                                         "source-name", "Test browse",
+                                         NULL);
+  fixture->decorator_source = g_object_new (test_decorator_source_get_type (),
+                                            "source-id", "test-decorator",
+                                            "source-name", "Test decorator",
+                                            NULL);
+
+  g_object_ref (fixture->decorator_source);
+  g_assert_true (grl_registry_register_source (fixture->registry,
+                                               fixture->plugin,
+                                               fixture->decorator_source,
+                                               &error));
+  g_assert_no_error (error);
+}
+
+static void
+resolve_cache_fixture_teardown (ResolveCacheFixture *fixture, gconstpointer data)
+{
+  grl_registry_unregister_source (fixture->registry,
+                                  fixture->decorator_source,
+                                  NULL);
+  g_object_unref (fixture->decorator_source);
+  g_object_unref (fixture->browse_source);
+  g_object_unref (fixture->plugin);
+  g_main_loop_unref (fixture->loop);
+}
+
+typedef struct {
+  GMainLoop *loop;
+  guint received;
+  gboolean in_order;
+  gboolean decorated;
+} BrowseResult;
+
+static void
+browse_full_cb (GrlSource *source,
+                guint operation_id,
+                GrlMedia *media,
+                guint remaining,
+                gpointer user_data,
+                const GError *error)
+{
+  BrowseResult *result = user_data;
+
+  g_assert_no_error (error);
+  /* Results are always received in the thread that requested them */
+  g_assert_true (g_main_context_is_owner (g_main_context_default ()));
+
+  if (media) {
+    gchar *id = g_strdup_printf ("media-%u", result->received);
+
+    if (g_strcmp0 (grl_media_get_id (media), id) != 0) {
+      result->in_order = FALSE;
+    }
+    if (!grl_media_get_artist (media)) {
+      result->decorated = FALSE;
+    }
+    result->received++;
+    g_free (id);
+    g_object_unref (media);
+  }
+
+  if (remaining == 0) {
+    g_main_loop_quit (result->loop);
+  }
+}
+
+static void
+resolve_cache_browse (ResolveCacheFixture *fixture, gconstpointer data)
+{
+  TestDecoratorSource *decorator;
+  GrlOperationOptions *options;
+  GrlMedia *changed;
+  GList *keys;
+  guint i;
+  static const guint expected_resolves[] = { 50, 50, 51 };
+
+  decorator = (TestDecoratorSource *) fixture->decorator_source;
+  grl_source_set_resolve_cache_ttl (fixture->decorator_source, 60);
+
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE,
+                                    GRL_METADATA_KEY_ARTIST,
+                                    NULL);
+  options = grl_operation_options_new (NULL);
+  grl_operation_options_set_count (options, 50);
+  grl_operation_options_set_resolution_flags (options, GRL_RESOLVE_FULL);
+
+  for (i = 0; i < G_N_ELEMENTS (expected_resolves); i++) {
+    BrowseResult result = { fixture->loop, 0, TRUE, TRUE };
+
+    grl_source_browse (fixture->browse_source, NULL, keys, options,
+                       browse_full_cb, &result);
+    g_main_loop_run (fixture->loop);
+
+    g_assert_cmpuint (result.received, ==, 50);
+    g_assert_true (result.in_order);
+    g_assert_true (result.decorated);
+    /* Only the first browse and the changed media reach the decorator */
+    g_assert_cmpuint (decorator->resolves, ==, expected_resolves[i]);
+
+    if (i == 1) {
+      changed = grl_media_audio_new ();
+      grl_media_set_id (changed, "media-3");
+      grl_source_notify_change (fixture->browse_source, changed,
+                                GRL_CONTENT_CHANGED, FALSE);
+      g_object_unref (changed);
+    }
+  }
+
+  grl_source_set_resolve_cache_ttl (fixture->decorator_source, 0);
+
+  g_object_unref (options);
+  g_list_free (keys);
+}
+
+static void
+resolve_plan_cb (GrlSource *source,
+                 guint operation_id,
+                 GrlMedia *media,
+                 gpointer user_data,
+                 const GError *error)
+{
+  gboolean *done = user_data;
+
+  g_assert_no_error (error);
+  g_assert_cmpstr (grl_media_get_artist (media), ==, "artist");
+  *done = TRUE;
+}
+
+/* Resolves the artist of a new media with @url, returning how many times
+   @source was asked whether it could */
+static guint
+resolve_plan (TestPlanSource *source,
+              const gchar *url)
+{
+  GrlOperationOptions *options;
+  GrlMedia *media;
+  GList *keys;
+  gboolean done = FALSE;
+  guint may_resolves = source->may_resolves;
+
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_ARTIST, NULL);
+  options = grl_operation_options_new (NULL);
+  grl_operation_options_set_resolution_flags (options, GRL_RESOLVE_FULL);
+
+  media = grl_media_audio_new ();
+  grl_media_set_url (media, url);
+  grl_source_resolve (GRL_SOURCE (source), media, keys, options,
+                      resolve_plan_cb, &done);
+  while (!done) {
+    g_main_context_iteration (NULL, TRUE);
+  }
+
+  g_object_unref (media);
+  g_object_unref (options);
+  g_list_free (keys);
+
+  return source->may_resolves - may_resolves;
+}
+
+static void
+resolve_cache_plans (ResolveCacheFixture *fixture, gconstpointer data)
+{
+  TestPlanSource *source, *picky;
+  GrlSource *other;
+  gchar *url;
+  guint may_resolves;
+  guint i;
+
+  /* Start with sources whose answers only depend on what plans are keyed on */
+  grl_registry_unregister_source (fixture->registry,
+                                  fixture->decorator_source,
+                                  NULL);
+
+  source = g_object_new (test_plan_source_get_type (),
+                         "source-id", "test-plan",
+                         "plan-cacheable", TRUE,
+                         NULL);
+  g_object_ref (source);
+  g_assert_true (grl_registry_register_source (fixture->registry,
+                                               fixture->plugin,
+                                               GRL_SOURCE (source),
+                                               NULL));
+
+  /* Alike medias reuse the plan */
+  g_assert_cmpuint (resolve_plan (source, "http://example.com/1"), >, 0);
+  g_assert_cmpuint (resolve_plan (source, "http://example.com/2"), ==, 0);
+  g_assert_cmpuint (resolve_plan (source, "file:///music/1"), >, 0);
+
+  /* Registering a source drops the plans */
+  other = g_object_new (test_browse_source_get_type (),
+                        "source-id", "test-plan-other",
+                        NULL);
+  g_object_ref (other);
+  g_assert_true (grl_registry_register_source (fixture->registry,
+                                               fixture->plugin,
+                                               other,
+                                               NULL));
+  g_assert_cmpuint (resolve_plan (source, "http://example.com/3"), >, 0);
+  g_assert_cmpuint (resolve_plan (source, "http://example.com/4"), ==, 0);
+
+  /* And unregistering it too */
+  grl_registry_unregister_source (fixture->registry, other, NULL);
+  g_object_unref (other);
+  g_assert_cmpuint (resolve_plan (source, "http://example.com/5"), >, 0);
+
+  /* The cache is emptied once it has 64 plans */
+  for (i = 0; i <= 64; i++) {
+    url = g_strdup_printf ("scheme%u:1", i);
+    g_assert_cmpuint (resolve_plan (source, url), >, 0);
+    g_free (url);
+  }
+  g_assert_cmpuint (resolve_plan (source, "scheme64:2"), ==, 0);
+  g_assert_cmpuint (resolve_plan (source, "scheme0:2"), >, 0);
+
+  /* A source looking at anything else is asked again for each media, but
+     the rest are not */
+  picky = g_object_new (test_plan_source_get_type (),
+                        "source-id", "test-plan-picky",
+                        NULL);
+  picky->prefix = "http://example.com/";
+  g_object_ref (picky);
+  g_assert_true (grl_registry_register_source (fixture->registry,
+                                               fixture->plugin,
+                                               GRL_SOURCE (picky),
+                                               NULL));
+  g_assert_cmpuint (resolve_plan (source, "http://example.com/6"), >, 0);
+  may_resolves = picky->may_resolves;
+  g_assert_cmpuint (resolve_plan (source, "http://example.com/7"), ==, 0);
+  g_assert_cmpuint (picky->may_resolves, >, may_resolves);
+
+  /* A different answer needs another plan, and both are kept */
+  g_assert_cmpuint (resolve_plan (source, "http://example.org/1"), >, 0);
+  g_assert_cmpuint (resolve_plan (source, "http://example.org/2"), ==, 0);
+  g_assert_cmpuint (resolve_plan (source, "http://example.com/8"), ==, 0);
+
+  grl_registry_unregister_source (fixture->registry, GRL_SOURCE (picky), NULL);
+  g_object_unref (picky);
+
+  g_object_ref (fixture->decorator_source);
+  g_assert_true (grl_registry_register_source (fixture->registry,
+                                               fixture->plugin,
+                                               fixture->decorator_source,
+                                               NULL));
+
+  grl_registry_unregister_source (fixture->registry, GRL_SOURCE (source), NULL);
+  g_object_unref (source);
+}
+
+int
+main (int argc, char **argv)
+{
+  setlocale (LC_ALL, "");
+
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_bug_base ("http://gitlab.gnome.org/GNOME/grilo/issues/%s");
+
+  grl_init (&argc, &argv);
+
+  g_test_add ("/resolve-cache/browse",
+              ResolveCacheFixture, NULL,
+              resolve_cache_fixture_setup,
+              resolve_cache_browse,
+              resolve_cache_fixture_teardown);
+
+  g_test_add ("/resolve-cache/plans",
+              ResolveCacheFixture, NULL,
+              resolve_cache_fixture_setup,
+              resolve_cache_plans,
+              resolve_cache_fixture_teardown);
+
+  return g_test_run ();
+}
@@ -0,0 +1,1100 @@
+/*
+ * Copyright (C) 2026 Grilo Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#undef G_DISABLE_ASSERT
+
+#undef G_DISABLE_ASSERT
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+#include <glib.h>
+#include <glib-object.h>
+
+#include <grilo.h>
+
+/* ================ Browse source ================ */
+
+/* Sends "count" audio items with id and title, starting at "skip" */
+
+typedef struct {
+  GrlSource parent;
+} TestBrowseSource;
+
+typedef struct {
+  GrlSourceClass parent_class;
+} TestBrowseSourceClass;
+
+GType test_browse_source_get_type (void);
+
+G_DEFINE_TYPE (TestBrowseSource, test_browse_source, GRL_TYPE_SOURCE)
+
+static const GList *
+test_browse_source_supported_keys (GrlSource *source)
+{
+  static GList *keys = NULL;
+
+  if (!keys) {
+    keys = grl_metadata_key_list_new (GRL_METADATA_KEY_ID,
+                                      GRL_METADATA_KEY_TITLE,
+                                      NULL);
+  }
+
+  return keys;
+}
+
+static void
+test_browse_source_browse (GrlSource *source,
+                           GrlSourceBrowseSpec *bs)
+{
+  gint count = grl_operation_options_get_count (bs->options);
+  guint skip = grl_operation_options_get_skip (bs->options);
+  gint i;
+
+  if (count <= 0) {
+    bs->callback (source, bs->operation_id, NULL, 0, bs->user_data, NULL);
+    return;
+  }
+
+  for (i = 0; i < count; i++) {
+    GrlMedia *media = grl_media_audio_new ();
+    gchar *id = g_strdup_printf ("media-%u", skip + i);
+
+    grl_media_set_id (media, id);
+    grl_media_set_title (media, id);
+    g_free (id);
+
+    bs->callback (source, bs->operation_id, media, count - i - 1,
+                  bs->user_data, NULL);
+  }
+}
+
+static void
+test_browse_source_class_init (TestBrowseSourceClass *klass)
+{
+  GrlSourceClass *source_class = GRL_SOURCE_CLASS (klass);
+
+  source_class->supported_keys = test_browse_source_supported_keys;
+  source_class->browse = test_browse_source_browse;
+}
+
+static void
+test_browse_source_init (TestBrowseSource *source)
+{
+}
+
+/* ================ Decorator source ================ */
+
+/* Resolves the artist of any media, which is a slow key. Requests are answered
+   together once the default main context is idle, whatever the thread they
+   come from, in the reverse order they were received, unless "hang" is set */
+
+typedef struct {
+  GrlSource parent;
+  GMutex lock;
+  GList *pending;
+  guint complete_id;
+  guint max_pending;
+  guint resolves;
+  gboolean hang;
+} TestDecoratorSource;
+
+typedef struct {
+  GrlSourceClass parent_class;
+} TestDecoratorSourceClass;
+
+GType test_decorator_source_get_type (void);
+
+G_DEFINE_TYPE (TestDecoratorSource, test_decorator_source, GRL_TYPE_SOURCE)
+
+static const GList *
+test_decorator_source_supported_keys (GrlSource *source)
+{
+  static GList *keys = NULL;
+
+  if (!keys) {
+    keys = grl_metadata_key_list_new (GRL_METADATA_KEY_ARTIST,
+                                      NULL);
+  }
+
+  return keys;
+}
+
+static gboolean
+test_decorator_source_may_resolve (GrlSource *source,
+                                   GrlMedia *media,
+                                   GrlKeyID key_id,
+                                   GList **missing_keys)
+{
+  return key_id == GRL_METADATA_KEY_ARTIST;
+}
+
+static gboolean
+test_decorator_source_complete (gpointer user_data)
+{
+  TestDecoratorSource *decorator = user_data;
+  GList *pending, *l;
+
+  g_mutex_lock (&decorator->lock);
+  pending = decorator->pending;
+  decorator->pending = NULL;
+  decorator->complete_id = 0;
+  g_mutex_unlock (&decorator->lock);
+
+  /* The list is in reverse order of arrival */
+  for (l = pending; l; l = g_list_next (l)) {
+    GrlSourceResolveSpec *rs = l->data;
+
+    grl_media_set_artist (rs->media, "artist");
+    rs->callback (rs->source, rs->operation_id, rs->media, rs->user_data, NULL);
+  }
+  g_list_free (pending);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+test_decorator_source_resolve (GrlSource *source,
+                               GrlSourceResolveSpec *rs)
+{
+  TestDecoratorSource *decorator = (TestDecoratorSource *) source;
+
+  g_mutex_lock (&decorator->lock);
+  decorator->resolves++;
+  decorator->pending = g_list_prepend (decorator->pending, rs);
+  decorator->max_pending = MAX (decorator->max_pending,
+                                g_list_length (decorator->pending));
+  if (!decorator->complete_id && !decorator->hang) {
+    decorator->complete_id = g_idle_add_full (G_PRIORITY_LOW,
+                                              test_decorator_source_complete,
+                                              decorator,
+                                              NULL);
+  }
+  g_mutex_unlock (&decorator->lock);
+}
+
+static void
+test_decorator_source_finalize (GObject *object)
+{
+  TestDecoratorSource *decorator = (TestDecoratorSource *) object;
+
+  g_mutex_clear (&decorator->lock);
+
+  G_OBJECT_CLASS (test_decorator_source_parent_class)->finalize (object);
+}
+
+static void
+test_decorator_source_class_init (TestDecoratorSourceClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  GrlSourceClass *source_class = GRL_SOURCE_CLASS (klass);
+
+  object_class->finalize = test_decorator_source_finalize;
+
+  source_class->supported_keys = test_decorator_source_supported_keys;
+  source_class->slow_keys = test_decorator_source_supported_keys;
+  source_class->may_resolve = test_decorator_source_may_resolve;
+  source_class->resolve = test_decorator_source_resolve;
+}
+
+static void
+test_decorator_source_init (TestDecoratorSource *source)
+{
+  g_mutex_init (&source->lock);
+}
+
+/* ================ Batch decorator source ================ */
+
+/* Resolves the artist of any media but those titled "unknown". Several
+   medias are answered at once, when the main context is idle */
+
+typedef struct {
+  GrlSource parent;
+  guint batches;
+  guint batched_medias;
+} TestBatchSource;
+
+typedef struct {
+  GrlSourceClass parent_class;
+} TestBatchSourceClass;
+
+GType test_batch_source_get_type (void);
+
+G_DEFINE_TYPE (TestBatchSource, test_batch_source, GRL_TYPE_SOURCE)
+
+static void
+test_batch_source_resolve (GrlSource *source,
+                           GrlSourceResolveSpec *rs)
+{
+  grl_media_set_artist (rs->media, "artist");
+  rs->callback (rs->source, rs->operation_id, rs->media, rs->user_data, NULL);
+}
+
+static gboolean
+test_batch_source_may_resolve (GrlSource *source,
+                               GrlMedia *media,
+                               GrlKeyID key_id,
+                               GList **missing_keys)
+{
+  return key_id == GRL_METADATA_KEY_ARTIST &&
+    g_strcmp0 (grl_media_get_title (media), "unknown") != 0;
+}
+
+static gboolean
+test_batch_source_complete (gpointer user_data)
+{
+  GrlSourceResolveBatchSpec *rbs = user_data;
+  guint i;
+
+  for (i = 0; i < rbs->medias->len; i++) {
+    grl_media_set_artist (g_ptr_array_index (rbs->medias, i), "artist");
+  }
+  rbs->callback (rbs->source, rbs->operation_id, rbs->medias,
+                 rbs->user_data, NULL);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+test_batch_source_resolve_batch (GrlSource *source,
+                                 GrlSourceResolveBatchSpec *rbs)
+{
+  TestBatchSource *batch_source = (TestBatchSource *) source;
+
+  batch_source->batches++;
+  batch_source->batched_medias += rbs->medias->len;
+
+  g_idle_add (test_batch_source_complete, rbs);
+}
+
+static void
+test_batch_source_class_init (TestBatchSourceClass *klass)
+{
+  GrlSourceClass *source_class = GRL_SOURCE_CLASS (klass);
+
+  source_class->supported_keys = test_decorator_source_supported_keys;
+  source_class->may_resolve = test_batch_source_may_resolve;
+  source_class->resolve = test_batch_source_resolve;
+  source_class->resolve_batch = test_batch_source_resolve_batch;
+}
+
+static void
+test_batch_source_init (TestBatchSource *source)
+{
+}
+
+/* ================ Keys source ================ */
+
+/* Supports the keys in "keys", which tests change at will */
+
+typedef struct {
+  GrlSource parent;
+  GList *keys;
+} TestKeysSource;
+
+typedef struct {
+  GrlSourceClass parent_class;
+} TestKeysSourceClass;
+
+GType test_keys_source_get_type (void);
+
+G_DEFINE_TYPE (TestKeysSource, test_keys_source, GRL_TYPE_SOURCE)
+
+static const GList *
+test_keys_source_supported_keys (GrlSource *source)
+{
+  return ((TestKeysSource *) source)->keys;
+}
+
+static void
+test_keys_source_resolve (GrlSource *source,
+                          GrlSourceResolveSpec *rs)
+{
+  rs->callback (rs->source, rs->operation_id, rs->media, rs->user_data, NULL);
+}
+
+static void
+test_keys_source_class_init (TestKeysSourceClass *klass)
+{
+  GrlSourceClass *source_class = GRL_SOURCE_CLASS (klass);
+
+  source_class->supported_keys = test_keys_source_supported_keys;
+  source_class->resolve = test_keys_source_resolve;
+}
+
+static void
+test_keys_source_init (TestKeysSource *source)
+{
+}
+
+/* ================ Tests ================ */
+
+typedef struct {
+  GrlRegistry *registry;
+  GrlPlugin *plugin;
+  GrlSource *browse_source;
+  GrlSource *decorator_source;
+  GMainLoop *loop;
+} ResolveFixture;
+
+static void
+resolve_fixture_setup (ResolveFixture *fixture, gconstpointer data)
+{
+  GError *error = NULL;
+
+  fixture->registry = grl_registry_get_default ();
+  fixture->loop = g_main_loop_new (NULL, TRUE);
+  fixture->plugin = g_object_new (GRL_TYPE_PLUGIN, NULL);
+
+  fixture->browse_source = g_object_new (test_browse_source_get_type (),
+                                         "source-id", "test-browse",
+                                         "source-name", "Test browse",
+                                         NULL);
+  fixture->decorator_source = g_object_new (test_decorator_source_get_type (),
+                                            "source-id", "test-decorator",
+                                            "source-name", "Test decorator",
+                                            NULL);
+
+  g_object_ref (fixture->decorator_source);
+  g_assert_true (grl_registry_register_source (fixture->registry,
+                                               fixture->plugin,
+                                               fixture->decorator_source,
+                                               &error));
+  g_assert_no_error (error);
+}
+
+static void
+resolve_fixture_teardown (ResolveFixture *fixture, gconstpointer data)
+{
+  grl_registry_unregister_source (fixture->registry,
+                                  fixture->decorator_source,
+                                  NULL);
+  g_object_unref (fixture->decorator_source);
+  g_object_unref (fixture->browse_source);
+  g_object_unref (fixture->plugin);
+  g_main_loop_unref (fixture->loop);
+}
+
+typedef struct {
+  GMainLoop *loop;
+  guint received;
+  gboolean in_order;
+  gboolean decorated;
+} BrowseResult;
+
+static void
+browse_full_cb (GrlSource *source,
+                guint operation_id,
+                GrlMedia *media,
+                guint remaining,
+                gpointer user_data,
+                const GError *error)
+{
+  BrowseResult *result = user_data;
+
+  g_assert_no_error (error);
+  /* Results are always received in the thread that requested them */
+  g_assert_true (g_main_context_is_owner (g_main_context_default ()));
+
+  if (media) {
+    gchar *id = g_strdup_printf ("media-%u", result->received);
+
+    if (g_strcmp0 (grl_media_get_id (media), id) != 0) {
+      result->in_order = FALSE;
+    }
+    if (!grl_media_get_artist (media)) {
+      result->decorated = FALSE;
+    }
+    result->received++;
+    g_free (id);
+    g_object_unref (media);
+  }
+
+  if (remaining == 0) {
+    g_main_loop_quit (result->loop);
+  }
+}
+
+static void
+resolve_browse_full (ResolveFixture *fixture, gconstpointer data)
+{
+  static const guint sizes[] = { 100, 1000, 10000, 50000 };
+  GrlOperationOptions *options;
+  GList *keys;
+  guint i;
+
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE,
+                                    GRL_METADATA_KEY_ARTIST,
+                                    NULL);
+
+  for (i = 0; i < G_N_ELEMENTS (sizes); i++) {
+    BrowseResult result = { fixture->loop, 0, TRUE, TRUE };
+    gdouble elapsed;
+
+    /* Bigger pages are only useful to measure performance */
+    if (sizes[i] > 1000 && !g_test_perf ()) {
+      break;
+    }
+
+    options = grl_operation_options_new (NULL);
+    grl_operation_options_set_count (options, sizes[i]);
+    grl_operation_options_set_resolution_flags (options, GRL_RESOLVE_FULL);
+
+    g_test_timer_start ();
+    grl_source_browse (fixture->browse_source, NULL, keys, options,
+                       browse_full_cb, &result);
+    g_main_loop_run (fixture->loop);
+    elapsed = g_test_timer_elapsed ();
+
+    g_assert_cmpuint (result.received, ==, sizes[i]);
+    g_assert_true (result.in_order);
+    g_assert_true (result.decorated);
+
+    /* Readiness bookkeeping must not grow with the page size */
+    g_test_minimized_result (elapsed * G_USEC_PER_SEC / sizes[i],
+                             "%u items: %.3f usec per item",
+                             sizes[i], elapsed * G_USEC_PER_SEC / sizes[i]);
+
+    g_object_unref (options);
+  }
+
+  g_list_free (keys);
+}
+
+static void
+resolve_browse_concurrency (ResolveFixture *fixture, gconstpointer data)
+{
+  BrowseResult result = { fixture->loop, 0, TRUE, TRUE };
+  TestDecoratorSource *decorator;
+  GrlOperationOptions *options;
+  GList *keys;
+
+  decorator = (TestDecoratorSource *) fixture->decorator_source;
+  grl_source_set_resolve_concurrency (fixture->decorator_source, 4);
+
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE,
+                                    GRL_METADATA_KEY_ARTIST,
+                                    NULL);
+  options = grl_operation_options_new (NULL);
+  grl_operation_options_set_count (options, 100);
+  grl_operation_options_set_resolution_flags (options, GRL_RESOLVE_FULL);
+
+  grl_source_browse (fixture->browse_source, NULL, keys, options,
+                     browse_full_cb, &result);
+  g_main_loop_run (fixture->loop);
+
+  g_assert_cmpuint (result.received, ==, 100);
+  g_assert_true (result.in_order);
+  g_assert_true (result.decorated);
+  g_assert_cmpuint (decorator->max_pending, ==, 4);
+
+  g_object_unref (options);
+  g_list_free (keys);
+}
+
+static void
+resolve_browse_batch (ResolveFixture *fixture, gconstpointer data)
+{
+  BrowseResult result = { fixture->loop, 0, TRUE, TRUE };
+  TestBatchSource *batch_source;
+  GrlOperationOptions *options;
+  GError *error = NULL;
+  GList *keys;
+
+  /* Replace the decorator with one able to complete several elements at once */
+  grl_registry_unregister_source (fixture->registry,
+                                  fixture->decorator_source,
+                                  NULL);
+  batch_source = g_object_new (test_batch_source_get_type (),
+                               "source-id", "test-batch",
+                               "source-name", "Test batch",
+                               NULL);
+  g_object_ref (batch_source);
+  g_assert_true (grl_registry_register_source (fixture->registry,
+                                               fixture->plugin,
+                                               GRL_SOURCE (batch_source),
+                                               &error));
+  g_assert_no_error (error);
+
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE,
+                                    GRL_METADATA_KEY_ARTIST,
+                                    NULL);
+  options = grl_operation_options_new (NULL);
+  grl_operation_options_set_count (options, 100);
+  grl_operation_options_set_resolution_flags (options, GRL_RESOLVE_FULL);
+
+  grl_source_browse (fixture->browse_source, NULL, keys, options,
+                     browse_full_cb, &result);
+  g_main_loop_run (fixture->loop);
+
+  g_assert_cmpuint (result.received, ==, 100);
+  g_assert_true (result.in_order);
+  g_assert_true (result.decorated);
+  g_assert_cmpuint (batch_source->batched_medias, ==, 100);
+  g_assert_cmpuint (batch_source->batches, <, 100);
+
+  grl_registry_unregister_source (fixture->registry,
+                                  GRL_SOURCE (batch_source),
+                                  NULL);
+  g_object_unref (batch_source);
+  /* Teardown expects the decorator to be registered */
+  g_object_ref (fixture->decorator_source);
+  g_assert_true (grl_registry_register_source (fixture->registry,
+                                               fixture->plugin,
+                                               fixture->decorator_source,
+                                               &error));
+  g_assert_no_error (error);
+
+  g_object_unref (options);
+  g_list_free (keys);
+}
+
+static void
+resolve_batch_done_cb (GrlSource *source,
+                       guint operation_id,
+                       GPtrArray *medias,
+                       gpointer user_data,
+                       const GError *error)
+{
+  guint *pending = user_data;
+
+  g_assert_no_error (error);
+  (*pending)--;
+}
+
+/* Returns @n audio medias with ids "media-0"... and no artist, the last one
+   titled "unknown" */
+static GPtrArray *
+resolve_batch_medias (guint n)
+{
+  GPtrArray *medias = g_ptr_array_new_with_free_func (g_object_unref);
+  guint i;
+
+  for (i = 0; i < n; i++) {
+    GrlMedia *media = grl_media_audio_new ();
+    gchar *id = g_strdup_printf ("media-%u", i);
+
+    grl_media_set_id (media, id);
+    grl_media_set_title (media, i == n - 1 ? "unknown" : id);
+    g_free (id);
+    g_ptr_array_add (medias, media);
+  }
+
+  return medias;
+}
+
+static void
+resolve_batch_routing (ResolveFixture *fixture, gconstpointer data)
+{
+  TestBatchSource *batch_source;
+  GrlOperationOptions *options;
+  GPtrArray *first, *second;
+  GList *keys;
+  guint pending;
+  guint i;
+
+  batch_source = g_object_new (test_batch_source_get_type (),
+                               "source-id", "test-batch",
+                               NULL);
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_ARTIST, NULL);
+  options = grl_operation_options_new (NULL);
+
+  /* Elements the source may not resolve are not sent to it, and identical
+     requests running at the same time share the one sent to the source */
+  first = resolve_batch_medias (5);
+  second = resolve_batch_medias (5);
+  pending = 2;
+  grl_source_resolve_batch (GRL_SOURCE (batch_source), first, keys, options,
+                            resolve_batch_done_cb, &pending);
+  grl_source_resolve_batch (GRL_SOURCE (batch_source), second, keys, options,
+                            resolve_batch_done_cb, &pending);
+  while (pending > 0) {
+    g_main_context_iteration (NULL, TRUE);
+  }
+
+  g_assert_cmpuint (batch_source->batches, ==, 1);
+  g_assert_cmpuint (batch_source->batched_medias, ==, 4);
+  for (i = 0; i < 5; i++) {
+    const gchar *artist = i < 4 ? "artist" : NULL;
+
+    g_assert_cmpstr (grl_media_get_artist (g_ptr_array_index (first, i)), ==, artist);
+    g_assert_cmpstr (grl_media_get_artist (g_ptr_array_index (second, i)), ==, artist);
+  }
+  g_ptr_array_unref (second);
+  g_ptr_array_unref (first);
+
+  /* Elements found in the cache are not sent either */
+  grl_source_set_resolve_cache_ttl (GRL_SOURCE (batch_source), 60);
+  first = resolve_batch_medias (5);
+  pending = 1;
+  grl_source_resolve_batch (GRL_SOURCE (batch_source), first, keys, options,
+                            resolve_batch_done_cb, &pending);
+  while (pending > 0) {
+    g_main_context_iteration (NULL, TRUE);
+  }
+  g_assert_cmpuint (batch_source->batches, ==, 2);
+  g_ptr_array_unref (first);
+
+  first = resolve_batch_medias (5);
+  pending = 1;
+  grl_source_resolve_batch (GRL_SOURCE (batch_source), first, keys, options,
+                            resolve_batch_done_cb, &pending);
+  while (pending > 0) {
+    g_main_context_iteration (NULL, TRUE);
+  }
+  g_assert_cmpuint (batch_source->batches, ==, 2);
+  g_assert_cmpstr (grl_media_get_artist (g_ptr_array_index (first, 0)), ==, "artist");
+  g_ptr_array_unref (first);
+
+  grl_source_set_resolve_cache_ttl (GRL_SOURCE (batch_source), 0);
+
+  g_object_unref (options);
+  g_list_free (keys);
+  g_object_unref (batch_source);
+}
+
+static GrlOperationInfo *
+find_operation (GList *operations,
+                guint operation_id)
+{
+  for (; operations; operations = g_list_next (operations)) {
+    GrlOperationInfo *info = operations->data;
+    if (info->operation_id == operation_id) {
+      return info;
+    }
+  }
+
+  return NULL;
+}
+
+typedef struct {
+  GMainLoop *loop;
+  GPtrArray *medias;
+  guint decorated;
+  guint updated;
+  gboolean done;
+  gboolean cancel;
+} ProgressiveResult;
+
+static void
+progressive_keys_updated_cb (GrlMedia *media,
+                             GList *keys,
+                             gpointer user_data)
+{
+  ProgressiveResult *result = user_data;
+
+  g_assert_cmpuint (g_list_length (keys), ==, 1);
+  g_assert_cmpuint (GRLPOINTER_TO_KEYID (keys->data), ==, GRL_METADATA_KEY_ARTIST);
+  g_assert_nonnull (grl_media_get_artist (media));
+  result->updated++;
+
+  if (result->done && result->updated == result->medias->len) {
+    g_main_loop_quit (result->loop);
+  }
+}
+
+static void
+browse_progressive_cb (GrlSource *source,
+                       guint operation_id,
+                       GrlMedia *media,
+                       guint remaining,
+                       gpointer user_data,
+                       const GError *error)
+{
+  ProgressiveResult *result = user_data;
+
+  g_assert_no_error (error);
+
+  if (media) {
+    if (grl_media_get_artist (media)) {
+      result->decorated++;
+    }
+    g_signal_connect (media, "keys-updated",
+                      G_CALLBACK (progressive_keys_updated_cb), result);
+    g_ptr_array_add (result->medias, media);
+  }
+
+  if (remaining == 0) {
+    GList *operations;
+
+    result->done = TRUE;
+
+    /* The operation goes on while the slow keys are resolved */
+    operations = grl_operation_list_active ();
+    g_assert_nonnull (find_operation (operations, operation_id));
+    g_list_free_full (operations, (GDestroyNotify) grl_operation_info_free);
+
+    if (result->cancel) {
+      grl_operation_cancel (operation_id);
+    }
+  }
+}
+
+static void
+resolve_browse_progressive (ResolveFixture *fixture, gconstpointer data)
+{
+  ProgressiveResult result = { fixture->loop, NULL, 0, 0, FALSE, FALSE };
+  GList *operations;
+  guint operation_id;
+  gboolean listed;
+  TestDecoratorSource *decorator;
+  GrlOperationOptions *options;
+  GList *keys;
+
+  decorator = (TestDecoratorSource *) fixture->decorator_source;
+  result.medias = g_ptr_array_new_with_free_func (g_object_unref);
+
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE,
+                                    GRL_METADATA_KEY_ARTIST,
+                                    NULL);
+  options = grl_operation_options_new (NULL);
+  grl_operation_options_set_count (options, 10);
+  grl_operation_options_set_resolution_flags (options,
+                                              GRL_RESOLVE_FULL |
+                                              GRL_RESOLVE_PROGRESSIVE);
+
+  operation_id = grl_source_browse (fixture->browse_source, NULL, keys,
+                                    options, browse_progressive_cb, &result);
+  g_main_loop_run (fixture->loop);
+
+  /* Elements were sent without the slow key, and completed afterwards */
+  g_assert_true (result.done);
+  g_assert_cmpuint (result.medias->len, ==, 10);
+  g_assert_cmpuint (result.decorated, ==, 0);
+  g_assert_cmpuint (result.updated, ==, 10);
+  g_assert_cmpuint (decorator->resolves, ==, 10);
+
+  operations = grl_operation_list_active ();
+  g_assert_null (find_operation (operations, operation_id));
+  g_list_free_full (operations, (GDestroyNotify) grl_operation_info_free);
+
+  /* Cancelling after the last result stops the slow keys */
+  g_ptr_array_set_size (result.medias, 0);
+  result.done = FALSE;
+  result.cancel = TRUE;
+  result.updated = 0;
+  operation_id = grl_source_browse (fixture->browse_source, NULL, keys,
+                                    options, browse_progressive_cb, &result);
+
+  do {
+    g_main_context_iteration (NULL, TRUE);
+    operations = grl_operation_list_active ();
+    listed = find_operation (operations, operation_id) != NULL;
+    g_list_free_full (operations, (GDestroyNotify) grl_operation_info_free);
+  } while (!result.done || listed);
+
+  g_assert_cmpuint (result.medias->len, ==, 10);
+  g_assert_cmpuint (result.updated, ==, 0);
+  g_assert_cmpuint (decorator->resolves, ==, 10);
+
+  g_ptr_array_unref (result.medias);
+  g_object_unref (options);
+  g_list_free (keys);
+}
+
+typedef struct {
+  GMainLoop *loop;
+  guint received;
+  guint decorated;
+  GError *error;
+} DeadlineResult;
+
+static void
+browse_deadline_cb (GrlSource *source,
+                    guint operation_id,
+                    GrlMedia *media,
+                    guint remaining,
+                    gpointer user_data,
+                    const GError *error)
+{
+  DeadlineResult *result = user_data;
+
+  if (media) {
+    result->received++;
+    if (grl_media_get_artist (media)) {
+      result->decorated++;
+    }
+    g_object_unref (media);
+  }
+
+  if (remaining == 0) {
+    result->error = error ? g_error_copy (error) : NULL;
+    g_main_loop_quit (result->loop);
+  }
+}
+
+static void
+resolve_deadline_cb (GrlSource *source,
+                     guint operation_id,
+                     GrlMedia *media,
+                     gpointer user_data,
+                     const GError *error)
+{
+  DeadlineResult *result = user_data;
+
+  result->received++;
+  if (grl_media_get_artist (media)) {
+    result->decorated++;
+  }
+  result->error = error ? g_error_copy (error) : NULL;
+  g_main_loop_quit (result->loop);
+}
+
+static void
+resolve_deadline (ResolveFixture *fixture, gconstpointer data)
+{
+  DeadlineResult browse_result = { fixture->loop, 0, 0, NULL };
+  DeadlineResult resolve_result = { fixture->loop, 0, 0, NULL };
+  GrlOperationOptions *options;
+  GrlMedia *media;
+  GList *keys;
+
+  /* The decorator never answers */
+  ((TestDecoratorSource *) fixture->decorator_source)->hang = TRUE;
+
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE,
+                                    GRL_METADATA_KEY_ARTIST,
+                                    NULL);
+  options = grl_operation_options_new (NULL);
+  grl_operation_options_set_count (options, 20);
+  grl_operation_options_set_resolution_flags (options, GRL_RESOLVE_FULL);
+  grl_operation_options_set_deadline (options, 50);
+
+  /* Elements are sent without the keys of the decorator */
+  grl_source_browse (fixture->browse_source, NULL, keys, options,
+                     browse_deadline_cb, &browse_result);
+  g_main_loop_run (fixture->loop);
+
+  g_assert_cmpuint (browse_result.received, ==, 20);
+  g_assert_cmpuint (browse_result.decorated, ==, 0);
+  g_assert_error (browse_result.error, GRL_CORE_ERROR, GRL_CORE_ERROR_DEADLINE_EXCEEDED);
+  g_clear_error (&browse_result.error);
+
+  /* The media is sent with the keys known */
+  media = grl_media_audio_new ();
+  grl_media_set_id (media, "media-1");
+  grl_source_resolve (fixture->decorator_source, media, keys, options,
+                      resolve_deadline_cb, &resolve_result);
+  g_main_loop_run (fixture->loop);
+
+  g_assert_cmpuint (resolve_result.received, ==, 1);
+  g_assert_cmpuint (resolve_result.decorated, ==, 0);
+  g_assert_error (resolve_result.error, GRL_CORE_ERROR, GRL_CORE_ERROR_DEADLINE_EXCEEDED);
+  g_clear_error (&resolve_result.error);
+
+  g_object_unref (media);
+  g_object_unref (options);
+  g_list_free (keys);
+}
+
+typedef struct {
+  GMainLoop *loop;
+  guint pending;
+  guint resolved;
+  guint cancelled;
+} ResolveResult;
+
+static void
+resolve_shared_cb (GrlSource *source,
+                   guint operation_id,
+                   GrlMedia *media,
+                   gpointer user_data,
+                   const GError *error)
+{
+  ResolveResult *result = user_data;
+
+  if (error) {
+    g_assert_error (error, GRL_CORE_ERROR, GRL_CORE_ERROR_OPERATION_CANCELLED);
+    result->cancelled++;
+  } else if (grl_media_get_artist (media)) {
+    result->resolved++;
+  }
+
+  if (--result->pending == 0) {
+    g_main_loop_quit (result->loop);
+  }
+}
+
+static gboolean
+resolve_shared_cancel (gpointer user_data)
+{
+  grl_operation_cancel (GPOINTER_TO_UINT (user_data));
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+resolve_shared (ResolveFixture *fixture, gconstpointer data)
+{
+  TestDecoratorSource *decorator;
+  GrlOperationOptions *options;
+  GrlMedia *medias[3];
+  GList *keys;
+  guint i, operation_id = 0;
+
+  decorator = (TestDecoratorSource *) fixture->decorator_source;
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_ARTIST, NULL);
+  options = grl_operation_options_new (NULL);
+
+  for (i = 0; i < 2; i++) {
+    ResolveResult result = { fixture->loop, 3, 0, 0 };
+    guint j;
+
+    for (j = 0; j < 3; j++) {
+      medias[j] = grl_media_audio_new ();
+      grl_media_set_id (medias[j], "media-1");
+      grl_media_set_title (medias[j], "title");
+      operation_id = grl_source_resolve (fixture->decorator_source, medias[j],
+                                         keys, options,
+                                         resolve_shared_cb, &result);
+      if (j == 0 && i == 1) {
+        /* Once the requests reached the source, cancelling the one that
+           started them must not affect the others */
+        g_idle_add (resolve_shared_cancel, GUINT_TO_POINTER (operation_id));
+      }
+    }
+
+    g_main_loop_run (fixture->loop);
+
+    g_assert_cmpuint (decorator->resolves, ==, i + 1);
+    g_assert_cmpuint (result.resolved, ==, 3 - i);
+    g_assert_cmpuint (result.cancelled, ==, i);
+
+    /* The source does not touch the media of a cancelled request */
+    for (j = 0; j < 3; j++) {
+      g_assert_cmpstr (grl_media_get_title (medias[j]), ==, "title");
+      g_assert_cmpstr (grl_media_get_artist (medias[j]), ==,
+                       i == 1 && j == 0 ? NULL : "artist");
+      g_object_unref (medias[j]);
+    }
+  }
+
+  g_object_unref (options);
+  g_list_free (keys);
+}
+
+static void
+resolve_supported_keys_changed (ResolveFixture *fixture, gconstpointer data)
+{
+  TestKeysSource *source;
+  GrlMedia *media;
+
+  source = g_object_new (test_keys_source_get_type (),
+                         "source-id", "test-keys",
+                         NULL);
+  source->keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE, NULL);
+
+  media = grl_media_new ();
+  grl_media_set_source (media, "test-keys");
+
+  /* The default may_resolve() checks the supported keys */
+  g_assert_true (grl_source_may_resolve (GRL_SOURCE (source), media,
+                                         GRL_METADATA_KEY_TITLE, NULL));
+  g_assert_false (grl_source_may_resolve (GRL_SOURCE (source), media,
+                                          GRL_METADATA_KEY_ARTIST, NULL));
+
+  /* Changed in place */
+  source->keys->data = GRLKEYID_TO_POINTER (GRL_METADATA_KEY_ARTIST);
+  g_assert_false (grl_source_may_resolve (GRL_SOURCE (source), media,
+                                          GRL_METADATA_KEY_TITLE, NULL));
+  g_assert_true (grl_source_may_resolve (GRL_SOURCE (source), media,
+                                         GRL_METADATA_KEY_ARTIST, NULL));
+
+  /* Replaced by a new list, which may take the place of the old one */
+  g_list_free (source->keys);
+  source->keys = grl_metadata_key_list_new (GRL_METADATA_KEY_ARTIST,
+                                            GRL_METADATA_KEY_TITLE,
+                                            NULL);
+  g_assert_true (grl_source_may_resolve (GRL_SOURCE (source), media,
+                                         GRL_METADATA_KEY_TITLE, NULL));
+  g_assert_true (grl_source_may_resolve (GRL_SOURCE (source), media,
+                                         GRL_METADATA_KEY_ARTIST, NULL));
+
+  g_list_free (source->keys);
+  source->keys = NULL;
+  g_assert_false (grl_source_may_resolve (GRL_SOURCE (source), media,
+                                          GRL_METADATA_KEY_TITLE, NULL));
+
+  g_object_unref (media);
+  g_object_unref (source);
+}
+
+int
+main (int argc, char **argv)
+{
+  setlocale (LC_ALL, "");
+
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_bug_base ("http://gitlab.gnome.org/GNOME/grilo/issues/%s");
+
+  grl_init (&argc, &argv);
+
+  g_test_add ("/resolve/browse/full",
+              ResolveFixture, NULL,
+              resolve_fixture_setup,
+              resolve_browse_full,
+              resolve_fixture_teardown);
+
+  g_test_add ("/resolve/browse/concurrency",
+              ResolveFixture, NULL,
+              resolve_fixture_setup,
+              resolve_browse_concurrency,
+              resolve_fixture_teardown);
+
+  g_test_add ("/resolve/browse/batch",
+              ResolveFixture, NULL,
+              resolve_fixture_setup,
+              resolve_browse_batch,
+              resolve_fixture_teardown);
+
+  g_test_add ("/resolve/batch",
+              ResolveFixture, NULL,
+              resolve_fixture_setup,
+              resolve_batch_routing,
+              resolve_fixture_teardown);
+
+  g_test_add ("/resolve/browse/progressive",
+              ResolveFixture, NULL,
+              resolve_fixture_setup,
+              resolve_browse_progressive,
+              resolve_fixture_teardown);
+
+  g_test_add ("/resolve/deadline",
+              ResolveFixture, NULL,
+              resolve_fixture_setup,
+              resolve_deadline,
+              resolve_fixture_teardown);
+
+  g_test_add ("/resolve/shared",
+              ResolveFixture, NULL,
+              resolve_fixture_setup,
+              resolve_shared,
+              resolve_fixture_teardown);
+
+  g_test_add ("/resolve/supported-keys-changed",
+              ResolveFixture, NULL,
+              resolve_fixture_setup,
+              resolve_supported_keys_changed,
+              resolve_fixture_teardown);
+
+  return g_test_run ();
+}
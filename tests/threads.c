@@ -0,0 +1,587 @@
+/*
+ * Copyright (C) 2026 Grilo Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#undef G_DISABLE_ASSERT
+
+#undef G_DISABLE_ASSERT
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+#include <glib.h>
+#include <glib-object.h>
+
+#include <grilo.h>
+
+/* ================ Browse source ================ */
+
+/* Sends "count" audio items with id and title, starting at "skip", keeping
+   the thread it was last asked from */
+
+typedef struct {
+  GrlSource parent;
+  GThread *browse_thread;
+} TestBrowseSource;
+
+typedef struct {
+  GrlSourceClass parent_class;
+} TestBrowseSourceClass;
+
+GType test_browse_source_get_type (void);
+
+G_DEFINE_TYPE (TestBrowseSource, test_browse_source, GRL_TYPE_SOURCE)
+
+static const GList *
+test_browse_source_supported_keys (GrlSource *source)
+{
+  static GList *keys = NULL;
+
+  if (!keys) {
+    keys = grl_metadata_key_list_new (GRL_METADATA_KEY_ID,
+                                      GRL_METADATA_KEY_TITLE,
+                                      NULL);
+  }
+
+  return keys;
+}
+
+static void
+test_browse_source_browse (GrlSource *source,
+                           GrlSourceBrowseSpec *bs)
+{
+  gint count = grl_operation_options_get_count (bs->options);
+  guint skip = grl_operation_options_get_skip (bs->options);
+  gint i;
+
+  ((TestBrowseSource *) source)->browse_thread = g_thread_self ();
+
+  if (count <= 0) {
+    bs->callback (source, bs->operation_id, NULL, 0, bs->user_data, NULL);
+    return;
+  }
+
+  for (i = 0; i < count; i++) {
+    GrlMedia *media = grl_media_audio_new ();
+    gchar *id = g_strdup_printf ("media-%u", skip + i);
+
+    grl_media_set_id (media, id);
+    grl_media_set_title (media, id);
+    g_free (id);
+
+    bs->callback (source, bs->operation_id, media, count - i - 1,
+                  bs->user_data, NULL);
+  }
+}
+
+static void
+test_browse_source_class_init (TestBrowseSourceClass *klass)
+{
+  GrlSourceClass *source_class = GRL_SOURCE_CLASS (klass);
+
+  source_class->supported_keys = test_browse_source_supported_keys;
+  source_class->browse = test_browse_source_browse;
+}
+
+static void
+test_browse_source_init (TestBrowseSource *source)
+{
+}
+
+/* ================ Decorator source ================ */
+
+/* Resolves the artist of any media, which is a slow key. Requests are answered
+   together once the default main context is idle, whatever the thread they
+   come from, in the reverse order they were received */
+
+typedef struct {
+  GrlSource parent;
+  GMutex lock;
+  GList *pending;
+  guint complete_id;
+} TestDecoratorSource;
+
+typedef struct {
+  GrlSourceClass parent_class;
+} TestDecoratorSourceClass;
+
+GType test_decorator_source_get_type (void);
+
+G_DEFINE_TYPE (TestDecoratorSource, test_decorator_source, GRL_TYPE_SOURCE)
+
+static const GList *
+test_decorator_source_supported_keys (GrlSource *source)
+{
+  static GList *keys = NULL;
+
+  if (!keys) {
+    keys = grl_metadata_key_list_new (GRL_METADATA_KEY_ARTIST,
+                                      NULL);
+  }
+
+  return keys;
+}
+
+static gboolean
+test_decorator_source_may_resolve (GrlSource *source,
+                                   GrlMedia *media,
+                                   GrlKeyID key_id,
+                                   GList **missing_keys)
+{
+  return key_id == GRL_METADATA_KEY_ARTIST;
+}
+
+static gboolean
+test_decorator_source_complete (gpointer user_data)
+{
+  TestDecoratorSource *decorator = user_data;
+  GList *pending, *l;
+
+  g_mutex_lock (&decorator->lock);
+  pending = decorator->pending;
+  decorator->pending = NULL;
+  decorator->complete_id = 0;
+  g_mutex_unlock (&decorator->lock);
+
+  /* The list is in reverse order of arrival */
+  for (l = pending; l; l = g_list_next (l)) {
+    GrlSourceResolveSpec *rs = l->data;
+
+    grl_media_set_artist (rs->media, "artist");
+    rs->callback (rs->source, rs->operation_id, rs->media, rs->user_data, NULL);
+  }
+  g_list_free (pending);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+test_decorator_source_resolve (GrlSource *source,
+                               GrlSourceResolveSpec *rs)
+{
+  TestDecoratorSource *decorator = (TestDecoratorSource *) source;
+
+  g_mutex_lock (&decorator->lock);
+  decorator->pending = g_list_prepend (decorator->pending, rs);
+  if (!decorator->complete_id) {
+    decorator->complete_id = g_idle_add_full (G_PRIORITY_LOW,
+                                              test_decorator_source_complete,
+                                              decorator,
+                                              NULL);
+  }
+  g_mutex_unlock (&decorator->lock);
+}
+
+static void
+test_decorator_source_finalize (GObject *object)
+{
+  TestDecoratorSource *decorator = (TestDecoratorSource *) object;
+
+  g_mutex_clear (&decorator->lock);
+
+  G_OBJECT_CLASS (test_decorator_source_parent_class)->finalize (object);
+}
+
+static void
+test_decorator_source_class_init (TestDecoratorSourceClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  GrlSourceClass *source_class = GRL_SOURCE_CLASS (klass);
+
+  object_class->finalize = test_decorator_source_finalize;
+
+  source_class->supported_keys = test_decorator_source_supported_keys;
+  source_class->slow_keys = test_decorator_source_supported_keys;
+  source_class->may_resolve = test_decorator_source_may_resolve;
+  source_class->resolve = test_decorator_source_resolve;
+}
+
+static void
+test_decorator_source_init (TestDecoratorSource *source)
+{
+  g_mutex_init (&source->lock);
+}
+
+/* ================ Tests ================ */
+
+typedef struct {
+  GrlRegistry *registry;
+  GrlPlugin *plugin;
+  GrlSource *browse_source;
+  GrlSource *decorator_source;
+  GMainLoop *loop;
+} ThreadsFixture;
+
+static void
+threads_fixture_setup (ThreadsFixture *fixture, gconstpointer data)
+{
+  GError *error = NULL;
+
+  fixture->registry = grl_registry_get_default ();
+  fixture->loop = g_main_loop_new (NULL, TRUE);
+  fixture->plugin = g_object_new (GRL_TYPE_PLUGIN, NULL);
+
+  fixture->browse_source = g_object_new (test_browse_source_get_type (),
+                                         "source-id", "test-browse",
+                                         "source-name", "Test browse",
+                                         NULL);
+  fixture->decorator_source = g_object_new (test_decorator_source_get_type (),
+                                            "source-id", "test-decorator",
+                                            "source-name", "Test decorator",
+                                            NULL);
+
+  g_object_ref (fixture->decorator_source);
+  g_assert_true (grl_registry_register_source (fixture->registry,
+                                               fixture->plugin,
+                                               fixture->decorator_source,
+                                               &error));
+  g_assert_no_error (error);
+}
+
+static void
+threads_fixture_teardown (ThreadsFixture *fixture, gconstpointer data)
+{
+  grl_registry_unregister_source (fixture->registry,
+                                  fixture->decorator_source,
+                                  NULL);
+  g_object_unref (fixture->decorator_source);
+  g_object_unref (fixture->browse_source);
+  g_object_unref (fixture->plugin);
+  g_main_loop_unref (fixture->loop);
+}
+
+typedef struct {
+  GMainLoop *loop;
+  guint received;
+  gboolean in_order;
+  gboolean decorated;
+} BrowseResult;
+
+static void
+browse_full_cb (GrlSource *source,
+                guint operation_id,
+                GrlMedia *media,
+                guint remaining,
+                gpointer user_data,
+                const GError *error)
+{
+  BrowseResult *result = user_data;
+
+  g_assert_no_error (error);
+  /* Results are always received in the thread that requested them */
+  g_assert_true (g_main_context_is_owner (g_main_context_default ()));
+
+  if (media) {
+    gchar *id = g_strdup_printf ("media-%u", result->received);
+
+    if (g_strcmp0 (grl_media_get_id (media), id) != 0) {
+      result->in_order = FALSE;
+    }
+    if (!grl_media_get_artist (media)) {
+      result->decorated = FALSE;
+    }
+    result->received++;
+    g_free (id);
+    g_object_unref (media);
+  }
+
+  if (remaining == 0) {
+    g_main_loop_quit (result->loop);
+  }
+}
+
+static void
+threads_browse (ThreadsFixture *fixture, gconstpointer data)
+{
+  BrowseResult result = { fixture->loop, 0, TRUE, TRUE };
+  TestBrowseSource *browse_source;
+  GrlOperationOptions *options;
+  GList *keys;
+
+  browse_source = (TestBrowseSource *) fixture->browse_source;
+  grl_source_set_thread_safe_operations (fixture->browse_source, GRL_OP_BROWSE);
+
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE,
+                                    GRL_METADATA_KEY_ARTIST,
+                                    NULL);
+  options = grl_operation_options_new (NULL);
+  grl_operation_options_set_count (options, 100);
+  grl_operation_options_set_resolution_flags (options, GRL_RESOLVE_FULL);
+
+  grl_source_browse (fixture->browse_source, NULL, keys, options,
+                     browse_full_cb, &result);
+  g_main_loop_run (fixture->loop);
+
+  g_assert_true (browse_source->browse_thread != g_thread_self ());
+  g_assert_cmpuint (result.received, ==, 100);
+  g_assert_true (result.in_order);
+  g_assert_true (result.decorated);
+
+  g_object_unref (options);
+  g_list_free (keys);
+}
+
+typedef struct {
+  ThreadsFixture *fixture;
+  GMainContext *context;
+  GList *medias;
+  GError *error;
+  gboolean done;
+} AsyncBrowse;
+
+static void
+browse_async_cb (GObject *object,
+                 GAsyncResult *result,
+                 gpointer user_data)
+{
+  AsyncBrowse *ab = user_data;
+
+  /* Results are returned to the context of the caller */
+  g_assert_true (g_main_context_is_owner (ab->context));
+
+  ab->medias = grl_source_browse_finish (GRL_SOURCE (object), result, &ab->error);
+  ab->done = TRUE;
+}
+
+static gboolean
+browse_async_quit (gpointer user_data)
+{
+  g_main_loop_quit (user_data);
+  return FALSE;
+}
+
+static gpointer
+browse_async_thread (gpointer user_data)
+{
+  AsyncBrowse *ab = user_data;
+  GrlOperationOptions *options;
+  GList *keys;
+
+  ab->context = g_main_context_new ();
+  g_main_context_push_thread_default (ab->context);
+
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE, NULL);
+  options = grl_operation_options_new (NULL);
+  grl_operation_options_set_count (options, 5);
+
+  grl_source_browse_async (ab->fixture->browse_source, NULL, keys, options,
+                           NULL, browse_async_cb, ab);
+  while (!ab->done) {
+    g_main_context_iteration (ab->context, TRUE);
+  }
+
+  g_object_unref (options);
+  g_list_free (keys);
+  g_main_context_pop_thread_default (ab->context);
+  g_main_context_unref (ab->context);
+
+  g_idle_add (browse_async_quit, ab->fixture->loop);
+
+  return NULL;
+}
+
+static void
+threads_browse_async (ThreadsFixture *fixture, gconstpointer data)
+{
+  AsyncBrowse ab = { fixture, NULL, NULL, NULL, FALSE };
+  GrlOperationOptions *options;
+  GCancellable *cancellable;
+  GThread *thread;
+  GList *keys;
+
+  /* Started from a thread that runs its own context */
+  thread = g_thread_new ("browse-async", browse_async_thread, &ab);
+  g_main_loop_run (fixture->loop);
+  g_thread_join (thread);
+
+  g_assert_no_error (ab.error);
+  g_assert_cmpuint (g_list_length (ab.medias), ==, 5);
+  g_assert_cmpstr (grl_media_get_id (ab.medias->data), ==, "media-0");
+  g_list_free_full (ab.medias, g_object_unref);
+
+  /* Cancelled before the source is asked */
+  memset (&ab, 0, sizeof (ab));
+  ab.fixture = fixture;
+  ab.context = g_main_context_default ();
+
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE, NULL);
+  options = grl_operation_options_new (NULL);
+  cancellable = g_cancellable_new ();
+  g_cancellable_cancel (cancellable);
+
+  grl_source_browse_async (fixture->browse_source, NULL, keys, options,
+                           cancellable, browse_async_cb, &ab);
+  while (!ab.done) {
+    g_main_context_iteration (NULL, TRUE);
+  }
+
+  g_assert_error (ab.error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+  g_assert_null (ab.medias);
+  g_clear_error (&ab.error);
+
+  g_object_unref (cancellable);
+  g_object_unref (options);
+  g_list_free (keys);
+}
+
+#define STRESS_THREADS 4
+#define STRESS_BROWSES 25
+
+typedef struct {
+  ThreadsFixture *fixture;
+  gint running;
+} StressData;
+
+/* The decorator answers from the default main context, iterated by the main
+   thread, so its results must be sent back to the context of each thread */
+static gpointer
+threads_stress_thread (gpointer user_data)
+{
+  StressData *stress = user_data;
+  ThreadsFixture *fixture = stress->fixture;
+  GrlOperationOptions *options;
+  GMainContext *context;
+  GList *keys, *artist_keys, *medias, *l;
+  GrlMedia *media;
+  GError *error = NULL;
+  gchar *id;
+  guint i;
+
+  context = g_main_context_new ();
+  g_main_context_push_thread_default (context);
+
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE,
+                                    GRL_METADATA_KEY_ARTIST,
+                                    NULL);
+  artist_keys = grl_metadata_key_list_new (GRL_METADATA_KEY_ARTIST, NULL);
+  options = grl_operation_options_new (NULL);
+  grl_operation_options_set_count (options, 5);
+  grl_operation_options_set_resolution_flags (options, GRL_RESOLVE_FULL);
+
+  for (i = 0; i < STRESS_BROWSES; i++) {
+    g_assert_true (grl_registry_lookup_source (fixture->registry,
+                                               "test-decorator") ==
+                   fixture->decorator_source);
+
+    grl_operation_options_set_skip (options, i);
+    medias = grl_source_browse_sync (fixture->browse_source, NULL, keys,
+                                     options, &error);
+    g_assert_no_error (error);
+    g_assert_cmpuint (g_list_length (medias), ==, 5);
+
+    id = g_strdup_printf ("media-%u", i);
+    g_assert_cmpstr (grl_media_get_id (medias->data), ==, id);
+    g_free (id);
+    for (l = medias; l; l = g_list_next (l)) {
+      g_assert_cmpstr (grl_media_get_artist (l->data), ==, "artist");
+    }
+    g_list_free_full (medias, g_object_unref);
+
+    id = g_strdup_printf ("stress-%u", i);
+    media = grl_media_audio_new ();
+    grl_media_set_id (media, id);
+    media = grl_source_resolve_sync (fixture->decorator_source, media,
+                                     artist_keys, options, &error);
+    g_assert_no_error (error);
+    g_assert_cmpstr (grl_media_get_id (media), ==, id);
+    g_assert_cmpstr (grl_media_get_artist (media), ==, "artist");
+    g_object_unref (media);
+    g_free (id);
+  }
+
+  g_object_unref (options);
+  g_list_free (artist_keys);
+  g_list_free (keys);
+  g_main_context_pop_thread_default (context);
+  g_main_context_unref (context);
+
+  if (g_atomic_int_dec_and_test (&stress->running)) {
+    g_idle_add (browse_async_quit, fixture->loop);
+  }
+
+  return NULL;
+}
+
+static void
+count_warnings (const gchar *log_domain,
+                GLogLevelFlags log_level,
+                const gchar *message,
+                gpointer user_data)
+{
+  g_atomic_int_inc ((gint *) user_data);
+}
+
+static void
+threads_stress (ThreadsFixture *fixture, gconstpointer data)
+{
+  StressData stress = { fixture, STRESS_THREADS };
+  GThread *threads[STRESS_THREADS];
+  gint warnings = 0;
+  guint handler;
+  guint i;
+
+  /* Answering from the global default context is the normal path */
+  handler = g_log_set_handler ("Grilo", G_LOG_LEVEL_WARNING,
+                               count_warnings, &warnings);
+
+  /* Each thread runs its operations in its own context */
+  for (i = 0; i < STRESS_THREADS; i++) {
+    threads[i] = g_thread_new ("stress", threads_stress_thread, &stress);
+  }
+  g_main_loop_run (fixture->loop);
+  for (i = 0; i < STRESS_THREADS; i++) {
+    g_thread_join (threads[i]);
+  }
+
+  g_log_remove_handler ("Grilo", handler);
+  g_assert_cmpint (warnings, ==, 0);
+}
+
+int
+main (int argc, char **argv)
+{
+  setlocale (LC_ALL, "");
+
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_bug_base ("http://gitlab.gnome.org/GNOME/grilo/issues/%s");
+
+  grl_init (&argc, &argv);
+
+  g_test_add ("/threads/browse",
+              ThreadsFixture, NULL,
+              threads_fixture_setup,
+              threads_browse,
+              threads_fixture_teardown);
+
+  g_test_add ("/threads/browse-async",
+              ThreadsFixture, NULL,
+              threads_fixture_setup,
+              threads_browse_async,
+              threads_fixture_teardown);
+
+  g_test_add ("/threads/stress",
+              ThreadsFixture, NULL,
+              threads_fixture_setup,
+              threads_stress,
+              threads_fixture_teardown);
+
+  return g_test_run ();
+}
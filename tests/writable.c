@@ -0,0 +1,348 @@
+/*
+ * Copyright (C) 2026 Grilo Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#undef G_DISABLE_ASSERT
+
+#undef G_DISABLE_ASSERT
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+#include <glib.h>
+#include <glib-object.h>
+
+#include <grilo.h>
+
+/* ================ Writable source ================ */
+
+/* Keeps the titles stored, and the URLs of the medias they were stored in, by
+   media id, counting the single and batched writes. Removals are answered once the main loop is idle, and fail for
+   the media with id "locked" */
+
+typedef struct {
+  GrlSource parent;
+  GHashTable *titles;
+  GHashTable *urls;
+  guint stores;
+  guint batches;
+  GList *removing;
+  guint removes;
+  guint max_removing;
+} TestWritableSource;
+
+typedef struct {
+  GrlSourceClass parent_class;
+} TestWritableSourceClass;
+
+GType test_writable_source_get_type (void);
+
+G_DEFINE_TYPE (TestWritableSource, test_writable_source, GRL_TYPE_SOURCE)
+
+static const GList *
+test_writable_source_writable_keys (GrlSource *source)
+{
+  static GList *keys = NULL;
+
+  if (!keys) {
+    keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE, NULL);
+  }
+
+  return keys;
+}
+
+static void
+test_writable_source_write (TestWritableSource *writable,
+                            GrlMedia *media)
+{
+  g_hash_table_insert (writable->titles,
+                       g_strdup (grl_media_get_id (media)),
+                       g_strdup (grl_media_get_title (media)));
+  g_hash_table_insert (writable->urls,
+                       g_strdup (grl_media_get_id (media)),
+                       g_strdup (grl_media_get_url (media)));
+}
+
+static void
+test_writable_source_store_metadata (GrlSource *source,
+                                     GrlSourceStoreMetadataSpec *sms)
+{
+  TestWritableSource *writable = (TestWritableSource *) source;
+
+  writable->stores++;
+  test_writable_source_write (writable, sms->media);
+  sms->callback (sms->source, sms->media, NULL, sms->user_data, NULL);
+}
+
+static void
+test_writable_source_store_metadata_batch (GrlSource *source,
+                                           GrlSourceStoreMetadataBatchSpec *smbs)
+{
+  TestWritableSource *writable = (TestWritableSource *) source;
+  guint i;
+
+  writable->batches++;
+  for (i = 0; i < smbs->medias->len; i++) {
+    test_writable_source_write (writable, g_ptr_array_index (smbs->medias, i));
+  }
+  smbs->callback (smbs->source, smbs->medias, NULL, smbs->user_data, NULL);
+}
+
+static gboolean
+test_writable_source_remove_complete (gpointer user_data)
+{
+  TestWritableSource *writable = user_data;
+  GrlSourceRemoveSpec *rs;
+  GError *error;
+
+  rs = g_list_last (writable->removing)->data;
+  writable->removing = g_list_remove (writable->removing, rs);
+
+  if (g_strcmp0 (rs->media_id, "locked") == 0) {
+    error = g_error_new (GRL_CORE_ERROR, GRL_CORE_ERROR_REMOVE_FAILED,
+                         "locked");
+    rs->callback (rs->source, rs->media, rs->user_data, error);
+    g_error_free (error);
+  } else {
+    rs->callback (rs->source, rs->media, rs->user_data, NULL);
+  }
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+test_writable_source_remove (GrlSource *source,
+                             GrlSourceRemoveSpec *rs)
+{
+  TestWritableSource *writable = (TestWritableSource *) source;
+
+  writable->removes++;
+  writable->removing = g_list_prepend (writable->removing, rs);
+  writable->max_removing = MAX (writable->max_removing,
+                                g_list_length (writable->removing));
+  g_idle_add (test_writable_source_remove_complete, writable);
+}
+
+static void
+test_writable_source_finalize (GObject *object)
+{
+  TestWritableSource *writable = (TestWritableSource *) object;
+
+  g_hash_table_unref (writable->titles);
+  g_hash_table_unref (writable->urls);
+
+  G_OBJECT_CLASS (test_writable_source_parent_class)->finalize (object);
+}
+
+static void
+test_writable_source_class_init (TestWritableSourceClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  GrlSourceClass *source_class = GRL_SOURCE_CLASS (klass);
+
+  object_class->finalize = test_writable_source_finalize;
+  source_class->supported_keys = test_writable_source_writable_keys;
+  source_class->writable_keys = test_writable_source_writable_keys;
+  source_class->store_metadata = test_writable_source_store_metadata;
+  source_class->store_metadata_batch = test_writable_source_store_metadata_batch;
+  source_class->remove = test_writable_source_remove;
+}
+
+static void
+test_writable_source_init (TestWritableSource *source)
+{
+  source->titles = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                          g_free, g_free);
+  source->urls = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                        g_free, g_free);
+}
+
+/* ================ Tests ================ */
+
+static void
+store_metadata_count_cb (GrlSource *source,
+                         GrlMedia *media,
+                         GList *failed_keys,
+                         gpointer user_data,
+                         const GError *error)
+{
+  guint *stored = user_data;
+
+  g_assert_no_error (error);
+  g_assert_null (failed_keys);
+  (*stored)++;
+}
+
+static void
+writable_write_behind (void)
+{
+  TestWritableSource *writable;
+  GList *keys;
+  guint stored = 0;
+  guint i;
+  static const gchar *ids[] = { "media-1", "media-1", "media-2", "media-3" };
+  static const gchar *titles[] = { "first", "second", "other", "last" };
+
+  writable = g_object_new (test_writable_source_get_type (),
+                           "source-id", "test-writable",
+                           "source-name", "Test writable",
+                           NULL);
+  grl_source_set_write_behind (GRL_SOURCE (writable), 3, 0);
+
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE, NULL);
+
+  /* Both edits of media-1 are merged, and the three medias are written
+     together once there are three of them */
+  for (i = 0; i < G_N_ELEMENTS (ids); i++) {
+    GrlMedia *media = grl_media_audio_new ();
+    gchar *url = g_strconcat ("file:///", ids[i], NULL);
+
+    grl_media_set_id (media, ids[i]);
+    grl_media_set_url (media, url);
+    grl_media_set_title (media, titles[i]);
+    g_free (url);
+    grl_source_store_metadata (GRL_SOURCE (writable), media, keys,
+                               GRL_WRITE_NORMAL,
+                               store_metadata_count_cb, &stored);
+    g_object_unref (media);
+  }
+
+  while (stored < G_N_ELEMENTS (ids)) {
+    g_main_context_iteration (NULL, TRUE);
+  }
+
+  g_assert_cmpuint (writable->stores, ==, 0);
+  g_assert_cmpuint (writable->batches, ==, 1);
+  g_assert_cmpuint (g_hash_table_size (writable->titles), ==, 3);
+  g_assert_cmpstr (g_hash_table_lookup (writable->titles, "media-1"),
+                   ==, "second");
+  /* The source gets the rest of the media too */
+  g_assert_cmpstr (g_hash_table_lookup (writable->urls, "media-1"),
+                   ==, "file:///media-1");
+
+  g_object_unref (writable);
+  g_list_free (keys);
+}
+
+typedef struct {
+  gboolean done;
+  /* Bit i is set if the element i could not be removed */
+  guint failed;
+} RemoveBatchResult;
+
+static void
+remove_batch_cb (GrlSource *source,
+                 GPtrArray *medias,
+                 GPtrArray *errors,
+                 gpointer user_data,
+                 const GError *error)
+{
+  RemoveBatchResult *result = user_data;
+  guint i;
+
+  g_assert_error (error, GRL_CORE_ERROR, GRL_CORE_ERROR_REMOVE_FAILED);
+  g_assert_cmpuint (errors->len, ==, medias->len);
+
+  for (i = 0; i < errors->len; i++) {
+    if (g_ptr_array_index (errors, i)) {
+      g_assert_error (g_ptr_array_index (errors, i),
+                      GRL_CORE_ERROR, GRL_CORE_ERROR_REMOVE_FAILED);
+      result->failed |= 1 << i;
+    }
+  }
+  result->done = TRUE;
+}
+
+static void
+writable_remove_batch (void)
+{
+  TestWritableSource *writable;
+  GPtrArray *medias;
+  RemoveBatchResult result = { FALSE, 0 };
+  guint i;
+
+  writable = g_object_new (test_writable_source_get_type (),
+                           "source-id", "test-writable",
+                           "source-name", "Test writable",
+                           NULL);
+
+  /* The media without id does not reach the source, and the locked one
+     can not be removed */
+  medias = g_ptr_array_new_with_free_func (g_object_unref);
+  for (i = 0; i < 12; i++) {
+    GrlMedia *media = grl_media_audio_new ();
+
+    if (i == 3) {
+      grl_media_set_id (media, "locked");
+    } else if (i != 7) {
+      gchar *id = g_strdup_printf ("media-%u", i);
+
+      grl_media_set_id (media, id);
+      g_free (id);
+    }
+    g_ptr_array_add (medias, media);
+  }
+
+  grl_source_remove_batch (GRL_SOURCE (writable), medias,
+                           remove_batch_cb, &result);
+  while (!result.done) {
+    g_main_context_iteration (NULL, TRUE);
+  }
+
+  g_assert_cmphex (result.failed, ==, (1 << 3) | (1 << 7));
+  g_assert_cmpuint (writable->removes, ==, 11);
+  g_assert_cmpuint (writable->max_removing, >, 1);
+  g_assert_cmpuint (writable->max_removing, <=, 4);
+
+  /* The number of removals running at once can be changed */
+  grl_source_set_remove_concurrency (GRL_SOURCE (writable), 2);
+  writable->max_removing = 0;
+  result.done = FALSE;
+  result.failed = 0;
+  grl_source_remove_batch (GRL_SOURCE (writable), medias,
+                           remove_batch_cb, &result);
+  while (!result.done) {
+    g_main_context_iteration (NULL, TRUE);
+  }
+
+  g_assert_cmphex (result.failed, ==, (1 << 3) | (1 << 7));
+  g_assert_cmpuint (writable->removes, ==, 22);
+  g_assert_cmpuint (writable->max_removing, ==, 2);
+
+  g_ptr_array_unref (medias);
+  g_object_unref (writable);
+}
+
+int
+main (int argc, char **argv)
+{
+  setlocale (LC_ALL, "");
+
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_bug_base ("http://gitlab.gnome.org/GNOME/grilo/issues/%s");
+
+  grl_init (&argc, &argv);
+
+  g_test_add_func ("/writable/store-metadata/write-behind", writable_write_behind);
+  g_test_add_func ("/writable/remove/batch", writable_remove_batch);
+
+  return g_test_run ();
+}
@@ -37,6 +37,7 @@ static gchar *conffile = NULL;
 static GrlRegistry *registry = NULL;
 static gboolean version;
 static gboolean keys;
+static gboolean metrics;
 
 static GOptionEntry entries[] = {
   { "delay", 'd', 0,
@@ -51,6 +52,10 @@ static GOptionEntry entries[] = {
     G_OPTION_ARG_NONE, &keys,
     "List available metadata keys in the system",
     NULL },
+  { "metrics", 'M', 0,
+    G_OPTION_ARG_NONE, &metrics,
+    "Print the latencies of the sources when finishing",
+    NULL },
   { "version", 'V', 0,
     G_OPTION_ARG_NONE, &version,
     "Print version",
@@ -494,6 +499,7 @@ main (int argc, char *argv[])
 {
   GError *error = NULL;
   GOptionContext *context;
+  gchar *dump;
 
   setlocale (LC_ALL, "");
 
@@ -518,6 +524,10 @@ main (int argc, char *argv[])
 
   GRL_LOG_DOMAIN_INIT (grl_inspect_log_domain, "grl-inspect");
 
+  if (metrics) {
+    grl_metrics_set_enabled (TRUE);
+  }
+
   registry = grl_registry_get_default ();
   if (conffile) {
     grl_registry_add_config_from_file (registry, conffile, &error);
@@ -535,6 +545,12 @@ main (int argc, char *argv[])
 
   g_main_loop_run (mainloop);
 
+  if (metrics) {
+    dump = grl_metrics_dump ();
+    g_printerr ("%s", dump);
+    g_free (dump);
+  }
+
   grl_deinit ();
 
   return 0;
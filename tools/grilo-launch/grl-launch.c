@@ -34,6 +34,7 @@ static GOptionContext *context = NULL;
 static GrlMediaSerializeType serialize_type;
 static GrlRegistry *registry = NULL;
 static gboolean full;
+static gboolean metrics;
 static gboolean serialize;
 static gboolean titles;
 static gboolean version;
@@ -70,6 +71,10 @@ static GOptionEntry entries[] = {
     G_OPTION_ARG_STRING, &keys_parameter,
     "List of comma-separated keys to retrieve",
     NULL },
+  { "metrics", 'M', 0,
+    G_OPTION_ARG_NONE, &metrics,
+    "Print the latencies of the sources when finishing",
+    NULL },
   { "serialize", 'S', 0,
     G_OPTION_ARG_NONE, &serialize,
     "Serialize",
@@ -815,6 +820,7 @@ int
 main (int argc, char *argv[])
 {
   GError *error = NULL;
+  gchar *dump;
 
   setlocale (LC_ALL, "");
 
@@ -850,6 +856,10 @@ main (int argc, char *argv[])
 
   GRL_LOG_DOMAIN_INIT (grl_launch_log_domain, "grl-launch");
 
+  if (metrics) {
+    grl_metrics_set_enabled (TRUE);
+  }
+
   registry = grl_registry_get_default ();
   if (conffile) {
     grl_registry_add_config_from_file (registry, conffile, &error);
@@ -867,6 +877,12 @@ main (int argc, char *argv[])
 
   g_main_loop_run (mainloop);
 
+  if (metrics) {
+    dump = grl_metrics_dump ();
+    g_printerr ("%s", dump);
+    g_free (dump);
+  }
+
   g_option_context_free (context);
   grl_deinit ();
 